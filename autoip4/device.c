@@ -206,6 +206,8 @@ ni_autoip_device_set_request(ni_autoip_device_t *dev, const ni_auto4_request_t *
 		ni_auto4_request_destroy(&dev->request);
 		if (request)
 			ni_auto4_request_copy(&dev->request, request);
+		else
+			ni_server_interface_event_filter_del(dev->link.ifindex);
 	}
 }
 
@@ -218,6 +220,7 @@ ni_autoip_acquire(ni_autoip_device_t *dev, const ni_auto4_request_t *request)
 	if (!dev || !request)
 		return -1;
 
+	ni_server_interface_event_filter_add(dev->link.ifindex);
 	ni_autoip_device_stop(dev);
 	ni_autoip_device_set_request(dev, request);
 	ni_note("%s: Request to acquire AUTOv4 lease with UUID %s",
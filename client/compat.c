@@ -2806,7 +2806,7 @@ __ni_compat_generate_ifcfg(xml_node_t *ifnode, const ni_compat_netdev_t *compat)
 	return TRUE;
 }
 
-static xml_node_t *
+xml_node_t *
 ni_compat_generate_ifcfg(const ni_compat_netdev_t *compat, xml_document_t *doc)
 {
 	xml_node_t *ifnode, *namenode;
@@ -2827,11 +2827,31 @@ ni_compat_generate_ifcfg(const ni_compat_netdev_t *compat, xml_document_t *doc)
 	return ifnode;
 }
 
+ni_bool_t
+ni_compat_add_config_document(xml_document_array_t *array, xml_document_t *config_doc,
+				ni_client_state_config_t *conf, ni_bool_t check_prio, ni_bool_t raw)
+{
+	xml_node_t *root = xml_document_root(config_doc);
+
+	if (!raw)
+		ni_ifconfig_metadata_add_to_node(root, conf);
+
+	xml_node_location_relocate(root, conf->origin);
+
+	if (ni_ifconfig_validate_adding_doc(config_doc, check_prio)) {
+		ni_debug_ifconfig("%s: %s", __func__, xml_node_location(root));
+		xml_document_array_append(array, config_doc);
+		return TRUE;
+	}
+
+	xml_document_free(config_doc);
+	return FALSE;
+}
+
 unsigned int
 ni_compat_generate_interfaces(xml_document_array_t *array, ni_compat_ifconfig_t *ifcfg, ni_bool_t check_prio, ni_bool_t raw)
 {
 	xml_document_t *config_doc;
-	xml_node_t *root;
 	unsigned int i;
 
 	if (!ifcfg)
@@ -2843,23 +2863,12 @@ ni_compat_generate_interfaces(xml_document_array_t *array, ni_compat_ifconfig_t
 		ni_client_state_config_t *conf = &cs->config;
 
 		config_doc = xml_document_new();
-		root = xml_document_root(config_doc);
 
 		if (ni_string_empty(conf->origin))
 			ni_string_dup(&conf->origin, ifcfg->schema);
 
 		ni_compat_generate_ifcfg(compat, config_doc);
-		if (!raw)
-			ni_ifconfig_metadata_add_to_node(root, conf);
-
-		xml_node_location_relocate(root, conf->origin);
-
-		if (ni_ifconfig_validate_adding_doc(config_doc, check_prio)) {
-			ni_debug_ifconfig("%s: %s", __func__, xml_node_location(root));
-			xml_document_array_append(array, config_doc);
-		} else {
-			xml_document_free(config_doc);
-		}
+		ni_compat_add_config_document(array, config_doc, conf, check_prio, raw);
 	}
 
 	return i;
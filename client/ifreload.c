@@ -47,11 +47,123 @@
 #include "ifreload.h"
 #include "ifstatus.h"
 
+/*
+ * Delta apply: a changed config which differs only in settings the up
+ * run re-applies in place (e.g. linkUp changes the mtu, requestLease
+ * updates the addresses and routes of the lease) does not need an
+ * ifdown, which would bounce the link.
+ */
+typedef enum {
+	NI_IFRELOAD_DELTA_INPLACE,	/* up run applies the change	*/
+	NI_IFRELOAD_DELTA_ADDRCONF,	/* drop leases, keep the link	*/
+	NI_IFRELOAD_DELTA_FULL,		/* regular ifdown		*/
+} ni_ifreload_delta_t;
+
+/* bonding options the kernel refuses to change while enslaved or up */
+static const char *	ni_ifreload_bond_down_options[] = {
+	"mode", "slaves", "fail-over-mac", "xmit-hash-policy", "lacp-rate",
+	"ad-select", "min-links", "tlb-dynamic-lb", NULL
+};
+
+static ni_bool_t
+ni_ifreload_node_equal(const xml_node_t *a, const xml_node_t *b)
+{
+	char *sa, *sb;
+	ni_bool_t equal;
+
+	if (!a || !b)
+		return a == b;
+
+	sa = xml_node_sprint(a);
+	sb = xml_node_sprint(b);
+	equal = ni_string_eq(sa, sb);
+	ni_string_free(&sa);
+	ni_string_free(&sb);
+	return equal;
+}
+
+static ni_bool_t
+ni_ifreload_children_differ(const xml_node_t *a, const xml_node_t *b, const char **names)
+{
+	for ( ; *names; ++names) {
+		if (!ni_ifreload_node_equal(xml_node_get_child(a, *names),
+					xml_node_get_child(b, *names)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_ifreload_delta_t
+ni_ifreload_node_delta(const char *ifname, const char *name,
+			const xml_node_t *old, const xml_node_t *new)
+{
+	static const char *link_down_options[] = { "master", "port", NULL };
+
+	if (ni_ifreload_node_equal(old, new))
+		return NI_IFRELOAD_DELTA_INPLACE;
+
+	ni_debug_application("%s: <%s> config changed", ifname, name);
+
+	/* client side settings and sysctls */
+	if (ni_string_eq(name, "control") || ni_string_eq(name, "dependencies") ||
+	    ni_string_eq(name, "scripts") || ni_string_eq(name, "ipv4") ||
+	    ni_string_eq(name, "ipv6"))
+		return NI_IFRELOAD_DELTA_INPLACE;
+
+	/* ethtool settings are applied by changeDevice */
+	if (ni_string_eq(name, "ethernet") || ni_string_eq(name, "ethtool"))
+		return NI_IFRELOAD_DELTA_INPLACE;
+
+	/* mtu, txqlen, ... are applied by linkUp, not a new master */
+	if (ni_string_eq(name, "link"))
+		return old && new && !ni_ifreload_children_differ(old, new, link_down_options) ?
+			NI_IFRELOAD_DELTA_INPLACE : NI_IFRELOAD_DELTA_FULL;
+
+	if (ni_string_eq(name, "bond"))
+		return old && new && !ni_ifreload_children_differ(old, new,
+						ni_ifreload_bond_down_options) ?
+			NI_IFRELOAD_DELTA_INPLACE : NI_IFRELOAD_DELTA_FULL;
+
+	/* requestLease replaces the lease, a removed one has to be dropped */
+	if (!strncmp(name, "ipv4:", 5) || !strncmp(name, "ipv6:", 5))
+		return new ? NI_IFRELOAD_DELTA_INPLACE : NI_IFRELOAD_DELTA_ADDRCONF;
+
+	return NI_IFRELOAD_DELTA_FULL;
+}
+
+static ni_ifreload_delta_t
+ni_ifreload_worker_delta(ni_ifworker_t *w)
+{
+	ni_ifreload_delta_t delta = NI_IFRELOAD_DELTA_INPLACE, d;
+	xml_node_t *old, *child;
+
+	if (!w->device || !(old = ni_ifworker_applied_config(w))) {
+		ni_debug_application("%s: applied config unknown", w->name);
+		return NI_IFRELOAD_DELTA_FULL;
+	}
+
+	for (child = w->config.node->children; child; child = child->next) {
+		d = ni_ifreload_node_delta(w->name, child->name,
+				xml_node_get_child(old, child->name), child);
+		if (d > delta)
+			delta = d;
+	}
+	for (child = old->children; child; child = child->next) {
+		if (xml_node_get_child(w->config.node, child->name))
+			continue;
+		d = ni_ifreload_node_delta(w->name, child->name, child, NULL);
+		if (d > delta)
+			delta = d;
+	}
+	xml_node_free(old);
+	return delta;
+}
+
 static int
 ni_do_ifreload_direct(int argc, char **argv)
 {
 	enum  { OPT_HELP, OPT_IFCONFIG, OPT_PERSISTENT, OPT_TRANSIENT,
-		OPT_TIMEOUT,
+		OPT_TIMEOUT, OPT_DELTA,
 #ifdef NI_TEST_HACKS
 		OPT_IGNORE_PRIO, OPT_IGNORE_STARTMODE,
 #endif
@@ -62,6 +174,7 @@ ni_do_ifreload_direct(int argc, char **argv)
 		{ "ifconfig",		required_argument,	NULL,	OPT_IFCONFIG },
 		{ "timeout",		required_argument,	NULL,	OPT_TIMEOUT },
 		{ "transient",		no_argument,		NULL,	OPT_TRANSIENT },
+		{ "delta",		no_argument,		NULL,	OPT_DELTA },
 #ifdef NI_TEST_HACKS
 		{ "ignore-prio",	no_argument,		NULL, 	OPT_IGNORE_PRIO },
 		{ "ignore-startmode",	no_argument,		NULL,	OPT_IGNORE_STARTMODE },
@@ -78,6 +191,7 @@ ni_do_ifreload_direct(int argc, char **argv)
 	ni_bool_t check_prio = TRUE;
 	ni_bool_t opt_persistent = FALSE;
 	ni_bool_t opt_transient = FALSE;
+	ni_bool_t opt_delta = FALSE;
 	unsigned int opt_timeout = 0;
 	int c, status = NI_WICKED_RC_USAGE;
 	unsigned int nmarked, i;
@@ -122,6 +236,10 @@ ni_do_ifreload_direct(int argc, char **argv)
 			opt_transient = TRUE;
 			break;
 
+		case OPT_DELTA:
+			opt_delta = TRUE;
+			break;
+
 		case OPT_TIMEOUT:
 			if (!strcmp(optarg, "infinite")) {
 				opt_timeout = NI_IFWORKER_INFINITE_TIMEOUT;
@@ -148,6 +266,8 @@ usage:
 				"      Read interface configuration(s) from file\n"
 				"  --timeout <sec>\n"
 				"      Timeout after <sec> seconds\n"
+				"  --delta\n"
+				"      Apply changes in place when no ifdown is required\n"
 #ifdef NI_TEST_HACKS
 				"  --ignore-prio\n"
 				"      Ignore checking the config origin priorities\n"
@@ -297,6 +417,24 @@ usage:
 					"device is not configured by wicked", w->name);
 				continue;
 			}
+			if (opt_delta) {
+				switch (ni_ifreload_worker_delta(w)) {
+				case NI_IFRELOAD_DELTA_INPLACE:
+					ni_info("skipping ifdown operation for %s interface: "
+						"changes are applied in place", w->name);
+					continue;
+
+				case NI_IFRELOAD_DELTA_ADDRCONF:
+					ni_info("%s: dropping leases only", w->name);
+					w->target_range.min = NI_FSM_STATE_NONE;
+					w->target_range.max = NI_FSM_STATE_LLDP_UP;
+					nmarked++;
+					continue;
+
+				default:
+					break;
+				}
+			}
 			w->target_range.min = NI_FSM_STATE_NONE;
 			switch (w->iftype) {
 			case NI_IFTYPE_TEAM:
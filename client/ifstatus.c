@@ -48,6 +48,7 @@
 #include <wicked/fsm.h>
 
 #include "wicked-client.h"
+#include "client/ifconfig.h"
 #include "appconfig.h"
 #include "ifcheck.h"
 #include "ifstatus.h"
@@ -635,11 +636,157 @@ ni_ifstatus_to_retcode(int status, ni_bool_t mandatory)
 	}
 }
 
+static int
+ni_ifstatus_result_code(const ni_uint_array_t *stcodes, const ni_uint_array_t *stflags,
+			ni_bool_t multiple, ni_bool_t opt_transient)
+{
+	int status = NI_WICKED_ST_OK;
+	unsigned int i;
+
+	if (!stcodes->count) {
+		status = NI_WICKED_ST_UNUSED;
+	} else
+	if (!multiple) {
+		status = stcodes->data[0];
+		if (!opt_transient) {
+			switch (status) {
+			case NI_WICKED_ST_NO_DEVICE:
+			case NI_WICKED_ST_UNCONFIGURED:
+			case NI_WICKED_ST_NOT_RUNNING:
+			case NI_WICKED_ST_IN_PROGRESS:
+				break;
+			default:
+				status = NI_WICKED_ST_OK;
+				break;
+			}
+		}
+	} else
+	for (i = 0; i < stcodes->count && i < stflags->count; ++i) {
+		unsigned int st = stcodes->data[i];
+		unsigned int fl = stflags->data[i];
+		int rc = ni_ifstatus_to_retcode(st, fl);
+		if (rc == NI_WICKED_ST_FAILED)
+			status = rc;
+	}
+	return status;
+}
+
+/*
+ * Build a device from the state returned by the nanny getStatus call,
+ * containing just what the status checks above are looking at.
+ */
+static ni_netdev_t *
+ni_ifstatus_cached_device(const char *ifname, const ni_dbus_variant_t *dict)
+{
+	const ni_dbus_variant_t *var, *leases;
+	ni_addrconf_lease_t *lease;
+	uint32_t value, family, type;
+	const char *master;
+	ni_netdev_t *dev;
+	unsigned int i;
+
+	/* no device in the nanny's worker */
+	if (!ni_dbus_dict_get_uint32(dict, "status", &value))
+		return NULL;
+
+	dev = ni_netdev_new(ifname, 0);
+	dev->link.ifflags = value;
+	if (ni_dbus_dict_get_uint32(dict, "type", &value))
+		dev->link.type = value;
+	if (ni_dbus_dict_get_string(dict, "master", &master))
+		ni_netdev_ref_set_ifname(&dev->link.masterdev, master);
+
+	if ((var = ni_dbus_dict_get(dict, "client-state")))
+		ni_objectmodel_netif_client_state_from_dict(ni_netdev_get_client_state(dev), var);
+
+	leases = ni_dbus_dict_get(dict, "leases");
+	if (!leases || !ni_dbus_variant_is_dict_array(leases))
+		return dev;
+
+	for (i = 0; i < leases->array.len; ++i) {
+		var = &leases->variant_array_value[i];
+		if (!ni_dbus_dict_get_uint32(var, "family", &family) ||
+		    !ni_dbus_dict_get_uint32(var, "type", &type))
+			continue;
+
+		lease = ni_addrconf_lease_new(type, family);
+		if (ni_dbus_dict_get_uint32(var, "state", &value))
+			lease->state = value;
+		if (ni_dbus_dict_get_uint32(var, "flags", &value))
+			lease->flags = value;
+		if (ni_netdev_set_lease(dev, lease) < 0)
+			ni_addrconf_lease_free(lease);
+	}
+	return dev;
+}
+
+/*
+ * Show the status using the nanny's already warm fsm instead of
+ * refreshing all devices and loading the configs in this process.
+ * Returns -1 when the nanny is not available to fall back.
+ */
+static int
+ni_ifstatus_cached(const ni_string_array_t *ifnames, ni_bool_t multiple,
+			ni_bool_t quiet, ni_bool_t opt_transient, ni_bool_t check_config)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_uint_array_t   stcodes = NI_UINT_ARRAY_INIT;
+	ni_uint_array_t   stflags = NI_UINT_ARRAY_INIT;
+	const ni_dbus_variant_t *dict;
+	ni_tristate_t link_required;
+	const char *ifname;
+	ni_netdev_t *dev;
+	unsigned int i;
+	uint32_t value;
+	int status;
+
+	if (!ni_config_use_nanny() || !ni_nanny_call_get_status(ifnames, &result))
+		return -1;
+
+	for (i = 0; (dict = ni_dbus_dict_get_entry(&result, i, &ifname)); ++i) {
+		ni_bool_t mandatory = TRUE;
+		unsigned int st;
+
+		dev = ni_ifstatus_cached_device(ifname, dict);
+		st = ni_ifstatus_of_device(dev, &mandatory);
+
+		/* as ni_ifcheck_worker_device_link_required */
+		if (check_config) {
+			link_required = NI_TRISTATE_DEFAULT;
+			if (ni_dbus_dict_get_uint32(dict, "link-required", &value))
+				link_required = (int)value;
+			if (!ni_tristate_is_set(link_required) && dev)
+				link_required = ni_netdev_guess_link_required(dev);
+			if (!ni_tristate_is_disabled(link_required))
+				mandatory = TRUE;
+		}
+		ni_netdev_put(dev);
+
+		ni_uint_array_append(&stcodes, st);
+		ni_uint_array_append(&stflags, mandatory);
+		if (!quiet)
+			ni_ifstatus_show_status(ifname, st);
+	}
+
+	if (stcodes.count == 0) {
+		if (!quiet)
+			printf("ifstatus: no matching interfaces\n");
+		status = NI_WICKED_ST_NO_DEVICE;
+	} else {
+		status = ni_ifstatus_result_code(&stcodes, &stflags, multiple, opt_transient);
+	}
+
+	ni_uint_array_destroy(&stcodes);
+	ni_uint_array_destroy(&stflags);
+	ni_dbus_variant_destroy(&result);
+	return status;
+}
+
 int
 ni_do_ifstatus(int argc, char **argv)
 {
 	enum  { OPT_QUIET, OPT_BRIEF, OPT_NORMAL, OPT_VERBOSE,
-		OPT_HELP, OPT_SHOW, OPT_IFCONFIG, OPT_TRANSIENT };
+		OPT_HELP, OPT_SHOW, OPT_IFCONFIG, OPT_TRANSIENT, OPT_CACHED };
 	static struct option ifcheck_options[] = {
 		{ "help",         no_argument,       NULL, OPT_HELP        },
 		{ "quiet",        no_argument,       NULL, OPT_QUIET       },
@@ -647,6 +794,7 @@ ni_do_ifstatus(int argc, char **argv)
 		{ "verbose",      no_argument,       NULL, OPT_VERBOSE     },
 		{ "ifconfig",     required_argument, NULL, OPT_IFCONFIG    },
 		{ "transient",    no_argument,       NULL, OPT_TRANSIENT },
+		{ "cached",       no_argument,       NULL, OPT_CACHED      },
 
 		{ NULL,           no_argument,       NULL, 0               }
 	};
@@ -659,6 +807,7 @@ ni_do_ifstatus(int argc, char **argv)
 	ni_bool_t         multiple = FALSE;
 	ni_bool_t         all = FALSE;
 	ni_bool_t         opt_transient = FALSE;
+	ni_bool_t         opt_cached = FALSE;
 	ni_bool_t         check_config;
 	ni_fsm_t *        fsm;
 	unsigned int      i, nmarked;
@@ -697,6 +846,8 @@ ni_do_ifstatus(int argc, char **argv)
 				"      Show only a brief status, no additional info\n"
 				"  --verbose\n"
 				"      Show a more detailed information\n"
+				"  --cached\n"
+				"      Query the brief status from the nanny service\n"
 				"\n"
 				"  --ifconfig <filename>\n"
 				"      Read interface configuration(s) from file\n"
@@ -717,6 +868,10 @@ ni_do_ifstatus(int argc, char **argv)
 		case OPT_TRANSIENT:
 			opt_transient = TRUE;
 			break;
+
+		case OPT_CACHED:
+			opt_cached = TRUE;
+			break;
 		}
 	}
 
@@ -728,6 +883,29 @@ ni_do_ifstatus(int argc, char **argv)
 			goto usage;
 	}
 
+	/* The nanny knows the status of the devices it manages and
+	 * their configs, unless we have to read them from a file. */
+	if (opt_cached && opt_ifconfig.count == 0) {
+		for (c = optind; c < argc; ++c) {
+			if (ni_string_eq(argv[c], "all")) {
+				ni_string_array_destroy(&ifnames);
+				all = TRUE;
+				break;
+			}
+			if (ni_string_array_index(&ifnames, argv[c]) == -1)
+				ni_string_array_append(&ifnames, argv[c]);
+		}
+
+		status = ni_ifstatus_cached(&ifnames, ifnames.count > 1 || all,
+				opt_verbose == OPT_QUIET, opt_transient, check_config);
+		if (status >= 0)
+			goto cleanup;
+
+		ni_debug_application("nanny status not available, refreshing state");
+		ni_string_array_destroy(&ifnames);
+		all = FALSE;
+	}
+
 	if (!ni_fsm_create_client(fsm)) {
 		/* Severe error we always explicitly return */
 		status = NI_WICKED_ST_ERROR;
@@ -821,33 +999,7 @@ ni_do_ifstatus(int argc, char **argv)
 		goto cleanup;
 	}
 
-	if (!stcodes.count) {
-		if (status == NI_WICKED_ST_OK) {
-			status = NI_WICKED_ST_UNUSED;
-		}
-	} else
-	if (!multiple) {
-		status = stcodes.data[0];
-		if (!opt_transient) {
-			switch (status) {
-			case NI_WICKED_ST_NO_DEVICE:
-			case NI_WICKED_ST_UNCONFIGURED:
-			case NI_WICKED_ST_NOT_RUNNING:
-			case NI_WICKED_ST_IN_PROGRESS:
-				break;
-			default:
-				status = NI_WICKED_ST_OK;
-				break;
-			}
-		}
-	} else
-	for (i = 0; i < stcodes.count && i < stflags.count; ++i) {
-		unsigned int st = stcodes.data[i];
-		unsigned int fl = stflags.data[i];
-		int rc = ni_ifstatus_to_retcode(st, fl);
-		if (rc == NI_WICKED_ST_FAILED)
-			status = rc;
-	}
+	status = ni_ifstatus_result_code(&stcodes, &stflags, multiple, opt_transient);
 
 cleanup:
 	ni_uint_array_destroy(&stcodes);
@@ -937,33 +1089,7 @@ ni_ifstatus_display_result(ni_fsm_t *fsm, ni_string_array_t *names, ni_ifworker_
 		ni_ifstatus_show_status(w->name, st);
 	}
 
-	if (!stcodes.count) {
-		if (status == NI_WICKED_ST_OK) {
-			status = NI_WICKED_ST_UNUSED;
-		}
-	} else
-	if (!multiple) {
-		status = stcodes.data[0];
-		if (!opt_transient) {
-			switch (status) {
-			case NI_WICKED_ST_NO_DEVICE:
-			case NI_WICKED_ST_UNCONFIGURED:
-			case NI_WICKED_ST_NOT_RUNNING:
-			case NI_WICKED_ST_IN_PROGRESS:
-				break;
-			default:
-				status = NI_WICKED_ST_OK;
-				break;
-			}
-		}
-	} else
-	for (i = 0; i < stcodes.count && i < stflags.count; ++i) {
-		unsigned int st = stcodes.data[i];
-		unsigned int fl = stflags.data[i];
-		int rc = ni_ifstatus_to_retcode(st, fl);
-		if (rc == NI_WICKED_ST_FAILED)
-			status = rc;
-	}
+	status = ni_ifstatus_result_code(&stcodes, &stflags, multiple, opt_transient);
 
 	return status;
 }
@@ -103,6 +103,7 @@ extern int		do_lease(int, char **);
 extern int		do_check(int, char **);
 static int		do_xpath(int, char **);
 static int		do_get_names(int, char **);
+static int		do_metrics(int, char **);
 static int		do_convert(int, char **);
 
 static void
@@ -173,6 +174,7 @@ main(int argc, char **argv)
 				"  show-config [options]\n"
 				"  convert     [options]\n"
 				"  getnames    [options]\n"
+				"  metrics     [options]\n"
 				"  xpath       [options] expr ...\n"
 				"  ethtool     [options] <ifname> <...>\n"
 				"  nanny       <action> ...\n"
@@ -313,6 +315,9 @@ main(int argc, char **argv)
 	if (!strcmp(cmd, "getnames")) {
 		status = do_get_names(argc - optind, argv + optind);
 	} else
+	if (!strcmp(cmd, "metrics")) {
+		status = do_metrics(argc - optind, argv + optind);
+	} else
 	if (!strcmp(cmd, "convert")) {
 		status = do_convert(argc - optind, argv + optind);
 	} else
@@ -1526,6 +1531,127 @@ out:
 	return rv;
 }
 
+/*
+ * Show the runtime metrics of one of the wicked daemons
+ */
+static const struct metrics_service {
+	const char *	name;
+	const char *	bus_name;
+	const char *	object_path;
+} metrics_services[] = {
+	{ "wickedd",	NI_OBJECTMODEL_DBUS_BUS_NAME,		NI_OBJECTMODEL_OBJECT_PATH		},
+	{ "nanny",	NI_OBJECTMODEL_DBUS_BUS_NAME_NANNY,	NI_OBJECTMODEL_NANNY_PATH		},
+	{ "dhcp4",	NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP4,	NI_OBJECTMODEL_OBJECT_ROOT "/DHCP4"	},
+	{ "dhcp6",	NI_OBJECTMODEL_DBUS_BUS_NAME_DHCP6,	NI_OBJECTMODEL_OBJECT_ROOT "/DHCP6"	},
+	{ "auto4",	NI_OBJECTMODEL_DBUS_BUS_NAME_AUTO4,	NI_OBJECTMODEL_OBJECT_ROOT "/AUTO4"	},
+	{ NULL }
+};
+
+static void
+do_metrics_print_histogram(const char *name, const ni_dbus_variant_t *dict)
+{
+	const ni_dbus_variant_t *buckets, *var;
+	uint64_t count = 0, sum = 0, value;
+	const char *bound;
+	unsigned int i;
+
+	ni_dbus_dict_get_uint64(dict, "count", &count);
+	ni_dbus_dict_get_uint64(dict, "sum", &sum);
+	printf("%-28s count %llu, sum %llu, avg %llu\n", name,
+			(unsigned long long)count, (unsigned long long)sum,
+			(unsigned long long)(count ? sum / count : 0));
+
+	if (!(buckets = ni_dbus_dict_get(dict, "buckets")))
+		return;
+	for (i = 0; (var = ni_dbus_dict_get_entry(buckets, i, &bound)); ++i) {
+		if (!ni_dbus_variant_get_uint64(var, &value))
+			continue;
+		if (ni_string_eq(bound, "inf"))
+			printf("    %-24s %llu\n", "larger", (unsigned long long)value);
+		else
+			printf("    < %-22s %llu\n", bound, (unsigned long long)value);
+	}
+}
+
+int
+do_metrics(int argc, char **argv)
+{
+	enum  { OPT_HELP, OPT_SERVICE };
+	static struct option local_options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP },
+		{ "service",	required_argument,	NULL,	OPT_SERVICE },
+		{ NULL }
+	};
+	const struct metrics_service *svc = &metrics_services[0];
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	const ni_dbus_variant_t *var;
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *root;
+	const char *name;
+	uint64_t value;
+	unsigned int i;
+	int c;
+
+	optind = 1;
+	while ((c = getopt_long(argc, argv, "", local_options, NULL)) != EOF) {
+		switch (c) {
+		case OPT_SERVICE:
+			for (svc = metrics_services; svc->name; ++svc) {
+				if (ni_string_eq(svc->name, optarg))
+					break;
+			}
+			if (!svc->name) {
+				fprintf(stderr, "Unknown service \"%s\"\n", optarg);
+				goto usage;
+			}
+			break;
+
+		default:
+		case OPT_HELP:
+		usage:
+			fprintf(stderr,
+				"wicked [options] metrics [options]\n"
+				"\nSupported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				"  --service <wickedd|nanny|dhcp4|dhcp6|auto4>\n"
+				"      Query the metrics of the given daemon (default: wickedd).\n"
+				);
+			return NI_WICKED_RC_USAGE;
+		}
+	}
+	if (optind != argc)
+		goto usage;
+
+	if (!(client = ni_create_dbus_client(svc->bus_name))) {
+		ni_error("Unable to connect to %s dbus service", svc->name);
+		return NI_WICKED_RC_ERROR;
+	}
+	root = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class,
+				svc->object_path, NI_OBJECTMODEL_METRICS_INTERFACE, NULL);
+
+	if (!ni_dbus_object_call_variant(root, NI_OBJECTMODEL_METRICS_INTERFACE,
+				"getMetrics", 0, NULL, 1, &result, &error)) {
+		ni_dbus_print_error(&error, "%s.getMetrics() failed", svc->object_path);
+		dbus_error_free(&error);
+		ni_dbus_client_free(client);
+		return NI_WICKED_RC_ERROR;
+	}
+
+	for (i = 0; (var = ni_dbus_dict_get_entry(&result, i, &name)); ++i) {
+		if (ni_dbus_variant_is_dict(var))
+			do_metrics_print_histogram(name, var);
+		else
+		if (ni_dbus_variant_get_uint64(var, &value))
+			printf("%-28s %llu\n", name, (unsigned long long)value);
+	}
+
+	ni_dbus_variant_destroy(&result);
+	ni_dbus_client_free(client);
+	return NI_WICKED_RC_SUCCESS;
+}
+
 /*
  * The check for routability is implemented as a simple
  * UDP connect, which should return immediately, since no
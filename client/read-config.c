@@ -35,6 +35,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/param.h>
 
 #include <wicked/util.h>
@@ -43,10 +45,12 @@
 
 #include "wicked-client.h"
 #include "client/ifconfig.h"
+#include "util_priv.h"
 
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
-extern ni_bool_t	__ni_suse_get_ifconfig(const char *, const char *,
-						ni_compat_ifconfig_t *);
+extern ni_bool_t	__ni_suse_read_ifconfig(xml_document_array_t *, const char *,
+						const char *, const char *,
+						ni_bool_t, ni_bool_t);
 #endif
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
 extern ni_bool_t	__ni_redhat_get_ifconfig(const char *, const char *,
@@ -110,6 +114,12 @@ static ni_bool_t	ni_ifconfig_read_firmware(xml_document_array_t *,
 						const char *,
 						ni_bool_t,
 						ni_bool_t);
+static ni_bool_t	ni_ifconfig_read_firmware_finish(xml_document_array_t *,
+						const char *,
+						const char *,
+						ni_firmware_discovery_t *,
+						ni_bool_t,
+						ni_bool_t);
 
 static const ni_ifconfig_type_t *
 __ni_ifconfig_find_map(const ni_ifconfig_type_t *map, const char *name, size_t len)
@@ -199,19 +209,70 @@ static const ni_ifconfig_type_t	__ni_ifconfig_types[] = {
 	{ NULL,		{ .guess= ni_ifconfig_guess_type	} },
 };
 
+/*
+ * Files in a wicked xml config directory are parsed by a few threads
+ * when there are enough of them; 0 uses one per cpu, up to the max.
+ */
+#define NI_IFCONFIG_READ_THREADS_MAX	4
+#define NI_IFCONFIG_READ_THREADS_FILES	8
+
+static unsigned int	ni_ifconfig_read_threads;
+
+void
+ni_ifconfig_set_read_threads(unsigned int threads)
+{
+	ni_ifconfig_read_threads = threads;
+}
+
+static const char *
+ni_ifconfig_firmware_path(const char *path)
+{
+	size_t len = strcspn(path, ":");
+
+	if (path[len] != ':' || len != sizeof("firmware") - 1)
+		return NULL;
+	if (strncasecmp(path, "firmware", len))
+		return NULL;
+	return path + len + 1;
+}
+
 ni_bool_t
 ni_ifconfig_load(ni_fsm_t *fsm, const char *root, ni_string_array_t *opt_ifconfig, ni_bool_t check_prio, ni_bool_t raw)
 {
 	xml_document_array_t docs = XML_DOCUMENT_ARRAY_INIT;
+	ni_firmware_discovery_t **fwd;
+	ni_bool_t rv = TRUE;
+	const char *path;
 	unsigned int i;
 
+	/* The firmware discovery scripts run while we're reading the
+	 * other sources; their result is still merged in source order.
+	 */
+	fwd = xcalloc(opt_ifconfig->count + 1, sizeof(*fwd));
 	for (i = 0; i < opt_ifconfig->count; ++i) {
-		if (!ni_ifconfig_read(&docs, root, opt_ifconfig->data[i], check_prio, raw)) {
-			xml_document_array_destroy(&docs);
-			return FALSE;
+		if ((path = ni_ifconfig_firmware_path(opt_ifconfig->data[i])))
+			fwd[i] = ni_netconfig_firmware_discovery_start(root, path);
+	}
+
+	for (i = 0; rv && i < opt_ifconfig->count; ++i) {
+		if ((path = ni_ifconfig_firmware_path(opt_ifconfig->data[i]))) {
+			rv = ni_ifconfig_read_firmware_finish(&docs, "firmware", path,
+					fwd[i], check_prio, raw);
+			fwd[i] = NULL;
+		} else {
+			rv = ni_ifconfig_read(&docs, root, opt_ifconfig->data[i], check_prio, raw);
 		}
 	}
 
+	for (i = 0; i < opt_ifconfig->count; ++i)
+		xml_document_free(ni_netconfig_firmware_discovery_finish(fwd[i]));
+	free(fwd);
+
+	if (!rv) {
+		xml_document_array_destroy(&docs);
+		return FALSE;
+	}
+
 	for (i = 0; i < docs.count; i++) {
 		xml_node_t *root, *ifnode;
 		const char *origin;
@@ -384,25 +445,14 @@ ni_ifconfig_validate_adding_doc(xml_document_t *config_doc, ni_bool_t check_prio
 /*
  * Read ifconfig
  */
-static ni_bool_t
-ni_ifconfig_read_wicked_xml_file(xml_document_array_t *docs, const char *type,
-			const char *root, const char *pathname, ni_bool_t check_prio, ni_bool_t raw)
+static void
+ni_ifconfig_read_wicked_xml_doc(xml_document_array_t *docs, const char *type,
+			const char *pathname, xml_document_t *config_doc,
+			ni_bool_t check_prio, ni_bool_t raw)
 {
 	ni_client_state_config_t conf = NI_CLIENT_STATE_CONFIG_INIT;
-	char pathbuf[PATH_MAX] = {'\0'};
-	xml_document_t *config_doc;
 	xml_node_t *rnode, *cnode, *next;
 
-	if (!ni_string_empty(root)) {
-		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, pathname);
-		pathname = pathbuf;
-	}
-
-	if (!(config_doc = xml_document_read(pathname))) {
-		ni_error("unable to load interface definition from %s", pathname);
-		return FALSE;
-	}
-
 	/* Modify shared location in the document to use origin */
 	rnode = xml_document_root(config_doc);
 	ni_ifconfig_format_origin(&conf.origin, type, pathname);
@@ -439,7 +489,114 @@ ni_ifconfig_read_wicked_xml_file(xml_document_array_t *docs, const char *type,
 
 	ni_client_state_config_reset(&conf);
 	xml_document_free(config_doc);
+}
+
+static ni_bool_t
+ni_ifconfig_read_wicked_xml_file(xml_document_array_t *docs, const char *type,
+			const char *root, const char *pathname, ni_bool_t check_prio, ni_bool_t raw)
+{
+	char pathbuf[PATH_MAX] = {'\0'};
+	xml_document_t *config_doc;
+
+	if (!ni_string_empty(root)) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, pathname);
+		pathname = pathbuf;
+	}
+
+	if (!(config_doc = xml_document_read(pathname))) {
+		ni_error("unable to load interface definition from %s", pathname);
+		return FALSE;
+	}
+
+	ni_ifconfig_read_wicked_xml_doc(docs, type, pathname, config_doc, check_prio, raw);
+	return TRUE;
+}
+
+/*
+ * Parse the files of a config directory in parallel. The threads
+ * only run xml_document_read; everything else (migration, priority
+ * validation) is done by the caller in file order.
+ */
+typedef struct ni_ifconfig_xml_reader {
+	pthread_mutex_t			lock;
+	unsigned int			next;
+	const char *			dirname;
+	const ni_string_array_t *	files;
+	xml_document_t **		result;
+} ni_ifconfig_xml_reader_t;
+
+static void *
+ni_ifconfig_xml_reader_run(void *arg)
+{
+	ni_ifconfig_xml_reader_t *reader = arg;
+	char pathbuf[PATH_MAX];
+	unsigned int i;
+
+	for (;;) {
+		pthread_mutex_lock(&reader->lock);
+		i = reader->next++;
+		pthread_mutex_unlock(&reader->lock);
+
+		if (i >= reader->files->count)
+			break;
+
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", reader->dirname,
+				reader->files->data[i]);
+		reader->result[i] = xml_document_read(pathbuf);
+	}
+	return NULL;
+}
+
+static unsigned int
+ni_ifconfig_xml_reader_threads(unsigned int files)
+{
+	unsigned int threads = ni_ifconfig_read_threads;
+	long cpus;
+
+	if (files < NI_IFCONFIG_READ_THREADS_FILES)
+		return 1;
+
+	if (!threads) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? cpus : 1;
+	}
+	if (threads > NI_IFCONFIG_READ_THREADS_MAX)
+		threads = NI_IFCONFIG_READ_THREADS_MAX;
+	if (threads > files / 2)
+		threads = files / 2;
+	return threads ? threads : 1;
+}
+
+static ni_bool_t
+ni_ifconfig_xml_reader_parse(const char *dirname, const ni_string_array_t *files,
+			xml_document_t **result)
+{
+	ni_ifconfig_xml_reader_t reader;
+	pthread_t tid[NI_IFCONFIG_READ_THREADS_MAX];
+	unsigned int i, count, threads;
+
+	threads = ni_ifconfig_xml_reader_threads(files->count);
+	if (threads <= 1)
+		return FALSE;
+
+	memset(&reader, 0, sizeof(reader));
+	pthread_mutex_init(&reader.lock, NULL);
+	reader.dirname = dirname;
+	reader.files = files;
+	reader.result = result;
+
+	/* the calling thread is one of the readers */
+	for (count = 0; count < threads - 1; ++count) {
+		if (pthread_create(&tid[count], NULL, ni_ifconfig_xml_reader_run, &reader))
+			break;
+	}
+	ni_ifconfig_xml_reader_run(&reader);
+	for (i = 0; i < count; ++i)
+		pthread_join(tid[i], NULL);
 
+	pthread_mutex_destroy(&reader.lock);
+	ni_debug_ifconfig("%s: parsed %u files using %u threads",
+			dirname, files->count, count + 1);
 	return TRUE;
 }
 
@@ -448,7 +605,9 @@ ni_ifconfig_read_wicked_xml_dir(xml_document_array_t *docs, const char *type,
 			const char *root, const char *pathname, ni_bool_t check_prio, ni_bool_t raw)
 {
 	char pathbuf[PATH_MAX] = {'\0'};
+	char *filename = NULL;
 	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	xml_document_t **result = NULL;
 	unsigned int i;
 	ni_bool_t empty = TRUE;
 
@@ -460,11 +619,31 @@ ni_ifconfig_read_wicked_xml_dir(xml_document_array_t *docs, const char *type,
 	}
 
 	if (ni_scandir(pathname, "*.xml", &files) != 0) {
+		result = xcalloc(files.count, sizeof(*result));
+		if (!ni_ifconfig_xml_reader_parse(pathname, &files, result)) {
+			free(result);
+			result = NULL;
+		}
+
 		for (i = 0; i < files.count; ++i) {
 			/* Ignore wrong xml config files - warning only */
-			if (ni_ifconfig_read_wicked_xml_file(docs, type, pathname, files.data[i], check_prio, raw))
-				empty = FALSE;
+			if (!result) {
+				if (ni_ifconfig_read_wicked_xml_file(docs, type, pathname,
+							files.data[i], check_prio, raw))
+					empty = FALSE;
+				continue;
+			}
+
+			ni_string_printf(&filename, "%s/%s", pathname, files.data[i]);
+			if (!result[i]) {
+				ni_error("unable to load interface definition from %s", filename);
+				continue;
+			}
+			ni_ifconfig_read_wicked_xml_doc(docs, type, filename, result[i], check_prio, raw);
+			empty = FALSE;
 		}
+		ni_string_free(&filename);
+		free(result);
 	}
 
 	if (empty)
@@ -544,17 +723,8 @@ ni_bool_t
 ni_ifconfig_read_compat_suse(xml_document_array_t *array, const char *type,
 			const char *root, const char *path, ni_bool_t check_prio, ni_bool_t raw)
 {
-	ni_compat_ifconfig_t conf;
-	ni_bool_t rv;
-
-	ni_compat_ifconfig_init(&conf, type);
-
 	/* TODO: apply timeout */
-	if ((rv = __ni_suse_get_ifconfig(root, path, &conf))) {
-		ni_compat_generate_interfaces(array, &conf, check_prio, raw);
-	}
-	ni_compat_ifconfig_destroy(&conf);
-	return rv;
+	return __ni_suse_read_ifconfig(array, type, root, path, check_prio, raw);
 }
 #endif
 
@@ -608,15 +778,16 @@ ni_ifconfig_read_compat(xml_document_array_t *array, const char *type,
 	return FALSE;
 }
 
-ni_bool_t
-ni_ifconfig_read_firmware(xml_document_array_t *array, const char *type,
-			const char *root, const char *path, ni_bool_t check_prio, ni_bool_t raw)
+static ni_bool_t
+ni_ifconfig_read_firmware_finish(xml_document_array_t *array, const char *type,
+			const char *path, ni_firmware_discovery_t *fwd,
+			ni_bool_t check_prio, ni_bool_t raw)
 {
 	xml_document_t *config_doc;
 	ni_client_state_config_t conf = NI_CLIENT_STATE_CONFIG_INIT;
 	xml_node_t *rnode, *cnode, *next;
 
-	config_doc = ni_netconfig_firmware_discovery(root, path);
+	config_doc = ni_netconfig_firmware_discovery_finish(fwd);
 	if (!config_doc) {
 		ni_error("unable to get firmware interface definitions from %s:%s",
 			type, path);
@@ -660,6 +831,15 @@ ni_ifconfig_read_firmware(xml_document_array_t *array, const char *type,
 	return TRUE;
 }
 
+ni_bool_t
+ni_ifconfig_read_firmware(xml_document_array_t *array, const char *type,
+			const char *root, const char *path, ni_bool_t check_prio, ni_bool_t raw)
+{
+	return ni_ifconfig_read_firmware_finish(array, type, path,
+			ni_netconfig_firmware_discovery_start(root, path),
+			check_prio, raw);
+}
+
 const char *
 ni_ifconfig_format_origin(char **origin, const char *schema, const char *path)
 {
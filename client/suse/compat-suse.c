@@ -38,7 +38,9 @@
 #include <net/ethernet.h>
 #include <netlink/netlink.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 #include <pwd.h>
 #include <grp.h>
 
@@ -281,6 +283,487 @@ done:
 	return success;
 }
 
+/*
+ * Compiled ifcfg cache
+ *
+ * The generated interface XML is stored per ifcfg file together with a
+ * stamp (inode, size, mtime and ctime) of the files it has been read from:
+ * the ifcfg-<name>, ifroute-<name>, ifrule-<name> and ifsysctl-<name>.
+ * The stamp of the global files (config, dhcp, routes, sysctl files, ...)
+ * is the cache key -- any change there discards the whole cache.
+ *
+ * Bond, bridge and ovs masters and their slaves/ports are adjusted using
+ * the other ifcfg files (__ni_suse_adjust_slaves), so any change affecting
+ * such a "shared" file causes a full reparse. Other files are re-parsed
+ * only when their stamp changes.
+ */
+#define __NI_SUSE_CACHE_FILE			"compat-suse-cache.xml"
+#define __NI_SUSE_CACHE_VERSION			"1"
+
+static ni_bool_t		__ni_suse_cache_enabled = TRUE;
+
+ni_bool_t
+__ni_suse_ifconfig_cache_enable(ni_bool_t enable)
+{
+	ni_bool_t old = __ni_suse_cache_enabled;
+
+	__ni_suse_cache_enabled = enable;
+	return old;
+}
+
+static const char *
+__ni_suse_cache_filename(char *buf, size_t size)
+{
+	snprintf(buf, size, "%s/%s", ni_config_storedir(), __NI_SUSE_CACHE_FILE);
+	return buf;
+}
+
+void
+__ni_suse_ifconfig_cache_drop(void)
+{
+	char filename[PATH_MAX];
+
+	unlink(__ni_suse_cache_filename(filename, sizeof(filename)));
+}
+
+static void
+__ni_suse_cache_stamp(ni_stringbuf_t *buf, const char *filename)
+{
+	struct stat st;
+
+	if (stat(filename, &st) < 0) {
+		ni_stringbuf_puts(buf, "-;");
+		return;
+	}
+	ni_stringbuf_printf(buf, "%lx:%lx:%lx.%lx:%lx.%lx;",
+			(unsigned long)st.st_ino, (unsigned long)st.st_size,
+			(unsigned long)st.st_mtim.tv_sec, (unsigned long)st.st_mtim.tv_nsec,
+			(unsigned long)st.st_ctim.tv_sec, (unsigned long)st.st_ctim.tv_nsec);
+}
+
+static void
+__ni_suse_cache_stamp_dir(ni_stringbuf_t *buf, const char *dirname, const char *pattern)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	char pathbuf[PATH_MAX];
+	unsigned int i;
+
+	__ni_suse_cache_stamp(buf, dirname);
+	if (!ni_isdir(dirname) || !ni_scandir(dirname, pattern, &names))
+		return;
+
+	for (i = 0; i < names.count; ++i) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", dirname, names.data[i]);
+		ni_stringbuf_printf(buf, "%s=", names.data[i]);
+		__ni_suse_cache_stamp(buf, pathbuf);
+	}
+	ni_string_array_destroy(&names);
+}
+
+static char *
+__ni_suse_cache_globals(const char *schema, const char *root, const char *real)
+{
+	const char *hostnames[] = __NI_SUSE_HOSTNAME_FILES, **name;
+	const char *sysctldirs[] = __NI_SUSE_SYSCTL_DIRS, **sysctld;
+	const char *globals[] = {
+		__NI_SUSE_CONFIG_GLOBAL, __NI_SUSE_CONFIG_DHCP,
+		__NI_SUSE_ROUTES_GLOBAL, __NI_SUSE_IFSYSCTL_FILE,
+		NULL
+	};
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	char pathbuf[PATH_MAX];
+	struct utsname u;
+
+	ni_stringbuf_printf(&buf, "%s|%s|%s|%s|", __NI_SUSE_CACHE_VERSION,
+			schema, root, real);
+
+	for (name = globals; *name; ++name) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", real, *name);
+		__ni_suse_cache_stamp(&buf, pathbuf);
+	}
+	snprintf(pathbuf, sizeof(pathbuf), "%s/providers", real);
+	__ni_suse_cache_stamp_dir(&buf, pathbuf, "*");
+
+	for (name = hostnames; *name; ++name) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *name);
+		__ni_suse_cache_stamp(&buf, pathbuf);
+	}
+
+	memset(&u, 0, sizeof(u));
+	if (uname(&u) == 0) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s%s", root,
+				__NI_SUSE_SYSCTL_BOOT, u.release);
+		__ni_suse_cache_stamp(&buf, pathbuf);
+	}
+	for (sysctld = sysctldirs; *sysctld; ++sysctld) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *sysctld);
+		__ni_suse_cache_stamp_dir(&buf, pathbuf, "*"__NI_SUSE_SYSCTL_SUFFIX);
+	}
+	snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, __NI_SUSE_SYSCTL_FILE);
+	__ni_suse_cache_stamp(&buf, pathbuf);
+
+	ni_stringbuf_puts(&buf, ni_isdir(__NI_SUSE_PROC_IPV6_DIR) ? "ipv6;" : "-;");
+
+	/* dhcp and addrconf defaults from the wicked config */
+	__ni_suse_cache_stamp_dir(&buf, ni_get_global_config_dir(), "*.xml");
+
+	return buf.string;
+}
+
+static char *
+__ni_suse_cache_file_stamp(const char *real, const char *filename)
+{
+	const char *prefixes[] = {
+		__NI_SUSE_CONFIG_IFPREFIX, __NI_SUSE_ROUTES_IFPREFIX,
+		"ifrule-", __NI_SUSE_IFSYSCTL_FILE"-",
+		NULL
+	}, **prefix;
+	const char *ifname = filename + (sizeof(__NI_SUSE_CONFIG_IFPREFIX)-1);
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	char pathbuf[PATH_MAX];
+
+	for (prefix = prefixes; *prefix; ++prefix) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s%s", real, *prefix, ifname);
+		__ni_suse_cache_stamp(&buf, pathbuf);
+	}
+	return buf.string;
+}
+
+static ni_bool_t
+__ni_suse_cache_shared(const ni_compat_netdev_t *compat)
+{
+	switch (compat->dev->link.type) {
+	case NI_IFTYPE_BOND:
+	case NI_IFTYPE_BRIDGE:
+	case NI_IFTYPE_OVS_BRIDGE:
+	case NI_IFTYPE_OVS_SYSTEM:
+		return TRUE;
+	default:
+		return !ni_string_empty(compat->dev->link.masterdev.name);
+	}
+}
+
+static xml_node_t *
+__ni_suse_cache_entry(xml_node_t *cache, const char *name)
+{
+	return xml_node_get_child_with_attrs(cache, "ifcfg",
+			&(ni_var_array_t) { .count = 1, .data = &(ni_var_t) {
+				.name = "name", .value = (char *)name } });
+}
+
+static xml_node_t *
+__ni_suse_cache_file_entry(xml_node_t *cache, const char *real, const char *name)
+{
+	xml_node_t *entry;
+	char *stamp;
+
+	entry = xml_node_new("ifcfg", cache);
+	xml_node_add_attr(entry, "name", name);
+	stamp = __ni_suse_cache_file_stamp(real, name);
+	xml_node_add_attr(entry, "stamp", stamp);
+	ni_string_free(&stamp);
+	return entry;
+}
+
+/*
+ * Add the generated interface XML of a compat netdev to its file entry
+ */
+static void
+__ni_suse_cache_add(xml_node_t *cache, ni_compat_netdev_t *compat)
+{
+	ni_client_state_t *cs = ni_netdev_get_client_state(compat->dev);
+	const char *origin = cs->config.origin;
+	const char *name = ni_basename(origin);
+	xml_document_t *doc;
+	xml_node_t *entry, *node, *root;
+
+	if (ni_string_empty(name))
+		return;
+
+	/* slaves and ovs-system may be created without an ifcfg file */
+	if (!(entry = __ni_suse_cache_entry(cache, name))) {
+		entry = xml_node_new("ifcfg", cache);
+		xml_node_add_attr(entry, "name", name);
+	}
+	if (__ni_suse_cache_shared(compat))
+		xml_node_add_attr(entry, "shared", "true");
+
+	doc = xml_document_new();
+	ni_compat_generate_ifcfg(compat, doc);
+
+	node = xml_node_new("document", entry);
+	xml_node_add_attr(node, "ifname", compat->dev->name);
+	xml_node_add_attr(node, "origin", origin);
+	root = xml_document_root(doc);
+	while (root->children)
+		xml_node_reparent(node, root->children);
+	xml_document_free(doc);
+}
+
+static ni_bool_t
+__ni_suse_cache_write(xml_document_t *doc)
+{
+	char filename[PATH_MAX];
+	char tempname[PATH_MAX + sizeof(".XXXXXX")];
+	FILE *fp;
+	int fd, ret;
+
+	__ni_suse_cache_filename(filename, sizeof(filename));
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
+
+	/* unique per process; mode 0600, ifcfg files may contain secrets */
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_warn("unable to create ifcfg cache temp file %s: %m", tempname);
+		return FALSE;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		ni_warn("unable to write ifcfg cache %s: %m", tempname);
+		close(fd);
+		unlink(tempname);
+		return FALSE;
+	}
+	ret = xml_document_print(doc, fp);
+	if (fclose(fp) < 0 || ret < 0 || rename(tempname, filename) < 0) {
+		ni_warn("unable to write ifcfg cache %s: %m", filename);
+		unlink(tempname);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Re-parse changed ifcfg files without shared interfaces and update
+ * their entries. Returns FALSE when a full reparse is required.
+ */
+static ni_bool_t
+__ni_suse_cache_update(xml_node_t *cache, const char *schema, const char *root,
+			const char *path, const char *real, const ni_string_array_t *files,
+			ni_bool_t *modified)
+{
+	ni_string_array_t changed = NI_STRING_ARRAY_INIT;
+	ni_string_array_t slaves = NI_STRING_ARRAY_INIT;
+	ni_string_array_t derived = NI_STRING_ARRAY_INIT;
+	ni_compat_netdev_array_t netdevs;
+	xml_node_t *entry, *next, *node;
+	char pathbuf[PATH_MAX];
+	const char *name;
+	ni_bool_t ret = FALSE;
+	unsigned int i;
+	char *stamp;
+
+	ni_compat_netdev_array_init(&netdevs);
+
+	for (entry = cache->children; entry; entry = next) {
+		next = entry->next;
+		name = xml_node_get_attr(entry, "name");
+
+		if (xml_node_get_attr(entry, "shared")) {
+			for (node = entry->children; node; node = node->next)
+				ni_string_array_append(&slaves, xml_node_get_attr(node, "ifname"));
+		}
+
+		if (!xml_node_get_attr(entry, "stamp"))
+			continue;
+		if (ni_string_array_index(files, name) >= 0)
+			continue;
+
+		ni_debug_readwrite("ifcfg cache: %s removed", name);
+		if (xml_node_get_attr(entry, "shared"))
+			goto done;
+		xml_node_delete_child_node(cache, entry);
+		*modified = TRUE;
+	}
+
+	for (i = 0; i < files->count; ++i) {
+		name = files->data[i];
+		entry = __ni_suse_cache_entry(cache, name);
+		stamp = __ni_suse_cache_file_stamp(real, name);
+
+		if (!entry || !ni_string_eq(stamp, xml_node_get_attr(entry, "stamp"))) {
+			ni_debug_readwrite("ifcfg cache: %s changed", name);
+			if (entry && xml_node_get_attr(entry, "shared")) {
+				ni_string_free(&stamp);
+				goto done;
+			}
+			ni_string_array_append(&changed, name);
+		}
+		ni_string_free(&stamp);
+	}
+
+	if (!changed.count) {
+		ret = TRUE;
+		goto done;
+	}
+
+	if (!__ni_suse_read_globals(root, path, real))
+		goto done;
+
+	for (i = 0; i < changed.count; ++i) {
+		ni_compat_netdev_t *compat;
+
+		name = changed.data[i];
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", real, name);
+		if (!(compat = __ni_suse_read_interface(pathbuf,
+				name + (sizeof(__NI_SUSE_CONFIG_IFPREFIX)-1))))
+			continue;
+
+		ni_compat_netdev_set_origin(compat, schema, pathbuf);
+		ni_compat_netdev_array_append(&netdevs, compat);
+
+		if (__ni_suse_cache_shared(compat) ||
+		    ni_string_array_index(&slaves, compat->dev->name) >= 0)
+			goto done;
+	}
+
+	for (i = 0; i < changed.count; ++i) {
+		if ((entry = __ni_suse_cache_entry(cache, changed.data[i])))
+			xml_node_delete_child_node(cache, entry);
+		__ni_suse_cache_file_entry(cache, real, changed.data[i]);
+	}
+	for (i = 0; i < netdevs.count; ++i)
+		__ni_suse_cache_add(cache, netdevs.data[i]);
+
+	/* keep the file order, followed by entries without own file */
+	for (entry = cache->children; entry; entry = next) {
+		next = entry->next;
+		if (!xml_node_get_attr(entry, "stamp"))
+			ni_string_array_append(&derived, xml_node_get_attr(entry, "name"));
+	}
+	for (i = 0; i < files->count; ++i) {
+		if ((entry = __ni_suse_cache_entry(cache, files->data[i])))
+			xml_node_reparent(cache, entry);
+	}
+	for (i = 0; i < derived.count; ++i) {
+		if ((entry = __ni_suse_cache_entry(cache, derived.data[i])))
+			xml_node_reparent(cache, entry);
+	}
+
+	*modified = TRUE;
+	ret = TRUE;
+
+done:
+	__ni_suse_free_globals();
+	ni_compat_netdev_array_destroy(&netdevs);
+	ni_string_array_destroy(&changed);
+	ni_string_array_destroy(&slaves);
+	ni_string_array_destroy(&derived);
+	return ret;
+}
+
+static xml_document_t *
+__ni_suse_cache_build(const char *schema, const char *root, const char *path,
+			const char *real, const ni_string_array_t *files,
+			const char *globals)
+{
+	extern unsigned int ni_wait_for_interfaces;
+	ni_compat_ifconfig_t conf;
+	xml_document_t *doc = NULL;
+	xml_node_t *cache;
+	unsigned int i;
+
+	ni_compat_ifconfig_init(&conf, schema);
+	if (__ni_suse_get_ifconfig(root, path, &conf)) {
+		doc = xml_document_new();
+		cache = xml_node_new("compat-suse-cache", xml_document_root(doc));
+		xml_node_add_attr(cache, "globals", globals);
+		xml_node_add_attr_uint(cache, "wait-for-interfaces", ni_wait_for_interfaces);
+
+		/* files without a valid config get an empty entry */
+		for (i = 0; i < files->count; ++i)
+			__ni_suse_cache_file_entry(cache, real, files->data[i]);
+
+		for (i = 0; i < conf.netdevs.count; ++i)
+			__ni_suse_cache_add(cache, conf.netdevs.data[i]);
+	}
+	ni_compat_ifconfig_destroy(&conf);
+	return doc;
+}
+
+/*
+ * Read the ifcfg files using the compiled cache
+ */
+ni_bool_t
+__ni_suse_read_ifconfig(xml_document_array_t *array, const char *schema, const char *root,
+			const char *path, ni_bool_t check_prio, ni_bool_t raw)
+{
+	extern unsigned int ni_wait_for_interfaces;
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *_path = __NI_SUSE_SYSCONFIG_NETWORK_DIR;
+	char filename[PATH_MAX];
+	char pathbuf[PATH_MAX];
+	char *pathname = NULL;
+	char *globals = NULL;
+	ni_client_state_config_t conf;
+	xml_document_t *doc = NULL;
+	xml_document_t *config_doc;
+	xml_node_t *cache = NULL, *entry, *node, *child;
+	ni_bool_t modified = FALSE;
+
+	if (!ni_string_empty(path))
+		_path = path;
+	if (!root)
+		root = "";
+
+	if (ni_string_empty(root))
+		snprintf(pathbuf, sizeof(pathbuf), "%s", _path);
+	else
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, _path);
+
+	if (!__ni_suse_cache_enabled || !ni_realpath(pathbuf, &pathname) || !ni_isdir(pathname)) {
+		ni_compat_ifconfig_t ifcfg;
+		ni_bool_t rv;
+
+		ni_string_free(&pathname);
+		ni_compat_ifconfig_init(&ifcfg, schema);
+		if ((rv = __ni_suse_get_ifconfig(root, path, &ifcfg)))
+			ni_compat_generate_interfaces(array, &ifcfg, check_prio, raw);
+		ni_compat_ifconfig_destroy(&ifcfg);
+		return rv;
+	}
+
+	globals = __ni_suse_cache_globals(schema, root, pathname);
+	__ni_suse_ifcfg_scan_files(pathname, &files);
+
+	__ni_suse_cache_filename(filename, sizeof(filename));
+	if (ni_file_exists(filename) && (doc = xml_document_read(filename)))
+		cache = xml_node_get_child(xml_document_root(doc), "compat-suse-cache");
+
+	if (cache && ni_string_eq(globals, xml_node_get_attr(cache, "globals")) &&
+	    __ni_suse_cache_update(cache, schema, root, _path, pathname, &files, &modified)) {
+		xml_node_get_attr_uint(cache, "wait-for-interfaces", &ni_wait_for_interfaces);
+	} else {
+		ni_debug_readwrite("ifcfg cache: reading all files in %s", pathname);
+		xml_document_free(doc);
+		doc = __ni_suse_cache_build(schema, root, _path, pathname, &files, globals);
+		cache = doc ? xml_node_get_child(xml_document_root(doc), "compat-suse-cache") : NULL;
+		modified = TRUE;
+	}
+	ni_string_array_destroy(&files);
+	ni_string_free(&pathname);
+	ni_string_free(&globals);
+
+	if (!cache) {
+		xml_document_free(doc);
+		return FALSE;
+	}
+	if (modified)
+		__ni_suse_cache_write(doc);
+
+	ni_client_state_config_init(&conf);
+	for (entry = cache->children; entry; entry = entry->next) {
+		for (node = entry->children; node; node = node->next) {
+			config_doc = xml_document_new();
+			for (child = node->children; child; child = child->next)
+				xml_node_clone(child, xml_document_root(config_doc));
+			ni_string_dup(&conf.origin, xml_node_get_attr(node, "origin"));
+			ni_compat_add_config_document(array, config_doc, &conf, check_prio, raw);
+		}
+	}
+	ni_client_state_config_reset(&conf);
+	xml_document_free(doc);
+	return TRUE;
+}
+
 /*
  * Read HOSTNAME file
  */
@@ -31,12 +31,15 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <sys/time.h>
 
 #include <wicked/types.h>
 #include <wicked/util.h>
 #include <wicked/address.h>
 #include <wicked/addrconf.h>
+#include <wicked/xml.h>
 
+#include "wicked-client.h"
 #include "dhcp4/tester.h"
 #include "dhcp6/tester.h"
 #include "netinfo_priv.h"
@@ -285,6 +288,243 @@ cleanup:
 	return status;
 }
 
+#if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
+extern ni_bool_t	__ni_suse_ifconfig_cache_enable(ni_bool_t);
+extern void		__ni_suse_ifconfig_cache_drop(void);
+
+static ni_bool_t
+ni_do_test_ifconfig_load_run(const char *source, unsigned int iterations, unsigned long *usec,
+				unsigned int *count)
+{
+	struct timeval start, end, delta;
+	xml_document_array_t docs;
+	unsigned int i;
+
+	*usec = 0;
+	for (i = 0; i < iterations; ++i) {
+		xml_document_array_init(&docs);
+		ni_timer_get_time(&start);
+		if (!ni_ifconfig_read(&docs, opt_global_rootdir, source, FALSE, TRUE)) {
+			xml_document_array_destroy(&docs);
+			return FALSE;
+		}
+		ni_timer_get_time(&end);
+		timersub(&end, &start, &delta);
+		*usec += delta.tv_sec * 1000000 + delta.tv_usec;
+		*count = docs.count;
+		xml_document_array_destroy(&docs);
+	}
+	*usec /= iterations;
+	return TRUE;
+}
+
+/*
+ * Compare the time to read the ifcfg files without, with an empty
+ * and with an up-to-date compat-suse cache.
+ */
+int
+ni_do_test_ifconfig_load(const char *caller, int argc, char **argv)
+{
+	enum {
+		OPT_HELP 	 = 'h',
+		OPT_ITERATIONS	 = 'i',
+	};
+	static struct option	options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "iterations",	required_argument,	NULL,	OPT_ITERATIONS	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	int opt = 0, status = NI_WICKED_RC_USAGE;
+	unsigned int iterations = 10, count = 0;
+	unsigned long uncached, cold, warm;
+	char *program = NULL;
+	const char *source;
+	ni_bool_t enabled;
+
+	ni_string_printf(&program, "%s %s",	caller  ? caller  : "wicked",
+						argv[0] ? argv[0] : "test");
+	argv[0] = program;
+
+	optind = 1;
+	while ((opt = getopt_long(argc, argv, "+hi:", options, NULL)) != EOF) {
+		switch (opt) {
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+			/* fall through */
+		default:
+		usage:
+			fprintf(stderr,
+				"\nUsage:\n"
+				"  %s [options] [source]\n"
+				"\n"
+				"Options:\n"
+				"  --help, -h      show this help text and exit.\n"
+				"\n"
+				"  --iterations, -i	<number of reads to average> (default: 10)\n"
+				"\n", program);
+			goto cleanup;
+
+		case OPT_ITERATIONS:
+			if (ni_parse_uint(optarg, &iterations, 10) < 0 || !iterations) {
+				fprintf(stderr, "%s: unable to parse iterations option '%s'\n",
+						program, optarg);
+				goto usage;
+			}
+			break;
+		}
+	}
+
+	if (optind + 1 < argc) {
+		fprintf(stderr, "Error: %s: multiple sources not supported\n", program);
+		goto usage;
+	}
+	source = optind < argc ? argv[optind] : "compat:suse:";
+
+	status = NI_WICKED_RC_ERROR;
+	enabled = __ni_suse_ifconfig_cache_enable(FALSE);
+	if (!ni_do_test_ifconfig_load_run(source, iterations, &uncached, &count))
+		goto restore;
+
+	__ni_suse_ifconfig_cache_enable(TRUE);
+	__ni_suse_ifconfig_cache_drop();
+	if (!ni_do_test_ifconfig_load_run(source, 1, &cold, &count))
+		goto restore;
+	if (!ni_do_test_ifconfig_load_run(source, iterations, &warm, &count))
+		goto restore;
+
+	printf("%s: %u interface configs\n", source, count);
+	printf("uncached: %10lu usec\n", uncached);
+	printf("cold:     %10lu usec\n", cold);
+	printf("warm:     %10lu usec\n", warm);
+	status = NI_WICKED_RC_SUCCESS;
+
+restore:
+	__ni_suse_ifconfig_cache_enable(enabled);
+cleanup:
+	ni_string_free(&program);
+	return status;
+}
+#endif
+
+static ni_bool_t
+ni_do_test_ifconfig_startup_run(ni_string_array_t *sources, unsigned int threads,
+				unsigned int iterations, unsigned long *usec, unsigned int *count)
+{
+	struct timeval start, end, delta;
+	unsigned int i;
+	ni_fsm_t *fsm;
+
+	*usec = 0;
+	ni_ifconfig_set_read_threads(threads);
+	for (i = 0; i < iterations; ++i) {
+		fsm = ni_fsm_new();
+		ni_timer_get_time(&start);
+		if (!ni_ifconfig_load(fsm, opt_global_rootdir, sources, FALSE, TRUE)) {
+			ni_fsm_free(fsm);
+			return FALSE;
+		}
+		ni_timer_get_time(&end);
+		timersub(&end, &start, &delta);
+		*usec += delta.tv_sec * 1000000 + delta.tv_usec;
+		*count = fsm->workers.count;
+		ni_fsm_free(fsm);
+	}
+	*usec /= iterations;
+	return TRUE;
+}
+
+/*
+ * Compare the time to load all config sources into a fsm
+ * with sequential and with parallel wicked xml file reads.
+ */
+int
+ni_do_test_ifconfig_startup(const char *caller, int argc, char **argv)
+{
+	enum {
+		OPT_HELP 	 = 'h',
+		OPT_ITERATIONS	 = 'i',
+		OPT_THREADS	 = 't',
+	};
+	static struct option	options[] = {
+		{ "help",	no_argument,		NULL,	OPT_HELP	},
+		{ "iterations",	required_argument,	NULL,	OPT_ITERATIONS	},
+		{ "threads",	required_argument,	NULL,	OPT_THREADS	},
+		{ NULL,		no_argument,		NULL,	0		}
+	};
+	ni_string_array_t sources = NI_STRING_ARRAY_INIT;
+	int opt = 0, status = NI_WICKED_RC_USAGE;
+	unsigned int iterations = 10, threads = 0, count = 0;
+	unsigned long sequential, parallel;
+	char *program = NULL;
+
+	ni_string_printf(&program, "%s %s",	caller  ? caller  : "wicked",
+						argv[0] ? argv[0] : "test");
+	argv[0] = program;
+
+	optind = 1;
+	while ((opt = getopt_long(argc, argv, "+hi:t:", options, NULL)) != EOF) {
+		switch (opt) {
+		case OPT_HELP:
+			status = NI_WICKED_RC_SUCCESS;
+			/* fall through */
+		default:
+		usage:
+			fprintf(stderr,
+				"\nUsage:\n"
+				"  %s [options] [source...]\n"
+				"\n"
+				"Options:\n"
+				"  --help, -h      show this help text and exit.\n"
+				"\n"
+				"  --iterations, -i	<number of loads to average> (default: 10)\n"
+				"  --threads, -t	<xml reader threads> (default: 0, one per cpu)\n"
+				"\n", program);
+			goto cleanup;
+
+		case OPT_ITERATIONS:
+			if (ni_parse_uint(optarg, &iterations, 10) < 0 || !iterations) {
+				fprintf(stderr, "%s: unable to parse iterations option '%s'\n",
+						program, optarg);
+				goto usage;
+			}
+			break;
+
+		case OPT_THREADS:
+			if (ni_parse_uint(optarg, &threads, 10) < 0) {
+				fprintf(stderr, "%s: unable to parse threads option '%s'\n",
+						program, optarg);
+				goto usage;
+			}
+			break;
+		}
+	}
+
+	if (optind < argc) {
+		while (optind < argc)
+			ni_string_array_append(&sources, argv[optind++]);
+	} else {
+		ni_string_array_copy(&sources, ni_config_sources("ifconfig"));
+	}
+
+	status = NI_WICKED_RC_ERROR;
+	if (!ni_do_test_ifconfig_startup_run(&sources, 1, iterations, &sequential, &count))
+		goto restore;
+	if (!ni_do_test_ifconfig_startup_run(&sources, threads, iterations, &parallel, &count))
+		goto restore;
+
+	printf("%u interface workers from %u sources\n", count, sources.count);
+	printf("sequential: %10lu usec\n", sequential);
+	printf("parallel:   %10lu usec\n", parallel);
+	status = NI_WICKED_RC_SUCCESS;
+
+restore:
+	ni_ifconfig_set_read_threads(0);
+cleanup:
+	ni_string_array_destroy(&sources);
+	ni_string_free(&program);
+	return status;
+}
+
 int
 ni_do_test(const char *caller, int argc, char **argv)
 {
@@ -319,6 +559,10 @@ ni_do_test(const char *caller, int argc, char **argv)
 				"Commands:\n"
 				"  dhcp4       [options...]\n"
 				"  dhcp6       [options...]\n"
+#if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
+				"  ifconfig-load [options...] [source]\n"
+#endif
+				"  ifconfig-startup [options...] [source...]\n"
 				"\n", program);
 			goto cleanup;
 		}
@@ -339,7 +583,16 @@ ni_do_test(const char *caller, int argc, char **argv)
 	} else 
 	if (ni_string_eq(cmd, "dhcp6")) {
 		status = ni_do_test_dhcp6(program, argc - optind, argv + optind);
-	} else {
+	} else
+#if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
+	if (ni_string_eq(cmd, "ifconfig-load")) {
+		status = ni_do_test_ifconfig_load(program, argc - optind, argv + optind);
+	} else
+#endif
+	if (ni_string_eq(cmd, "ifconfig-startup")) {
+		status = ni_do_test_ifconfig_startup(program, argc - optind, argv + optind);
+	} else
+	{
 		fprintf(stderr, "%s: unsupported command %s\n", program, cmd);
 		goto usage;
 	}
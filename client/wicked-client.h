@@ -143,10 +143,14 @@ extern void			ni_compat_netdev_array_destroy(ni_compat_netdev_array_t *);
 extern void			ni_compat_ifconfig_init(ni_compat_ifconfig_t *, const char *);
 extern void			ni_compat_ifconfig_destroy(ni_compat_ifconfig_t *);
 extern unsigned int		ni_compat_generate_interfaces(xml_document_array_t *, ni_compat_ifconfig_t *, ni_bool_t, ni_bool_t);
+extern xml_node_t *		ni_compat_generate_ifcfg(const ni_compat_netdev_t *, xml_document_t *);
+extern ni_bool_t		ni_compat_add_config_document(xml_document_array_t *, xml_document_t *,
+							ni_client_state_config_t *, ni_bool_t, ni_bool_t);
 extern void			ni_compat_netdev_set_origin(ni_compat_netdev_t *, const char *, const char *);
 
 extern ni_bool_t		ni_ifconfig_read(xml_document_array_t *, const char *, const char *, ni_bool_t, ni_bool_t);
 extern ni_bool_t		ni_ifconfig_load(ni_fsm_t *, const char *, ni_string_array_t *, ni_bool_t, ni_bool_t);
+extern void			ni_ifconfig_set_read_threads(unsigned int);
 
 extern const ni_string_array_t *ni_config_sources(const char *);
 
@@ -465,12 +465,16 @@ dhcp4_supplicant(void)
 	ni_objectmodel_dhcp4_init();
 
 	dhcp4_register_services(dhcp4_dbus_server);
+	ni_objectmodel_register_metrics(dhcp4_dbus_server);
 
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(dhcp4_interface_event) < 0)
 		ni_fatal("unable to initialize netlink link listener");
 	if (ni_server_enable_interface_addr_events(NULL) < 0)
 		ni_fatal("unable to initialize netlink addr listener");
+	if (ni_config_rtnl_event_device_filter() &&
+	    ni_server_enable_interface_event_filter() < 0)
+		ni_fatal("unable to initialize netlink device filter");
 
 	if (!opt_foreground) {
 		ni_daemon_close_t close_flags = NI_DAEMON_CLOSE_STD;
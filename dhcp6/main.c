@@ -437,6 +437,7 @@ dhcp6_supplicant(void)
 	ni_objectmodel_dhcp6_init();
 
 	dhcp6_register_services(dhcp6_dbus_server);
+	ni_objectmodel_register_metrics(dhcp6_dbus_server);
 
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(dhcp6_interface_event) < 0)
@@ -448,6 +449,10 @@ dhcp6_supplicant(void)
 	if (ni_server_enable_interface_prefix_events(dhcp6_interface_prefix_event) < 0)
 		ni_fatal("Unable to initialize netlink prefix event listener");
 
+	if (ni_config_rtnl_event_device_filter() &&
+	    ni_server_enable_interface_event_filter() < 0)
+		ni_fatal("Unable to initialize netlink device event filter");
+
 	if (!opt_foreground) {
 		ni_daemon_close_t close_flags = NI_DAEMON_CLOSE_STD;
 
@@ -360,6 +360,7 @@ extern ni_dbus_object_t *	ni_dbus_client_object_new_child(ni_dbus_object_t *pare
 					const char *interface,
 					void *local_data);
 extern dbus_bool_t		ni_dbus_object_refresh_children(ni_dbus_object_t *);
+extern dbus_bool_t		ni_dbus_object_refresh_children_since(ni_dbus_object_t *, unsigned int *);
 extern ni_dbus_object_t *	ni_dbus_object_find_child(ni_dbus_object_t *parent, const char *name);
 extern dbus_bool_t		ni_dbus_object_call_variant(const ni_dbus_object_t *,
 					const char *interface, const char *method,
@@ -378,6 +379,8 @@ extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *ob
 					const char *method, va_list *app);
 
 extern dbus_bool_t		ni_dbus_object_get_managed_objects(ni_dbus_object_t *, DBusError *, ni_bool_t purge);
+extern dbus_bool_t		ni_dbus_object_get_managed_objects_since(ni_dbus_object_t *,
+					unsigned int *generation, DBusError *);
 extern dbus_bool_t		ni_dbus_object_refresh_properties(ni_dbus_object_t *, const ni_dbus_service_t *, DBusError *);
 extern dbus_bool_t		ni_dbus_object_send_property(ni_dbus_object_t *proxy,
 					const char *service_name,
@@ -268,6 +268,7 @@ typedef struct ni_ethtool_pause {
  */
 struct ni_ethtool {
 	ni_bitfield_t			supported;
+	unsigned int			refresh;
 
 	/* read-only info        */
 	ni_ethtool_driver_info_t *	driver_info;
@@ -247,6 +247,7 @@ struct ni_fsm {
 	unsigned int		timeout_count;
 	unsigned int		event_seq;
 	unsigned int		last_event_seq[__NI_EVENT_MAX];
+	unsigned int		netdev_generation;	/* of the last netif list refresh */
 	unsigned int		block_events;
 	ni_fsm_event_t *	events;
 	struct {
@@ -340,6 +341,7 @@ extern ni_bool_t		ni_ifworker_match_netdev_ifindex(const ni_ifworker_t *, unsign
 extern ni_bool_t		ni_ifworker_match_alias(const ni_ifworker_t *, const char *);
 extern ni_iftype_t		ni_ifworker_iftype_from_xml(xml_node_t *);
 extern void			ni_ifworker_set_config(ni_ifworker_t *, xml_node_t *, const char *);
+extern xml_node_t *		ni_ifworker_applied_config(const ni_ifworker_t *);
 extern ni_bool_t		ni_ifworker_control_set_usercontrol(ni_ifworker_t *, ni_bool_t);
 extern ni_bool_t		ni_ifworker_control_set_persistent(ni_ifworker_t *, ni_bool_t);
 extern  void			ni_ifworker_rearm(ni_ifworker_t *);
@@ -138,6 +138,9 @@ extern int		ni_server_enable_interface_prefix_events(void (*handler)(ni_netdev_t
 extern int		ni_server_enable_interface_nduseropt_events(void (*handler)(ni_netdev_t *, ni_event_t));
 extern int		ni_server_enable_route_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_route_t *));
 extern int		ni_server_enable_rule_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_rule_t *));
+extern int		ni_server_enable_interface_event_filter(void);
+extern ni_bool_t	ni_server_interface_event_filter_add(unsigned int);
+extern ni_bool_t	ni_server_interface_event_filter_del(unsigned int);
 extern int		ni_server_enable_interface_uevents(void);
 extern void		ni_server_disable_interface_uevents(void);
 extern void		ni_server_trace_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
@@ -156,6 +159,9 @@ extern const char *	ni_config_piddir(void);
 extern const char *	ni_config_statedir(void);
 extern const char *	ni_config_storedir(void);
 extern const char *	ni_config_backupdir(void);
+extern ni_bool_t	ni_config_rtnl_event_device_filter(void);
+extern unsigned int	ni_config_client_state_write_behind(void);
+extern ni_bool_t	ni_config_client_state_indexed_store(void);
 extern const char *	ni_extension_statedir(const char *);
 
 extern ni_dbus_client_t *ni_create_dbus_client(const char *bus_name);
@@ -167,6 +173,10 @@ extern void		ni_netconfig_destroy(ni_netconfig_t *);
 extern ni_netdev_t *	ni_netconfig_devlist(ni_netconfig_t *nic);
 extern xml_document_t *	ni_netconfig_firmware_discovery(const char *, const char *);
 
+typedef struct ni_firmware_discovery ni_firmware_discovery_t;
+extern ni_firmware_discovery_t *ni_netconfig_firmware_discovery_start(const char *, const char *);
+extern xml_document_t *	ni_netconfig_firmware_discovery_finish(ni_firmware_discovery_t *);
+
 extern ni_modem_t *	ni_netconfig_modem_list(ni_netconfig_t *);
 
 extern ni_netconfig_t *	ni_global_state_handle(int);
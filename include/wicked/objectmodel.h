@@ -23,8 +23,14 @@ extern void			ni_objectmodel_register_netif_service(ni_iftype_t, ni_dbus_service
 extern ni_dbus_server_t *	ni_objectmodel_create_service(void);
 extern ni_bool_t		ni_objectmodel_save_state(const char *);
 extern ni_bool_t		ni_objectmodel_recover_state(const char *, const char **);
+extern xml_document_t *		ni_objectmodel_state_read(const char *);
+extern ni_bool_t		ni_objectmodel_state_journal_open(const char *, const char **);
+extern ni_bool_t		ni_objectmodel_state_journal_close(void);
+extern void			ni_objectmodel_state_journal_update(const ni_dbus_object_t *);
+extern void			ni_objectmodel_state_journal_delete(const ni_dbus_object_t *);
 
 extern dbus_bool_t		ni_objectmodel_create_initial_objects(ni_dbus_server_t *);
+extern void			ni_objectmodel_register_metrics(ni_dbus_server_t *);
 extern ni_dbus_object_t *	ni_objectmodel_register_netif(ni_dbus_server_t *, ni_netdev_t *ifp,
 					const ni_dbus_class_t *override_class);
 extern dbus_bool_t		ni_objectmodel_unregister_netif(ni_dbus_server_t *, ni_netdev_t *ifp);
@@ -103,6 +109,7 @@ extern ni_dbus_class_t *	ni_objectmodel_class_new(const char *, const ni_dbus_cl
 #define NI_OBJECTMODEL_MANAGED_NETIF_INTERFACE	NI_OBJECTMODEL_INTERFACE ".ManagedInterface"
 #define NI_OBJECTMODEL_MANAGED_MODEM_INTERFACE	NI_OBJECTMODEL_INTERFACE ".ManagedModem"
 #define NI_OBJECTMODEL_MANAGED_POLICY_INTERFACE	NI_OBJECTMODEL_INTERFACE ".ManagedPolicy"
+#define NI_OBJECTMODEL_METRICS_INTERFACE	NI_OBJECTMODEL_INTERFACE ".Metrics"
 
 /*
  * Signals emitted by addrconf services
@@ -38,11 +38,13 @@ struct ni_variable {
 	char *		value;
 };
 
+typedef struct ni_var_index	ni_var_index_t;
 typedef struct ni_var_array ni_var_array_t;
 struct ni_var_array {
 	ni_var_array_t *next;
 	unsigned int	count;
 	ni_var_t *	data;
+	ni_var_index_t *index;
 };
 
 #define NI_VAR_ARRAY_INIT	{ .count = 0, .data = NULL }
@@ -143,6 +145,9 @@ extern void		ni_var_array_destroy(ni_var_array_t *);
 extern void		ni_var_array_copy(ni_var_array_t *, const ni_var_array_t *);
 extern void		ni_var_array_move(ni_var_array_t *, ni_var_array_t *);
 extern ni_var_t *	ni_var_array_get(const ni_var_array_t *, const char *name);
+extern void		ni_var_array_index_enable(ni_var_array_t *);
+extern unsigned int	ni_var_array_find_prefix(const ni_var_array_t *, const char *,
+						ni_uint_array_t *);
 extern void		ni_var_array_set(ni_var_array_t *, const char *name, const char *value);
 
 extern int		ni_var_array_get_string(ni_var_array_t *, const char *, char **);
@@ -194,6 +199,7 @@ extern int		ni_pidfile_write(const char *, unsigned int, pid_t);
 
 extern FILE *		ni_mkstemp(char **namep);
 extern int		ni_copy_file(FILE *, FILE *);
+extern int		ni_copy_file_path(const char *, const char *);
 extern int		ni_backup_file_to(const char *, const char *);
 extern int		ni_restore_file_from(const char *, const char *);
 extern FILE *		ni_file_open(const char *, const char *, unsigned int);
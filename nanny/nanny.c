@@ -58,6 +58,7 @@ ni_objectmodel_nanny_init(ni_nanny_t *mgr)
 	root_object->handle = mgr;
 	root_object->class = &ni_objectmodel_nanny_class;
 	ni_objectmodel_bind_compatible_interfaces(root_object);
+	ni_objectmodel_register_metrics(mgr->server);
 
 	{
 		unsigned int i;
@@ -869,6 +870,116 @@ ni_objectmodel_nanny_get_device(ni_dbus_object_t *object, const ni_dbus_method_t
 	return TRUE;
 }
 
+/*
+ * Nanny.getStatus(ifnames)
+ * Return the device state ifstatus needs from the nanny's fsm, so the
+ * client does not have to build its own. The device is refreshed from
+ * wickedd only when there were events since the last call.
+ */
+static ni_bool_t
+ni_nanny_status_to_dict(ni_nanny_t *mgr, ni_ifworker_t *w, ni_dbus_variant_t *dict)
+{
+	ni_managed_device_t *mdev;
+	ni_addrconf_lease_t *lease;
+	ni_dbus_variant_t *var;
+	ni_netdev_t *dev;
+
+	mdev = ni_nanny_get_device(mgr, w);
+	if (w->object && (!mdev || mdev->status_seq != mgr->fsm->event_seq)) {
+		if (!ni_dbus_object_refresh_children(w->object))
+			return FALSE;
+		if (mdev)
+			mdev->status_seq = mgr->fsm->event_seq;
+	}
+
+	ni_dbus_dict_add_uint32(dict, "link-required", w->control.link_required);
+	if (!(dev = w->device))
+		return TRUE;
+
+	ni_dbus_dict_add_uint32(dict, "type", dev->link.type);
+	ni_dbus_dict_add_uint32(dict, "status", dev->link.ifflags);
+	if (!ni_string_empty(dev->link.masterdev.name))
+		ni_dbus_dict_add_string(dict, "master", dev->link.masterdev.name);
+
+	if (dev->client_state) {
+		if (!(var = ni_dbus_dict_add(dict, "client-state")))
+			return FALSE;
+		ni_dbus_variant_init_dict(var);
+		if (!ni_objectmodel_netif_client_state_to_dict(dev->client_state, var))
+			return FALSE;
+	}
+
+	if (!(var = ni_dbus_dict_add(dict, "leases")))
+		return FALSE;
+	ni_dbus_dict_array_init(var);
+	for (lease = dev->leases; lease; lease = lease->next) {
+		ni_dbus_variant_t *entry;
+
+		if (!(entry = ni_dbus_dict_array_add(var)))
+			return FALSE;
+		ni_dbus_variant_init_dict(entry);
+		ni_dbus_dict_add_uint32(entry, "family", lease->family);
+		ni_dbus_dict_add_uint32(entry, "type", lease->type);
+		ni_dbus_dict_add_uint32(entry, "state", lease->state);
+		ni_dbus_dict_add_uint32(entry, "flags", lease->flags);
+	}
+	return TRUE;
+}
+
+static dbus_bool_t
+ni_objectmodel_nanny_get_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+					unsigned int argc, const ni_dbus_variant_t *argv,
+					ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t *dict;
+	const char *ifname;
+	ni_ifworker_t *w;
+	ni_nanny_t *mgr;
+	unsigned int i;
+	dbus_bool_t rv;
+
+	if ((mgr = ni_objectmodel_nanny_unwrap(object, error)) == NULL || mgr->fsm == NULL)
+		return FALSE;
+
+	if (argc != 1 || !ni_dbus_variant_is_string_array(&argv[0]))
+		return ni_dbus_error_invalid_args(error, ni_dbus_object_get_path(object), method->name);
+
+	/* an empty array requests all the workers */
+	ni_dbus_variant_init_dict(&result);
+	for (i = 0; i < mgr->fsm->workers.count; ++i) {
+		w = mgr->fsm->workers.data[i];
+		if (w->type != NI_IFWORKER_TYPE_NETDEV || !w->name)
+			continue;
+
+		if (argv[0].array.len) {
+			ni_bool_t match = FALSE;
+			unsigned int n;
+
+			for (n = 0; !match && n < argv[0].array.len; ++n) {
+				ifname = argv[0].string_array_value[n];
+				match = ni_string_eq(w->name, ifname);
+			}
+			if (!match)
+				continue;
+		}
+
+		if (!(dict = ni_dbus_dict_add(&result, w->name)))
+			break;
+		ni_dbus_variant_init_dict(dict);
+		if (!ni_nanny_status_to_dict(mgr, w, dict)) {
+			ni_dbus_variant_destroy(&result);
+			dbus_set_error(error, DBUS_ERROR_FAILED,
+					"Unable to refresh device %s", w->name);
+			return FALSE;
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
 /*
  * Nanny.createPolicy()
  */
@@ -1172,6 +1283,7 @@ ni_objectmodel_nanny_recheck(ni_dbus_object_t *object, const ni_dbus_method_t *m
 
 static ni_dbus_method_t		ni_objectmodel_nanny_methods[] = {
 	{ "getDevice",		"s",		.handler = ni_objectmodel_nanny_get_device	 },
+	{ "getStatus",		"as",		.handler = ni_objectmodel_nanny_get_status	 },
 	{ "createPolicy",	"s",		.handler_ex = ni_objectmodel_nanny_create_policy },
 	{ "deletePolicy",	"s",		.handler_ex = ni_objectmodel_nanny_delete_policy },
 	{ "addSecret",		"a{sv}ss",	.handler_ex = ni_objectmodel_nanny_set_secret	 },
@@ -44,6 +44,7 @@ struct ni_managed_device {
 	ni_bool_t		missing_secrets;
 
 	ni_managed_state_t	state;
+	unsigned int		status_seq;	// fsm event_seq of the last status refresh
 
 	unsigned int		fail_count;
 	unsigned int		max_fail_count;
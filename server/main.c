@@ -33,6 +33,7 @@
 #include <wicked/modem.h>
 #include "netinfo_priv.h"
 #include "udev-utils.h"
+#include "client/client_state.h"
 #include "auto6.h"
 
 enum {
@@ -85,6 +86,10 @@ static ni_bool_t	opt_no_modem_manager = TRUE;
 static ni_bool_t	opt_systemd;
 static char *		opt_state_file;
 static ni_dbus_server_t *dbus_server;
+static const char *	recover_prefix_list[] = {
+	NI_OBJECTMODEL_ADDRCONF_INTERFACE,
+	NULL
+};
 
 static void		run_interface_server(void);
 static void		discover_state(ni_dbus_server_t *);
@@ -277,11 +282,18 @@ run_interface_server(void)
 			ni_fatal("unable to background server");
 	}
 
+	ni_client_state_write_behind(ni_config_client_state_write_behind(),
+					ni_config_client_state_indexed_store());
+
 	discover_state(dbus_server);
 
-	if (opt_recover_state)
+	if (opt_recover_state) {
 		recover_state(opt_state_file);
 
+		if (!ni_objectmodel_state_journal_open(opt_state_file, recover_prefix_list))
+			ni_warn("unable to journal server state changes to %s", opt_state_file);
+	}
+
 #ifdef HAVE_SYSTEMD_SD_DAEMON_H
 	if (opt_systemd) {
 		sd_notify(0, "READY=1");
@@ -299,9 +311,12 @@ run_interface_server(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
-	if (opt_recover_state)
+	if (opt_recover_state && !ni_objectmodel_state_journal_close())
 		ni_objectmodel_save_state(opt_state_file);
 
+	if (!ni_client_state_flush())
+		ni_warn("unable to write queued client states");
+
 	exit(0);
 }
 
@@ -323,12 +338,6 @@ discover_udev_netdev_state(ni_netdev_t *dev)
 		if (ni_udev_netdev_is_ready(dev))
 			dev->link.ifflags |= NI_IFF_DEVICE_READY;
 	}
-
-	/* query ethtool settings which are guarded by ready
-	 * flag (rules processed / already renamed by udev)
-	 * as ethtool is a query by ifname...
-	 */
-	ni_system_ethtool_refresh(dev);
 }
 
 void
@@ -353,6 +362,12 @@ discover_state(ni_dbus_server_t *server)
 					ni_netdev_discover_client_state(ifp);
 			}
 		}
+
+		/* query ethtool settings which are guarded by ready
+		 * flag (rules processed / already renamed by udev);
+		 * dumped in bulk where possible, the rest on demand.
+		 */
+		ni_system_ethtool_refresh_all(nc);
 #ifdef MODEM
 		for (modem = ni_netconfig_modem_list(nc); modem; modem = modem->list.next)
 			ni_objectmodel_register_modem(server, modem);
@@ -368,18 +383,13 @@ discover_state(ni_dbus_server_t *server)
 void
 recover_state(const char *filename)
 {
-	const char *prefix_list[] = {
-		NI_OBJECTMODEL_ADDRCONF_INTERFACE,
-		NULL
-	};
-
 	if (!ni_file_exists(filename)) {
 		ni_debug_wicked("%s: %s does not exist, skip this", __func__, filename);
 		return;
 	}
 
 	/* Recover the lease information of all interfaces. */
-	if (!ni_objectmodel_recover_state(filename, prefix_list)) {
+	if (!ni_objectmodel_recover_state(filename, recover_prefix_list)) {
 		ni_error("unable to recover address configuration state");
 		return;
 	}
@@ -60,6 +60,7 @@ struct ni_extension {
 };
 
 #define NI_DHCP_SERVER_PREFERENCES_MAX	16
+#define NI_CONFIG_ARP_VERIFY_RATE	200
 typedef struct ni_server_preference {
 	ni_opaque_t		serverid;
 	ni_sockaddr_t		address;
@@ -72,8 +73,17 @@ typedef struct ni_config_rtnl_event {
 	 */
 	unsigned int	recv_buff_length;
 	unsigned int	mesg_buff_length;
+	ni_bool_t	device_filter;
 } ni_config_rtnl_event_t;
 
+typedef struct ni_config_client_state {
+	/*
+	 * client-state (ifup state) write tunables
+	 */
+	unsigned int	write_behind;	/* flush delay in msec, 0 = write-through */
+	ni_bool_t	indexed_store;
+} ni_config_client_state_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -90,9 +100,12 @@ typedef enum {
 	NI_CONFIG_TEAMD_CTL_UNIX,
 } ni_config_teamd_ctl_t;
 
+#define NI_CONFIG_TEAMD_SOCKET_DIR	"/var/run/teamd"
+
 typedef struct ni_config_teamd {
 	ni_bool_t		enabled;
 	ni_config_teamd_ctl_t	ctl;
+	char *			socket_dir;
 } ni_config_teamd_t;
 
 typedef enum {
@@ -107,6 +120,12 @@ typedef enum {
 	NI_CONFIG_DHCP4_CID_TYPE_DISABLE,
 } ni_config_dhcp4_cid_type_t;
 
+typedef struct ni_config_dhcp_renew {
+	unsigned int		jitter;		/* max. random delay after T1 in sec	*/
+	unsigned int		stagger;	/* window for the per-device offset	*/
+	unsigned int		rate;		/* renewals per second, 0: unlimited	*/
+} ni_config_dhcp_renew_t;
+
 typedef struct ni_config_dhcp4 {
 	struct ni_config_dhcp4 *next;
 	char *			device;
@@ -117,6 +136,7 @@ typedef struct ni_config_dhcp4 {
 	unsigned int		routes_opts;
 	char *			vendor_class;
 	unsigned int		lease_time;
+	ni_config_dhcp_renew_t	renew;
 	ni_string_array_t	ignore_servers;
 
 	unsigned int		num_preferred_servers;
@@ -136,6 +156,7 @@ typedef struct ni_config_dhcp6 {
 	unsigned int		allow_update;
 	unsigned int		lease_time;
 	unsigned int		release_nretries;
+	ni_config_dhcp_renew_t	renew;
 	struct {
 		unsigned int	time;
 		ni_uint_range_t range;
@@ -154,6 +175,28 @@ typedef struct ni_config_dhcp6 {
 	ni_dhcp_option_decl_t *	custom_options;
 } ni_config_dhcp6_t;
 
+typedef struct ni_config_arp {
+	struct {
+	    unsigned int	rate;		/* probes per second, 0: unlimited */
+	} verify;
+} ni_config_arp_t;
+
+typedef enum {
+	NI_CONFIG_LEASE_FILE_XML = 0,
+	NI_CONFIG_LEASE_FILE_BINARY,
+} ni_config_lease_file_format_t;
+
+#define NI_CONFIG_LEASE_FILE_MAX_RECORDS	64
+
+typedef struct ni_config_lease_file {
+	ni_config_lease_file_format_t	format;
+	unsigned int	max_records;	/* renew records appended before a rewrite */
+} ni_config_lease_file_t;
+
+typedef struct ni_config_updater {
+	unsigned int	batch_window;	/* msec to collect jobs into a batch */
+} ni_config_updater_t;
+
 typedef struct ni_config_auto4 {
 	unsigned int	allow_update;
 } ni_config_auto4_t;
@@ -178,6 +221,10 @@ typedef struct ni_config {
 	    ni_config_auto4_t		auto4;
 	    ni_config_auto6_t		auto6;
 
+	    ni_config_arp_t		arp;
+	    ni_config_lease_file_t	lease_file;
+	    ni_config_updater_t		updater;
+
 	} addrconf;
 
 	char *			dbus_xml_schema_file;
@@ -194,6 +241,7 @@ typedef struct ni_config {
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_client_state_t client_state;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
@@ -207,6 +255,10 @@ extern ni_extension_t *	ni_config_find_system_updater(ni_config_t *, const char
 extern unsigned int	ni_config_addrconf_update_mask(ni_addrconf_mode_t, unsigned int);
 extern unsigned int	ni_config_addrconf_update(const char *, ni_addrconf_mode_t, unsigned int);
 extern ni_bool_t	ni_config_use_nanny(void);
+extern unsigned int	ni_config_addrconf_arp_verify_rate(void);
+extern ni_config_lease_file_format_t	ni_config_addrconf_lease_file_format(void);
+extern unsigned int	ni_config_addrconf_lease_file_max_records(void);
+extern unsigned int	ni_config_addrconf_updater_batch_window(void);
 
 extern const ni_config_dhcp4_t *	ni_config_dhcp4_find_device(const char *);
 extern const ni_config_dhcp6_t *	ni_config_dhcp6_find_device(const char *);
@@ -217,6 +269,7 @@ extern ni_bool_t	ni_config_teamd_enable(ni_config_teamd_ctl_t);
 extern ni_bool_t	ni_config_teamd_disable(void);
 extern ni_bool_t	ni_config_teamd_enabled(void);
 extern ni_config_teamd_ctl_t	ni_config_teamd_ctl(void);
+extern const char *	ni_config_teamd_socket_dir(void);
 extern const char *	ni_config_teamd_ctl_type_to_name(ni_config_teamd_ctl_t);
 
 extern ni_extension_t *	ni_extension_list_find(ni_extension_t *, const char *);
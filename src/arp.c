@@ -9,7 +9,9 @@
 
 #include <net/if_arp.h>
 #include <netinet/if_ether.h>
+#include <arpa/inet.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include <wicked/netinfo.h>
@@ -17,6 +19,7 @@
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "buffer.h"
+#include "util_priv.h"
 
 static void	ni_arp_socket_recv(ni_socket_t *);
 static int	ni_arp_parse(ni_arp_socket_t *, ni_buffer_t *, ni_arp_packet_t *);
@@ -218,6 +221,176 @@ ni_arp_timeout_left(struct timeval *started, const struct timeval *current, unsi
 }
 
 
+/*
+ * The addresses to verify/notify are looked up in a small open
+ * addressing hash; with hundreds of addresses on a segment, the
+ * linear array scans per packet are the dominating cost.
+ */
+#define NI_ARP_ADDRESS_INDEX_MIN_SIZE	64
+
+static inline unsigned int
+ni_arp_address_hash(struct in_addr ip)
+{
+	unsigned int hash = ntohl(ip.s_addr) * 2654435761U;
+
+	return hash ^ (hash >> 16);
+}
+
+static ni_address_t *
+ni_arp_address_index_find(const ni_arp_address_index_t *index,
+		const ni_address_array_t *array, struct in_addr ip)
+{
+	unsigned int mask, slot, pos;
+	ni_address_t *ap;
+
+	if (!index->size)
+		return NULL;
+
+	mask = index->size - 1;
+	slot = ni_arp_address_hash(ip) & mask;
+	while ((pos = index->slots[slot])) {
+		ap = array->data[pos - 1];
+		if (ap->local_addr.sin.sin_addr.s_addr == ip.s_addr)
+			return ap;
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+static void
+ni_arp_address_index_put(ni_arp_address_index_t *index,
+		const ni_address_array_t *array, unsigned int pos)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int slot;
+
+	slot = ni_arp_address_hash(array->data[pos]->local_addr.sin.sin_addr) & mask;
+	while (index->slots[slot])
+		slot = (slot + 1) & mask;
+	index->slots[slot] = pos + 1;
+}
+
+static void
+ni_arp_address_index_destroy(ni_arp_address_index_t *index)
+{
+	free(index->slots);
+	index->slots = NULL;
+	index->size = 0;
+}
+
+/*
+ * Index the address appended last to the array
+ */
+static void
+ni_arp_address_index_append(ni_arp_address_index_t *index, const ni_address_array_t *array)
+{
+	unsigned int pos, size;
+
+	if (!array->count)
+		return;
+
+	if (array->count * 2 >= index->size) {
+		size = index->size ? index->size * 2 : NI_ARP_ADDRESS_INDEX_MIN_SIZE;
+		while (array->count * 2 >= size)
+			size *= 2;
+
+		ni_arp_address_index_destroy(index);
+		index->slots = xcalloc(size, sizeof(index->slots[0]));
+		index->size = size;
+		for (pos = 0; pos < array->count; ++pos)
+			ni_arp_address_index_put(index, array, pos);
+	} else {
+		ni_arp_address_index_put(index, array, array->count - 1);
+	}
+}
+
+static unsigned int
+ni_arp_address_array_add(ni_address_array_t *array, ni_arp_address_index_t *index, ni_address_t *ap)
+{
+	ni_address_t *ref;
+
+	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
+		return 0;
+
+	if (ni_arp_address_index_find(index, array, ap->local_addr.sin.sin_addr))
+		return 0;	/* already have it */
+
+	ref = ni_address_ref(ap);
+	if (!ref || !ni_address_array_append(array, ref)) {
+		ni_address_free(ref);
+		return 0;
+	}
+	ni_arp_address_index_append(index, array);
+
+	return array->count;
+}
+
+/*
+ * Sorted hwaddr -> ifindex table of the other interfaces of the host
+ */
+static int
+ni_arp_hwaddr_cmp(const ni_hwaddr_t *a, const ni_hwaddr_t *b)
+{
+	if (a->type != b->type)
+		return a->type < b->type ? -1 : 1;
+	if (a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	return memcmp(a->data, b->data, a->len);
+}
+
+static int
+ni_arp_hwaddr_entry_cmp(const void *a, const void *b)
+{
+	return ni_arp_hwaddr_cmp(&((const ni_arp_hwaddr_entry_t *)a)->hwaddr,
+				 &((const ni_arp_hwaddr_entry_t *)b)->hwaddr);
+}
+
+static void
+ni_arp_hwaddr_index_destroy(ni_arp_hwaddr_index_t *index)
+{
+	free(index->data);
+	memset(index, 0, sizeof(*index));
+}
+
+static void
+ni_arp_hwaddr_index_build(ni_arp_hwaddr_index_t *index, ni_netconfig_t *nc, unsigned int ifindex)
+{
+	const ni_netdev_t *dev;
+	unsigned int count = 0;
+
+	ni_arp_hwaddr_index_destroy(index);
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		count++;
+
+	index->data = xcalloc(count + 1, sizeof(index->data[0]));
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (dev->link.ifindex == ifindex || !dev->link.hwaddr.len)
+			continue;
+
+		index->data[index->count].hwaddr  = dev->link.hwaddr;
+		index->data[index->count].ifindex = dev->link.ifindex;
+		index->count++;
+	}
+	qsort(index->data, index->count, sizeof(index->data[0]), ni_arp_hwaddr_entry_cmp);
+	index->valid = TRUE;
+}
+
+/* position of the first entry with this hwaddr, or index->count */
+static unsigned int
+ni_arp_hwaddr_index_lookup(const ni_arp_hwaddr_index_t *index, const ni_hwaddr_t *hwaddr)
+{
+	unsigned int lo = 0, hi = index->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ni_arp_hwaddr_cmp(&index->data[mid].hwaddr, hwaddr) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 void
 ni_arp_verify_init(ni_arp_verify_t *vfy,  unsigned int nprobes, unsigned int wait_ms)
 {
@@ -226,43 +399,49 @@ ni_arp_verify_init(ni_arp_verify_t *vfy,  unsigned int nprobes, unsigned int wai
 	vfy->wait_ms = wait_ms;
 }
 
+void
+ni_arp_verify_set_rate(ni_arp_verify_t *vfy, unsigned int rate)
+{
+	if (vfy)
+		vfy->rate = rate;
+}
+
 void
 ni_arp_verify_reset(ni_arp_verify_t *vfy,  unsigned int nprobes, unsigned int wait_ms)
 {
 	vfy->nprobes = nprobes;
 	vfy->wait_ms = wait_ms;
+	vfy->delay_ms = 0;
+	vfy->next = 0;
+	vfy->sent = 0;
 	timerclear(&vfy->started);
 	ni_address_array_destroy(&vfy->ipaddrs);
+	ni_arp_address_index_destroy(&vfy->index);
+	ni_arp_hwaddr_index_destroy(&vfy->hwaddrs);
 }
 
 void
 ni_arp_verify_destroy(ni_arp_verify_t *vfy)
 {
 	ni_address_array_destroy(&vfy->ipaddrs);
+	ni_arp_address_index_destroy(&vfy->index);
+	ni_arp_hwaddr_index_destroy(&vfy->hwaddrs);
 	memset(vfy, 0, sizeof(*vfy));
 }
 
 unsigned int
 ni_arp_verify_add_address(ni_arp_verify_t *vfy,  ni_address_t *ap)
 {
-	ni_address_t *ref;
-
 	if (!vfy || !ap || !vfy->nprobes)
 		return 0;
 
-	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
-		return 0;
-
-	if (ni_address_array_find_match(&vfy->ipaddrs, ap, NULL, ni_address_equal_local_addr))
-		return 0;	/* already have it */
-
-	ref = ni_address_ref(ap);
-	if (!ref || !ni_address_array_append(&vfy->ipaddrs, ref)) {
-		ni_address_free(ref);
-		return 0;
-	}
+	return ni_arp_address_array_add(&vfy->ipaddrs, &vfy->index, ap);
+}
 
-	return vfy->ipaddrs.count;
+ni_address_t *
+ni_arp_verify_find_address(const ni_arp_verify_t *vfy, struct in_addr ip)
+{
+	return vfy ? ni_arp_address_index_find(&vfy->index, &vfy->ipaddrs, ip) : NULL;
 }
 
 void
@@ -270,28 +449,30 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 {
 	ni_arp_verify_t *vfy = (ni_arp_verify_t *)user_data;
 	ni_netconfig_t *nc = ni_global_state_handle(0);
+	const ni_arp_hwaddr_entry_t *entry;
 	const ni_netdev_t *dev;
 	ni_bool_t false_alarm = FALSE;
 	ni_bool_t found_addr = FALSE;
-	ni_address_t sip, *dup;
+	ni_sockaddr_t sip;
+	ni_address_t *dup;
 	const char *hwaddr;
+	unsigned int pos;
 
 	if (!sock || !pkt || pkt->op != ARPOP_REPLY || !vfy)
 		return;
 
 	/* Is it about the address we're validating? */
-	memset(&sip, 0, sizeof(sip));
-	ni_sockaddr_set_ipv4(&sip.local_addr, pkt->sip, 0);
-	dup = ni_address_array_find_match(&vfy->ipaddrs, &sip, NULL, ni_address_equal_local_addr);
+	dup = ni_arp_verify_find_address(vfy, pkt->sip);
 	if (!dup) {
+		ni_sockaddr_set_ipv4(&sip, pkt->sip, 0);
 		ni_debug_application("%s: ignore report about unrelated address %s from  %s",
-				sock->dev_info.ifname, ni_sockaddr_print(&sip.local_addr),
+				sock->dev_info.ifname, ni_sockaddr_print(&sip),
 				ni_link_address_print(&pkt->sha));
 		return;
 	} else
 	if (ni_address_is_duplicate(dup)) {
 		ni_debug_application("%s: ignore further reply about duplicate address %s from %s",
-				sock->dev_info.ifname, ni_sockaddr_print(&sip.local_addr),
+				sock->dev_info.ifname, ni_sockaddr_print(&dup->local_addr),
 				ni_link_address_print(&pkt->sha));
 		return;
 	}
@@ -301,7 +482,7 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 	 */
 	if (ni_link_address_equal(&sock->dev_info.hwaddr, &pkt->sha)) {
 		ni_debug_application("%s: ifgnore address %s in use by our own mac address %s",
-				sock->dev_info.ifname, ni_sockaddr_print(&sip.local_addr),
+				sock->dev_info.ifname, ni_sockaddr_print(&dup->local_addr),
 				ni_link_address_print(&pkt->sha));
 		return;
 	}
@@ -309,15 +490,21 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 	/* As well as ARP replies that seem to come from our own host:
 	 * dup if same address, not a dup if there are two interfaces
 	 * connected to the same broadcast domain.
+	 * The hwaddr index is rebuilt at the begin of each probe round.
 	 */
-	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
-		if (dev->link.ifindex == sock->dev_info.ifindex)
-			continue;
+	if (!vfy->hwaddrs.valid)
+		ni_arp_hwaddr_index_build(&vfy->hwaddrs, nc, sock->dev_info.ifindex);
 
-		if (!ni_netdev_link_is_up(dev))
+	pos = ni_arp_hwaddr_index_lookup(&vfy->hwaddrs, &pkt->sha);
+	for (; pos < vfy->hwaddrs.count; ++pos) {
+		entry = &vfy->hwaddrs.data[pos];
+		if (!ni_link_address_equal(&entry->hwaddr, &pkt->sha))
+			break;
+
+		if (!(dev = ni_netdev_by_index(nc, entry->ifindex)))
 			continue;
 
-		if (!ni_link_address_equal(&dev->link.hwaddr, &pkt->sha))
+		if (!ni_netdev_link_is_up(dev))
 			continue;
 
 		/* OK, we have an interface matching the hwaddr,
@@ -326,7 +513,8 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 		 * alarm, except it really has the IP assigned.
 		 */
 		false_alarm = TRUE;
-		found_addr = !!ni_address_list_find(dev->addrs, &dup->local_addr);
+		if (ni_address_list_find(dev->addrs, &dup->local_addr))
+			found_addr = TRUE;
 	}
 	if (false_alarm && !found_addr) {
 		ni_debug_application("%s: reply from one of our interfaces",
@@ -342,12 +530,33 @@ ni_arp_verify_process(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *u
 			hwaddr ? " (in use by " : "", hwaddr ? hwaddr : "", hwaddr ? ")" : "");
 }
 
+/*
+ * With a rate set, each probe round is sent in batches every pace
+ * interval instead of in one burst. Every address is still probed at
+ * the same position in each round and the wait time is applied after
+ * the last batch, so the probes of an address stay at least wait_ms
+ * apart, as before.
+ */
+#define NI_ARP_VERIFY_PACE_MS		50
+
+static inline unsigned int
+ni_arp_verify_batch(const ni_arp_verify_t *vfy)
+{
+	unsigned int batch;
+
+	if (!vfy->rate)
+		return -1U;
+
+	batch = (vfy->rate * NI_ARP_VERIFY_PACE_MS) / 1000;
+	return batch ? batch : 1;
+}
+
 ni_bool_t
 ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *timeout)
 {
 	static struct in_addr null = { 0 };
 	const struct in_addr *ip;
-	unsigned int i, count;
+	unsigned int i, batch;
 	struct timeval now;
 	ni_address_t *ap;
 
@@ -355,37 +564,54 @@ ni_arp_verify_send(ni_arp_socket_t *sock, ni_arp_verify_t *vfy, unsigned int *ti
 		return FALSE;
 
 	ni_timer_get_time(&now);
-	if ((*timeout = ni_arp_timeout_left(&vfy->started, &now, vfy->wait_ms)))
+	if ((*timeout = ni_arp_timeout_left(&vfy->started, &now, vfy->delay_ms)))
 		return TRUE;
 
-	if (vfy->nprobes && vfy->ipaddrs.count) {
-		vfy->started = now;
+	if (!vfy->next) {
+		if (!vfy->nprobes || !vfy->ipaddrs.count)
+			goto done;
+
 		vfy->nprobes--;
+		vfy->sent = 0;
+		vfy->hwaddrs.valid = FALSE;
+	}
 
-		for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
-			ap = vfy->ipaddrs.data[i];
+	batch = ni_arp_verify_batch(vfy);
+	for (i = 0; i < batch && vfy->next < vfy->ipaddrs.count; vfy->next++) {
+		ap = vfy->ipaddrs.data[vfy->next];
 
-			if (ni_address_is_duplicate(ap))
-				continue;
+		if (ni_address_is_duplicate(ap))
+			continue;
 
-			if (!ni_address_is_tentative(ap))
-				continue;
+		if (!ni_address_is_tentative(ap))
+			continue;
 
-			ni_debug_application("%s: sending arp verify for IP %s",
-					sock->dev_info.ifname,
-					ni_sockaddr_print(&ap->local_addr));
+		ni_debug_application("%s: sending arp verify for IP %s",
+				sock->dev_info.ifname,
+				ni_sockaddr_print(&ap->local_addr));
 
-			ip = &ap->local_addr.sin.sin_addr;
-			if (ni_arp_send_request(sock, null, *ip) > 0)
-				count++;
-		}
-		if (count) {
-			*timeout = vfy->wait_ms;
-			return TRUE;
-		}
+		i++;
+		ip = &ap->local_addr.sin.sin_addr;
+		if (ni_arp_send_request(sock, null, *ip) > 0)
+			vfy->sent++;
 	}
 
-	for (count = 0, i = 0; i < vfy->ipaddrs.count; ++i) {
+	vfy->started = now;
+	if (vfy->next < vfy->ipaddrs.count) {
+		vfy->delay_ms = NI_ARP_VERIFY_PACE_MS;
+		*timeout = vfy->delay_ms;
+		return TRUE;
+	}
+
+	vfy->next = 0;
+	if (vfy->sent) {
+		vfy->delay_ms = vfy->wait_ms;
+		*timeout = vfy->delay_ms;
+		return TRUE;
+	}
+
+done:
+	for (i = 0; i < vfy->ipaddrs.count; ++i) {
 		ap = vfy->ipaddrs.data[i];
 
 		if (ni_address_is_tentative(ap))
@@ -410,36 +636,24 @@ ni_arp_notify_reset(ni_arp_notify_t *nfy,  unsigned int nclaims, unsigned int wa
 	nfy->wait_ms = wait_ms;
 	timerclear(&nfy->started);
 	ni_address_array_destroy(&nfy->ipaddrs);
+	ni_arp_address_index_destroy(&nfy->index);
 }
 
 void
 ni_arp_notify_destroy(ni_arp_notify_t *nfy)
 {
 	ni_address_array_destroy(&nfy->ipaddrs);
+	ni_arp_address_index_destroy(&nfy->index);
 	memset(nfy, 0, sizeof(*nfy));
 }
 
 unsigned int
 ni_arp_notify_add_address(ni_arp_notify_t *nfy,  ni_address_t *ap)
 {
-	ni_address_t *ref;
-
 	if (!nfy || !ap || !nfy->nclaims)
 		return 0;
 
-	if (ap->family != AF_INET || !ni_sockaddr_is_ipv4_specified(&ap->local_addr))
-		return 0;
-
-	if (ni_address_array_find_match(&nfy->ipaddrs, ap, NULL, ni_address_equal_local_addr))
-		return 0;	/* already have it */
-
-	ref = ni_address_ref(ap);
-	if (!ref || !ni_address_array_append(&nfy->ipaddrs, ref)) {
-		ni_address_free(ref);
-		return 0;
-	}
-
-	return nfy->ipaddrs.count;
+	return ni_arp_address_array_add(&nfy->ipaddrs, &nfy->index, ap);
 }
 
 ni_bool_t
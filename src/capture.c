@@ -110,6 +110,12 @@ typedef union ni_packetaddr {
 	struct sockaddr_ll	sll;
 } ni_packetaddr_t;
 
+typedef struct ni_capture_packet {
+	size_t			len;
+	ni_bool_t		partial_csum;
+	ni_sockaddr_t		from;
+} ni_capture_packet_t;
+
 /*
  * Platform specific
  */
@@ -123,6 +129,18 @@ struct ni_capture {
 	void *			buffer;
 	size_t			mtu;
 
+	/* packets drained from the socket in the current wakeup */
+	struct {
+		unsigned int		size;
+		unsigned int		count;
+		unsigned int		next;
+		unsigned char *		buffer;
+		ni_capture_packet_t *	packet;
+	} batch;
+	ni_capture_stats_t	stats;
+
+	void			(*receive)(ni_socket_t *);
+
 	struct {
 		struct timeval		deadline;
 		const ni_buffer_t *	buffer;
@@ -418,12 +436,39 @@ __ni_capture_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
 /*
  * Capture receive handling
  */
+#if defined(PACKET_AUXDATA)
+/* use 2 times bigger buffer to catch possible additions... */
+#define NI_CAPTURE_CMSG_SIZE	CMSG_SPACE(sizeof(struct tpacket_auxdata)*2)
+#else
+#define NI_CAPTURE_CMSG_SIZE	CMSG_SPACE(0)
+#endif
+
+static ni_bool_t
+__ni_capture_partial_csum(struct msghdr *msg)
+{
+#if defined(PACKET_AUXDATA)
+	struct cmsghdr *cmsg;
+	struct tpacket_auxdata *aux;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_PACKET &&
+		    cmsg->cmsg_type == PACKET_AUXDATA &&
+		    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct tpacket_auxdata))) {
+			aux = (void *)CMSG_DATA(cmsg);
+			if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
+				return TRUE;
+			break;
+		}
+	}
+#endif
+	return FALSE;
+}
+
 int
 __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from)
 {
 #if defined(PACKET_AUXDATA)
-	/* use 2 times bigger buffer to catch possible additions... */
-	unsigned char cbuf[CMSG_SPACE(sizeof(struct tpacket_auxdata)*2)];
+	unsigned char cbuf[NI_CAPTURE_CMSG_SIZE];
 	struct iovec iov = {
 		.iov_base = buf,
 		.iov_len  = len,
@@ -436,8 +481,6 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 		.msg_name = from ? from : NULL,
 		.msg_namelen = from ? sizeof(from->ss) : 0,
 	};
-	struct cmsghdr *cmsg;
-	struct tpacket_auxdata *aux;
 	ssize_t bytes;
 
 	*partial_csum = FALSE;
@@ -448,17 +491,7 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 	if ((bytes = recvmsg (fd, &msg, 0)) < 0)
 		return bytes;
 
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-		if (cmsg->cmsg_level == SOL_PACKET &&
-		    cmsg->cmsg_type == PACKET_AUXDATA &&
-		    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct tpacket_auxdata))) {
-			aux = (void *)CMSG_DATA(cmsg);
-			if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
-				*partial_csum = TRUE;
-			break;
-		}
-	}
-
+	*partial_csum = __ni_capture_partial_csum(&msg);
 	return bytes;
 #else
 	*partial_csum = FALSE;
@@ -467,6 +500,114 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 #endif
 }
 
+/*
+ * Drain up to batch.size packets from the socket with a single
+ * recvmmsg call. Returns the number of packets queued, 0 when
+ * there is nothing to read and -1 when the caller has to fall
+ * back to reading a single packet.
+ */
+static int
+__ni_capture_recv_batch(ni_capture_t *capture)
+{
+#if defined(HAVE_RECVMMSG)
+	unsigned char cbuf[NI_CAPTURE_BATCH_MAX][NI_CAPTURE_CMSG_SIZE];
+	struct mmsghdr msgs[NI_CAPTURE_BATCH_MAX];
+	struct iovec iov[NI_CAPTURE_BATCH_MAX];
+	ni_capture_packet_t *pkt;
+	unsigned int i;
+	int n;
+
+	capture->batch.count = 0;
+	capture->batch.next = 0;
+	if (capture->batch.size < 2)
+		return -1;
+
+	memset(msgs, 0, sizeof(msgs));
+	memset(cbuf, 0, sizeof(cbuf));
+	for (i = 0; i < capture->batch.size; ++i) {
+		pkt = &capture->batch.packet[i];
+		memset(&pkt->from, 0, sizeof(pkt->from));
+
+		iov[i].iov_base = capture->batch.buffer + i * capture->mtu;
+		iov[i].iov_len = capture->mtu;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cbuf[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cbuf[i]);
+		msgs[i].msg_hdr.msg_name = &pkt->from;
+		msgs[i].msg_hdr.msg_namelen = sizeof(pkt->from.ss);
+	}
+
+	n = recvmmsg(capture->sock->__fd, msgs, capture->batch.size, MSG_DONTWAIT, NULL);
+	if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		if (errno == ENOSYS) {
+			/* no kernel support, don't try again */
+			capture->batch.size = 0;
+		}
+		return -1;
+	}
+
+	for (i = 0; i < (unsigned int)n; ++i) {
+		pkt = &capture->batch.packet[i];
+		pkt->len = msgs[i].msg_len;
+		pkt->partial_csum = __ni_capture_partial_csum(&msgs[i].msg_hdr);
+	}
+	capture->batch.count = n;
+	return n;
+#else
+	(void)capture;
+	return -1;
+#endif
+}
+
+/*
+ * Socket receive callback: drain a batch of packets and hand them to
+ * the protocol callback one by one. The callback picks each packet up
+ * via ni_capture_recv as it would read a single packet from the socket.
+ */
+static void
+__ni_capture_socket_recv(ni_socket_t *sock)
+{
+	ni_capture_t *capture;
+	unsigned int next;
+	int count;
+
+	if (!(capture = sock->user_data)) {
+		ni_error("capture socket without capture object?!");
+		return;
+	}
+
+	capture->stats.wakeups++;
+	if ((count = __ni_capture_recv_batch(capture)) < 0) {
+		capture->stats.packets++;
+		capture->receive(sock);
+		return;
+	}
+	if (count == 0)
+		return;
+
+	capture->stats.packets += count;
+	if ((unsigned int)count > capture->stats.max_batch)
+		capture->stats.max_batch = count;
+	if ((unsigned int)count == capture->batch.size)
+		capture->stats.full_batches++;
+
+	ni_socket_hold(sock);
+	while (capture->batch.next < capture->batch.count) {
+		next = capture->batch.next;
+		capture->receive(sock);
+
+		/* the callback closed the capture */
+		if (sock->__fd < 0)
+			break;
+		if (capture->batch.next == next)
+			capture->batch.next++;
+	}
+	ni_socket_release(sock);
+}
+
 ni_bool_t
 ni_capture_from_hwaddr_set(ni_hwaddr_t *hwaddr, const ni_sockaddr_t *from)
 {
@@ -497,14 +638,25 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 int
 ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, const char *hint)
 {
-	void *payload;
+	ni_capture_packet_t *pkt;
+	void *data, *payload;
 	size_t payload_len;
 	ssize_t bytes;
 	ni_bool_t partial_checksum = FALSE;
 	const char *lladdr;
 
-	bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+	if (capture->batch.next < capture->batch.count) {
+		pkt = &capture->batch.packet[capture->batch.next++];
+		data = capture->batch.buffer + (pkt - capture->batch.packet) * capture->mtu;
+		bytes = pkt->len;
+		partial_checksum = pkt->partial_csum;
+		if (from)
+			*from = pkt->from;
+	} else {
+		data = capture->buffer;
+		bytes = __ni_capture_recv(capture->sock->__fd, data,
+				capture->mtu, &partial_checksum, from);
+	}
 
 	if (bytes < 0) {
 		ni_error("%s: %s cannot read %s%spacket from socket: %m",
@@ -522,7 +674,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
+		payload = ni_capture_inspect_udp_header(data, bytes,
 						&payload_len, partial_checksum);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
@@ -534,7 +686,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = data;
 		payload_len = bytes;
 		break;
 
@@ -563,6 +715,12 @@ ni_capture_get_user_data(const ni_capture_t *capture)
 	return capture->user_data;
 }
 
+void
+ni_capture_get_stats(const ni_capture_t *capture, ni_capture_stats_t *stats)
+{
+	*stats = capture->stats;
+}
+
 /*
  * Check if the capture is valid, and has the desired protocol
  */
@@ -743,8 +901,14 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	if (capture->mtu == 0)
 		capture->mtu = MTU_MAX;
 	capture->buffer = xmalloc(capture->mtu);
+#if defined(HAVE_RECVMMSG)
+	capture->batch.size = NI_CAPTURE_BATCH_MAX;
+	capture->batch.buffer = xmalloc(capture->batch.size * capture->mtu);
+	capture->batch.packet = xcalloc(capture->batch.size, sizeof(ni_capture_packet_t));
+#endif
 
-	capture->sock->receive = receive;
+	capture->receive = receive;
+	capture->sock->receive = __ni_capture_socket_recv;
 	capture->sock->get_timeout = __ni_capture_socket_get_timeout;
 	capture->sock->check_timeout = __ni_capture_socket_check_timeout;
 	capture->sock->user_data = capture;
@@ -842,8 +1006,14 @@ ni_capture_free(ni_capture_t *capture)
 		return;
 	if (capture->sock)
 		ni_socket_close(capture->sock);
+	if (capture->stats.wakeups)
+		ni_debug_socket("%s: received %u packets in %u wakeups (max %u, %u full batches)",
+				capture->ifname, capture->stats.packets, capture->stats.wakeups,
+				capture->stats.max_batch, capture->stats.full_batches);
 	if (capture->buffer)
 		free(capture->buffer);
+	free(capture->batch.buffer);
+	free(capture->batch.packet);
 	ni_string_free(&capture->ifname);
 	free(capture);
 }
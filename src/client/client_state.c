@@ -12,6 +12,7 @@
 #endif
 #include <sys/time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <limits.h>
 #include <errno.h>
 #include <unistd.h>
@@ -427,18 +428,82 @@ ni_client_state_scripts_copy(ni_client_state_scripts_t *dst,
 		dst->node = xml_node_clone(src->node, NULL);
 }
 
-ni_bool_t
-ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex)
+/*
+ * Write-behind mode
+ *
+ * By default, every ni_client_state_save() writes the state-<ifindex>.xml
+ * file immediately (temp file + rename, without fsync).
+ *
+ * In write-behind mode, saves, moves and drops are queued per ifindex,
+ * coalescing repeated updates of a device, and flushed in one batch when
+ * the delay expired, on ni_client_state_flush() or when the mode is
+ * disabled. The durability guarantees are:
+ *
+ *  - an update is on disk at most delay msec after it has been queued;
+ *    a crash before loses the queued updates, never older ones.
+ *  - updates failing to write remain queued and the flush is retried
+ *    after the delay (or NI_CLIENT_STATE_FLUSH_RETRY msec).
+ *  - loads see queued updates of the own process immediately.
+ *  - per-ifindex files are replaced atomically as before.
+ *  - with the indexed store, all states are kept in one client-state.xml
+ *    file, which is written, fsync'ed and renamed once per batch; after
+ *    a crash it contains the complete result of some earlier flush.
+ *
+ * State files of devices stored in the index are removed, loads fall
+ * back to them for states written before the indexed store was enabled.
+ * Disabling the indexed store moves its states back into state files.
+ */
+#define NI_CLIENT_STATE_FLUSH_RETRY	1000	/* msec */
+
+typedef struct ni_client_state_pending {
+	unsigned int		ifindex;
+	xml_node_t *		node;		/* NULL to drop the state */
+} ni_client_state_pending_t;
+
+static struct ni_client_state_writer {
+	unsigned int		delay;
+	ni_bool_t		indexed;
+
+	unsigned int		count;
+	ni_client_state_pending_t *data;
+	const ni_timer_t *	timer;
+
+	xml_node_t *		store;
+} ni_client_state_writer;
+
+static void
+ni_client_state_store_filename(char *path, size_t size)
+{
+	snprintf(path, size, "%s/%s", ni_config_statedir(),
+			NI_CLIENT_STATE_STORE_FILE);
+}
+
+static xml_node_t *
+ni_client_state_read_xml(const char *path)
+{
+	xml_node_t *xml;
+	FILE *fp;
+
+	if (!(fp = fopen(path, "re"))) {
+		if (errno != ENOENT)
+			ni_error("Cannot open state file '%s': %m", path);
+		return NULL;
+	}
+
+	if (!(xml = xml_node_scan(fp, path)))
+		ni_error("Cannot parse xml from state file '%s", path);
+	fclose(fp);
+	return xml;
+}
+
+static ni_bool_t
+ni_client_state_write_xml(const xml_node_t *node, const char *path, ni_bool_t sync)
 {
-	char path[PATH_MAX] = {'\0'};
 	char temp[PATH_MAX] = {'\0'};
-	xml_node_t *node;
 	FILE *fp = NULL;
 	int fd;
 
-	ni_client_state_filename(ifindex, path, sizeof(path));
 	snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
-
 	if ((fd = mkstemp(temp)) < 0) {
 		ni_error("Cannot create %s state temp file", path);
 		return FALSE;
@@ -449,23 +514,15 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 		goto failure;
 	}
 
-	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
-		ni_error("Cannot create %s node for %s", NI_CLIENT_STATE_XML_NODE, path);
-		goto failure;
-	}
-
-	if (!ni_client_state_print_xml(client_state, node)) {
-		ni_error("Cannot format state into xml for %s", path);
-		xml_node_free(node);
+	if (xml_node_print(node, fp) < 0 || fflush(fp) != 0) {
+		ni_error("Cannot write into %s state temp file", path);
 		goto failure;
 	}
 
-	if (xml_node_print(node, fp) < 0) {
-		ni_error("Cannot write into %s state temp file", path);
-		xml_node_free(node);
+	if (sync && fsync(fd) < 0) {
+		ni_error("Cannot sync %s state temp file: %m", path);
 		goto failure;
 	}
-	xml_node_free(node);
 
 	if (rename(temp, path) < 0) {
 		ni_error("Cannot move temp file to state file %s", path);
@@ -473,46 +530,358 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 	}
 
 	fclose(fp);
-
 	return TRUE;
 
 failure:
-	if (fp) {
+	if (fp)
 		fclose(fp);
-	}
 	unlink(temp);
 	return FALSE;
 }
 
-ni_bool_t
-ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
+static xml_node_t *
+ni_client_state_format_xml(const ni_client_state_t *client_state, unsigned int ifindex)
+{
+	xml_node_t *node;
+
+	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
+		ni_error("Cannot create %s node for ifindex %u",
+				NI_CLIENT_STATE_XML_NODE, ifindex);
+		return NULL;
+	}
+
+	if (!ni_client_state_print_xml(client_state, node)) {
+		ni_error("Cannot format state into xml for ifindex %u", ifindex);
+		xml_node_free(node);
+		return NULL;
+	}
+	return node;
+}
+
+static xml_node_t *
+ni_client_state_store(void)
 {
 	char path[PATH_MAX] = {'\0'};
-	xml_node_t *xml;
+	xml_node_t *store;
+
+	if ((store = ni_client_state_writer.store))
+		return store;
+
+	ni_client_state_store_filename(path, sizeof(path));
+	if (!(store = ni_client_state_read_xml(path)))
+		store = xml_node_new(NULL, NULL);
+
+	ni_client_state_writer.store = store;
+	return store;
+}
+
+static xml_node_t *
+ni_client_state_store_find(xml_node_t *store, unsigned int ifindex)
+{
 	xml_node_t *node;
-	FILE *fp;
+	unsigned int index;
 
-	if (!client_state)
+	for (node = store ? store->children : NULL; node; node = node->next) {
+		if (!ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE))
+			continue;
+		if (xml_node_get_attr_uint(node, "ifindex", &index) && index == ifindex)
+			return node;
+	}
+	return NULL;
+}
+
+static ni_client_state_pending_t *
+ni_client_state_pending_find(unsigned int ifindex)
+{
+	unsigned int i;
+
+	for (i = 0; i < ni_client_state_writer.count; ++i) {
+		if (ni_client_state_writer.data[i].ifindex == ifindex)
+			return &ni_client_state_writer.data[i];
+	}
+	return NULL;
+}
+
+static void
+ni_client_state_flush_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_client_state_writer.timer != timer)
+		return;
+
+	ni_client_state_writer.timer = NULL;
+	ni_client_state_flush();
+}
+
+static ni_bool_t
+ni_client_state_queue(unsigned int ifindex, xml_node_t *node)
+{
+	struct ni_client_state_writer *w = &ni_client_state_writer;
+	ni_client_state_pending_t *p;
+
+	if (!(p = ni_client_state_pending_find(ifindex))) {
+		if ((w->count % 16) == 0) {
+			p = realloc(w->data, (w->count + 16) * sizeof(*p));
+			if (!p) {
+				xml_node_free(node);
+				return FALSE;
+			}
+			w->data = p;
+		}
+		p = &w->data[w->count++];
+		p->ifindex = ifindex;
+		p->node = NULL;
+	}
+	xml_node_free(p->node);
+	p->node = node;
+
+	if (!w->delay)
+		return ni_client_state_flush();
+
+	if (!w->timer)
+		w->timer = ni_timer_register(w->delay, ni_client_state_flush_timeout, NULL);
+	return TRUE;
+}
+
+static ni_bool_t
+ni_client_state_flush_indexed(void)
+{
+	struct ni_client_state_writer *w = &ni_client_state_writer;
+	char path[PATH_MAX] = {'\0'};
+	xml_node_t *store, *node;
+	unsigned int i;
+
+	if (!(store = ni_client_state_store()))
 		return FALSE;
 
-	ni_client_state_filename(ifindex, path, sizeof(path));
-	if (!(fp = fopen(path, "re"))) {
-		if (errno != ENOENT)
-			ni_error("Cannot open state file '%s': %m", path);
+	for (i = 0; i < w->count; ++i) {
+		ni_client_state_pending_t *p = &w->data[i];
+
+		if ((node = ni_client_state_store_find(store, p->ifindex)))
+			xml_node_delete_child_node(store, node);
+
+		if (p->node) {
+			node = xml_node_clone(p->node, store);
+			xml_node_add_attr_uint(node, "ifindex", p->ifindex);
+		}
+	}
+
+	ni_client_state_store_filename(path, sizeof(path));
+	if (!ni_client_state_write_xml(store, path, TRUE))
 		return FALSE;
+
+	/* the index shadows older state files now */
+	for (i = 0; i < w->count; ++i) {
+		ni_client_state_filename(w->data[i].ifindex, path, sizeof(path));
+		if (unlink(path) < 0 && errno != ENOENT)
+			ni_error("Cannot remove state file '%s': %m", path);
+		xml_node_free(w->data[i].node);
 	}
+	w->count = 0;
+	return TRUE;
+}
 
-	if (!(xml = xml_node_scan(fp, path))) {
-		fclose(fp);
-		ni_error("Cannot parse xml from state file '%s", path);
+static ni_bool_t
+ni_client_state_flush_files(void)
+{
+	struct ni_client_state_writer *w = &ni_client_state_writer;
+	char path[PATH_MAX] = {'\0'};
+	unsigned int i, n;
+
+	/* keep the entries failing to write queued */
+	for (i = n = 0; i < w->count; ++i) {
+		ni_client_state_pending_t *p = &w->data[i];
+
+		ni_client_state_filename(p->ifindex, path, sizeof(path));
+		if (p->node) {
+			if (!ni_client_state_write_xml(p->node, path, FALSE)) {
+				w->data[n++] = *p;
+				continue;
+			}
+		} else
+		if (unlink(path) < 0 && errno != ENOENT) {
+			ni_error("Cannot remove state file '%s': %m", path);
+			w->data[n++] = *p;
+			continue;
+		}
+		xml_node_free(p->node);
+	}
+	w->count = n;
+	return n == 0;
+}
+
+/*
+ * Write all queued states to disk; states failing to write
+ * remain queued and are retried by the flush timer.
+ */
+ni_bool_t
+ni_client_state_flush(void)
+{
+	struct ni_client_state_writer *w = &ni_client_state_writer;
+	unsigned int delay;
+	ni_bool_t rv;
+
+	if (w->timer) {
+		ni_timer_cancel(w->timer);
+		w->timer = NULL;
+	}
+	if (!w->count)
+		return TRUE;
+
+	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_READWRITE,
+			"flushing %u queued client states", w->count);
+
+	if (w->indexed)
+		rv = ni_client_state_flush_indexed();
+	else
+		rv = ni_client_state_flush_files();
+
+	if (!rv) {
+		delay = w->delay ? w->delay : NI_CLIENT_STATE_FLUSH_RETRY;
+		ni_warn("Cannot write %u queued client states, retrying in %u msec",
+				w->count, delay);
+		w->timer = ni_timer_register(delay, ni_client_state_flush_timeout, NULL);
 		return FALSE;
 	}
-	fclose(fp);
 
-	node = xml->name ? xml : xml->children;
+	free(w->data);
+	w->data = NULL;
+	w->count = 0;
+	return TRUE;
+}
+
+/*
+ * Move the indexed store states back into per-ifindex files
+ */
+static ni_bool_t
+ni_client_state_store_export(void)
+{
+	char path[PATH_MAX] = {'\0'};
+	xml_node_t *store, *node;
+	unsigned int ifindex;
+	ni_bool_t rv = TRUE;
+
+	ni_client_state_store_filename(path, sizeof(path));
+	if (!ni_file_exists(path) || !(store = ni_client_state_read_xml(path)))
+		return TRUE;
+
+	for (node = store->children; node; node = node->next) {
+		if (!ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE) ||
+		    !xml_node_get_attr_uint(node, "ifindex", &ifindex))
+			continue;
+
+		xml_node_del_attr(node, "ifindex");
+		ni_client_state_filename(ifindex, path, sizeof(path));
+		if (!ni_client_state_write_xml(node, path, TRUE))
+			rv = FALSE;
+	}
+	xml_node_free(store);
+
+	ni_client_state_store_filename(path, sizeof(path));
+	if (rv && unlink(path) < 0 && errno != ENOENT) {
+		ni_error("Cannot remove state file '%s': %m", path);
+		rv = FALSE;
+	}
+	return rv;
+}
+
+/*
+ * Enable write-behind with a flush delay in msec or with the indexed
+ * store only (delay 0); disable both with (0, FALSE).
+ */
+void
+ni_client_state_write_behind(unsigned int delay, ni_bool_t indexed)
+{
+	struct ni_client_state_writer *w = &ni_client_state_writer;
+
+	ni_client_state_flush();
+
+	w->delay = delay;
+	w->indexed = indexed;
+	xml_node_free(w->store);
+	w->store = NULL;
+
+	if (!indexed)
+		ni_client_state_store_export();
+}
+
+/*
+ * Also queue while states failed to write after write-behind has been
+ * disabled, so they are not shadowing or overwriting newer updates.
+ */
+static inline ni_bool_t
+ni_client_state_write_behind_enabled(void)
+{
+	return ni_client_state_writer.delay || ni_client_state_writer.indexed ||
+		ni_client_state_writer.count;
+}
+
+ni_bool_t
+ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex)
+{
+	char path[PATH_MAX] = {'\0'};
+	xml_node_t *node;
+	ni_bool_t rv;
+
+	if (!(node = ni_client_state_format_xml(client_state, ifindex)))
+		return FALSE;
+
+	if (ni_client_state_write_behind_enabled())
+		return ni_client_state_queue(ifindex, node);
+
+	ni_client_state_filename(ifindex, path, sizeof(path));
+	rv = ni_client_state_write_xml(node, path, FALSE);
+	xml_node_free(node);
+	return rv;
+}
+
+/*
+ * Find the current state node of ifindex (queued, indexed, file)
+ */
+static const xml_node_t *
+ni_client_state_lookup(unsigned int ifindex, xml_node_t **xml, char *path, size_t size)
+{
+	const ni_client_state_pending_t *p;
+	const xml_node_t *node;
+	xml_node_t *store;
+
+	*xml = NULL;
+	if ((p = ni_client_state_pending_find(ifindex))) {
+		snprintf(path, size, "queued state of ifindex %u", ifindex);
+		return p->node;
+	}
+
+	if (ni_client_state_writer.indexed) {
+		store = ni_client_state_store();
+		if ((node = ni_client_state_store_find(store, ifindex))) {
+			ni_client_state_store_filename(path, size);
+			return node;
+		}
+	}
+
+	ni_client_state_filename(ifindex, path, size);
+	if (!(*xml = ni_client_state_read_xml(path)))
+		return NULL;
+
+	node = (*xml)->name ? *xml : (*xml)->children;
 	if (!node || !ni_string_eq(node->name, NI_CLIENT_STATE_XML_NODE)) {
 		ni_error("State file '%s' does not contain %s node",
 			path, NI_CLIENT_STATE_XML_NODE);
+		return NULL;
+	}
+	return node;
+}
+
+ni_bool_t
+ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
+{
+	char path[PATH_MAX] = {'\0'};
+	const xml_node_t *node;
+	xml_node_t *xml = NULL;
+
+	if (!client_state)
+		return FALSE;
+
+	if (!(node = ni_client_state_lookup(ifindex, &xml, path, sizeof(path)))) {
 		xml_node_free(xml);
 		return FALSE;
 	}
@@ -528,7 +897,6 @@ ni_client_state_load(ni_client_state_t *client_state, unsigned int ifindex)
 	return TRUE;
 }
 
-
 ni_bool_t
 ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 {
@@ -538,6 +906,25 @@ ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 	if (ifindex_old == ifindex_new)
 		return TRUE;
 
+	if (ni_client_state_write_behind_enabled()) {
+		const xml_node_t *node;
+		xml_node_t *xml = NULL;
+		xml_node_t *copy;
+
+		node = ni_client_state_lookup(ifindex_old, &xml, path_old, sizeof(path_old));
+		copy = node ? xml_node_clone(node, NULL) : NULL;
+		xml_node_free(xml);
+		if (!copy) {
+			ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_READWRITE,
+				"no state of ifindex %u to move to %u", ifindex_old, ifindex_new);
+			return TRUE;
+		}
+		xml_node_del_attr(copy, "ifindex");
+
+		return ni_client_state_queue(ifindex_new, copy) &&
+			ni_client_state_queue(ifindex_old, NULL);
+	}
+
 	ni_client_state_filename(ifindex_old, path_old, sizeof(path_old));
 	ni_client_state_filename(ifindex_new, path_new, sizeof(path_new));
 
@@ -558,6 +945,9 @@ ni_client_state_drop(unsigned int ifindex)
 {
 	char path[PATH_MAX] = {'\0'};
 
+	if (ni_client_state_write_behind_enabled())
+		return ni_client_state_queue(ifindex, NULL);
+
 	ni_client_state_filename(ifindex, path, sizeof(path));
 
 	if (unlink(path) < 0) {
@@ -13,6 +13,7 @@
 #include <wicked/logging.h>
 
 #define NI_CLIENT_STATE_XML_NODE		"client-state"
+#define NI_CLIENT_STATE_STORE_FILE		"client-state.xml"
 
 #define NI_CLIENT_STATE_XML_CONTROL_NODE	"control"
 #define NI_CLIENT_STATE_XML_PERSISTENT_NODE	"persistent"
@@ -82,6 +83,8 @@ extern ni_bool_t	ni_client_state_load(ni_client_state_t *, unsigned int);
 extern ni_bool_t	ni_client_state_save(const ni_client_state_t *, unsigned int);
 extern ni_bool_t	ni_client_state_move(unsigned int, unsigned int);
 extern ni_bool_t	ni_client_state_drop(unsigned int);
+extern void		ni_client_state_write_behind(unsigned int, ni_bool_t);
+extern ni_bool_t	ni_client_state_flush(void);
 extern ni_bool_t	ni_client_state_set_persistent(xml_node_t *);
 
 extern void		ni_client_state_control_debug(const char *, const ni_client_state_control_t *, const char *);
@@ -39,6 +39,9 @@ static const char *__ni_ifconfig_source_types[] = {
 static ni_bool_t	ni_config_parse_addrconf_dhcp4(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_addrconf_dhcp6(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_addrconf_auto6(ni_config_auto6_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_arp(ni_config_arp_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_lease_file(ni_config_lease_file_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_updater(ni_config_updater_t *, xml_node_t *);
 static void		ni_config_parse_update_targets(unsigned int *, const xml_node_t *);
 static void		ni_config_parse_update_dhcp4_routes(unsigned int *, const xml_node_t *);
 static void		ni_config_parse_fslocation(ni_config_fslocation_t *, xml_node_t *);
@@ -49,6 +52,7 @@ static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *)
 static ni_bool_t	ni_config_parse_extension(ni_extension_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_client_state(ni_config_client_state_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static ni_c_binding_t *	ni_c_binding_new(ni_c_binding_t **, const char *name, const char *lib, const char *symbol);
@@ -82,6 +86,8 @@ ni_config_new()
 	conf->addrconf.dhcp4.routes_opts = -1U;
 	conf->addrconf.dhcp6.release_nretries = -1U;
 	conf->addrconf.dhcp6.info_refresh.range.max = NI_LIFETIME_INFINITE;
+	conf->addrconf.arp.verify.rate = NI_CONFIG_ARP_VERIFY_RATE;
+	conf->addrconf.lease_file.max_records = NI_CONFIG_LEASE_FILE_MAX_RECORDS;
 
 	ni_config_fslocation_init(&conf->piddir,   WICKED_PIDDIR,   0755);
 	ni_config_fslocation_init(&conf->statedir, WICKED_STATEDIR, 0755);
@@ -91,6 +97,10 @@ ni_config_new()
 
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
+	conf->rtnl_event.device_filter = FALSE;
+
+	conf->client_state.write_behind = 0;
+	conf->client_state.indexed_store = FALSE;
 
 	/* we enable it explicitly in wickedd only */
 	conf->teamd.enabled = FALSE;
@@ -114,6 +124,7 @@ ni_config_dhcp4_clone(const ni_config_dhcp4_t *src, const char *device)
 	ni_string_dup(&dst->device, device);
 
 	dst->lease_time = src->lease_time;
+	dst->renew = src->renew;
 	dst->allow_update = src->allow_update;
 	ni_string_dup(&dst->vendor_class, src->vendor_class);
 	ni_string_array_copy(&dst->ignore_servers, &src->ignore_servers);
@@ -177,6 +188,7 @@ ni_config_dhcp6_clone(const ni_config_dhcp6_t *src, const char *device)
 	ni_string_dup(&dst->device, device);
 
 	dst->lease_time = src->lease_time;
+	dst->renew = src->renew;
 	dst->allow_update = src->allow_update;
 	ni_string_dup(&dst->default_duid, src->default_duid);
 	dst->create_duid = src->create_duid;
@@ -246,6 +258,7 @@ ni_config_free(ni_config_t *conf)
 	ni_extension_list_destroy(&conf->updater_extensions);
 	ni_string_free(&conf->dbus_name);
 	ni_string_free(&conf->dbus_type);
+	ni_string_free(&conf->teamd.socket_dir);
 	ni_string_free(&conf->dbus_xml_schema_file);
 	ni_config_fslocation_destroy(&conf->piddir);
 	ni_config_fslocation_destroy(&conf->storedir);
@@ -376,6 +389,18 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (!strcmp(gchild->name, "auto6")
 				 && !ni_config_parse_addrconf_auto6(&conf->addrconf.auto6, gchild))
 					goto failed;
+
+				if (!strcmp(gchild->name, "arp")
+				 && !ni_config_parse_addrconf_arp(&conf->addrconf.arp, gchild))
+					goto failed;
+
+				if (!strcmp(gchild->name, "lease-file")
+				 && !ni_config_parse_addrconf_lease_file(&conf->addrconf.lease_file, gchild))
+					goto failed;
+
+				if (!strcmp(gchild->name, "updater")
+				 && !ni_config_parse_addrconf_updater(&conf->addrconf.updater, gchild))
+					goto failed;
 			}
 		} else
 		if (strcmp(child->name, "sources") == 0) {
@@ -406,6 +431,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "client-state") == 0) {
+			if (!ni_config_parse_client_state(&conf->client_state, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -513,6 +542,32 @@ ni_config_dhcp4_cid_type_parse(ni_config_dhcp4_cid_type_t *type, const char *nam
 	return ni_parse_uint_mapped(name, config_dhcp6_cid_type_names, type);
 }
 
+static void
+ni_config_parse_dhcp_renew(ni_config_dhcp_renew_t *renew, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int *value;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "jitter"))
+			value = &renew->jitter;
+		else
+		if (ni_string_eq(child->name, "stagger"))
+			value = &renew->stagger;
+		else
+		if (ni_string_eq(child->name, "rate"))
+			value = &renew->rate;
+		else
+			continue;
+
+		if (ni_parse_uint(child->cdata, value, 10) < 0) {
+			ni_warn("%s: discarding invalid renew %s value \"%s\"",
+				xml_node_location(child), child->name, child->cdata);
+			*value = 0;
+		}
+	}
+}
+
 static ni_bool_t
 ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 {
@@ -530,6 +585,9 @@ ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 		if (!strcmp(child->name, "lease-time") && child->cdata)
 			dhcp4->lease_time = strtoul(child->cdata, NULL, 0);
 		else
+		if (ni_string_eq(child->name, "renew"))
+			ni_config_parse_dhcp_renew(&dhcp4->renew, child);
+		else
 		if (!strcmp(child->name, "ignore-server")) {
 			if ((attrval = xml_node_get_attr(child, "ip")) != NULL)
 				ni_string_array_append(&dhcp4->ignore_servers, attrval);
@@ -1076,6 +1134,9 @@ ni_config_parse_addrconf_dhcp6_nodes(ni_config_dhcp6_t *dhcp6, xml_node_t *node)
 		if (!strcmp(child->name, "release-retransmits") && child->cdata) {
 			dhcp6->release_nretries = strtoul(child->cdata, NULL, 0);
 		} else
+		if (ni_string_eq(child->name, "renew")) {
+			ni_config_parse_dhcp_renew(&dhcp6->renew, child);
+		} else
 		if (!strcmp(child->name, "info-refresh-time")) {
 			const char *attrval;
 			unsigned int value;
@@ -1236,6 +1297,72 @@ ni_config_parse_addrconf_auto6(ni_config_auto6_t *auto6, xml_node_t *node)
 	return TRUE;
 }
 
+ni_bool_t
+ni_config_parse_addrconf_arp(ni_config_arp_t *arp, xml_node_t *node)
+{
+	xml_node_t *child;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "verify-rate")) {
+			if (ni_parse_uint(child->cdata, &arp->verify.rate, 10) < 0) {
+				ni_error("%s: invalid arp verify-rate value \"%s\"",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+static const ni_intmap_t	config_lease_file_format_names[] = {
+	{ "xml",		NI_CONFIG_LEASE_FILE_XML	},
+	{ "binary",		NI_CONFIG_LEASE_FILE_BINARY	},
+	{ NULL,			-1U				}
+};
+
+ni_bool_t
+ni_config_parse_addrconf_lease_file(ni_config_lease_file_t *lf, xml_node_t *node)
+{
+	xml_node_t *child;
+	unsigned int format;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "format")) {
+			if (ni_parse_uint_mapped(child->cdata, config_lease_file_format_names, &format) < 0) {
+				ni_error("%s: invalid lease-file format \"%s\"",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			lf->format = format;
+		} else
+		if (ni_string_eq(child->name, "max-records")) {
+			if (ni_parse_uint(child->cdata, &lf->max_records, 10) < 0) {
+				ni_error("%s: invalid lease-file max-records value \"%s\"",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+ni_bool_t
+ni_config_parse_addrconf_updater(ni_config_updater_t *updater, xml_node_t *node)
+{
+	xml_node_t *child;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "batch-window")) {
+			if (ni_parse_uint(child->cdata, &updater->batch_window, 10) < 0) {
+				ni_error("%s: invalid updater batch-window value \"%s\"",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
 void
 ni_config_parse_update_targets(unsigned int *update_mask, const xml_node_t *node)
 {
@@ -1535,11 +1662,57 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 		if (ni_string_eq(child->name, "message-buffer-length")) {
 			if (ni_parse_uint(child->cdata, &conf->mesg_buff_length, 0))
 				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "device-filter")) {
+			if (ni_parse_boolean(child->cdata, &conf->device_filter))
+				return FALSE;
 		}
 	}
 	return TRUE;
 }
 
+ni_bool_t
+ni_config_rtnl_event_device_filter(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_event.device_filter : FALSE;
+}
+
+/*
+ * client-state write options
+ */
+ni_bool_t
+ni_config_parse_client_state(ni_config_client_state_t *conf, xml_node_t *node)
+{
+	xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "write-behind")) {
+			if (ni_parse_uint(child->cdata, &conf->write_behind, 0))
+				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "indexed-store")) {
+			if (ni_parse_boolean(child->cdata, &conf->indexed_store))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+unsigned int
+ni_config_client_state_write_behind(void)
+{
+	return ni_global.config ? ni_global.config->client_state.write_behind : 0;
+}
+
+ni_bool_t
+ni_config_client_state_indexed_store(void)
+{
+	return ni_global.config ? ni_global.config->client_state.indexed_store : FALSE;
+}
+
 /*
  * bonding support config options
  */
@@ -1641,6 +1814,14 @@ ni_config_teamd_ctl(void)
 	return ni_global.config ? ni_global.config->teamd.ctl : NI_CONFIG_TEAMD_CTL_DETECT_ONCE;
 }
 
+const char *
+ni_config_teamd_socket_dir(void)
+{
+	if (ni_global.config && !ni_string_empty(ni_global.config->teamd.socket_dir))
+		return ni_global.config->teamd.socket_dir;
+	return NI_CONFIG_TEAMD_SOCKET_DIR;
+}
+
 ni_bool_t
 ni_config_teamd_enable(ni_config_teamd_ctl_t type)
 {
@@ -1686,6 +1867,9 @@ ni_config_parse_teamd(ni_config_teamd_t *conf, const xml_node_t *node)
 				return FALSE;
 			}
 		}
+		if (ni_string_eq(child->name, "socket-dir")) {
+			ni_string_dup(&conf->socket_dir, child->cdata);
+		}
 	}
 	return TRUE;
 }
@@ -1946,6 +2130,33 @@ ni_config_use_nanny(void)
 	return ni_global.config ? ni_global.config->use_nanny : FALSE;
 }
 
+unsigned int
+ni_config_addrconf_arp_verify_rate(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.arp.verify.rate :
+				  NI_CONFIG_ARP_VERIFY_RATE;
+}
+
+ni_config_lease_file_format_t
+ni_config_addrconf_lease_file_format(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.lease_file.format :
+				  NI_CONFIG_LEASE_FILE_XML;
+}
+
+unsigned int
+ni_config_addrconf_lease_file_max_records(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.lease_file.max_records :
+				  NI_CONFIG_LEASE_FILE_MAX_RECORDS;
+}
+
+unsigned int
+ni_config_addrconf_updater_batch_window(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.updater.batch_window : 0;
+}
+
 void
 ni_config_fslocation_init(ni_config_fslocation_t *loc, const char *path, unsigned int mode)
 {
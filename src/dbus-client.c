@@ -471,37 +471,16 @@ ni_dbus_object_call_async(ni_dbus_object_t *proxy,
 }
 
 /*
- * Use ObjectManager.GetManagedObjects to retrieve (part of)
- * the server's object hierarchy
+ * Parse an a{sv} dict of object paths and their interface dicts,
+ * creating or updating the proxy objects below the given one
  */
-dbus_bool_t
-ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni_bool_t purge)
+static dbus_bool_t
+__ni_dbus_object_get_managed_object_dict(ni_dbus_object_t *proxy, DBusMessageIter *iter)
 {
-	ni_dbus_client_t *client;
-	ni_dbus_object_t *objmgr;
-	ni_dbus_message_t *call = NULL, *reply = NULL;
-	DBusMessageIter iter, iter_dict;
-	dbus_bool_t rv = FALSE;
+	DBusMessageIter iter_dict;
 
-	if (!(client = ni_dbus_object_get_client(proxy))) {
-		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
+	if (!ni_dbus_message_open_dict_read(iter, &iter_dict))
 		return FALSE;
-	}
-
-	if (purge)
-		__ni_dbus_object_mark_stale(proxy);
-
-	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
-			NI_DBUS_INTERFACE ".ObjectManager",
-			NULL);
-
-	call = ni_dbus_object_call_new(objmgr, "GetManagedObjects", 0);
-	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
-		goto out;
-
-	dbus_message_iter_init(reply, &iter);
-	if (!ni_dbus_message_open_dict_read(&iter, &iter_dict))
-		goto bad_reply;
 	while (dbus_message_iter_get_arg_type(&iter_dict) == DBUS_TYPE_DICT_ENTRY) {
 		DBusMessageIter iter_dict_entry;
 		ni_dbus_object_t *descendant;
@@ -511,11 +490,11 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 		dbus_message_iter_next(&iter_dict);
 
 		if (dbus_message_iter_get_arg_type(&iter_dict_entry) != DBUS_TYPE_STRING)
-			goto bad_reply;
+			return FALSE;
 		dbus_message_iter_get_basic(&iter_dict_entry, &object_path);
 
 		if (!dbus_message_iter_next(&iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant = ni_dbus_object_create(proxy, object_path, NULL, NULL);
 
@@ -538,11 +517,47 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 			descendant->class->initialize(descendant);
 
 		if (!__ni_dbus_object_get_managed_object_interfaces(descendant, &iter_dict_entry))
-			goto bad_reply;
+			return FALSE;
 
 		descendant->stale = FALSE;
 	}
 
+	return TRUE;
+}
+
+/*
+ * Use ObjectManager.GetManagedObjects to retrieve (part of)
+ * the server's object hierarchy
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni_bool_t purge)
+{
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *objmgr;
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	DBusMessageIter iter;
+	dbus_bool_t rv = FALSE;
+
+	if (!(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
+		return FALSE;
+	}
+
+	if (purge)
+		__ni_dbus_object_mark_stale(proxy);
+
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
+			NI_DBUS_INTERFACE ".ObjectManager",
+			NULL);
+
+	call = ni_dbus_object_call_new(objmgr, "GetManagedObjects", 0);
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL)
+		goto out;
+
+	dbus_message_iter_init(reply, &iter);
+	if (!__ni_dbus_object_get_managed_object_dict(proxy, &iter))
+		goto bad_reply;
+
 	if (purge)
 		__ni_dbus_object_purge_stale(proxy);
 
@@ -561,6 +576,98 @@ bad_reply:
 	goto out;
 }
 
+/*
+ * Use ObjectManager.GetManagedObjectsSince to update the proxy objects
+ * with the changes since the generation of our previous call. On return,
+ * *generation is set to the server's current generation, to be passed
+ * into the next call. Servers without the method get a full refresh.
+ */
+dbus_bool_t
+ni_dbus_object_get_managed_objects_since(ni_dbus_object_t *proxy, unsigned int *generation,
+				DBusError *error)
+{
+	ni_dbus_client_t *client;
+	ni_dbus_object_t *objmgr, *removed;
+	ni_dbus_message_t *call = NULL, *reply = NULL;
+	DBusMessageIter iter, iter_array;
+	dbus_uint32_t since = *generation;
+	dbus_bool_t reset = FALSE;
+	const char *path;
+	dbus_bool_t rv = FALSE;
+
+	if (!(client = ni_dbus_object_get_client(proxy))) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "%s: not a client object", __FUNCTION__);
+		return FALSE;
+	}
+
+	objmgr = ni_dbus_client_object_new(client, &ni_dbus_anonymous_class, proxy->path,
+			NI_DBUS_INTERFACE ".ObjectManager",
+			NULL);
+
+	call = ni_dbus_object_call_new(objmgr, "GetManagedObjectsSince",
+			DBUS_TYPE_UINT32, &since, 0);
+	if ((reply = ni_dbus_client_call(client, call, error)) == NULL) {
+		if (dbus_error_has_name(error, DBUS_ERROR_UNKNOWN_METHOD)) {
+			dbus_error_free(error);
+			*generation = 0;
+			rv = ni_dbus_object_get_managed_objects(proxy, error, TRUE);
+		}
+		goto out;
+	}
+
+	dbus_message_iter_init(reply, &iter);
+	if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_UINT32)
+		goto bad_reply;
+	dbus_message_iter_get_basic(&iter, &since);
+
+	if (!dbus_message_iter_next(&iter)
+	 || dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_BOOLEAN)
+		goto bad_reply;
+	dbus_message_iter_get_basic(&iter, &reset);
+	dbus_message_iter_next(&iter);
+
+	if (reset)
+		__ni_dbus_object_mark_stale(proxy);
+
+	if (!__ni_dbus_object_get_managed_object_dict(proxy, &iter))
+		goto bad_reply;
+
+	if (reset)
+		__ni_dbus_object_purge_stale(proxy);
+
+	if (dbus_message_iter_next(&iter)) {
+		if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+			goto bad_reply;
+		dbus_message_iter_recurse(&iter, &iter_array);
+		while (dbus_message_iter_get_arg_type(&iter_array) == DBUS_TYPE_STRING) {
+			dbus_message_iter_get_basic(&iter_array, &path);
+			dbus_message_iter_next(&iter_array);
+
+			if ((removed = ni_dbus_object_lookup(proxy, path)) && removed != proxy) {
+				ni_debug_dbus("purging removed object %s", removed->path);
+				ni_dbus_object_free(removed);
+			}
+		}
+	}
+
+	ni_debug_dbus("%s: refreshed objects changed since generation %u, now %u%s",
+			proxy->path, *generation, since, reset ? " (full)" : "");
+	*generation = since;
+	rv = TRUE;
+
+out:
+	if (call)
+		dbus_message_unref(call);
+	if (reply)
+		dbus_message_unref(reply);
+	ni_dbus_object_free(objmgr);
+	return rv;
+
+bad_reply:
+	dbus_set_error(error, DBUS_ERROR_FAILED, "%s: failed to parse reply", __FUNCTION__);
+	goto out;
+}
+
 static dbus_bool_t
 __ni_dbus_object_get_managed_object_interfaces(ni_dbus_object_t *proxy, DBusMessageIter *iter)
 {
@@ -792,6 +899,21 @@ ni_dbus_object_refresh_children(ni_dbus_object_t *proxy)
 	return rv;
 }
 
+dbus_bool_t
+ni_dbus_object_refresh_children_since(ni_dbus_object_t *proxy, unsigned int *generation)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	dbus_bool_t rv;
+
+	rv = ni_dbus_object_get_managed_objects_since(proxy, generation, &error);
+	if (!rv) {
+		ni_dbus_print_error(&error, "%s.getManagedObjectsSince failed", proxy->path);
+		*generation = 0;
+	}
+	dbus_error_free(&error);
+	return rv;
+}
+
 /*
  * Use Properties.GetAll to refresh the properties of an object
  */
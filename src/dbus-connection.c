@@ -17,6 +17,7 @@
 #include "dbus-connection.h"
 #include "dbus-dict.h"
 #include "process.h"
+#include "metrics.h"
 #include "debug.h"
 
 #undef DEBUG_WATCH_VERBOSE
@@ -310,8 +311,10 @@ ni_dbus_connection_call(ni_dbus_connection_t *connection,
 {
 	DBusPendingCall *pending;
 	DBusMessage *reply;
+	struct timespec start;
 	int msgtype;
 
+	ni_metrics_start(&start);
 	if (!dbus_connection_send_with_reply(connection->conn, call, &pending, call_timeout)) {
 		dbus_set_error(error, DBUS_ERROR_FAILED,
 				"unable to send DBus message (errno=%d)", errno);
@@ -323,6 +326,7 @@ ni_dbus_connection_call(ni_dbus_connection_t *connection,
 	}
 
 	dbus_pending_call_block(pending);
+	ni_metrics_observe_since(NI_METRIC_HISTOGRAM_DBUS_CALL, &start);
 
 	/* This makes sure that any signals we received while waiting for the reply
 	 * do get dispatched. */
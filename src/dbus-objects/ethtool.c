@@ -33,6 +33,7 @@
 #include <wicked/dbus-service.h>
 #include <net/if_arp.h>
 #include <limits.h>
+#include "netinfo_priv.h"
 #include "dbus-common.h"
 #include "model.h"
 #include "debug.h"
@@ -99,8 +100,10 @@ ni_objectmodel_ethtool_handle(const ni_dbus_object_t *object,
 	if (!(dev = ni_objectmodel_unwrap_netif(object, error)))
 		return NULL;
 
-	if (!write_access)
+	if (!write_access) {
+		ni_system_ethtool_revalidate(dev);
 		return dev->ethtool;
+	}
 
 	return ni_netdev_get_ethtool(dev);
 }
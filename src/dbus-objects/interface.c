@@ -1218,6 +1218,12 @@ ni_objectmodel_send_netif_event(ni_dbus_server_t *server, ni_dbus_object_t *obje
 		return FALSE;
 	}
 
+	/* journal lease and device state changes for recovery */
+	if (ifevent == NI_EVENT_DEVICE_DELETE)
+		ni_objectmodel_state_journal_delete(object);
+	else
+		ni_objectmodel_state_journal_update(object);
+
 	return __ni_objectmodel_device_event(server, object, NI_OBJECTMODEL_NETIF_INTERFACE, ifevent, uuid);
 }
 
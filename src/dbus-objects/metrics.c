@@ -0,0 +1,118 @@
+/*
+ *	DBus encapsulation of the runtime metrics
+ *
+ *	Copyright (C) 2015 SUSE Linux GmbH, Nuernberg, Germany.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ * The org.opensuse.Network.Metrics interface is provided on the root
+ * object of each wicked daemon and reports the counters of that process.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/objectmodel.h>
+#include "dbus-common.h"
+#include "model.h"
+#include "metrics.h"
+
+static dbus_bool_t
+ni_objectmodel_metrics_histogram_to_dict(const ni_metrics_histogram_t *h, ni_dbus_variant_t *dict)
+{
+	ni_dbus_variant_t *buckets;
+	unsigned int i;
+
+	ni_dbus_variant_init_dict(dict);
+	ni_dbus_dict_add_uint64(dict, "count", h->count);
+	ni_dbus_dict_add_uint64(dict, "sum", h->sum);
+
+	/* non-empty buckets only, keyed by their upper bound in usec */
+	if (!(buckets = ni_dbus_dict_add(dict, "buckets")))
+		return FALSE;
+	ni_dbus_variant_init_dict(buckets);
+	for (i = 0; i < NI_METRICS_BUCKETS; ++i) {
+		if (!h->bucket[i])
+			continue;
+		ni_dbus_dict_add_uint64(buckets, ni_metrics_bucket_name(i), h->bucket[i]);
+	}
+	return TRUE;
+}
+
+/*
+ * Metrics.getMetrics
+ */
+static dbus_bool_t
+ni_objectmodel_metrics_get(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	const ni_metric_info_t *info;
+	ni_dbus_variant_t *dict;
+	unsigned int i;
+	dbus_bool_t rv;
+
+	if (argc != 0) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s.%s: unexpected arguments",
+				object->path, method->name);
+		return FALSE;
+	}
+
+	ni_dbus_variant_init_dict(&result);
+	for (i = 0; (info = ni_metrics_info(i)); ++i)
+		ni_dbus_dict_add_uint64(&result, info->name, ni_metrics_value[i]);
+
+	for (i = 0; (info = ni_metrics_histogram_info(i)); ++i) {
+		if (!(dict = ni_dbus_dict_add(&result, info->name)) ||
+		    !ni_objectmodel_metrics_histogram_to_dict(&ni_metrics_histogram[i], dict)) {
+			ni_dbus_variant_destroy(&result);
+			dbus_set_error(error, DBUS_ERROR_FAILED,
+					"%s.%s: unable to build metrics dict",
+					object->path, method->name);
+			return FALSE;
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		ni_objectmodel_metrics_methods[] = {
+	{ "getMetrics",		"",		.handler = ni_objectmodel_metrics_get },
+	{ NULL }
+};
+
+static ni_dbus_service_t	ni_objectmodel_metrics_service = {
+	.name		= NI_OBJECTMODEL_METRICS_INTERFACE,
+	.methods	= ni_objectmodel_metrics_methods,
+};
+
+/*
+ * Provide the metrics interface on the root object of a server
+ */
+void
+ni_objectmodel_register_metrics(ni_dbus_server_t *server)
+{
+	ni_dbus_object_t *object;
+
+	if ((object = ni_dbus_server_get_root_object(server)))
+		ni_dbus_object_register_service(object, &ni_objectmodel_metrics_service);
+}
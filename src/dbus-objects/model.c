@@ -131,6 +131,7 @@ ni_objectmodel_create_initial_objects(ni_dbus_server_t *server)
 	/* Register root interface with the root of the object hierarchy */
 	object = ni_dbus_server_get_root_object(server);
 	ni_dbus_object_register_service(object, &ni_objectmodel_netif_root_interface);
+	ni_objectmodel_register_metrics(server);
 
 	ni_objectmodel_create_netif_list(server);
 #ifdef MODEM
@@ -3,19 +3,75 @@
  * This can be used to retain things like addrconf state across daemon
  * restarts.
  *
+ * Changes between two saves are appended to a journal file, which is
+ * merged into the (snapshot) state file on recovery and compacted into
+ * a new snapshot when it grows too large.
+ *
  * Copyright (C) 2012 Olaf Kirch <okir@suse.de>
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/dbus.h>
 #include <wicked/objectmodel.h>
+#include <wicked/socket.h>
 #include <wicked/xml.h>
+#include "util_priv.h"
+#include "xml-schema.h"
 #include "model.h"
 
+#define NI_OBJECTMODEL_STATE_JOURNAL_SUFFIX	".journal"
+#define NI_OBJECTMODEL_STATE_SNAPSHOT_NODE	"snapshot"
+#define NI_OBJECTMODEL_STATE_JOURNAL_DELAY	250	/* msec */
+#define NI_OBJECTMODEL_STATE_JOURNAL_RECORDS	256
+
+typedef struct ni_objectmodel_state_journal {
+	char *			filename;
+	char *			pathname;
+	const char **		prefix_list;
+	unsigned long		generation;
+
+	int			fd;
+	unsigned int		records;
+	ni_var_array_t		pending;
+	ni_var_array_t		written;
+	const ni_timer_t *	timer;
+} ni_objectmodel_state_journal_t;
+
+static ni_objectmodel_state_journal_t *	ni_objectmodel_state_journal;
+
+static ni_bool_t
+ni_objectmodel_state_prefix_match(const char *interface_name, const char **prefix_list)
+{
+	ni_bool_t match = FALSE;
+	unsigned int i;
+
+	if (!prefix_list)
+		return TRUE;
+
+	for (i = 0; prefix_list[i] && !match; ++i) {
+		const char *pfx = prefix_list[i];
+		unsigned int len;
+
+		len = strlen(pfx);
+		match = !strncmp(pfx, interface_name, len)
+			&& (interface_name[len] == '.' || interface_name[len] == '\0');
+	}
+	return match;
+}
+
 /*
  * Get the state of a dbus object as XML.
  * We do this by going via the dbus representation, which is a bit of a waste of
@@ -23,8 +79,9 @@
  * that we have one canonical mapping.
  * In fact, this is a lot like doing a Properties.GetAll call...
  */
-static ni_bool_t
-ni_objectmodel_save_object_state_xml(const ni_dbus_object_t *object, xml_node_t *parent)
+static xml_node_t *
+ni_objectmodel_save_object_state_xml(const ni_dbus_object_t *object, xml_node_t *parent,
+		const char **prefix_list, unsigned long generation)
 {
 	const ni_dbus_service_t *service;
 	xml_node_t *object_node;
@@ -33,11 +90,16 @@ ni_objectmodel_save_object_state_xml(const ni_dbus_object_t *object, xml_node_t
 
 	object_node = xml_node_new("object", parent);
 	xml_node_add_attr(object_node, "path", object->path);
+	if (generation)
+		xml_node_add_attr_ulong(object_node, "generation", generation);
 
 	for (i = 0; rv && (service = object->interfaces[i]) != NULL; ++i) {
 		ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
 		xml_node_t *prop_node;
 
+		if (!ni_objectmodel_state_prefix_match(service->name, prefix_list))
+			continue;
+
 		ni_dbus_variant_init_dict(&dict);
 		rv = ni_dbus_object_get_properties_as_dict(object, service, &dict, NULL);
 		if (rv && dict.array.len != 0) {
@@ -45,11 +107,20 @@ ni_objectmodel_save_object_state_xml(const ni_dbus_object_t *object, xml_node_t
 			prop_node = ni_dbus_xml_deserialize_properties(__ni_objectmodel_schema, service->name, &dict, object_node);
 			if (!prop_node)
 				rv = FALSE;
+		} else
+		if (rv && prefix_list && service->schema) {
+			/* journal record: an empty node drops the service state */
+			xml_node_new(service->schema->name, object_node);
 		}
 		ni_dbus_variant_destroy(&dict);
 	}
 
-	return rv;
+	if (!rv) {
+		xml_node_detach(object_node);
+		xml_node_free(object_node);
+		return NULL;
+	}
+	return object_node;
 }
 
 static ni_bool_t
@@ -65,43 +136,90 @@ ni_objectmodel_save_state_xml(xml_node_t *list, ni_dbus_server_t *server)
 	}
 
 	for (netif_object = object->children; rv && netif_object; netif_object = netif_object->next) {
-		rv = ni_objectmodel_save_object_state_xml(netif_object, list);
+		rv = !!ni_objectmodel_save_object_state_xml(netif_object, list, NULL, 0);
 	}
 
 	return rv;
 }
 
-ni_bool_t
-ni_objectmodel_save_state(const char *filename)
+static ni_bool_t
+__ni_objectmodel_save_state(const char *filename, unsigned long generation)
 {
+	char tempname[PATH_MAX] = {'\0'};
 	xml_document_t *doc;
+	xml_node_t *list;
 	ni_bool_t rv = FALSE;
 	FILE *fp = NULL;
+	int fd;
 
 	ni_debug_objectmodel("saving server state to %s", filename);
 
 	doc = xml_document_new();
-	if (!ni_objectmodel_save_state_xml(doc->root, __ni_objectmodel_server))
+	list = xml_document_root(doc);
+	if (generation) {
+		/* journal snapshot: only records of its generation apply */
+		list = xml_node_new(NI_OBJECTMODEL_STATE_SNAPSHOT_NODE, list);
+		xml_node_add_attr_ulong(list, "generation", generation);
+	}
+	if (!ni_objectmodel_save_state_xml(list, __ni_objectmodel_server))
+		goto done;
+
+	/* write to a temp file and rename, so a crash never truncates it */
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_error("%s: unable to create temporary state file %s: %m",
+				__func__, tempname);
+		tempname[0] = '\0';
 		goto done;
+	}
+	if (!(fp = fdopen(fd, "we"))) {
+		close(fd);
+		goto done;
+	}
 
-	fp = ni_file_open(filename, "w", 0600);
-	if (xml_document_print(doc, fp) < 0) {
+	if (xml_document_print(doc, fp) < 0 || fflush(fp) || fsync(fileno(fp)) < 0) {
 		ni_error("%s: unable to write server state to %s", __func__, filename);
 		goto done;
 	}
 
+	if (rename(tempname, filename) < 0) {
+		ni_error("%s: unable to rename %s to %s: %m", __func__, tempname, filename);
+		goto done;
+	}
+	tempname[0] = '\0';
 	rv = TRUE;
 
 done:
 	if (fp)
 		fclose(fp);
+	if (tempname[0])
+		unlink(tempname);
 	xml_document_free(doc);
 	return rv;
 }
 
+ni_bool_t
+ni_objectmodel_save_state(const char *filename)
+{
+	return __ni_objectmodel_save_state(filename, 0);
+}
+
 /*
  * Recover object state from an XML file
  */
+static const ni_dbus_service_t *
+ni_objectmodel_state_object_service(const ni_dbus_object_t *object, const char *name)
+{
+	const ni_dbus_service_t *service;
+	unsigned int i;
+
+	for (i = 0; (service = object->interfaces[i]) != NULL; ++i) {
+		if (service->schema && ni_string_eq(service->schema->name, name))
+			return service;
+	}
+	return NULL;
+}
+
 static ni_bool_t
 ni_objectmodel_recover_object_state_xml(xml_node_t *object_node, ni_dbus_object_t *object, const char **prefix_list)
 {
@@ -114,23 +232,16 @@ ni_objectmodel_recover_object_state_xml(xml_node_t *object_node, ni_dbus_object_
 		const ni_dbus_service_t *service;
 		dbus_bool_t rv;
 
-		interface_name = prop_node->name;
-
-		if (prefix_list) {
-			ni_bool_t match = FALSE;
-			unsigned int i;
+		/* property nodes are named by the schema service name */
+		if (!(service = ni_objectmodel_state_object_service(object, prop_node->name)))
+			continue;
 
-			for (i = 0; prefix_list[i] && !match; ++i) {
-				const char *pfx = prefix_list[i];
-				unsigned int len;
+		interface_name = service->name;
+		if (!ni_objectmodel_state_prefix_match(interface_name, prefix_list))
+			continue;
 
-				len = strlen(pfx);
-				match = !strncmp(pfx, interface_name, len)
-					&& (interface_name[len] == '.' || interface_name[len] == '\0');
-			}
-			if (!match)
-				continue;
-		}
+		if (!ni_string_eq(prop_node->name, interface_name))
+			ni_string_dup(&prop_node->name, interface_name);
 
 		/* Parse the XML properties and store in a dbus dict. */
 		if (ni_dbus_xml_serialize_properties(__ni_objectmodel_schema, &dict, prop_node) < 0) {
@@ -139,9 +250,6 @@ ni_objectmodel_recover_object_state_xml(xml_node_t *object_node, ni_dbus_object_
 			return FALSE;
 		}
 
-		/* If ni_dbus_xml_serialize_properties succeeded, the following call cannot fail. */
-		service = ni_objectmodel_service_by_name(interface_name);
-
 		/* Now set the object properties from the dbus dict */
 		rv = ni_dbus_object_set_properties_from_dict(object, service, &dict, NULL);
 		ni_dbus_variant_destroy(&dict);
@@ -191,20 +299,410 @@ ni_objectmodel_recover_state_xml(xml_node_t *list, const char **prefix_list)
 	return TRUE;
 }
 
+/*
+ * Merge the journal records into the state snapshot.
+ *
+ * Each record is a "@<length>\n" header followed by an <object> element
+ * of length bytes, containing the (empty when dropped) state of the
+ * journaled services or a deleted="true" attribute. A truncated or
+ * unparsable record ends the replay; it is the tail of an interrupted
+ * append and everything before it is intact.
+ *
+ * The state file written when the journal is opened or compacted is a
+ * <snapshot> with a generation attribute; only records of exactly this
+ * generation are merged. Records of an older generation are left over
+ * when the journal could not be truncated after a compaction, a state
+ * file without a generation is not a snapshot of the journal at all.
+ */
+static xml_node_t *
+ni_objectmodel_state_find_object(xml_node_t *list, const char *path)
+{
+	xml_node_t *node;
+
+	for (node = list->children; node; node = node->next) {
+		if (ni_string_eq(node->name, "object") &&
+		    ni_string_eq(xml_node_get_attr(node, "path"), path))
+			return node;
+	}
+	return NULL;
+}
+
+static void
+ni_objectmodel_state_merge_record(xml_node_t *list, xml_node_t *record)
+{
+	xml_node_t *object_node, *prop_node;
+	const char *path;
+
+	if (!(path = xml_node_get_attr(record, "path")))
+		return;
+
+	object_node = ni_objectmodel_state_find_object(list, path);
+	if (xml_node_has_attr(record, "deleted")) {
+		if (object_node)
+			xml_node_delete_child_node(list, object_node);
+		return;
+	}
+
+	if (!object_node) {
+		object_node = xml_node_new("object", list);
+		xml_node_add_attr(object_node, "path", path);
+	}
+
+	while ((prop_node = record->children) != NULL) {
+		xml_node_detach(prop_node);
+		if (prop_node->children) {
+			xml_node_replace_child(object_node, prop_node);
+		} else {
+			xml_node_delete_child(object_node, prop_node->name);
+			xml_node_free(prop_node);
+		}
+	}
+}
+
+static unsigned int
+ni_objectmodel_state_journal_replay(xml_node_t *list, unsigned long snapshot, const char *pathname)
+{
+	unsigned long generation;
+	unsigned int records = 0;
+	char *data, *pos, *end;
+	size_t size = 0;
+	xml_node_t *node;
+	FILE *fp;
+
+	if (!(fp = ni_file_open(pathname, "r", 0600)))
+		return 0;
+	data = ni_file_read(fp, &size, 0);
+	fclose(fp);
+	if (!data)
+		return 0;
+
+	for (pos = data, end = data + size; pos < end; ) {
+		xml_document_t *doc;
+		unsigned long len;
+		char *ptr, save;
+
+		if (*pos != '@')
+			break;
+		len = strtoul(pos + 1, &ptr, 10);
+		if (*ptr != '\n' || len == 0 || len > (unsigned long)(end - ptr - 1))
+			break;
+
+		pos = ptr + 1;
+		save = pos[len];
+		pos[len] = '\0';
+		doc = xml_document_from_string(pos, pathname);
+		pos[len] = save;
+		pos += len;
+
+		if (!doc || !(node = xml_document_root(doc)->children)) {
+			xml_document_free(doc);
+			break;
+		}
+
+		generation = 0;
+		xml_node_get_attr_ulong(node, "generation", &generation);
+		if (generation == snapshot) {
+			ni_objectmodel_state_merge_record(list, node);
+			records++;
+		}
+		xml_document_free(doc);
+	}
+
+	if (pos < end)
+		ni_warn("%s: ignoring incomplete journal record at offset %zu",
+				pathname, (size_t)(pos - data));
+
+	free(data);
+	return records;
+}
+
+/*
+ * Read the state file and merge its journal into it; the <object>
+ * list of the returned document is in the document root.
+ */
+xml_document_t *
+ni_objectmodel_state_read(const char *filename)
+{
+	unsigned long generation = 0;
+	xml_node_t *root, *list;
+	xml_document_t *doc;
+	char *pathname = NULL;
+	unsigned int records;
+
+	if (!(doc = xml_document_read(filename))) {
+		ni_error("unable to read server state from %s", filename);
+		return NULL;
+	}
+
+	root = xml_document_root(doc);
+	if (!(list = xml_node_get_child(root, NI_OBJECTMODEL_STATE_SNAPSHOT_NODE)))
+		list = root;
+	else
+		xml_node_get_attr_ulong(list, "generation", &generation);
+
+	ni_string_printf(&pathname, "%s%s", filename, NI_OBJECTMODEL_STATE_JOURNAL_SUFFIX);
+	if (pathname && ni_file_exists(pathname)) {
+		if (generation) {
+			records = ni_objectmodel_state_journal_replay(list, generation, pathname);
+			ni_debug_objectmodel("merged %u journal records from %s", records, pathname);
+		} else {
+			ni_debug_objectmodel("%s is not a journal snapshot, ignoring %s",
+					filename, pathname);
+		}
+	}
+	ni_string_free(&pathname);
+
+	if (list != root) {
+		while (list->children)
+			xml_node_reparent(root, list->children);
+		xml_node_delete_child_node(root, list);
+	}
+	return doc;
+}
+
 ni_bool_t
 ni_objectmodel_recover_state(const char *filename, const char **prefix_list)
 {
 	xml_document_t *doc;
 	ni_bool_t rv;
 
-	if (!(doc = xml_document_read(filename))) {
-		ni_error("unable to read server state from %s", filename);
+	if (!(doc = ni_objectmodel_state_read(filename)))
 		return FALSE;
-	}
 
 	rv = ni_objectmodel_recover_state_xml(doc->root, prefix_list);
 	xml_document_free(doc);
 	return rv;
 }
 
+/*
+ * Server state journal
+ */
+static ni_bool_t
+ni_objectmodel_state_journal_compact(ni_objectmodel_state_journal_t *journal)
+{
+	/* a snapshot of a new generation obsoletes all journal records */
+	if (!__ni_objectmodel_save_state(journal->filename, journal->generation + 1))
+		return FALSE;
+
+	journal->generation++;
+	if (ftruncate(journal->fd, 0) < 0)
+		ni_warn("unable to truncate server state journal %s: %m", journal->pathname);
+
+	journal->records = 0;
+	ni_var_array_destroy(&journal->written);
+	return TRUE;
+}
+
+static char *
+ni_objectmodel_state_journal_record(ni_objectmodel_state_journal_t *journal,
+		const char *path, ni_bool_t deleted)
+{
+	ni_dbus_object_t *object = NULL;
+	xml_node_t *node;
+	char *record;
+
+	if (!deleted)
+		object = ni_objectmodel_object_by_path(path);
+
+	if (object) {
+		node = ni_objectmodel_save_object_state_xml(object, NULL,
+				journal->prefix_list, journal->generation);
+		if (!node)
+			return NULL;
+	} else {
+		node = xml_node_new("object", NULL);
+		xml_node_add_attr(node, "path", path);
+		xml_node_add_attr_ulong(node, "generation", journal->generation);
+		xml_node_add_attr(node, "deleted", "true");
+	}
+
+	record = xml_node_sprint(node);
+	xml_node_free(node);
+	return record;
+}
+
+static void
+ni_objectmodel_state_journal_flush(ni_objectmodel_state_journal_t *journal)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_var_array_t written = NI_VAR_ARRAY_INIT;
+	unsigned int i;
+	const ni_var_t *var;
+	char *record;
+	off_t offset;
+	ssize_t len;
+	size_t done;
+
+	for (i = 0; i < journal->pending.count; ++i) {
+		var = &journal->pending.data[i];
+
+		record = ni_objectmodel_state_journal_record(journal, var->name,
+					ni_string_eq(var->value, "deleted"));
+		if (!record)
+			continue;
+
+		/* unchanged since the last record of the object */
+		if ((var = ni_var_array_get(&journal->written, var->name)) &&
+		    ni_string_eq(var->value, record)) {
+			free(record);
+			continue;
+		}
+
+		ni_stringbuf_printf(&buf, "@%zu\n", strlen(record));
+		ni_stringbuf_puts(&buf, record);
+		ni_var_array_set(&written, journal->pending.data[i].name, record);
+		free(record);
+	}
+	ni_var_array_destroy(&journal->pending);
+
+	if (!written.count)
+		goto done;
+
+	/* the end of the last complete record, to cut off a torn one */
+	offset = lseek(journal->fd, 0, SEEK_END);
+	for (done = 0; done < buf.len; done += len) {
+		len = write(journal->fd, buf.string + done, buf.len - done);
+		if (len < 0 && errno == EINTR) {
+			len = 0;
+			continue;
+		}
+		if (len <= 0) {
+			ni_error("unable to write server state journal %s: %m",
+					journal->pathname);
+			break;
+		}
+	}
+
+	if (done < buf.len) {
+		/* the replay stops at a torn record and would drop all later ones */
+		if (offset < 0 || ftruncate(journal->fd, offset) < 0) {
+			ni_warn("unable to truncate torn server state journal %s: %m",
+					journal->pathname);
+			ni_objectmodel_state_journal_compact(journal);
+		}
+		goto done;
+	}
+
+	if (fdatasync(journal->fd) < 0)
+		ni_warn("unable to sync server state journal %s: %m", journal->pathname);
+
+	for (i = 0; i < written.count; ++i) {
+		var = &written.data[i];
+		ni_var_array_set(&journal->written, var->name, var->value);
+	}
+	journal->records += written.count;
+	if (journal->records >= NI_OBJECTMODEL_STATE_JOURNAL_RECORDS)
+		ni_objectmodel_state_journal_compact(journal);
+
+done:
+	ni_var_array_destroy(&written);
+	ni_stringbuf_destroy(&buf);
+}
 
+static void
+ni_objectmodel_state_journal_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_objectmodel_state_journal_t *journal = user_data;
+
+	if (journal != ni_objectmodel_state_journal || journal->timer != timer)
+		return;
+
+	journal->timer = NULL;
+	ni_objectmodel_state_journal_flush(journal);
+}
+
+static void
+ni_objectmodel_state_journal_mark(const ni_dbus_object_t *object, const char *what)
+{
+	ni_objectmodel_state_journal_t *journal = ni_objectmodel_state_journal;
+
+	if (!journal || !object || ni_string_empty(object->path))
+		return;
+
+	ni_var_array_set(&journal->pending, object->path, what);
+	if (!journal->timer) {
+		journal->timer = ni_timer_register(NI_OBJECTMODEL_STATE_JOURNAL_DELAY,
+				ni_objectmodel_state_journal_timeout, journal);
+	}
+}
+
+void
+ni_objectmodel_state_journal_update(const ni_dbus_object_t *object)
+{
+	ni_objectmodel_state_journal_mark(object, "updated");
+}
+
+void
+ni_objectmodel_state_journal_delete(const ni_dbus_object_t *object)
+{
+	ni_objectmodel_state_journal_mark(object, "deleted");
+}
+
+/*
+ * Start journaling changes to filename.journal; the prefix_list
+ * has to stay valid until the journal is closed.
+ */
+ni_bool_t
+ni_objectmodel_state_journal_open(const char *filename, const char **prefix_list)
+{
+	ni_objectmodel_state_journal_t *journal;
+
+	if (ni_objectmodel_state_journal || ni_string_empty(filename))
+		return FALSE;
+
+	journal = xcalloc(1, sizeof(*journal));
+	ni_string_dup(&journal->filename, filename);
+	ni_string_printf(&journal->pathname, "%s%s", filename, NI_OBJECTMODEL_STATE_JOURNAL_SUFFIX);
+	journal->prefix_list = prefix_list;
+	journal->generation = (unsigned long)time(NULL);
+
+	journal->fd = open(journal->pathname, O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0600);
+	if (journal->fd < 0) {
+		ni_error("unable to open server state journal %s: %m", journal->pathname);
+		goto failed;
+	}
+
+	/* start with a snapshot of the recovered state and an empty journal */
+	if (!ni_objectmodel_state_journal_compact(journal))
+		goto failed;
+
+	ni_objectmodel_state_journal = journal;
+	return TRUE;
+
+failed:
+	if (journal->fd >= 0)
+		close(journal->fd);
+	ni_string_free(&journal->pathname);
+	ni_string_free(&journal->filename);
+	free(journal);
+	return FALSE;
+}
+
+/*
+ * Flush pending changes, write the final snapshot and close the journal.
+ */
+ni_bool_t
+ni_objectmodel_state_journal_close(void)
+{
+	ni_objectmodel_state_journal_t *journal;
+	ni_bool_t rv;
+
+	if (!(journal = ni_objectmodel_state_journal))
+		return FALSE;
+
+	if (journal->timer)
+		ni_timer_cancel(journal->timer);
+	journal->timer = NULL;
+
+	ni_objectmodel_state_journal_flush(journal);
+	rv = ni_objectmodel_state_journal_compact(journal);
+	ni_objectmodel_state_journal = NULL;
+
+	close(journal->fd);
+	ni_var_array_destroy(&journal->pending);
+	ni_var_array_destroy(&journal->written);
+	ni_string_free(&journal->pathname);
+	ni_string_free(&journal->filename);
+	free(journal);
+	return rv;
+}
@@ -16,19 +16,38 @@
 #include "dbus-dict.h"
 #include "debug.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 
 struct ni_dbus_server_object {
 	ni_dbus_server_t *	server;			/* back pointer at server */
+	unsigned int		generation;		/* last changed at generation */
+	uint64_t		digest;			/* of the last enumerated properties */
 };
 
 static const ni_dbus_class_t	dbus_root_object_class = {
 	.name = "<root>",
 };
 
+/*
+ * Removed objects are remembered for GetManagedObjectsSince in a
+ * small ring; clients older than the oldest entry get a full reply.
+ */
+#define NI_DBUS_SERVER_REMOVED_MAX	128
+
+typedef struct ni_dbus_server_removed {
+	char *			path;
+	unsigned int		generation;
+} ni_dbus_server_removed_t;
+
 struct ni_dbus_server {
 	ni_dbus_connection_t *	connection;
 	ni_dbus_object_t *	root_object;
+
+	unsigned int		generation;
+	unsigned int		removed_floor;
+	unsigned int		removed_next;
+	ni_dbus_server_removed_t removed[NI_DBUS_SERVER_REMOVED_MAX];
 };
 
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
@@ -48,6 +67,10 @@ ni_dbus_server_open(const char *bus_type, const char *bus_name, void *root_objec
 	ni_debug_dbus("%s(%s)", __FUNCTION__, bus_name);
 
 	server = xcalloc(1, sizeof(*server));
+	/* start at a random generation, so clients of a previous
+	 * server instance do not mistake theirs for a current one */
+	server->generation = (random() & 0x3fffffff) + 1;
+	server->removed_floor = server->generation;
 	server->connection = ni_dbus_connection_open(bus_type, bus_name);
 	if (server->connection == NULL) {
 		ni_dbus_server_free(server);
@@ -69,6 +92,8 @@ ni_dbus_server_open(const char *bus_type, const char *bus_name, void *root_objec
 void
 ni_dbus_server_free(ni_dbus_server_t *server)
 {
+	unsigned int i;
+
 	NI_TRACE_ENTER();
 
 	if (server->root_object)
@@ -79,6 +104,9 @@ ni_dbus_server_free(ni_dbus_server_t *server)
 		ni_dbus_connection_free(server->connection);
 	server->connection = NULL;
 
+	for (i = 0; i < NI_DBUS_SERVER_REMOVED_MAX; ++i)
+		ni_string_free(&server->removed[i].path);
+
 	free(server);
 }
 
@@ -177,6 +205,22 @@ __ni_dbus_server_object_inherit(ni_dbus_object_t *child, const ni_dbus_object_t
 		__ni_dbus_server_object_init(child, parent->server_object->server);
 }
 
+/*
+ * Remember the path of a removed object for GetManagedObjectsSince
+ */
+static void
+__ni_dbus_server_object_removed(ni_dbus_server_t *server, const char *path)
+{
+	ni_dbus_server_removed_t *rm = &server->removed[server->removed_next];
+
+	if (rm->path)
+		server->removed_floor = rm->generation;
+	ni_string_dup(&rm->path, path);
+	rm->generation = ++server->generation;
+
+	server->removed_next = (server->removed_next + 1) % NI_DBUS_SERVER_REMOVED_MAX;
+}
+
 /*
  * When deleting an object, destroy its server handle.
  */
@@ -185,8 +229,11 @@ __ni_dbus_server_object_destroy(ni_dbus_object_t *object)
 {
 	ni_dbus_server_t *server = ni_dbus_object_get_server(object);
 
-	if (server && object->path)
+	if (server && object->path) {
 		ni_dbus_connection_unregister_object(server->connection, object);
+		if (object->server_object->generation)
+			__ni_dbus_server_object_removed(server, object->path);
+	}
 
 	if (object->server_object) {
 		free(object->server_object);
@@ -218,6 +265,8 @@ static const ni_dbus_service_t __ni_dbus_object_properties_interface;
 static const ni_dbus_service_t __ni_dbus_object_introspectable_interface;
 static dbus_bool_t		__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *,
 					ni_dbus_variant_t *dict, DBusError *);
+static dbus_bool_t		__ni_dbus_object_manager_enumerate_since(ni_dbus_object_t *,
+					ni_dbus_variant_t *dict, unsigned int, DBusError *);
 
 dbus_bool_t
 ni_dbus_object_register_object_manager(ni_dbus_object_t *object)
@@ -278,8 +327,68 @@ __ni_dbus_object_manager_get_managed_objects(ni_dbus_object_t *object,
 	return rv;
 }
 
+/*
+ * GetManagedObjectsSince(generation) returns only the objects whose
+ * properties changed after the given generation and the paths of the
+ * objects removed since then:
+ *	u generation, b reset, a{sv} objects, as removed
+ * When reset is true, the objects are the complete set and anything
+ * the client has that is not in the reply is stale.
+ */
+static dbus_bool_t
+__ni_dbus_object_manager_get_managed_objects_since(ni_dbus_object_t *object,
+		const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply,
+		DBusError *error)
+{
+	ni_dbus_server_t *server = ni_dbus_object_get_server(object);
+	ni_dbus_variant_t result[4];
+	uint32_t since = 0;
+	ni_bool_t reset;
+	unsigned int i, len;
+	int rv;
+
+	NI_TRACE_ENTER_ARGS("path=%s, method=%s", object->path, method->name);
+
+	if (!server || argc != 1 || !ni_dbus_variant_get_uint32(&argv[0], &since))
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	reset = since < server->removed_floor || since > server->generation;
+	if (reset)
+		since = 0;
+
+	memset(result, 0, sizeof(result));
+	ni_dbus_variant_init_dict(&result[2]);
+	ni_dbus_variant_init_string_array(&result[3]);
+
+	rv = __ni_dbus_object_manager_enumerate_since(object, &result[2], since, error);
+
+	len = ni_string_len(object->path);
+	for (i = 0; rv && !reset && i < NI_DBUS_SERVER_REMOVED_MAX; ++i) {
+		const ni_dbus_server_removed_t *rm = &server->removed[i];
+
+		if (!rm->path || rm->generation <= since)
+			continue;
+		if (strncmp(rm->path, object->path, len) || rm->path[len] != '/')
+			continue;
+		ni_dbus_variant_append_string_array(&result[3], rm->path);
+	}
+
+	ni_dbus_variant_set_uint32(&result[0], server->generation);
+	ni_dbus_variant_set_bool(&result[1], reset);
+
+	if (rv)
+		rv = ni_dbus_message_serialize_variants(reply, 4, result, error);
+
+	for (i = 0; i < 4; ++i)
+		ni_dbus_variant_destroy(&result[i]);
+	return rv;
+}
+
 static ni_dbus_method_t	__ni_dbus_object_manager_methods[] = {
 	{ "GetManagedObjects",	NULL,	.handler = __ni_dbus_object_manager_get_managed_objects },
+	{ "GetManagedObjectsSince", "u", .handler = __ni_dbus_object_manager_get_managed_objects_since },
 	{ NULL }
 };
 
@@ -543,6 +652,87 @@ __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_vari
 	return rv;
 }
 
+/*
+ * Digest of an object's interface dict, used to notice property changes
+ * regardless of what changed them. The dict is marshalled into a scratch
+ * message and the resulting bytes are hashed.
+ */
+static uint64_t
+__ni_dbus_object_manager_digest(const ni_dbus_variant_t *ifdict)
+{
+	uint64_t digest = 14695981039346656037ULL;	/* FNV-1a */
+	DBusMessage *msg;
+	char *data = NULL;
+	int i, len = 0;
+
+	msg = dbus_message_new(DBUS_MESSAGE_TYPE_SIGNAL);
+	if (msg && ni_dbus_message_serialize_variants(msg, 1, ifdict, NULL)
+	 && dbus_message_marshal(msg, &data, &len)) {
+		for (i = 0; i < len; ++i) {
+			digest ^= (unsigned char)data[i];
+			digest *= 1099511628211ULL;
+		}
+		dbus_free(data);
+	} else {
+		/* cannot tell, treat it as changed */
+		digest = 0;
+	}
+	if (msg)
+		dbus_message_unref(msg);
+	return digest;
+}
+
+static dbus_bool_t
+__ni_dbus_object_manager_enumerate_since(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict,
+				unsigned int since, DBusError *error)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	ni_dbus_object_t *child;
+	int rv = TRUE;
+
+	if (object->interfaces && sob) {
+		ni_dbus_variant_t ifdict = NI_DBUS_VARIANT_INIT;
+		const ni_dbus_service_t *service;
+		uint64_t digest;
+		unsigned int i;
+
+		ni_dbus_variant_init_dict(&ifdict);
+		for (i = 0; rv && (service = object->interfaces[i]) != NULL; ++i) {
+			ni_dbus_variant_t *propdict = ni_dbus_dict_add(&ifdict, service->name);
+
+			ni_dbus_variant_init_dict(propdict);
+			rv = ni_dbus_object_get_properties_as_dict(object, service, propdict, error);
+		}
+
+		if (rv) {
+			digest = __ni_dbus_object_manager_digest(&ifdict);
+			if (!sob->generation || !digest || digest != sob->digest) {
+				sob->generation = ++sob->server->generation;
+				sob->digest = digest;
+			}
+		}
+
+		if (rv && sob->generation > since) {
+			/* hand the interface dict over to the reply */
+			*ni_dbus_dict_add(obj_dict, object->path) = ifdict;
+		} else {
+			ni_dbus_variant_destroy(&ifdict);
+		}
+	}
+
+	for (child = object->children; child && rv; child = child->next) {
+		if (child->class && child->class->refresh
+		 && !child->class->refresh(child)) {
+			rv = FALSE;
+			continue;
+		}
+
+		rv = __ni_dbus_object_manager_enumerate_since(child, obj_dict, since, error);
+	}
+
+	return rv;
+}
+
 /*
  * Object callbacks from dbus dispatcher
  */
@@ -609,6 +799,7 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	} else {
 		ni_dbus_variant_t argv[16];
 		uid_t caller_uid = -1;
+		struct timespec start;
 		int argc = 0;
 
 		memset(argv, 0, sizeof(argv));
@@ -666,11 +857,13 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 			reply = dbus_message_new_method_return(call);
 
 			/* Now do the call. */
+			ni_metrics_start(&start);
 			if (method->handler_ex) {
 				rv = method->handler_ex(object, method, argc, argv, caller_uid, reply, &error);
 			} else {
 				rv = method->handler(object, method, argc, argv, reply, &error);
 			}
+			ni_metrics_observe_since(NI_METRIC_HISTOGRAM_DBUS_METHOD, &start);
 
 			/* Beware, object may be gone after this! */
 			object = NULL;
@@ -33,11 +33,13 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <netinet/in.h>
+#include <sys/time.h>
 
 #include <wicked/util.h>
 #include <wicked/address.h>
 #include <wicked/logging.h>
 #include <wicked/xml.h>
+#include <wicked/socket.h>
 #include "dhcp.h"
 #include "buffer.h"
 
@@ -1876,3 +1878,78 @@ ni_dhcp_check_user_class_id(const char *id, size_t len)
 	return TRUE;
 }
 
+
+/*
+ * Renew scheduling
+ *
+ * After a mass reboot, all devices of a host and all hosts behind a
+ * relay would renew at the same T1. The renewals are spread with a
+ * per-device offset derived from a hash of the device's client id
+ * within a stagger window, plus a random jitter. The offset stays in
+ * the first half of the T1..T2 window, so the renew retransmissions
+ * still have time to complete before the rebind starts.
+ */
+unsigned int
+ni_dhcp_renew_hash(const void *data, size_t len, unsigned int hash)
+{
+	const unsigned char *ptr = data;
+
+	/* FNV-1a */
+	if (!hash)
+		hash = 2166136261U;
+	while (ptr && len--) {
+		hash ^= *ptr++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+unsigned long
+ni_dhcp_renew_offset(unsigned int hash, unsigned int stagger, unsigned int jitter,
+			unsigned int window)
+{
+	unsigned long max, range, offset = 0;
+
+	max = (unsigned long)window * 1000 / 2;
+	if (stagger && max) {
+		range = (unsigned long)stagger * 1000;
+		if (range > max)
+			range = max;
+		offset = hash % (range + 1);
+	}
+	if (jitter && offset < max) {
+		range = (unsigned long)jitter * 1000;
+		if (range > max - offset)
+			range = max - offset;
+		offset += random() % (range + 1);
+	}
+	return offset;
+}
+
+/*
+ * Limit the renewals started per second by the daemon: each call
+ * reserves the next free slot and returns the msec until it.
+ */
+unsigned long
+ni_dhcp_renew_rate_delay(unsigned int rate)
+{
+	static struct timeval next;
+	struct timeval now, delta;
+	unsigned long delay = 0;
+
+	if (!rate)
+		return 0;
+
+	ni_timer_get_time(&now);
+	if (timercmp(&next, &now, >)) {
+		timersub(&next, &now, &delta);
+		delay = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	} else {
+		next = now;
+	}
+
+	delta.tv_sec = 0;
+	delta.tv_usec = rate < 1000000 ? 1000000 / rate : 1;
+	timeradd(&next, &delta, &next);
+	return delay;
+}
@@ -144,4 +144,11 @@ extern ni_bool_t			ni_dhcp_domain_decode(ni_buffer_t *, char **);
 
 extern ni_bool_t			ni_dhcp_check_user_class_id(const char *, size_t);
 
+/*
+ * Renew scheduling
+ */
+extern unsigned int			ni_dhcp_renew_hash(const void *, size_t, unsigned int);
+extern unsigned long			ni_dhcp_renew_offset(unsigned int, unsigned int, unsigned int, unsigned int);
+extern unsigned long			ni_dhcp_renew_rate_delay(unsigned int);
+
 #endif /* WICKED_DHCP_H */
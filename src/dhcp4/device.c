@@ -130,6 +130,9 @@ ni_dhcp4_device_set_request(ni_dhcp4_device_t *dev, ni_dhcp4_request_t *request)
 	if (dev->request)
 		ni_dhcp4_request_free(dev->request);
 	dev->request = request;
+
+	if (!request)
+		ni_server_interface_event_filter_del(dev->link.ifindex);
 }
 
 void
@@ -259,11 +262,13 @@ ni_dhcp4_device_refresh(ni_dhcp4_device_t *dev)
 int
 ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 {
+	const ni_config_dhcp4_t *dhconf;
 	ni_dhcp4_config_t *config;
 	const char *classid;
 	size_t len;
 	int rv;
 
+	ni_server_interface_event_filter_add(dev->link.ifindex);
 	if ((rv = ni_dhcp4_device_refresh(dev)) < 0)
 		return rv;
 
@@ -285,7 +290,9 @@ ni_dhcp4_acquire(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *info)
 		config->update = info->update;
 		config->update &= ni_config_addrconf_update_mask(NI_ADDRCONF_DHCP, AF_INET);
 	}
-	config->doflags = ni_dhcp4_do_bits(ni_config_dhcp4_find_device(dev->ifname), config->update);
+	dhconf = ni_config_dhcp4_find_device(dev->ifname);
+	config->doflags = ni_dhcp4_do_bits(dhconf, config->update);
+	config->custom_options = dhconf ? dhconf->custom_options : NULL;
 
 	config->route_priority = info->route_priority;
 	config->recover_lease = info->recover_lease;
@@ -1005,6 +1012,33 @@ ni_dhcp4_config_max_lease_time(void)
 	return ni_global.config->addrconf.dhcp4.lease_time;
 }
 
+unsigned long
+ni_dhcp4_config_renew_offset(const ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
+{
+	const ni_config_dhcp4_t *conf = ni_config_dhcp4_find_device(dev->ifname);
+	unsigned int hash;
+
+	if (!conf || (!conf->renew.stagger && !conf->renew.jitter))
+		return 0;
+	if (lease->dhcp4.rebind_time <= lease->dhcp4.renewal_time)
+		return 0;
+
+	hash = ni_dhcp_renew_hash(dev->system.hwaddr.data, dev->system.hwaddr.len, 0);
+	if (dev->config)
+		hash = ni_dhcp_renew_hash(dev->config->client_id.data,
+					dev->config->client_id.len, hash);
+	return ni_dhcp_renew_offset(hash, conf->renew.stagger, conf->renew.jitter,
+			lease->dhcp4.rebind_time - lease->dhcp4.renewal_time);
+}
+
+unsigned int
+ni_dhcp4_config_renew_rate(const char *ifname)
+{
+	const ni_config_dhcp4_t *conf = ni_config_dhcp4_find_device(ifname);
+
+	return conf ? conf->renew.rate : 0;
+}
+
 static void
 ni_dhcp4_config_set_request_options(const char *ifname, ni_uint_array_t *cfg, const ni_string_array_t *req)
 {
@@ -71,7 +71,8 @@ typedef struct ni_dhcp4_device {
 	struct {
 	    uint32_t		xid;
 	    unsigned int	nak_backoff;	/* backoff timer when we get NAKs */
-	    unsigned int	accept_any_offer : 1;
+	    unsigned int	accept_any_offer : 1,
+				renew_deferred : 1;	/* renewal rate limited */
 	} dhcp4;
 
 	ni_buffer_t		message;
@@ -191,6 +192,7 @@ struct ni_dhcp4_config {
 	unsigned int		update;
 	unsigned int		doflags;
 	ni_uint_array_t		request_options;
+	const ni_dhcp_option_decl_t *custom_options;	/* from the global config */
 
 	ni_tristate_t		broadcast;
 
@@ -275,6 +277,9 @@ extern int		ni_dhcp4_config_have_server_preference(void);
 extern int		ni_dhcp4_config_server_preference_ipaddr(struct in_addr);
 extern int		ni_dhcp4_config_server_preference_hwaddr(const ni_hwaddr_t *);
 extern unsigned int	ni_dhcp4_config_max_lease_time(void);
+extern unsigned long	ni_dhcp4_config_renew_offset(const ni_dhcp4_device_t *,
+					const ni_addrconf_lease_t *);
+extern unsigned int	ni_dhcp4_config_renew_rate(const char *);
 extern void		ni_dhcp4_config_free(ni_dhcp4_config_t *);
 
 extern ni_dhcp4_request_t *ni_dhcp4_request_new(void);
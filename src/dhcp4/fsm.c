@@ -26,6 +26,7 @@
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/protocol.h"
+#include "dhcp.h"
 
 
 #define NAK_BACKOFF_MAX		60	/* seconds */
@@ -346,6 +347,7 @@ ni_dhcp4_fsm_restart(ni_dhcp4_device_t *dev)
 		dev->fsm.timer = NULL;
 	}
 	dev->dhcp4.xid = 0;
+	dev->dhcp4.renew_deferred = 0;
 	dev->config->elapsed_timeout = 0;
 
 	ni_dhcp4_device_drop_lease(dev);
@@ -468,6 +470,33 @@ ni_dhcp4_fsm_renewal(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 	return retry;
 }
 
+/*
+ * Defer the renewal when the daemon exceeds the configured renew rate,
+ * but never beyond the rebind time (T2).
+ */
+static ni_bool_t
+ni_dhcp4_fsm_renewal_defer(ni_dhcp4_device_t *dev)
+{
+	unsigned long delay;
+	time_t rebind;
+
+	if (dev->dhcp4.renew_deferred) {
+		dev->dhcp4.renew_deferred = 0;
+		return FALSE;
+	}
+
+	delay = ni_dhcp_renew_rate_delay(ni_dhcp4_config_renew_rate(dev->ifname));
+	rebind = dev->lease->acquired.tv_sec + dev->lease->dhcp4.rebind_time;
+	if (!delay || time(NULL) + (time_t)(delay / 1000) + 1 >= rebind)
+		return FALSE;
+
+	ni_debug_dhcp("%s: renew rate limit reached, deferring renewal by %lu msec",
+			dev->ifname, delay);
+	dev->dhcp4.renew_deferred = 1;
+	ni_dhcp4_fsm_set_timeout_msec(dev, delay);
+	return TRUE;
+}
+
 static void
 ni_dhcp4_fsm_renewal_init(ni_dhcp4_device_t *dev)
 {
@@ -657,6 +686,8 @@ ni_dhcp4_fsm_timeout(ni_dhcp4_device_t *dev)
 		break;
 
 	case NI_DHCP4_STATE_BOUND:
+		if (ni_dhcp4_fsm_renewal_defer(dev))
+			break;
 		ni_dhcp4_fsm_renewal_init(dev);
 		break;
 
@@ -862,9 +893,13 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 			dev->defer.timer = NULL;
 		}
 		if (dev->config->dry_run == NI_DHCP4_RUN_NORMAL) {
-			ni_debug_dhcp("%s: schedule renewal of lease in %u seconds",
-					dev->ifname, lease->dhcp4.renewal_time);
-			ni_dhcp4_fsm_set_timeout(dev, lease->dhcp4.renewal_time);
+			unsigned long offset = ni_dhcp4_config_renew_offset(dev, lease);
+
+			ni_debug_dhcp("%s: schedule renewal of lease in %u.%03lu seconds",
+					dev->ifname, lease->dhcp4.renewal_time + (unsigned int)(offset / 1000),
+					offset % 1000);
+			dev->dhcp4.renew_deferred = 0;
+			ni_dhcp4_fsm_set_timeout_msec(dev, lease->dhcp4.renewal_time * 1000 + offset);
 		}
 
 		/* If the user requested a specific route metric, apply it now */
@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -214,11 +215,11 @@ ni_dhcp4_option_next(ni_buffer_t *bp, ni_buffer_t *optbuf)
 		return -1;
 	if (bp->head == bp->tail)
 		return DHCP4_END;
-	if (bp->tail - bp->head < 2)
-		goto underflow;
 
 	code = bp->base[bp->head++];
 	if (code != DHCP4_PAD && code != DHCP4_END) {
+		if (bp->head == bp->tail)
+			goto underflow;
 		count = bp->base[bp->head++];
 		if (bp->tail - bp->head < count)
 			goto underflow;
@@ -1801,6 +1802,362 @@ ni_dhcp4_apply_routes(ni_addrconf_lease_t *lease, ni_route_array_t *routes)
 	ni_route_array_destroy(&temp);
 }
 
+/*
+ * Table driven option decoding: the decoder table maps each known
+ * option code to its length constraints, the lease (or parse context)
+ * field it is stored in and the function decoding it.
+ */
+typedef struct ni_dhcp4_decode_ctx {
+	ni_addrconf_lease_t *		lease;
+	const ni_dhcp_option_decl_t *	custom_options;
+
+	ni_route_array_t		default_routes;
+	ni_route_array_t		static_routes;
+	ni_route_array_t		classless_routes;
+	ni_string_array_t		dns_servers;
+	ni_string_array_t		dns_search;
+	ni_string_array_t		dns_domain;
+	ni_string_array_t		nis_servers;
+	char *				nisdomain;
+} ni_dhcp4_decode_ctx_t;
+
+typedef enum {
+	NI_DHCP4_DECODE_LEASE,
+	NI_DHCP4_DECODE_CTX,
+} ni_dhcp4_decode_base_t;
+
+typedef struct ni_dhcp4_option_decoder {
+	const char *			what;
+	uint8_t				min_len;	/* minimal data length     */
+	uint8_t				multiple;	/* length is a multiple of */
+	ni_dhcp4_decode_base_t		base;
+	size_t				offset;
+	int				(*decode)(ni_buffer_t *, void *, const char *);
+} ni_dhcp4_option_decoder_t;
+
+#define NI_DHCP4_LEASE_FIELD(f)	.base = NI_DHCP4_DECODE_LEASE, .offset = offsetof(ni_addrconf_lease_t, f)
+#define NI_DHCP4_CTX_FIELD(f)	.base = NI_DHCP4_DECODE_CTX, .offset = offsetof(ni_dhcp4_decode_ctx_t, f)
+/* decoders needing more than one field get the whole lease */
+#define NI_DHCP4_LEASE_ITSELF	.base = NI_DHCP4_DECODE_LEASE, .offset = 0
+
+static int
+ni_dhcp4_decode_ipv4(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_ipv4(bp, var);
+}
+
+static int
+ni_dhcp4_decode_uint32(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get32(bp, var);
+}
+
+static int
+ni_dhcp4_decode_mtu(ni_buffer_t *bp, void *var, const char *what)
+{
+	uint16_t *mtu = var;
+
+	if (ni_dhcp4_option_get16(bp, mtu) < 0)
+		return -1;
+
+	/* Minimum legal mtu is 68 accoridng to
+	 * RFC 2132. In practise it's 576 which is the
+	 * minimum maximum message size. */
+	if (*mtu <= MTU_MIN) {
+		ni_debug_dhcp("MTU %u is too low, minimum is %d; ignoring",
+				*mtu, MTU_MIN);
+		*mtu = 0;
+	}
+	return 0;
+}
+
+static int
+ni_dhcp4_decode_opaque(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_opaque(bp, var);
+}
+
+static int
+ni_dhcp4_decode_domain(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_domain(bp, var, what);
+}
+
+static int
+ni_dhcp4_decode_domain_list(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_domain_list(bp, var, what);
+}
+
+static int
+ni_dhcp4_decode_printable(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_printable(bp, var, what);
+}
+
+static int
+ni_dhcp4_decode_printable_list(ni_buffer_t *bp, void *var, const char *what)
+{
+	char *tmp = NULL;
+	int ret;
+
+	if (!(ret = ni_dhcp4_option_get_printable(bp, &tmp, what)))
+		ni_string_array_append(var, tmp);
+	ni_string_free(&tmp);
+	return ret;
+}
+
+static int
+ni_dhcp4_decode_pathname(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_pathname(bp, var, what);
+}
+
+static int
+ni_dhcp4_decode_netbios_type(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_option_get_netbios_type(bp, var);
+}
+
+static int
+ni_dhcp4_decode_addresses(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_decode_address_list(bp, var);
+}
+
+static int
+ni_dhcp4_decode_search(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_decode_dnssearch(bp, var, what);
+}
+
+static int
+ni_dhcp4_decode_sip(ni_buffer_t *bp, void *var, const char *what)
+{
+	return ni_dhcp4_decode_sipservers(bp, var);
+}
+
+static int
+ni_dhcp4_decode_classless_routes(ni_buffer_t *bp, void *var, const char *what)
+{
+	ni_route_array_destroy(var);
+	return ni_dhcp4_decode_csr(bp, var);
+}
+
+static int
+ni_dhcp4_decode_static_route_list(ni_buffer_t *bp, void *var, const char *what)
+{
+	ni_route_array_destroy(var);
+	return ni_dhcp4_decode_static_routes(bp, var);
+}
+
+static int
+ni_dhcp4_decode_router_list(ni_buffer_t *bp, void *var, const char *what)
+{
+	ni_route_array_destroy(var);
+	return ni_dhcp4_decode_routers(bp, var);
+}
+
+static int
+ni_dhcp4_decode_fqdn(ni_buffer_t *bp, void *var, const char *what)
+{
+	ni_addrconf_lease_t *lease = var;
+
+	return ni_dhcp4_option_get_fqdn(bp, &lease->hostname, &lease->fqdn);
+}
+
+static int
+ni_dhcp4_decode_hostname(ni_buffer_t *bp, void *var, const char *what)
+{
+	ni_addrconf_lease_t *lease = var;
+
+	/* the fqdn option takes precedence */
+	if (lease->fqdn.enabled == NI_TRISTATE_ENABLE) {
+		ni_buffer_clear(bp);
+		return 0;
+	}
+	return ni_dhcp4_option_get_domain(bp, &lease->hostname, what);
+}
+
+static const ni_dhcp4_option_decoder_t	ni_dhcp4_option_decoders[256] = {
+	[DHCP4_ADDRESS]		= { .what = "address", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.address),
+				    .decode = ni_dhcp4_decode_ipv4 },
+	[DHCP4_NETMASK]		= { .what = "netmask", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.netmask),
+				    .decode = ni_dhcp4_decode_ipv4 },
+	[DHCP4_BROADCAST]	= { .what = "broadcast", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.broadcast),
+				    .decode = ni_dhcp4_decode_ipv4 },
+	[DHCP4_SERVERIDENTIFIER]= { .what = "server-id", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.server_id),
+				    .decode = ni_dhcp4_decode_ipv4 },
+	[DHCP4_CLIENTID]	= { .what = "client-id", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.client_id),
+				    .decode = ni_dhcp4_decode_opaque },
+	[DHCP4_LEASETIME]	= { .what = "lease-time", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.lease_time),
+				    .decode = ni_dhcp4_decode_uint32 },
+	[DHCP4_RENEWALTIME]	= { .what = "renewal-time", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.renewal_time),
+				    .decode = ni_dhcp4_decode_uint32 },
+	[DHCP4_REBINDTIME]	= { .what = "rebind-time", .min_len = 4,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.rebind_time),
+				    .decode = ni_dhcp4_decode_uint32 },
+	[DHCP4_MTU]		= { .what = "mtu", .min_len = 2,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.mtu),
+				    .decode = ni_dhcp4_decode_mtu },
+	[DHCP4_FQDN]		= { .what = "fqdn", .min_len = 3,
+				    NI_DHCP4_LEASE_ITSELF,
+				    .decode = ni_dhcp4_decode_fqdn },
+	[DHCP4_HOSTNAME]	= { .what = "hostname", .min_len = 1,
+				    NI_DHCP4_LEASE_ITSELF,
+				    .decode = ni_dhcp4_decode_hostname },
+	[DHCP4_DNSDOMAIN]	= { .what = "dns-domain", .min_len = 1,
+				    NI_DHCP4_CTX_FIELD(dns_domain),
+				    .decode = ni_dhcp4_decode_domain_list },
+	[DHCP4_MESSAGE]		= { .what = "dhcp4-message", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.message),
+				    .decode = ni_dhcp4_decode_printable },
+	[DHCP4_ROOTPATH]	= { .what = "root-path", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(dhcp4.root_path),
+				    .decode = ni_dhcp4_decode_pathname },
+	[DHCP4_NISDOMAIN]	= { .what = "nis-domain", .min_len = 1,
+				    NI_DHCP4_CTX_FIELD(nisdomain),
+				    .decode = ni_dhcp4_decode_domain },
+	[DHCP4_NETBIOSNODETYPE]	= { .what = "netbios-node-type", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(netbios_type),
+				    .decode = ni_dhcp4_decode_netbios_type },
+	[DHCP4_NETBIOSSCOPE]	= { .what = "netbios-scope", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(netbios_scope),
+				    .decode = ni_dhcp4_decode_domain },
+	[DHCP4_DNSSERVER]	= { .what = "dns-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_CTX_FIELD(dns_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_NTPSERVER]	= { .what = "ntp-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(ntp_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_NISSERVER]	= { .what = "nis-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_CTX_FIELD(nis_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_LPRSERVER]	= { .what = "lpr-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(lpr_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_LOGSERVER]	= { .what = "log-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(log_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_NETBIOSNAMESERVER]={ .what = "netbios-name-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(netbios_name_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_NETBIOSDDSERVER]	= { .what = "netbios-dd-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(netbios_dd_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_DNSSEARCH]	= { .what = "dns-search domain", .min_len = 1,
+				    NI_DHCP4_CTX_FIELD(dns_search),
+				    .decode = ni_dhcp4_decode_search },
+	[DHCP4_NDS_SERVER]	= { .what = "nds-server", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_LEASE_FIELD(nds_servers),
+				    .decode = ni_dhcp4_decode_addresses },
+	[DHCP4_NDS_CTX]		= { .what = "nds-context", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(nds_context),
+				    .decode = ni_dhcp4_decode_printable_list },
+	[DHCP4_NDS_TREE]	= { .what = "nds-tree", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(nds_tree),
+				    .decode = ni_dhcp4_decode_printable },
+	[DHCP4_CSR]		= { .what = "classless-static-routes", .min_len = 5,
+				    NI_DHCP4_CTX_FIELD(classless_routes),
+				    .decode = ni_dhcp4_decode_classless_routes },
+	[DHCP4_MSCSR]		= { .what = "ms-classless-static-routes", .min_len = 5,
+				    NI_DHCP4_CTX_FIELD(classless_routes),
+				    .decode = ni_dhcp4_decode_classless_routes },
+	[DHCP4_SIPSERVER]	= { .what = "sip-server", .min_len = 2,
+				    NI_DHCP4_LEASE_FIELD(sip_servers),
+				    .decode = ni_dhcp4_decode_sip },
+	[DHCP4_STATICROUTE]	= { .what = "static-routes", .min_len = 8, .multiple = 8,
+				    NI_DHCP4_CTX_FIELD(static_routes),
+				    .decode = ni_dhcp4_decode_static_route_list },
+	[DHCP4_ROUTERS]		= { .what = "routers", .min_len = 4, .multiple = 4,
+				    NI_DHCP4_CTX_FIELD(default_routes),
+				    .decode = ni_dhcp4_decode_router_list },
+	[DHCP4_POSIX_TZ_STRING]	= { .what = "posix-tz-string", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(posix_tz_string),
+				    .decode = ni_dhcp4_decode_printable },
+	[DHCP4_POSIX_TZ_DBNAME]	= { .what = "posix-tz-dbname", .min_len = 1,
+				    NI_DHCP4_LEASE_FIELD(posix_tz_dbname),
+				    .decode = ni_dhcp4_decode_printable },
+};
+
+static inline void *
+ni_dhcp4_option_decoder_field(ni_dhcp4_decode_ctx_t *ctx, const ni_dhcp4_option_decoder_t *dec)
+{
+	if (dec->base == NI_DHCP4_DECODE_CTX)
+		return (char *)ctx + dec->offset;
+	return (char *)ctx->lease + dec->offset;
+}
+
+/*
+ * Options without a built-in decoder are kept in the lease; the ones
+ * with a custom declaration are discarded when they do not match it.
+ */
+static void
+ni_dhcp4_decode_other_option(ni_dhcp4_decode_ctx_t *ctx, ni_dhcp_option_t **optp, ni_buffer_t *bp)
+{
+	const ni_dhcp_option_decl_t *decl;
+	ni_dhcp_option_t *opt = *optp;
+	ni_var_array_t *vars;
+
+	decl = ni_dhcp_option_decl_list_find_by_code(ctx->custom_options, opt->code);
+	if (decl) {
+		if (!(vars = ni_dhcp_option_to_vars(opt, decl))) {
+			ni_debug_dhcp("discarding DHCP4 option %s code %u len %u: does not match declaration",
+					decl->name, opt->code, opt->len);
+			ni_buffer_clear(bp);
+			return;
+		}
+		ni_var_array_free(vars);
+	} else {
+		ni_debug_dhcp("adding unparsed DHCP4 option %s code %u len %u",
+				ni_dhcp4_option_name(opt->code), opt->code, opt->len);
+	}
+
+	if (ni_dhcp_option_list_append(&ctx->lease->dhcp4.options, opt)) {
+		ni_buffer_clear(bp);
+		*optp = NULL;
+	}
+}
+
+static void
+ni_dhcp4_decode_option(ni_dhcp4_decode_ctx_t *ctx, ni_dhcp_option_t **optp, ni_buffer_t *bp)
+{
+	const ni_dhcp4_option_decoder_t *dec;
+	ni_dhcp_option_t *opt = *optp;
+
+	dec = &ni_dhcp4_option_decoders[opt->code & 0xff];
+	if (!dec->decode) {
+		ni_dhcp4_decode_other_option(ctx, optp, bp);
+		return;
+	}
+
+	if (opt->len < dec->min_len || (dec->multiple && opt->len % dec->multiple)) {
+		bp->underflow = 1;
+		return;
+	}
+	dec->decode(bp, ni_dhcp4_option_decoder_field(ctx, dec), dec->what);
+}
+
+static void
+ni_dhcp4_decode_ctx_destroy(ni_dhcp4_decode_ctx_t *ctx)
+{
+	ni_route_array_destroy(&ctx->default_routes);
+	ni_route_array_destroy(&ctx->static_routes);
+	ni_route_array_destroy(&ctx->classless_routes);
+	ni_string_array_destroy(&ctx->dns_servers);
+	ni_string_array_destroy(&ctx->dns_search);
+	ni_string_array_destroy(&ctx->dns_domain);
+	ni_string_array_destroy(&ctx->nis_servers);
+	ni_string_free(&ctx->nisdomain);
+}
+
 /*
  * Parse a DHCP4 response.
  */
@@ -1808,25 +2165,22 @@ int
 ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_t *message,
 			ni_buffer_t *options, ni_addrconf_lease_t **leasep)
 {
+	ni_dhcp4_decode_ctx_t ctx;
 	ni_buffer_t overload_buf;
 	ni_addrconf_lease_t *lease;
-	ni_route_array_t default_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t static_routes = NI_ROUTE_ARRAY_INIT;
-	ni_route_array_t classless_routes = NI_ROUTE_ARRAY_INIT;
-	ni_string_array_t dns_servers = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_search = NI_STRING_ARRAY_INIT;
-	ni_string_array_t dns_domain = NI_STRING_ARRAY_INIT;
-	ni_string_array_t nis_servers = NI_STRING_ARRAY_INIT;
-	char *nisdomain = NULL;
-	char *tmp = NULL;
 	int opt_overload = 0;
 	int msg_type = -1;
 	int use_bootserver = 1;
 	int use_bootfile = 1;
 	unsigned int pfxlen;
 	ni_dhcp_option_t *opts = NULL, *opt;
+	ni_dhcp_option_t *seen[256];
 
+	memset(&ctx, 0, sizeof(ctx));
+	memset(seen, 0, sizeof(seen));
 	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+	ctx.lease = lease;
+	ctx.custom_options = config->custom_options;
 
 	lease->state = NI_ADDRCONF_STATE_GRANTED;
 	lease->type = NI_ADDRCONF_DHCP;
@@ -1840,6 +2194,8 @@ ni_dhcp4_parse_response(const ni_dhcp4_config_t *config, const ni_dhcp4_message_
 	lease->dhcp4.relay_addr.s_addr = message->giaddr;
 
 parse_more:
+	memset(seen, 0, sizeof(seen));
+
 	/* Loop as long as we still have data in the buffer. */
 	while (ni_buffer_count(options) && !options->underflow) {
 		ni_buffer_t buf;
@@ -1885,14 +2241,16 @@ parse_more:
 			continue;
 		}
 
-		if ((opt = ni_dhcp_option_list_find(opts, option))) {
+		/* concatenate split long options (RFC 3396) */
+		if ((opt = seen[option])) {
 			if (ni_dhcp_option_append(opt, ni_buffer_count(&buf), ni_buffer_head(&buf)))
 				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
 		} else
 		if ((opt = ni_dhcp_option_new(option, ni_buffer_count(&buf), ni_buffer_head(&buf)))) {
-			if (ni_dhcp_option_list_append(&opts, opt))
+			if (ni_dhcp_option_list_append(&opts, opt)) {
 				ni_buffer_pull_head(&buf, ni_buffer_count(&buf));
-			else
+				seen[option] = opt;
+			} else
 				ni_dhcp_option_free(opt);
 		} else {
 			ni_debug_dhcp("unable to allocate DHCP4 option %s", ni_dhcp4_option_name(option));
@@ -1919,152 +2277,7 @@ parse_more:
 		int option = opt->code;
 
 		ni_buffer_init_reader(&buf, opt->data, opt->len);
-		switch (option) {
-		case DHCP4_ADDRESS:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.address);
-			break;
-		case DHCP4_NETMASK:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.netmask);
-			break;
-		case DHCP4_BROADCAST:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.broadcast);
-			break;
-		case DHCP4_SERVERIDENTIFIER:
-			ni_dhcp4_option_get_ipv4(&buf, &lease->dhcp4.server_id);
-			break;
-		case DHCP4_CLIENTID:
-			ni_dhcp4_option_get_opaque(&buf, &lease->dhcp4.client_id);
-			break;
-		case DHCP4_LEASETIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.lease_time);
-			break;
-		case DHCP4_RENEWALTIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.renewal_time);
-			break;
-		case DHCP4_REBINDTIME:
-			ni_dhcp4_option_get32(&buf, &lease->dhcp4.rebind_time);
-			break;
-		case DHCP4_MTU:
-			ni_dhcp4_option_get16(&buf, &lease->dhcp4.mtu);
-			/* Minimum legal mtu is 68 accoridng to
-			 * RFC 2132. In practise it's 576 which is the
-			 * minimum maximum message size. */
-			if (lease->dhcp4.mtu <= MTU_MIN) {
-				ni_debug_dhcp("MTU %u is too low, minimum is %d; ignoring",
-						lease->dhcp4.mtu, MTU_MIN);
-				lease->dhcp4.mtu = 0;
-			}
-			break;
-		case DHCP4_FQDN:
-			ni_dhcp4_option_get_fqdn(&buf, &lease->hostname, &lease->fqdn);
-			break;
-		case DHCP4_HOSTNAME:
-			if (lease->fqdn.enabled != NI_TRISTATE_ENABLE) {
-				ni_dhcp4_option_get_domain(&buf, &lease->hostname,
-								"hostname");
-			}
-			break;
-		case DHCP4_DNSDOMAIN:
-			ni_dhcp4_option_get_domain_list(&buf, &dns_domain,
-							"dns-domain");
-			break;
-		case DHCP4_MESSAGE:
-			ni_dhcp4_option_get_printable(&buf, &lease->dhcp4.message,
-							"dhcp4-message");
-			break;
-		case DHCP4_ROOTPATH:
-			ni_dhcp4_option_get_pathname(&buf, &lease->dhcp4.root_path,
-							"root-path");
-			break;
-		case DHCP4_NISDOMAIN:
-			ni_dhcp4_option_get_domain(&buf, &nisdomain,
-							"nis-domain");
-			break;
-		case DHCP4_NETBIOSNODETYPE:
-			ni_dhcp4_option_get_netbios_type(&buf, &lease->netbios_type);
-			break;
-		case DHCP4_NETBIOSSCOPE:
-			ni_dhcp4_option_get_domain(&buf, &lease->netbios_scope,
-							"netbios-scope");
-			break;
-		case DHCP4_DNSSERVER:
-			ni_dhcp4_decode_address_list(&buf, &dns_servers);
-			break;
-		case DHCP4_NTPSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->ntp_servers);
-			break;
-		case DHCP4_NISSERVER:
-			ni_dhcp4_decode_address_list(&buf, &nis_servers);
-			break;
-		case DHCP4_LPRSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->lpr_servers);
-			break;
-		case DHCP4_LOGSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->log_servers);
-			break;
-		case DHCP4_NETBIOSNAMESERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->netbios_name_servers);
-			break;
-		case DHCP4_NETBIOSDDSERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->netbios_dd_servers);
-			break;
-		case DHCP4_DNSSEARCH:
-			ni_dhcp4_decode_dnssearch(&buf, &dns_search, "dns-search domain");
-			break;
-
-		case DHCP4_NDS_SERVER:
-			ni_dhcp4_decode_address_list(&buf, &lease->nds_servers);
-			break;
-		case DHCP4_NDS_CTX:
-			if (!ni_dhcp4_option_get_printable(&buf, &tmp, "nds-context"))
-				ni_string_array_append(&lease->nds_context, tmp);
-			ni_string_free(&tmp);
-			break;
-		case DHCP4_NDS_TREE:
-			ni_dhcp4_option_get_printable(&buf, &lease->nds_tree,
-							"nds-tree");
-			break;
-
-		case DHCP4_CSR:
-		case DHCP4_MSCSR:
-			ni_route_array_destroy(&classless_routes);
-			ni_dhcp4_decode_csr(&buf, &classless_routes);
-			break;
-
-		case DHCP4_SIPSERVER:
-			ni_dhcp4_decode_sipservers(&buf, &lease->sip_servers);
-			break;
-
-		case DHCP4_STATICROUTE:
-			ni_route_array_destroy(&static_routes);
-			ni_dhcp4_decode_static_routes(&buf, &static_routes);
-			break;
-
-		case DHCP4_ROUTERS:
-			ni_route_array_destroy(&default_routes);
-			ni_dhcp4_decode_routers(&buf, &default_routes);
-			break;
-
-		case DHCP4_POSIX_TZ_STRING:
-			ni_dhcp4_option_get_printable(&buf, &lease->posix_tz_string,
-							"posix-tz-string");
-			break;
-
-		case DHCP4_POSIX_TZ_DBNAME:
-			ni_dhcp4_option_get_printable(&buf, &lease->posix_tz_dbname,
-							"posix-tz-dbname");
-			break;
-
-		default:
-			ni_debug_dhcp("adding unparsed DHCP4 option %s code %u len %u",
-					ni_dhcp4_option_name(option), option, opt->len);
-
-			if (ni_dhcp_option_list_append(&lease->dhcp4.options, opt)) {
-				ni_buffer_clear(&buf);
-				opt = NULL;
-			}
-			break;
-		}
+		ni_dhcp4_decode_option(&ctx, &opt, &buf);
 
 		ni_dhcp_option_free(opt);
 		if (buf.underflow) {
@@ -2159,56 +2372,53 @@ parse_more:
 			ni_sockaddr_set_ipv4(&ap->bcast_addr, lease->dhcp4.broadcast, 0);
 	}
 
-	if (classless_routes.count) {
+	if (ctx.classless_routes.count) {
 		/* if CSR or MSCSR are available, ignore other routes */
-		ni_dhcp4_apply_routes(lease, &classless_routes);
-		ni_route_array_destroy(&classless_routes);
+		ni_dhcp4_apply_routes(lease, &ctx.classless_routes);
+		ni_route_array_destroy(&ctx.classless_routes);
 	} else {
-		ni_dhcp4_apply_routes(lease, &static_routes);
-		ni_route_array_destroy(&static_routes);
-		ni_dhcp4_apply_routes(lease, &default_routes);
-		ni_route_array_destroy(&default_routes);
+		ni_dhcp4_apply_routes(lease, &ctx.static_routes);
+		ni_route_array_destroy(&ctx.static_routes);
+		ni_dhcp4_apply_routes(lease, &ctx.default_routes);
+		ni_route_array_destroy(&ctx.default_routes);
 	}
 
-	if (dns_servers.count || dns_search.count || dns_domain.count) {
+	if (ctx.dns_servers.count || ctx.dns_search.count || ctx.dns_domain.count) {
 		ni_resolver_info_t *resolver = ni_resolver_info_new();
 
-		if (dns_domain.count)
-			ni_string_dup(&resolver->default_domain, dns_domain.data[0]);
+		if (ctx.dns_domain.count)
+			ni_string_dup(&resolver->default_domain, ctx.dns_domain.data[0]);
 
-		if (dns_search.count)
-			ni_string_array_move(&resolver->dns_search, &dns_search);
+		if (ctx.dns_search.count)
+			ni_string_array_move(&resolver->dns_search, &ctx.dns_search);
 		else
-			ni_string_array_move(&resolver->dns_search, &dns_domain);
+			ni_string_array_move(&resolver->dns_search, &ctx.dns_domain);
 
-		ni_string_array_move(&resolver->dns_servers, &dns_servers);
+		ni_string_array_move(&resolver->dns_servers, &ctx.dns_servers);
 		lease->resolver = resolver;
 	}
-	if (nisdomain != NULL) {
+	if (ctx.nisdomain != NULL) {
 		ni_nis_info_t *nis = ni_nis_info_new();
 
-		nis->domainname = nisdomain;
-		nisdomain = NULL;
+		nis->domainname = ctx.nisdomain;
+		ctx.nisdomain = NULL;
 
-		if (nis_servers.count == 0)
+		if (ctx.nis_servers.count == 0)
 			nis->default_binding = NI_NISCONF_BROADCAST;
 		else
-			ni_string_array_move(&nis->default_servers, &nis_servers);
+			ni_string_array_move(&nis->default_servers, &ctx.nis_servers);
 		lease->nis = nis;
 	}
 
+	/* not a DHCP4 message, don't leak the lease */
+	if (msg_type < 0)
+		goto error;
+
 	*leasep = lease;
 	lease = NULL;
 
 done:
-	ni_route_array_destroy(&default_routes);
-	ni_route_array_destroy(&static_routes);
-	ni_route_array_destroy(&classless_routes);
-	ni_string_array_destroy(&dns_servers);
-	ni_string_array_destroy(&dns_search);
-	ni_string_array_destroy(&dns_domain);
-	ni_string_array_destroy(&nis_servers);
-	ni_string_free(&nisdomain);
+	ni_dhcp4_decode_ctx_destroy(&ctx);
 	ni_dhcp_option_list_destroy(&opts);
 
 	return msg_type;
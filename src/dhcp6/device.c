@@ -231,6 +231,9 @@ ni_dhcp6_device_set_request(ni_dhcp6_device_t *dev, ni_dhcp6_request_t *request)
 	if(dev->request && dev->request != request)
 		ni_dhcp6_request_free(dev->request);
 	dev->request = request;
+
+	if (!request)
+		ni_server_interface_event_filter_del(dev->link.ifindex);
 }
 
 /*
@@ -880,6 +883,8 @@ ni_dhcp6_acquire(ni_dhcp6_device_t *dev, const ni_dhcp6_request_t *req, char **e
 		return -NI_ERROR_INVALID_ARGS;
 	}
 
+	ni_server_interface_event_filter_add(dev->link.ifindex);
+
 	config = xcalloc(1, sizeof(*config));
 	config->uuid = req->uuid;
 	config->mode = req->mode;
@@ -1366,6 +1371,30 @@ ni_dhcp6_config_release_nretries(const char *ifname)
 	return conf && conf->release_nretries ? conf->release_nretries : -1U;
 }
 
+unsigned long
+ni_dhcp6_config_renew_offset(const ni_dhcp6_device_t *dev, unsigned int window)
+{
+	const ni_config_dhcp6_t *conf = ni_config_dhcp6_find_device(dev->ifname);
+	unsigned int hash;
+
+	if (!conf || (!conf->renew.stagger && !conf->renew.jitter))
+		return 0;
+
+	hash = ni_dhcp_renew_hash(&dev->iaid, sizeof(dev->iaid), 0);
+	if (dev->config)
+		hash = ni_dhcp_renew_hash(dev->config->client_duid.data,
+					dev->config->client_duid.len, hash);
+	return ni_dhcp_renew_offset(hash, conf->renew.stagger, conf->renew.jitter, window);
+}
+
+unsigned int
+ni_dhcp6_config_renew_rate(const char *ifname)
+{
+	const ni_config_dhcp6_t *conf = ni_config_dhcp6_find_device(ifname);
+
+	return conf ? conf->renew.rate : 0;
+}
+
 unsigned int
 ni_dhcp6_config_info_refresh_time(const char *ifname, ni_uint_range_t *range)
 {
@@ -192,7 +192,8 @@ struct ni_dhcp6_device {
 
 	struct {
 	    int			state;
-	    unsigned int	fail_on_timeout : 1;
+	    unsigned int	fail_on_timeout : 1,
+				renew_deferred : 1;	/* renewal rate limited */
 	    const ni_timer_t *	timer;
 	} fsm;
 
@@ -35,6 +35,7 @@
 #include "dhcp6/protocol.h"
 #include "dhcp6/fsm.h"
 #include "duid.h"
+#include "dhcp.h"
 
 
 struct ni_dhcp6_message {
@@ -55,6 +56,7 @@ static int			ni_dhcp6_fsm_solicit      (ni_dhcp6_device_t *);
 static int			__ni_dhcp6_fsm_release    (ni_dhcp6_device_t *, unsigned int);
 static int			ni_dhcp6_fsm_request_lease(ni_dhcp6_device_t *, const ni_addrconf_lease_t *);
 static int			ni_dhcp6_fsm_confirm_lease(ni_dhcp6_device_t *, const ni_addrconf_lease_t *);
+static ni_bool_t		ni_dhcp6_fsm_renew_defer(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_renew(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_rebind(ni_dhcp6_device_t *);
 static int			ni_dhcp6_fsm_decline(ni_dhcp6_device_t *);
@@ -151,6 +153,7 @@ void
 ni_dhcp6_fsm_reset(ni_dhcp6_device_t *dev)
 {
 	dev->fsm.state = NI_DHCP6_STATE_INIT;
+	dev->fsm.renew_deferred = 0;
 
 	ni_dhcp6_fsm_timer_cancel(dev);
 	ni_dhcp6_device_retransmit_disarm(dev);
@@ -440,6 +443,7 @@ ni_dhcp6_fsm_timeout(ni_dhcp6_device_t *dev)
 		if (dev->config->mode == NI_DHCP6_MODE_INFO)
 			ni_dhcp6_fsm_request_info(dev);
 		else
+		if (!ni_dhcp6_fsm_renew_defer(dev))
 			ni_dhcp6_fsm_renew(dev);
 		break;
 
@@ -1657,6 +1661,31 @@ ni_dhcp6_fsm_confirm_lease(ni_dhcp6_device_t *dev, const ni_addrconf_lease_t *le
 	return rv;
 }
 
+/*
+ * Defer the renewal when the daemon exceeds the configured renew rate,
+ * but never beyond the rebind time (T2).
+ */
+static ni_bool_t
+ni_dhcp6_fsm_renew_defer(ni_dhcp6_device_t *dev)
+{
+	unsigned long delay;
+
+	if (dev->fsm.renew_deferred || !dev->lease) {
+		dev->fsm.renew_deferred = 0;
+		return FALSE;
+	}
+
+	delay = ni_dhcp_renew_rate_delay(ni_dhcp6_config_renew_rate(dev->ifname));
+	if (!delay || delay / 1000 + 1 >= ni_dhcp6_fsm_get_rebind_timeout(dev))
+		return FALSE;
+
+	ni_debug_dhcp("%s: renew rate limit reached, deferring renewal by %lu msec",
+			dev->ifname, delay);
+	dev->fsm.renew_deferred = 1;
+	ni_dhcp6_fsm_set_timeout_msec(dev, delay);
+	return TRUE;
+}
+
 static int
 ni_dhcp6_fsm_renew(ni_dhcp6_device_t *dev)
 {
@@ -2079,14 +2108,22 @@ ni_dhcp6_fsm_bound(ni_dhcp6_device_t *dev)
 					dev->ifname,
 					ni_dhcp6_fsm_state_name(dev->fsm.state));
 		} else {
+			unsigned int rebind = ni_dhcp6_fsm_get_rebind_timeout(dev);
+			unsigned long offset = 0;
+
+			if (rebind != NI_DHCP6_INFINITE_LIFETIME && rebind > timeout)
+				offset = ni_dhcp6_config_renew_offset(dev, rebind - timeout);
+
 			ni_timer_get_time(&now);
-			now.tv_sec += timeout;
+			now.tv_sec += timeout + offset / 1000;
 
-			ni_debug_dhcp("%s: Reached %s state, scheduled RENEW in %u sec at %s",
+			ni_debug_dhcp("%s: Reached %s state, scheduled RENEW in %u.%03lu sec at %s",
 					dev->ifname, ni_dhcp6_fsm_state_name(dev->fsm.state),
-					timeout, ni_dhcp6_print_timeval(&now));
+					timeout + (unsigned int)(offset / 1000), offset % 1000,
+					ni_dhcp6_print_timeval(&now));
 
-			ni_dhcp6_fsm_set_timeout_msec(dev, timeout * 1000);
+			dev->fsm.renew_deferred = 0;
+			ni_dhcp6_fsm_set_timeout_msec(dev, timeout * 1000UL + offset);
 		}
 		return 0;
 	}
@@ -35,6 +35,13 @@
 #include "util_priv.h"
 #include "kernel.h"
 
+#if defined(HAVE_LINUX_ETHTOOL_NETLINK_H)
+#include <linux/genetlink.h>
+#include <linux/ethtool_netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#endif
+
 /*
  * support mask to not repeat ioctl
  * calls that returned EOPNOTSUPP.
@@ -3607,32 +3614,383 @@ ni_ethtool_set_pause(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool, const ni
 
 
 /*
- * main system refresh and setup functions
+ * ethtool query sets, pending in ethtool->refresh until fetched
  */
+enum {
+	NI_ETHTOOL_REFRESH_DRIVER_INFO		= NI_BIT(0),
+	NI_ETHTOOL_REFRESH_PRIV_FLAGS		= NI_BIT(1),
+	NI_ETHTOOL_REFRESH_LINK_DETECTED	= NI_BIT(2),
+	NI_ETHTOOL_REFRESH_LINK_SETTINGS	= NI_BIT(3),
+	NI_ETHTOOL_REFRESH_WAKE_ON_LAN		= NI_BIT(4),
+	NI_ETHTOOL_REFRESH_FEATURES		= NI_BIT(5),
+	NI_ETHTOOL_REFRESH_EEE			= NI_BIT(6),
+	NI_ETHTOOL_REFRESH_RING			= NI_BIT(7),
+	NI_ETHTOOL_REFRESH_CHANNELS		= NI_BIT(8),
+	NI_ETHTOOL_REFRESH_COALESCE		= NI_BIT(9),
+	NI_ETHTOOL_REFRESH_PAUSE		= NI_BIT(10),
+
+	NI_ETHTOOL_REFRESH_ALL			= NI_BIT(11) - 1
+};
+
+static ni_ethtool_t *
+ni_ethtool_refresh_handle(ni_netdev_t *dev)
+{
+	if (!ni_netdev_device_is_ready(dev) || !dev->link.ifindex)
+		return NULL;
+
+	return ni_netdev_get_ethtool(dev);
+}
+
+#if defined(HAVE_LINUX_ETHTOOL_NETLINK_H)
+/*
+ * ethtool netlink (ETHTOOL_GENL) bulk query backend
+ *
+ * Dumps one attribute set for all devices with a single request
+ * instead of one SIOCETHTOOL ioctl per set and device. The sets
+ * which are not dumped here (or when the dump fails) stay pending
+ * and are queried via ioctl on demand.
+ */
+typedef struct ni_ethtool_nl_dump {
+	const char *		name;
+	unsigned int		set;
+	unsigned int		supp;
+	int			cmd;
+	int			reply;
+	int			header;
+	int			maxattr;
+	void			(*reset)(ni_ethtool_t *);
+	ni_bool_t		(*parse)(ni_ethtool_t *, struct nlattr **);
+} ni_ethtool_nl_dump_t;
+
+#define NI_ETHTOOL_NL_ATTR_MAX		ETHTOOL_A_COALESCE_MAX
+
+static inline unsigned int
+ni_ethtool_nla_u32(const struct nlattr *nla)
+{
+	return nla ? nla_get_u32(nla) : 0;
+}
+
+static inline unsigned int
+ni_ethtool_nla_u8(const struct nlattr *nla)
+{
+	return nla ? nla_get_u8(nla) : 0;
+}
+
+static void
+ni_ethtool_nl_reset_linkstate(ni_ethtool_t *ethtool)
+{
+	ethtool->link_detected = NI_TRISTATE_DEFAULT;
+}
+
 static ni_bool_t
-ni_ethtool_refresh(ni_netdev_t *dev)
+ni_ethtool_nl_parse_linkstate(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	if (!tb[ETHTOOL_A_LINKSTATE_LINK])
+		return FALSE;
+
+	ni_tristate_set(&ethtool->link_detected,
+			!!nla_get_u8(tb[ETHTOOL_A_LINKSTATE_LINK]));
+	return TRUE;
+}
+
+static void
+ni_ethtool_nl_reset_rings(ni_ethtool_t *ethtool)
+{
+	ni_ethtool_ring_free(ethtool->ring);
+	ethtool->ring = NULL;
+}
+
+static ni_bool_t
+ni_ethtool_nl_parse_rings(ni_ethtool_t *ethtool, struct nlattr **tb)
 {
+	ni_ethtool_ring_t *ring;
+
+	if (!(ring = ni_ethtool_ring_new()))
+		return FALSE;
+
+	ring->tx        = ni_ethtool_nla_u32(tb[ETHTOOL_A_RINGS_TX]);
+	ring->rx        = ni_ethtool_nla_u32(tb[ETHTOOL_A_RINGS_RX]);
+	ring->rx_mini   = ni_ethtool_nla_u32(tb[ETHTOOL_A_RINGS_RX_MINI]);
+	ring->rx_jumbo  = ni_ethtool_nla_u32(tb[ETHTOOL_A_RINGS_RX_JUMBO]);
+
+	ni_ethtool_ring_free(ethtool->ring);
+	ethtool->ring = ring;
+	return TRUE;
+}
+
+static void
+ni_ethtool_nl_reset_channels(ni_ethtool_t *ethtool)
+{
+	ni_ethtool_channels_free(ethtool->channels);
+	ethtool->channels = NULL;
+}
+
+static ni_bool_t
+ni_ethtool_nl_parse_channels(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_channels_t *channels;
+
+	if (!(channels = ni_ethtool_channels_new()))
+		return FALSE;
+
+	channels->tx       = ni_ethtool_nla_u32(tb[ETHTOOL_A_CHANNELS_TX_COUNT]);
+	channels->rx       = ni_ethtool_nla_u32(tb[ETHTOOL_A_CHANNELS_RX_COUNT]);
+	channels->other    = ni_ethtool_nla_u32(tb[ETHTOOL_A_CHANNELS_OTHER_COUNT]);
+	channels->combined = ni_ethtool_nla_u32(tb[ETHTOOL_A_CHANNELS_COMBINED_COUNT]);
+
+	ni_ethtool_channels_free(ethtool->channels);
+	ethtool->channels = channels;
+	return TRUE;
+}
+
+static void
+ni_ethtool_nl_reset_coalesce(ni_ethtool_t *ethtool)
+{
+	ni_ethtool_coalesce_free(ethtool->coalesce);
+	ethtool->coalesce = NULL;
+}
+
+static ni_bool_t
+ni_ethtool_nl_parse_coalesce(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_coalesce_t *coalesce;
+
+	if (!(coalesce = ni_ethtool_coalesce_new()))
+		return FALSE;
+
+	/* kernel omits unsupported params, ioctl reports them as 0 */
+	ni_tristate_set(&coalesce->adaptive_tx, ni_ethtool_nla_u8(tb[ETHTOOL_A_COALESCE_USE_ADAPTIVE_TX]));
+	ni_tristate_set(&coalesce->adaptive_rx, ni_ethtool_nla_u8(tb[ETHTOOL_A_COALESCE_USE_ADAPTIVE_RX]));
+
+	coalesce->pkt_rate_low          = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_PKT_RATE_LOW]);
+	coalesce->pkt_rate_high         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_PKT_RATE_HIGH]);
+
+	coalesce->sample_interval       = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RATE_SAMPLE_INTERVAL]);
+	coalesce->stats_block_usecs     = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_STATS_BLOCK_USECS]);
+
+	coalesce->tx_usecs              = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_USECS]);
+	coalesce->tx_usecs_irq          = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_USECS_IRQ]);
+	coalesce->tx_usecs_low          = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_USECS_LOW]);
+	coalesce->tx_usecs_high         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_USECS_HIGH]);
+
+	coalesce->tx_frames             = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES]);
+	coalesce->tx_frames_irq         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES_IRQ]);
+	coalesce->tx_frames_low         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES_LOW]);
+	coalesce->tx_frames_high        = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES_HIGH]);
+
+	coalesce->rx_usecs              = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_USECS]);
+	coalesce->rx_usecs_irq          = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_USECS_IRQ]);
+	coalesce->rx_usecs_low          = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_USECS_LOW]);
+	coalesce->rx_usecs_high         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_USECS_HIGH]);
+
+	coalesce->rx_frames             = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES]);
+	coalesce->rx_frames_irq         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES_IRQ]);
+	coalesce->rx_frames_low         = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES_LOW]);
+	coalesce->rx_frames_high        = ni_ethtool_nla_u32(tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES_HIGH]);
+
+	ni_ethtool_coalesce_free(ethtool->coalesce);
+	ethtool->coalesce = coalesce;
+	return TRUE;
+}
+
+static void
+ni_ethtool_nl_reset_pause(ni_ethtool_t *ethtool)
+{
+	ni_ethtool_pause_free(ethtool->pause);
+	ethtool->pause = NULL;
+}
+
+static ni_bool_t
+ni_ethtool_nl_parse_pause(ni_ethtool_t *ethtool, struct nlattr **tb)
+{
+	ni_ethtool_pause_t *pause;
+
+	if (!(pause = ni_ethtool_pause_new()))
+		return FALSE;
+
+	ni_tristate_set(&pause->tx, ni_ethtool_nla_u8(tb[ETHTOOL_A_PAUSE_TX]));
+	ni_tristate_set(&pause->rx, ni_ethtool_nla_u8(tb[ETHTOOL_A_PAUSE_RX]));
+	ni_tristate_set(&pause->autoneg, ni_ethtool_nla_u8(tb[ETHTOOL_A_PAUSE_AUTONEG]));
+
+	ni_ethtool_pause_free(ethtool->pause);
+	ethtool->pause = pause;
+	return TRUE;
+}
+
+static const ni_ethtool_nl_dump_t	ni_ethtool_nl_dumps[] = {
+	{	"linkstate",	NI_ETHTOOL_REFRESH_LINK_DETECTED, NI_ETHTOOL_SUPP_GET_LINK_DETECTED,
+		ETHTOOL_MSG_LINKSTATE_GET,	ETHTOOL_MSG_LINKSTATE_GET_REPLY,
+		ETHTOOL_A_LINKSTATE_HEADER,	ETHTOOL_A_LINKSTATE_MAX,
+		ni_ethtool_nl_reset_linkstate,	ni_ethtool_nl_parse_linkstate
+	},
+	{	"rings",	NI_ETHTOOL_REFRESH_RING,	NI_ETHTOOL_SUPP_GET_RING,
+		ETHTOOL_MSG_RINGS_GET,		ETHTOOL_MSG_RINGS_GET_REPLY,
+		ETHTOOL_A_RINGS_HEADER,		ETHTOOL_A_RINGS_MAX,
+		ni_ethtool_nl_reset_rings,	ni_ethtool_nl_parse_rings
+	},
+	{	"channels",	NI_ETHTOOL_REFRESH_CHANNELS,	NI_ETHTOOL_SUPP_GET_CHANNELS,
+		ETHTOOL_MSG_CHANNELS_GET,	ETHTOOL_MSG_CHANNELS_GET_REPLY,
+		ETHTOOL_A_CHANNELS_HEADER,	ETHTOOL_A_CHANNELS_MAX,
+		ni_ethtool_nl_reset_channels,	ni_ethtool_nl_parse_channels
+	},
+	{	"coalesce",	NI_ETHTOOL_REFRESH_COALESCE,	NI_ETHTOOL_SUPP_GET_COALESCE,
+		ETHTOOL_MSG_COALESCE_GET,	ETHTOOL_MSG_COALESCE_GET_REPLY,
+		ETHTOOL_A_COALESCE_HEADER,	ETHTOOL_A_COALESCE_MAX,
+		ni_ethtool_nl_reset_coalesce,	ni_ethtool_nl_parse_coalesce
+	},
+	{	"pause",	NI_ETHTOOL_REFRESH_PAUSE,	NI_ETHTOOL_SUPP_GET_PAUSE,
+		ETHTOOL_MSG_PAUSE_GET,		ETHTOOL_MSG_PAUSE_GET_REPLY,
+		ETHTOOL_A_PAUSE_HEADER,		ETHTOOL_A_PAUSE_MAX,
+		ni_ethtool_nl_reset_pause,	ni_ethtool_nl_parse_pause
+	},
+	{	NULL,	0, 0, 0, 0, 0, 0, NULL, NULL }
+};
+
+static void
+ni_ethtool_nl_process(ni_netconfig_t *nc, const ni_ethtool_nl_dump_t *dump,
+			struct nlmsghdr *h)
+{
+	struct nlattr *tb[NI_ETHTOOL_NL_ATTR_MAX + 1];
+	struct nlattr *hdr[ETHTOOL_A_HEADER_MAX + 1];
+	struct genlmsghdr *ghdr;
 	ni_ethtool_t *ethtool;
-	ni_netdev_ref_t ref;
+	ni_netdev_t *dev;
 
-	if (!dev || !(ethtool = ni_netdev_get_ethtool(dev)))
+	ghdr = nlmsg_data(h);
+	if (ghdr->cmd != dump->reply || dump->maxattr > NI_ETHTOOL_NL_ATTR_MAX)
+		return;
+
+	if (nlmsg_parse(h, GENL_HDRLEN, tb, dump->maxattr, NULL) < 0 ||
+	    !tb[dump->header])
+		return;
+
+	if (nla_parse_nested(hdr, ETHTOOL_A_HEADER_MAX, tb[dump->header], NULL) < 0 ||
+	    !hdr[ETHTOOL_A_HEADER_DEV_INDEX])
+		return;
+
+	dev = ni_netdev_by_index(nc, nla_get_u32(hdr[ETHTOOL_A_HEADER_DEV_INDEX]));
+	if (!dev || !(ethtool = ni_ethtool_refresh_handle(dev)))
+		return;
+
+	if (dump->parse(ethtool, tb))
+		ni_ethtool_set_supported(ethtool, dump->supp, TRUE);
+}
+
+static ni_bool_t
+ni_ethtool_nl_dump(ni_netconfig_t *nc, ni_netlink_t *nl, int family,
+			const ni_ethtool_nl_dump_t *dump)
+{
+	struct ni_nlmsg_list list;
+	struct ni_nlmsg *entry;
+	ni_ethtool_t *ethtool;
+	ni_netdev_t *dev;
+
+	ni_nlmsg_list_init(&list);
+	if (ni_nl_genl_dump_store(nl, family, dump->cmd, ETHTOOL_GENL_VERSION, &list) < 0) {
+		ni_debug_ifconfig("ethtool netlink %s dump failed, using ioctl", dump->name);
+		ni_nlmsg_list_destroy(&list);
 		return FALSE;
+	}
+
+	/* the kernel skips devices not supporting the set in the dump */
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (!(ethtool = ni_ethtool_refresh_handle(dev)))
+			continue;
+
+		dump->reset(ethtool);
+		ni_ethtool_set_supported(ethtool, dump->supp, FALSE);
+		ethtool->refresh &= ~dump->set;
+	}
+
+	for (entry = list.head; entry; entry = entry->next)
+		ni_ethtool_nl_process(nc, dump, &entry->h);
+
+	ni_nlmsg_list_destroy(&list);
+	return TRUE;
+}
+
+static unsigned int
+ni_ethtool_nl_refresh(ni_netconfig_t *nc)
+{
+	static int family = 0;
+	const ni_ethtool_nl_dump_t *dump;
+	unsigned int done = 0;
+	ni_netlink_t *nl;
+
+	if (family < 0)
+		return 0;
+
+	if (!(nl = __ni_netlink_open(NETLINK_GENERIC))) {
+		family = -1;
+		return 0;
+	}
+
+	if (!family && (family = ni_nl_genl_family(nl, ETHTOOL_GENL_NAME)) < 0) {
+		ni_debug_ifconfig("ethtool netlink interface not available, using ioctl");
+		family = -1;
+	}
+
+	for (dump = ni_ethtool_nl_dumps; family > 0 && dump->name; ++dump) {
+		if (ni_ethtool_nl_dump(nc, nl, family, dump))
+			done |= dump->set;
+	}
+
+	__ni_netlink_close(nl);
+	return done;
+}
+#else
+static unsigned int
+ni_ethtool_nl_refresh(ni_netconfig_t *nc)
+{
+	return 0;
+}
+#endif
+
+/*
+ * main system refresh and setup functions
+ */
+static void
+ni_ethtool_refresh_sets(ni_netdev_t *dev, ni_ethtool_t *ethtool, unsigned int sets)
+{
+	ni_netdev_ref_t ref;
 
 	ref.name = dev->name;
 	ref.index = dev->link.ifindex;
-	if (!ethtool->driver_info)
+	if (sets & NI_ETHTOOL_REFRESH_DRIVER_INFO && !ethtool->driver_info)
 		ni_ethtool_get_driver_info(&ref, ethtool);
-	ni_ethtool_get_priv_flags(&ref, ethtool);
-	ni_ethtool_get_link_detected(&ref, ethtool);
-	ni_ethtool_get_link_settings(&ref, ethtool);
-	ni_ethtool_get_wake_on_lan(&ref, ethtool);
-	ni_ethtool_get_features(&ref, ethtool, FALSE);
-	ni_ethtool_get_eee(&ref, ethtool);
-	ni_ethtool_get_ring(&ref, ethtool);
-	ni_ethtool_get_channels(&ref, ethtool);
-	ni_ethtool_get_coalesce(&ref, ethtool);
-	ni_ethtool_get_pause(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_PRIV_FLAGS)
+		ni_ethtool_get_priv_flags(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_LINK_DETECTED)
+		ni_ethtool_get_link_detected(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_LINK_SETTINGS)
+		ni_ethtool_get_link_settings(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_WAKE_ON_LAN)
+		ni_ethtool_get_wake_on_lan(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_FEATURES)
+		ni_ethtool_get_features(&ref, ethtool, FALSE);
+	if (sets & NI_ETHTOOL_REFRESH_EEE)
+		ni_ethtool_get_eee(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_RING)
+		ni_ethtool_get_ring(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_CHANNELS)
+		ni_ethtool_get_channels(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_COALESCE)
+		ni_ethtool_get_coalesce(&ref, ethtool);
+	if (sets & NI_ETHTOOL_REFRESH_PAUSE)
+		ni_ethtool_get_pause(&ref, ethtool);
+
+	ethtool->refresh &= ~sets;
+}
+
+static ni_bool_t
+ni_ethtool_refresh(ni_netdev_t *dev)
+{
+	ni_ethtool_t *ethtool;
 
+	if (!dev || !(ethtool = ni_netdev_get_ethtool(dev)))
+		return FALSE;
+
+	ni_ethtool_refresh_sets(dev, ethtool, NI_ETHTOOL_REFRESH_ALL);
 	return TRUE;
 }
 
@@ -3645,6 +4003,54 @@ ni_system_ethtool_refresh(ni_netdev_t *dev)
 	ni_ethtool_refresh(dev);
 }
 
+/*
+ * Mark the ethtool state stale; it is queried on next read only.
+ */
+void
+ni_system_ethtool_invalidate(ni_netdev_t *dev)
+{
+	ni_ethtool_t *ethtool;
+
+	if ((ethtool = ni_ethtool_refresh_handle(dev)))
+		ethtool->refresh = NI_ETHTOOL_REFRESH_ALL;
+}
+
+/*
+ * Query the stale parts of the ethtool state of a device.
+ */
+ni_bool_t
+ni_system_ethtool_revalidate(ni_netdev_t *dev)
+{
+	ni_ethtool_t *ethtool;
+
+	if (!dev || !dev->ethtool || !dev->ethtool->refresh)
+		return FALSE;
+
+	if (!(ethtool = ni_ethtool_refresh_handle(dev)))
+		return FALSE;
+
+	ni_ethtool_refresh_sets(dev, ethtool, ethtool->refresh);
+	return TRUE;
+}
+
+/*
+ * Invalidate the ethtool state of all devices and query the sets
+ * the kernel is able to dump for all devices at once via netlink.
+ */
+void
+ni_system_ethtool_refresh_all(ni_netconfig_t *nc)
+{
+	unsigned int done;
+	ni_netdev_t *dev;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		ni_system_ethtool_invalidate(dev);
+
+	done = ni_ethtool_nl_refresh(nc);
+	ni_debug_ifconfig("ethtool netlink refresh: %s, pending sets queried on demand",
+			done ? "done" : "not available");
+}
+
 int
 ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg)
 {
@@ -3655,6 +4061,7 @@ ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t
 
 	if (!dev->ethtool && !ni_ethtool_refresh(dev))
 		return -1;
+	ni_system_ethtool_revalidate(dev);
 
 	ref.name = dev->name;
 	ref.index = dev->link.ifindex;
@@ -7,27 +7,79 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/netinfo.h>
 #include <wicked/xml.h>
 #include "buffer.h"
 #include "appconfig.h"
 #include "process.h"
 #include "debug.h"
 
+struct ni_firmware_discovery {
+	char *			from;
+	ni_string_array_t	names;
+	unsigned int		count;
+	ni_process_t **		procs;
+	int *			fds;
+};
+
+static void
+__ni_firmware_discovery_free(ni_firmware_discovery_t *fwd)
+{
+	unsigned int i;
+
+	for (i = 0; i < fwd->count; ++i)
+		ni_process_free(fwd->procs[i]);
+	free(fwd->procs);
+	free(fwd->fds);
+	ni_string_array_destroy(&fwd->names);
+	ni_string_free(&fwd->from);
+	free(fwd);
+}
+
 /*
- * Run all the netif firmware discovery scripts and return their output
- * as one large buffer.
+ * Collect the output of the discovery scripts in the order they
+ * were started and return it as one large buffer.
  */
 static ni_buffer_t *
-__ni_netconfig_firmware_discovery(const char *root, const char *type, const char *path)
+__ni_netconfig_firmware_discovery_collect(ni_firmware_discovery_t *fwd)
 {
 	ni_buffer_t *result;
+	unsigned int i;
+	int rv, failed = 0;
+
+	result = ni_buffer_new_dynamic(1024);
+	for (i = 0; i < fwd->count; ++i) {
+		/* reap all of them, even when one failed */
+		rv = ni_process_capture_finish(fwd->procs[i], fwd->fds[i], result);
+		if (rv && !failed++) {
+			ni_error("unable to discover firmware (script \"%s\")",
+					fwd->names.data[i]);
+		}
+	}
+
+	if (failed) {
+		ni_buffer_free(result);
+		return NULL;
+	}
+	return result;
+}
+
+/*
+ * Start all the netif firmware discovery scripts at once; their
+ * output is collected by __ni_netconfig_firmware_discovery_collect.
+ */
+static ni_bool_t
+__ni_netconfig_firmware_discovery_start(ni_firmware_discovery_t *fwd,
+		const char *root, const char *type, const char *path)
+{
 	ni_config_t *config = ni_global.config;
 	ni_extension_t *ex;
 
 	ni_assert(config);
 
-	result = ni_buffer_new_dynamic(1024);
-
 	for (ex = config->fw_extensions; ex; ex = ex->next) {
 		ni_script_action_t *script;
 
@@ -36,7 +88,7 @@ __ni_netconfig_firmware_discovery(const char *root, const char *type, const char
 
 		for (script = ex->actions; script; script = script->next) {
 			ni_process_t *process;
-			int rv;
+			int fd;
 
 			/* Check if requested to use specific type/name only (e.g. "ibft") */
 			if (type && !ni_string_eq_nocase(type, script->name))
@@ -59,32 +111,38 @@ __ni_netconfig_firmware_discovery(const char *root, const char *type, const char
 				ni_string_array_append(&process->argv, path);
 			}
 
-			rv = ni_process_run_and_capture_output(process, result);
-			ni_process_free(process);
-			if (rv) {
+			if (ni_process_capture_start(process, &fd)) {
 				ni_error("unable to discover firmware (script \"%s\")",
 						script->name);
-				ni_buffer_free(result);
-				return NULL;
+				ni_process_free(process);
+				return FALSE;
 			}
+
+			fwd->procs = xrealloc(fwd->procs, (fwd->count + 1) * sizeof(fwd->procs[0]));
+			fwd->fds = xrealloc(fwd->fds, (fwd->count + 1) * sizeof(fwd->fds[0]));
+			fwd->procs[fwd->count] = process;
+			fwd->fds[fwd->count] = fd;
+			ni_string_array_append(&fwd->names, script->name);
+			fwd->count++;
 		}
 	}
 
-	return result;
+	return TRUE;
 }
 
 /*
- * Run the netif firmware discovery scripts and return their output
- * as an XML document.
+ * Start the netif firmware discovery scripts in the background, so
+ * the caller is able to do something else (e.g. read other config
+ * sources) until it needs the result from
+ * ni_netconfig_firmware_discovery_finish.
  * The optional from parameter allow to specify the firmware extension
  * type (e.g. ibft) and a firmware type specific path (e.g. ethernet0),
  * passed as last argument to the discovery script.
  */
-xml_document_t *
-ni_netconfig_firmware_discovery(const char *root, const char *from)
+ni_firmware_discovery_t *
+ni_netconfig_firmware_discovery_start(const char *root, const char *from)
 {
-	ni_buffer_t *buffer;
-	xml_document_t *doc;
+	ni_firmware_discovery_t *fwd;
 	char *path = NULL;
 	char *type = NULL;
 
@@ -92,9 +150,9 @@ ni_netconfig_firmware_discovery(const char *root, const char *from)
 	if (ni_string_empty(root))
 		root = NULL;
 
-	if (ni_string_empty(from))
-		from = NULL;
-	else {
+	fwd = xcalloc(1, sizeof(*fwd));
+	if (!ni_string_empty(from)) {
+		ni_string_dup(&fwd->from, from);
 		ni_string_dup(&type, from);
 
 		if ((path = strchr(type, ':')))
@@ -104,21 +162,58 @@ ni_netconfig_firmware_discovery(const char *root, const char *from)
 			path = NULL;
 	}
 
-	buffer = __ni_netconfig_firmware_discovery(root, type, path);
+	if (!__ni_netconfig_firmware_discovery_start(fwd, root, type, path)) {
+		/* reap the scripts we've already started */
+		ni_buffer_free(__ni_netconfig_firmware_discovery_collect(fwd));
+		__ni_firmware_discovery_free(fwd);
+		fwd = NULL;
+	}
+
+	ni_string_free(&type);
+	return fwd;
+}
+
+/*
+ * Wait for the discovery scripts and return their output as an
+ * XML document. The discovery handle is freed.
+ */
+xml_document_t *
+ni_netconfig_firmware_discovery_finish(ni_firmware_discovery_t *fwd)
+{
+	const char *from;
+	ni_buffer_t *buffer;
+	xml_document_t *doc;
+
+	if (!fwd)
+		return NULL;
+
+	buffer = __ni_netconfig_firmware_discovery_collect(fwd);
 	if (buffer == NULL) {
-		ni_string_free(&type);
+		__ni_firmware_discovery_free(fwd);
 		return NULL;
 	}
 
+	from = fwd->from;
 	ni_debug_ifconfig("%s: %s%sbuffer has %u bytes", __func__,
 			(from ? from : ""), (from ? " ": ""),
 			ni_buffer_count(buffer));
 	doc = xml_document_from_buffer(buffer, from);
 	ni_buffer_free(buffer);
-	ni_string_free(&type);
+	__ni_firmware_discovery_free(fwd);
 
 	if (doc == NULL)
 		ni_error("%s: error processing document", __func__);
 
 	return doc;
 }
+
+/*
+ * Run the netif firmware discovery scripts and return their output
+ * as an XML document.
+ */
+xml_document_t *
+ni_netconfig_firmware_discovery(const char *root, const char *from)
+{
+	return ni_netconfig_firmware_discovery_finish(
+			ni_netconfig_firmware_discovery_start(root, from));
+}
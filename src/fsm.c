@@ -10,6 +10,7 @@
 
 #include <string.h>
 #include <unistd.h>
+#include <limits.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -32,6 +33,7 @@
 #include "client/ifconfig.h"
 #include "appconfig.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 static ni_fsm_user_prompt_fn_t *ni_fsm_user_prompt_fn;
 static void *			ni_fsm_user_prompt_data;
@@ -1594,10 +1596,69 @@ ni_ifworker_update_client_state_control(ni_ifworker_t *w)
 	}
 }
 
+/*
+ * Keep a copy of the applied config, named by its uuid, so ifreload
+ * is able to find out what has been changed since.
+ */
+static const char *
+ni_ifworker_applied_config_path(char *buf, size_t size, const ni_uuid_t *uuid)
+{
+	snprintf(buf, size, "%s/ifconfig-%s.xml", ni_config_statedir(), ni_uuid_print(uuid));
+	return buf;
+}
+
+static void
+ni_ifworker_applied_config_save(ni_ifworker_t *w)
+{
+	ni_client_state_t *cs = w->device ? w->device->client_state : NULL;
+	char path[PATH_MAX];
+	FILE *fp;
+
+	if (cs && !ni_uuid_is_null(&cs->config.uuid) &&
+	    !ni_uuid_equal(&cs->config.uuid, &w->config.meta.uuid))
+		unlink(ni_ifworker_applied_config_path(path, sizeof(path), &cs->config.uuid));
+
+	if (xml_node_is_empty(w->config.node) || ni_uuid_is_null(&w->config.meta.uuid))
+		return;
+
+	/* the config may contain secrets */
+	ni_ifworker_applied_config_path(path, sizeof(path), &w->config.meta.uuid);
+	if (!(fp = ni_file_open(path, "w", 0600)))
+		return;
+	if (xml_node_print(w->config.node, fp) < 0)
+		ni_debug_application("%s: unable to write %s", w->name, path);
+	fclose(fp);
+}
+
+/*
+ * Return the config applied to the device or NULL when not known
+ */
+xml_node_t *
+ni_ifworker_applied_config(const ni_ifworker_t *w)
+{
+	ni_client_state_t *cs = w->device ? w->device->client_state : NULL;
+	xml_document_t *doc;
+	xml_node_t *node = NULL;
+	char path[PATH_MAX];
+
+	if (!cs || ni_uuid_is_null(&cs->config.uuid))
+		return NULL;
+
+	ni_ifworker_applied_config_path(path, sizeof(path), &cs->config.uuid);
+	if (!ni_file_exists(path) || !(doc = xml_document_read(path)))
+		return NULL;
+
+	if ((node = xml_node_get_child(xml_document_root(doc), "interface")))
+		node = xml_node_clone(node, NULL);
+	xml_document_free(doc);
+	return node;
+}
+
 static inline void
 ni_ifworker_update_client_state_config(ni_ifworker_t *w)
 {
 	if (w && w->object && !w->readonly) {
+		ni_ifworker_applied_config_save(w);
 		ni_call_set_client_state_config(w->object, &w->config.meta);
 		ni_client_state_config_debug(w->name, &w->config.meta, "update");
 	}
@@ -3966,8 +4027,9 @@ __ni_ifworker_refresh_netdevs(ni_fsm_t *fsm)
 		return FALSE;
 	}
 
-	/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
-	if (!ni_dbus_object_refresh_children(list_object)) {
+	/* Call ObjectManager.GetManagedObjectsSince to get the objects and
+	 * properties changed since our last refresh of the list */
+	if (!ni_dbus_object_refresh_children_since(list_object, &fsm->netdev_generation)) {
 		ni_error("Couldn't refresh list of active network interfaces");
 		return FALSE;
 	}
@@ -5192,6 +5254,7 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 			ni_fsm_events_block(fsm);
 
 			rv = action->call_func(fsm, w, action);
+			ni_metrics_inc(NI_METRIC_FSM_TRANSITIONS);
 			if (w->fsm.next_action)
 				w->fsm.next_action++;
 
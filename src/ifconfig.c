@@ -5257,6 +5257,7 @@ ni_address_updater_arp_init(ni_address_updater_t *au, ni_netdev_t *dev)
 	if (ni_address_updater_arp_verify_enabled(dev)) {
 		ni_arp_verify_init(&au->verify, NI_ADDRCONF_UPDATER_ARP_NPROBES,
 						NI_ADDRCONF_UPDATER_ARP_TIMEOUT);
+		ni_arp_verify_set_rate(&au->verify, ni_config_addrconf_arp_verify_rate());
 	}
 
 	if (ni_address_updater_arp_notify_enabled(dev)) {
@@ -11,8 +11,10 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <stddef.h>
 #include <netlink/msg.h>
 #include <netinet/icmp6.h>
+#include <linux/filter.h>
 
 #include <wicked/types.h>
 #include <wicked/netinfo.h>
@@ -27,6 +29,7 @@
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "metrics.h"
 
 #ifndef NI_ND_OPT_RDNSS_INFORMATION
 #define NI_ND_OPT_RDNSS_INFORMATION	25	/* RFC 5006 */
@@ -66,6 +69,20 @@ typedef struct ni_rtevent_handle
  */
 static ni_socket_t *	__ni_rtevent_sock;
 
+/*
+ * Optional device filter used by the supplicants, which are interested
+ * in the devices they've an active request for only. Address, prefix
+ * and nd user option events of other devices are dropped by a socket
+ * filter in the kernel (as long as the index list fits into it) and
+ * link events are dropped early, before they update the netconfig.
+ */
+#define NI_RTEVENT_FILTER_BPF_MAX	1024
+
+static struct {
+	ni_bool_t		enabled;
+	ni_uint_array_t		ifindex;
+} __ni_rtevent_filter;
+
 static int	__ni_rtevent_process(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_newlink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_dellink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
@@ -87,43 +104,55 @@ __ni_netdev_event(ni_netconfig_t *nc, ni_netdev_t *dev, ni_event_t ev)
 {
 	ni_debug_events("%s(%s, idx=%d, %s)", __FUNCTION__,
 			dev->name, dev->link.ifindex, ni_event_type_to_name(ev));
-	if (ni_global.interface_event)
+	if (ni_global.interface_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.interface_event(dev, ev);
+	}
 }
 
 static inline void
 __ni_netdev_addr_event(ni_netdev_t *dev, ni_event_t ev, const ni_address_t *ap)
 {
-	if (ni_global.interface_addr_event)
+	if (ni_global.interface_addr_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.interface_addr_event(dev, ev, ap);
+	}
 }
 
 static inline void
 __ni_netdev_prefix_event(ni_netdev_t *dev, ni_event_t ev, const ni_ipv6_ra_pinfo_t *pi)
 {
-	if (ni_global.interface_prefix_event)
+	if (ni_global.interface_prefix_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.interface_prefix_event(dev, ev, pi);
+	}
 }
 
 static inline void
 __ni_netdev_nduseropt_event(ni_netdev_t *dev, ni_event_t ev)
 {
-	if (ni_global.interface_nduseropt_event)
+	if (ni_global.interface_nduseropt_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.interface_nduseropt_event(dev, ev);
+	}
 }
 
 static inline void
 __ni_netinfo_route_event(ni_netconfig_t *nc, ni_event_t ev, const ni_route_t *rp)
 {
-	if (ni_global.route_event)
+	if (ni_global.route_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.route_event(nc, ev, rp);
+	}
 }
 
 static inline void
 __ni_netinfo_rule_event(ni_netconfig_t *nc, ni_event_t ev, const ni_rule_t *rule)
 {
-	if (ni_global.rule_event)
+	if (ni_global.rule_event) {
+		ni_metrics_inc(NI_METRIC_EVENTS_DISPATCHED);
 		ni_global.rule_event(nc, ev, rule);
+	}
 }
 
 /*
@@ -898,6 +927,134 @@ __ni_rtevent_nduseropt(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 	return __ni_rtevent_process_nd_radv_opts(dev, opt, msg->nduseropt_opts_len);
 }
 
+/*
+ * Check whether to drop an event of a device not in the filter.
+ * New devices, renames and deletions are processed regardless.
+ */
+static inline ni_bool_t
+__ni_rtevent_filter_watches(unsigned int ifindex)
+{
+	return ni_uint_array_contains(&__ni_rtevent_filter.ifindex, ifindex);
+}
+
+static ni_bool_t
+__ni_rtevent_filter_skip(ni_netconfig_t *nc, struct nlmsghdr *h)
+{
+	struct nduseroptmsg *ndmsg;
+	struct ifinfomsg *ifi;
+	struct ifaddrmsg *ifa;
+	struct prefixmsg *pfx;
+	struct nlattr *nla;
+	ni_netdev_t *dev;
+
+	if (!__ni_rtevent_filter.enabled)
+		return FALSE;
+
+	switch (h->nlmsg_type) {
+	case RTM_NEWLINK:
+		if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
+			return FALSE;
+		if (__ni_rtevent_filter_watches(ifi->ifi_index))
+			return FALSE;
+		if (!(dev = ni_netdev_by_index(nc, ifi->ifi_index)))
+			return FALSE;
+		nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME);
+		return nla && ni_string_eq(dev->name, nla_get_string(nla));
+
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		if (!(ifa = ni_rtnl_ifaddrmsg(h, -1)))
+			return FALSE;
+		return !__ni_rtevent_filter_watches(ifa->ifa_index);
+
+	case RTM_NEWPREFIX:
+		if (!(pfx = ni_rtnl_prefixmsg(h, RTM_NEWPREFIX)))
+			return FALSE;
+		return !__ni_rtevent_filter_watches(pfx->prefix_ifindex);
+
+	case RTM_NEWNDUSEROPT:
+		if (!(ndmsg = ni_rtnl_nduseroptmsg(h, RTM_NEWNDUSEROPT)))
+			return FALSE;
+		return !__ni_rtevent_filter_watches(ndmsg->nduseropt_ifindex);
+
+	default:
+		return FALSE;
+	}
+}
+
+static inline void
+__ni_rtevent_filter_insn(struct sock_filter *insn, unsigned short code,
+			unsigned char jt, unsigned char jf, unsigned int k)
+{
+	insn->code = code;
+	insn->jt = jt;
+	insn->jf = jf;
+	insn->k = k;
+}
+
+/*
+ * (Re)attach a socket filter dropping the address, prefix and nd user
+ * option events of devices not in the filter already in the kernel.
+ * As the netlink header and message fields are in host byte order,
+ * but BPF loads convert from network byte order, we're comparing the
+ * loaded values to htons/htonl converted constants.
+ */
+static int
+__ni_rtevent_filter_attach(ni_socket_t *sock)
+{
+	static const unsigned int types[] = {
+		RTM_NEWADDR, RTM_DELADDR, RTM_NEWPREFIX, RTM_NEWNDUSEROPT
+	};
+	const unsigned int ntypes = sizeof(types)/sizeof(types[0]);
+	const ni_uint_array_t *watch = &__ni_rtevent_filter.ifindex;
+	struct sock_filter *insn;
+	struct sock_fprog prog;
+	unsigned int i, n;
+	int ret;
+
+	if (!sock || sock->__fd < 0)
+		return -1;
+
+	if (!__ni_rtevent_filter.enabled || watch->count > NI_RTEVENT_FILTER_BPF_MAX) {
+		if (setsockopt(sock->__fd, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0) < 0
+		&&  errno != ENOENT) {
+			ni_warn("Unable to detach rtnetlink event filter: %m");
+			return -1;
+		}
+		return 0;
+	}
+
+	memset(&prog, 0, sizeof(prog));
+	prog.len = 1 + ntypes + 2 + 2 * watch->count + 1;
+	prog.filter = insn = xcalloc(prog.len, sizeof(*insn));
+
+	/* accept all messages, except of the per-device types ... */
+	n = 0;
+	__ni_rtevent_filter_insn(&insn[n++], BPF_LD|BPF_H|BPF_ABS, 0, 0,
+				offsetof(struct nlmsghdr, nlmsg_type));
+	for (i = 0; i < ntypes; ++i) {
+		__ni_rtevent_filter_insn(&insn[n++], BPF_JMP|BPF_JEQ|BPF_K,
+					ntypes - i, 0, htons(types[i]));
+	}
+	__ni_rtevent_filter_insn(&insn[n++], BPF_RET|BPF_K, 0, 0, ~0U);
+
+	/* ... where the ifindex follows the family and 3 other bytes */
+	__ni_rtevent_filter_insn(&insn[n++], BPF_LD|BPF_W|BPF_ABS, 0, 0,
+				NLMSG_HDRLEN + offsetof(struct ifaddrmsg, ifa_index));
+	for (i = 0; i < watch->count; ++i) {
+		__ni_rtevent_filter_insn(&insn[n++], BPF_JMP|BPF_JEQ|BPF_K,
+					0, 1, htonl(watch->data[i]));
+		__ni_rtevent_filter_insn(&insn[n++], BPF_RET|BPF_K, 0, 0, ~0U);
+	}
+	__ni_rtevent_filter_insn(&insn[n++], BPF_RET|BPF_K, 0, 0, 0);
+
+	ret = setsockopt(sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+	if (ret < 0)
+		ni_warn("Unable to attach rtnetlink event filter: %m");
+	free(insn);
+	return ret;
+}
+
 /*
  * Receive events from netlink socket and generate events.
  */
@@ -908,23 +1065,31 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 	struct nlmsghdr *nlh;
 	ni_netconfig_t *nc;
 
+	ni_metrics_inc(NI_METRIC_RTNL_RECEIVED);
 	if ((nc = ni_global_state_handle(0)) == NULL)
-		return NL_SKIP;
+		goto skip;
 
 	if (sender->nl_pid != 0) {
 		ni_error("ignoring rtnetlink event message from PID %u",
 			sender->nl_pid);
-		return NL_SKIP;
+		goto skip;
 	}
 
 	nlh = nlmsg_hdr(msg);
+	if (__ni_rtevent_filter_skip(nc, nlh))
+		goto skip;
+
 	if (__ni_rtevent_process(nc, sender, nlh) < 0) {
 		ni_debug_events("ignoring %s rtnetlink event",
 			ni_rtnl_msg_type_to_name(nlh->nlmsg_type, "unknown"));
-		return NL_SKIP;
+		goto skip;
 	}
 
 	return NL_OK;
+
+skip:
+	ni_metrics_inc(NI_METRIC_RTNL_DROPPED);
+	return NL_SKIP;
 }
 
 static ni_bool_t	__ni_rtevent_restart(ni_socket_t *sock);
@@ -950,6 +1115,7 @@ __ni_rtevent_receive(ni_socket_t *sock)
 			break;
 
 		default:
+			ni_metrics_inc(NI_METRIC_RTNL_RECV_ERRORS);
 			ni_error("rtnetlink event receive error: %s (%m)",
 					nl_geterror(ret));
 			if (__ni_rtevent_restart(sock)) {
@@ -1139,6 +1305,8 @@ __ni_rtevent_restart(ni_socket_t *sock)
 			for (i = 0; i < groups->count; ++i) {
 				__ni_rtevent_join_group(handle, groups->data[i]);
 			}
+			if (__ni_rtevent_filter.enabled)
+				__ni_rtevent_filter_attach(__ni_rtevent_sock);
 			ni_socket_activate(__ni_rtevent_sock);
 			return TRUE;
 		}
@@ -1179,6 +1347,69 @@ ni_server_listen_interface_events(void (*ifevent_handler)(ni_netdev_t *, ni_even
 	return 0;
 }
 
+/*
+ * Restrict event processing to the devices added to the filter.
+ */
+int
+ni_server_enable_interface_event_filter(void)
+{
+	if (!__ni_rtevent_sock) {
+		ni_error("Event monitor not enabled");
+		return -1;
+	}
+
+	__ni_rtevent_filter.enabled = TRUE;
+	if (__ni_rtevent_filter_attach(__ni_rtevent_sock) < 0) {
+		__ni_rtevent_filter.enabled = FALSE;
+		return -1;
+	}
+	ni_debug_events("Enabled rtnetlink event device filter");
+	return 0;
+}
+
+ni_bool_t
+ni_server_interface_event_filter_add(unsigned int ifindex)
+{
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+
+	if (!__ni_rtevent_filter.enabled)
+		return TRUE;
+
+	if (!ifindex)
+		return FALSE;
+
+	if (__ni_rtevent_filter_watches(ifindex))
+		return TRUE;
+
+	if (!ni_uint_array_append(&__ni_rtevent_filter.ifindex, ifindex))
+		return FALSE;
+	__ni_rtevent_filter_attach(__ni_rtevent_sock);
+
+	/* we've dropped its events until now -- resync the device */
+	nc = ni_global_state_handle(0);
+	if ((dev = ni_netdev_by_index(nc, ifindex)) != NULL) {
+		ni_debug_events("%s[%u]: added to rtnetlink event device filter",
+				dev->name, ifindex);
+		__ni_system_refresh_interface(nc, dev);
+	}
+	return TRUE;
+}
+
+ni_bool_t
+ni_server_interface_event_filter_del(unsigned int ifindex)
+{
+	if (!__ni_rtevent_filter.enabled)
+		return TRUE;
+
+	if (!ni_uint_array_remove(&__ni_rtevent_filter.ifindex, ifindex))
+		return FALSE;
+
+	ni_debug_events("[%u]: removed from rtnetlink event device filter", ifindex);
+	__ni_rtevent_filter_attach(__ni_rtevent_sock);
+	return TRUE;
+}
+
 void
 ni_server_trace_interface_addr_events(ni_netdev_t *dev, ni_event_t event, const ni_address_t *ap)
 {
@@ -1445,5 +1676,8 @@ ni_server_deactivate_interface_events(void)
 	ni_global.interface_event = NULL;
 	ni_global.interface_addr_event = NULL;
 	ni_global.interface_prefix_event = NULL;
+
+	__ni_rtevent_filter.enabled = FALSE;
+	ni_uint_array_destroy(&__ni_rtevent_filter.ifindex);
 }
 
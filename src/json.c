@@ -29,9 +29,6 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <ctype.h>
-#if 0
-#include <iconv.h>
-#endif
 #include <inttypes.h>
 #include <wicked/logging.h>
 
@@ -45,6 +42,12 @@
 #define	NI_JSON_OBJECT_CHUNK	4
 #define NI_JSON_ARRAY_CHUNK	4
 
+/*
+ * objects with at least this number of members get a name
+ * hash index; below, the linear scan is as fast as a lookup.
+ */
+#define NI_JSON_OBJECT_INDEX_MIN	8
+
 
 /*
  * structured types
@@ -65,6 +68,7 @@ struct ni_json {
 
 struct ni_json_pair {
 	unsigned int		refcount;
+	unsigned int		hash;
 
 	char *			name;
 	ni_json_t *		value;
@@ -73,6 +77,9 @@ struct ni_json_pair {
 struct ni_json_object {
 	unsigned int		count;
 	ni_json_pair_t **	data;
+
+	unsigned int		index_size;
+	unsigned int *		index;
 };
 
 struct ni_json_array {
@@ -192,9 +199,30 @@ ni_json_string_get(ni_json_t *json, char **ret)
 	return FALSE;
 }
 
+const char *
+ni_json_string_value(ni_json_t *json)
+{
+	char **val = ni_json_to_string(json);
+
+	return val ? *val : NULL;
+}
+
 /*
  * json object name:value pair
  */
+static inline unsigned int
+ni_json_name_hash(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 ni_json_pair_t *
 ni_json_pair_new(const char *name, ni_json_t *value)
 {
@@ -204,6 +232,7 @@ ni_json_pair_new(const char *name, ni_json_t *value)
 		pair = xcalloc(1, sizeof(*pair));
 		pair->refcount = 1;
 		pair->name = xstrdup(name);
+		pair->hash = ni_json_name_hash(name);
 		pair->value = value;
 		return pair;
 	}
@@ -275,6 +304,93 @@ ni_json_object_new(void)
 	return xcalloc(1, sizeof(ni_json_object_t));
 }
 
+/*
+ * The index is an open addressing hash of the member positions + 1,
+ * at most half filled. It is updated on append; a removal shifts the
+ * positions, so it is dropped and rebuilt on the next lookup.
+ */
+static void
+ni_json_object_index_destroy(ni_json_object_t *njo)
+{
+	free(njo->index);
+	njo->index = NULL;
+	njo->index_size = 0;
+}
+
+static void
+ni_json_object_index_put(ni_json_object_t *njo, unsigned int pos)
+{
+	unsigned int mask = njo->index_size - 1;
+	unsigned int slot;
+
+	slot = njo->data[pos]->hash & mask;
+	while (njo->index[slot])
+		slot = (slot + 1) & mask;
+	njo->index[slot] = pos + 1;
+}
+
+static void
+ni_json_object_index_build(ni_json_object_t *njo)
+{
+	unsigned int pos, size = NI_JSON_OBJECT_INDEX_MIN * 2;
+
+	while (njo->count * 2 >= size)
+		size *= 2;
+
+	ni_json_object_index_destroy(njo);
+	njo->index = xcalloc(size, sizeof(njo->index[0]));
+	njo->index_size = size;
+	for (pos = 0; pos < njo->count; ++pos)
+		ni_json_object_index_put(njo, pos);
+}
+
+/*
+ * Index the member appended last, once the object is large enough
+ */
+static void
+ni_json_object_index_append(ni_json_object_t *njo)
+{
+	if (njo->count < NI_JSON_OBJECT_INDEX_MIN)
+		return;
+
+	if (!njo->index || njo->count * 2 >= njo->index_size)
+		ni_json_object_index_build(njo);
+	else
+		ni_json_object_index_put(njo, njo->count - 1);
+}
+
+static int
+ni_json_object_find(ni_json_object_t *njo, const char *name)
+{
+	unsigned int hash, mask, slot, pos;
+	ni_json_pair_t *pair;
+
+	if (!name)
+		return -1;
+
+	if (njo->count < NI_JSON_OBJECT_INDEX_MIN) {
+		for (pos = 0; pos < njo->count; ++pos) {
+			if (ni_string_eq(njo->data[pos]->name, name))
+				return pos;
+		}
+		return -1;
+	}
+
+	if (!njo->index)
+		ni_json_object_index_build(njo);
+
+	hash = ni_json_name_hash(name);
+	mask = njo->index_size - 1;
+	slot = hash & mask;
+	while ((pos = njo->index[slot])) {
+		pair = njo->data[pos - 1];
+		if (pair->hash == hash && ni_string_eq(pair->name, name))
+			return pos - 1;
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
 static void
 ni_json_object_free(ni_json_object_t *njo)
 {
@@ -285,6 +401,7 @@ ni_json_object_free(ni_json_object_t *njo)
 	}
 	free(njo->data);
 	njo->data = NULL;
+	ni_json_object_index_destroy(njo);
 	free(njo);
 }
 
@@ -292,18 +409,14 @@ ni_json_pair_t *
 ni_json_object_get_pair(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
-
-		if (ni_string_eq(pair->name, name))
-			return pair;
-	}
-	return NULL;
+	if ((pos = ni_json_object_find(njo, name)) < 0)
+		return NULL;
+	return njo->data[pos];
 }
 
 ni_json_pair_t *
@@ -372,6 +485,7 @@ ni_json_object_append(ni_json_t *json, const char *name, ni_json_t *value)
 		ni_json_object_realloc(njo, njo->count);
 
 	njo->data[njo->count++] = pair;
+	ni_json_object_index_append(njo);
 	return TRUE;
 }
 
@@ -422,6 +536,7 @@ ni_json_object_remove_at(ni_json_t *json, unsigned int pos)
 	ret = ni_json_ref(njo->data[pos]->value);
 	ni_json_pair_free(njo->data[pos]);
 	njo->count--;
+	ni_json_object_index_destroy(njo);
 
 	if (pos < njo->count) {
 		memmove(&njo->data[pos], &njo->data[pos + 1],
@@ -444,18 +559,14 @@ ni_json_t *
 ni_json_object_remove(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
-
-		if (ni_string_eq(pair->name, name))
-			return ni_json_object_remove_at(json, i);
-	}
-	return NULL;
+	if ((pos = ni_json_object_find(njo, name)) < 0)
+		return NULL;
+	return ni_json_object_remove_at(json, pos);
 }
 
 ni_bool_t
@@ -721,7 +832,7 @@ ni_json_new_array(void)
 ni_json_t *
 ni_json_new_number(const char *string)
 {
-	if (ni_string_contains(string, ".")) {
+	if (string && strpbrk(string, ".eE")) {
 		double value = 0.0;
 
 		if (ni_parse_double(string, &value) < 0)
@@ -1037,12 +1148,10 @@ struct ni_json_reader_stack {
 
 struct ni_json_reader {
 	ni_buffer_t *			inbuf;
-#if 0
-	iconv_t				iconv;
-#endif
 	ni_bool_t			quiet;
 	ni_string_array_t		error;
 	ni_json_reader_stack_t *	stack;
+	ni_stringbuf_t			token;
 };
 
 static ni_json_reader_stack_t *
@@ -1067,6 +1176,7 @@ ni_json_reader_stack_pop(ni_json_reader_t *jr)
 		stack->parent = NULL;
 		ni_string_free(&stack->name);
 		ni_json_free(stack->value);
+		free(stack);
 	}
 	return jr->stack;
 }
@@ -1075,37 +1185,21 @@ static ni_bool_t
 ni_json_reader_init_buffer(ni_json_reader_t *jr, ni_buffer_t *buf)
 {
 	jr->inbuf = buf;
-#if 0
-	jr->iconv = (iconv_t)-1;
-#endif
 	jr->stack = NULL;
 	jr->quiet = FALSE;
 	ni_string_array_init(&jr->error);
+	ni_stringbuf_init(&jr->token);
 	return buf != NULL;
 }
 
-#if 0
-static ni_bool_t
-ni_json_reader_open_iconv(ni_json_reader_t *jr)
-{
-	if (jr->iconv == (iconv_t)-1)
-		jr->iconv = iconv_open("UTF-8", "UTF-16BE");
-	return	jr->iconv != (iconv_t)-1;
-}
-#endif
-
 static ni_bool_t
 ni_json_reader_destroy(ni_json_reader_t *jr)
 {
 	ni_string_array_destroy(&jr->error);
 	while (ni_json_reader_stack_pop(jr))
 		;
+	ni_stringbuf_destroy(&jr->token);
 	jr->inbuf = NULL;
-#if 0
-	if (jr->iconv)
-		iconv_close(jr->iconv);
-	jr->iconv = (iconv_t)-1;
-#endif
 	return TRUE;
 }
 
@@ -1173,106 +1267,131 @@ ni_json_reader_get_parent(ni_json_reader_t *jr)
 	return jr->stack->parent ? jr->stack->parent->value : NULL;
 }
 
+/*
+ * The lexer scans the input buffer in place: whitespace, literals,
+ * numbers and the unescaped runs in strings are consumed as a whole
+ * and copied into the token with a single put. The input is expected
+ * to be UTF-8 (or plain ASCII) and passed through unmodified, only the
+ * \uXXXX escapes are decoded into UTF-8.
+ */
+static inline size_t
+ni_json_reader_span(ni_json_reader_t *jr, int (*accept)(int))
+{
+	const unsigned char *ptr = ni_buffer_head(jr->inbuf);
+	size_t len = ni_buffer_count(jr->inbuf);
+	size_t n = 0;
+
+	while (n < len && accept(ptr[n]))
+		n++;
+	return n;
+}
+
 static void
 ni_json_reader_skip_spaces(ni_json_reader_t *jr)
 {
-	int cc;
-
-	while ((cc = ni_buffer_getc(jr->inbuf)) != EOF) {
-		if (!isspace(cc)) {
-			ni_buffer_ungetc(jr->inbuf, cc);
-			break;
-		}
-	}
+	ni_buffer_pull_head(jr->inbuf, ni_json_reader_span(jr, isspace));
 }
 
 static void
 ni_json_reader_get_literal(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	int cc;
+	size_t n = ni_json_reader_span(jr, isalpha);
 
-	while ((cc = ni_buffer_getc(jr->inbuf)) != EOF) {
-		if (!isalpha(cc)) {
-			ni_buffer_ungetc(jr->inbuf, cc);
-			break;
-		}
-		ni_stringbuf_putc(res, cc);
+	ni_stringbuf_put(res, ni_buffer_head(jr->inbuf), n);
+	ni_buffer_pull_head(jr->inbuf, n);
+}
+
+static int
+ni_json_number_char(int cc)
+{
+	switch (cc) {
+	case '+': case '-':
+	case 'e': case 'E':
+	case '.':
+		return 1;
+	default:
+		return isdigit(cc);
 	}
 }
 
 static void
 ni_json_reader_get_number(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	int cc;
+	size_t n = ni_json_reader_span(jr, ni_json_number_char);
 
-	while ((cc = ni_buffer_getc(jr->inbuf)) != EOF) {
-		switch (cc) {
-		case '+': case '-':
-		case 'e': case 'E':
-		case '.':
-			ni_stringbuf_putc(res, cc);
-			break;
-		default:
-			if (isdigit(cc)) {
-				ni_stringbuf_putc(res, cc);
-				break;
-			}
-			ni_buffer_ungetc(jr->inbuf, cc);
-			return;
-		}
-	}
+	ni_stringbuf_put(res, ni_buffer_head(jr->inbuf), n);
+	ni_buffer_pull_head(jr->inbuf, n);
 }
 
 static ni_bool_t
-ni_json_reader_get_eunicode(ni_json_reader_t *jr, ni_stringbuf_t *res)
+ni_json_reader_get_hex4(ni_json_reader_t *jr, unsigned int *code)
 {
-	char hbuf[5], sbuf[2] /*, obuf[8], *sptr, *optr */;
-	/* size_t slen, olen, n; */
-	unsigned int octet;
-	char *end = NULL;
+	const unsigned char *ptr;
+	unsigned int i;
 
-	if (ni_buffer_count(jr->inbuf) < 4)
+	if (!(ptr = ni_buffer_pull_head(jr->inbuf, 4)))
 		return FALSE;
 
-	/*
-	 * TODO: We decode mandatory control chars only...
-	 * Also.. do we need to handle multiple sequences:
-	 * "\uD834\uDD1E", a G clef character (U+1D11E)??
-	 */
-	memset(hbuf, 0, sizeof(hbuf));
-	if (ni_buffer_get(jr->inbuf, &hbuf[0], 2) < 0)
-		return FALSE;
+	for (*code = 0, i = 0; i < 4; ++i) {
+		if (!isxdigit(ptr[i]))
+			return FALSE;
+		*code <<= 4;
+		*code |= isdigit(ptr[i]) ? ptr[i] - '0' : (tolower(ptr[i]) - 'a' + 10);
+	}
+	return TRUE;
+}
 
-	octet = strtoul(&hbuf[0], &end, 16);
-	if (octet > 255 || *end != '\0')
-		return FALSE;
-	sbuf[0] = octet & 0xff;
+static void
+ni_json_utf8_encode(ni_stringbuf_t *res, unsigned int code)
+{
+	char buf[4];
 
-	if (ni_buffer_get(jr->inbuf, &hbuf[2], 2) < 0)
-		return FALSE;
-	octet = strtoul(&hbuf[2], &end, 16);
-        if (octet > 255 || *end != '\0')
-		return FALSE;
-	sbuf[1] = octet & 0xff;
+	if (code < 0x80) {
+		ni_stringbuf_putc(res, code);
+	} else
+	if (code < 0x800) {
+		buf[0] = 0xc0 | (code >> 6);
+		buf[1] = 0x80 | (code & 0x3f);
+		ni_stringbuf_put(res, buf, 2);
+	} else
+	if (code < 0x10000) {
+		buf[0] = 0xe0 | (code >> 12);
+		buf[1] = 0x80 | ((code >> 6) & 0x3f);
+		buf[2] = 0x80 | (code & 0x3f);
+		ni_stringbuf_put(res, buf, 3);
+	} else {
+		buf[0] = 0xf0 | (code >> 18);
+		buf[1] = 0x80 | ((code >> 12) & 0x3f);
+		buf[2] = 0x80 | ((code >> 6) & 0x3f);
+		buf[3] = 0x80 | (code & 0x3f);
+		ni_stringbuf_put(res, buf, 4);
+	}
+}
+
+static ni_bool_t
+ni_json_reader_get_eunicode(ni_json_reader_t *jr, ni_stringbuf_t *res)
+{
+	unsigned int code, low;
+	const unsigned char *ptr;
 
-	if (sbuf[0] != 0)
+	if (!ni_json_reader_get_hex4(jr, &code))
 		return FALSE;
-	if (sbuf[1] != 0)
-		ni_stringbuf_putc(res, sbuf[1]);
-#if 0
-	sptr = sbuf;
-	slen = sizeof(sbuf);
-	while (slen > 0) {
-		optr = obuf;
-		olen = sizeof(obuf);
-
-		n = iconv(jr->iconv, &sptr, &slen, &optr, &olen);
-		if (n == (size_t)-1)
-			return FALSE;
 
-		ni_stringbuf_put(res, obuf, n);
+	/* surrogate pair, e.g. "\uD834\uDD1E", a G clef character (U+1D11E) */
+	if (code >= 0xd800 && code < 0xdc00) {
+		if (!(ptr = ni_buffer_pull_head(jr->inbuf, 2)) || ptr[0] != '\\' || ptr[1] != 'u')
+			return FALSE;
+		if (!ni_json_reader_get_hex4(jr, &low) || low < 0xdc00 || low > 0xdfff)
+			return FALSE;
+		code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+	} else
+	if (code >= 0xdc00 && code <= 0xdfff) {
+		return FALSE;	/* unpaired low surrogate */
 	}
-#endif
+
+	/* a NUL would truncate the C string, skip it */
+	if (code)
+		ni_json_utf8_encode(res, code);
 	return TRUE;
 }
 
@@ -1295,17 +1414,28 @@ ni_json_string_unescape_map(unsigned char ec)
 static ni_bool_t
 ni_json_reader_get_qstring(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	ni_bool_t escaped = FALSE;
+	const unsigned char *ptr;
 	const char *us;
+	size_t len, n;
 	int cc;
 
-	while ((cc = ni_buffer_getc(jr->inbuf)) != EOF) {
-		if (escaped) {
+	for (;;) {
+		ptr = ni_buffer_head(jr->inbuf);
+		len = ni_buffer_count(jr->inbuf);
+		for (n = 0; n < len && ptr[n] != '"' && ptr[n] != '\\'; ++n)
+			;
+		if (n) {
+			ni_stringbuf_put(res, (const char *)ptr, n);
+			ni_buffer_pull_head(jr->inbuf, n);
+		}
+
+		switch (ni_buffer_getc(jr->inbuf)) {
+		case '"':
+			return TRUE; /* OK, end of quoted string */
+		case '\\':
+			if ((cc = ni_buffer_getc(jr->inbuf)) == EOF)
+				return FALSE;
 			if (cc == 'u') {
-#if 0
-				if (!ni_json_reader_open_iconv(jr))
-					return FALSE;	/* decoder failed */
-#endif
 				if (!ni_json_reader_get_eunicode(jr, res))
 					return FALSE;	/* decoding error */
 			} else {
@@ -1314,21 +1444,11 @@ ni_json_reader_get_qstring(ni_json_reader_t *jr, ni_stringbuf_t *res)
 
 				ni_stringbuf_puts(res, us);
 			}
-			escaped = FALSE;
-		} else {
-			switch (cc) {
-			case '"':
-				return TRUE; /* OK, end of quoted string */
-			case '\\':
-				escaped = TRUE;
-				break;
-			default:
-				ni_stringbuf_putc(res, cc);
-				break;
-			}
+			break;
+		default:
+			return FALSE; /* unterminated quoted string */
 		}
 	}
-	return FALSE; /* unterminated quoted string */
 }
 
 static ni_json_token_type_t
@@ -1336,6 +1456,7 @@ ni_json_get_token(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
 	int cc;
 
+	ni_stringbuf_truncate(res, 0);
 	if ((cc = ni_buffer_getc(jr->inbuf)) == EOF)
 		return EndOfFile;
 
@@ -1511,11 +1632,11 @@ ni_json_reader_process_string_value(ni_json_reader_t *jr, const char *string)
 static void
 ni_json_reader_parse_array(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1541,21 +1662,21 @@ ni_json_reader_parse_array(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, tokenValue->string);
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, tokenValue->string);
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed array element separator");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, tokenValue->string);
 		break;
 
 	case EndOfFile:
@@ -1566,19 +1687,18 @@ ni_json_reader_parse_array(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected array token");
 		break;
 	}
-	ni_stringbuf_clear(&tokenValue);
 }
 
 static void
 ni_json_reader_parse_object(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 	ni_json_t *value;
 	const char *name;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ObjectEnd:
@@ -1593,7 +1713,7 @@ ni_json_reader_parse_object(ni_json_reader_t *jr)
 		if ((value = ni_json_reader_get_current(jr)))
 			ni_json_reader_set_error(jr, "unexpected object pair value");
 		else
-			ni_json_reader_set_pair_name(jr, tokenValue.string);
+			ni_json_reader_set_pair_name(jr, tokenValue->string);
 		break;
 
 	case Colon:
@@ -1611,17 +1731,16 @@ ni_json_reader_parse_object(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected object token");
 		break;
 	}
-	ni_stringbuf_clear(&tokenValue);
 }
 
 static void
 ni_json_reader_parse_pair(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1644,21 +1763,21 @@ ni_json_reader_parse_pair(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object member separator or end");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, tokenValue->string);
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object member separator or end");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, tokenValue->string);
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "missed object memmer separator or end");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, tokenValue->string);
 		break;
 
 	case EndOfFile:
@@ -1674,11 +1793,11 @@ ni_json_reader_parse_pair(ni_json_reader_t *jr)
 static void
 ni_json_reader_parse_initial(ni_json_reader_t *jr)
 {
-	ni_stringbuf_t tokenValue = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t *tokenValue = &jr->token;
 	ni_json_token_type_t token;
 
 	ni_json_reader_skip_spaces(jr);
-	token = ni_json_get_token(jr, &tokenValue);
+	token = ni_json_get_token(jr, tokenValue);
 
 	switch (token) {
 	case ArrayBegin:
@@ -1693,21 +1812,21 @@ ni_json_reader_parse_initial(ni_json_reader_t *jr)
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected literal in scalar context");
 		else
-			ni_json_reader_process_literal_value(jr, tokenValue.string);
+			ni_json_reader_process_literal_value(jr, tokenValue->string);
 		break;
 
 	case Number:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected number in scalar context");
 		else
-			ni_json_reader_process_number_value(jr, tokenValue.string);
+			ni_json_reader_process_number_value(jr, tokenValue->string);
 		break;
 
 	case String:
 		if (ni_json_reader_get_current(jr))
 			ni_json_reader_set_error(jr, "unexpected string in scalar context");
 		else
-			ni_json_reader_process_string_value(jr, tokenValue.string);
+			ni_json_reader_process_string_value(jr, tokenValue->string);
 		break;
 
 	case EndOfFile:
@@ -1787,3 +1906,329 @@ ni_json_parse_string(const char *str)
 	return ni_json_parse_buffer(&buf);
 }
 
+/*
+ * pull parser
+ *
+ * Reports the document as a sequence of events without building the
+ * tree, so large inputs can be scanned for the few members of interest.
+ * It uses the same lexer as the tree reader, but is strict about the
+ * separators.
+ */
+typedef enum {
+	PullValue = 0,
+	PullValueOrEnd,
+	PullName,
+	PullNameOrEnd,
+	PullSeparatorOrEnd,
+	PullEndOfFile,
+	PullError,
+} ni_json_pull_expect_t;
+
+struct ni_json_pull {
+	ni_json_reader_t		reader;
+	ni_buffer_t			inbuf;
+
+	ni_json_pull_expect_t		expect;
+	ni_json_pull_event_t		event;
+	ni_json_token_type_t		token;
+	unsigned int			depth;
+	ni_json_t *			value;
+};
+
+ni_json_pull_t *
+ni_json_pull_new(const char *data, size_t len)
+{
+	ni_json_pull_t *jp;
+
+	if (!data)
+		return NULL;
+
+	jp = xcalloc(1, sizeof(*jp));
+	ni_buffer_init_reader(&jp->inbuf, (char *)data, len);
+	ni_json_reader_init_buffer(&jp->reader, &jp->inbuf);
+	ni_json_reader_stack_new(&jp->reader, Initial);
+	jp->expect = PullValue;
+	jp->event = NI_JSON_PULL_EOF;
+	return jp;
+}
+
+void
+ni_json_pull_free(ni_json_pull_t *jp)
+{
+	if (!jp)
+		return;
+
+	ni_json_free(jp->value);
+	ni_json_reader_destroy(&jp->reader);
+	free(jp);
+}
+
+static ni_json_pull_event_t
+ni_json_pull_error(ni_json_pull_t *jp, const char *what)
+{
+	ni_json_reader_set_error(&jp->reader, "%s at offset %zu", what, jp->inbuf.head);
+	jp->expect = PullError;
+	return jp->event = NI_JSON_PULL_ERROR;
+}
+
+static ni_json_pull_event_t
+ni_json_pull_begin(ni_json_pull_t *jp, ni_json_state_t state)
+{
+	ni_json_reader_stack_new(&jp->reader, state);
+	jp->depth++;
+	if (state == InArray) {
+		jp->expect = PullValueOrEnd;
+		return NI_JSON_PULL_ARRAY_BEGIN;
+	} else {
+		jp->expect = PullNameOrEnd;
+		return NI_JSON_PULL_OBJECT_BEGIN;
+	}
+}
+
+static ni_json_pull_event_t
+ni_json_pull_end(ni_json_pull_t *jp)
+{
+	ni_json_state_t state = ni_json_reader_get_state(&jp->reader);
+
+	ni_json_reader_stack_pop(&jp->reader);
+	jp->depth--;
+	jp->expect = jp->depth ? PullSeparatorOrEnd : PullEndOfFile;
+	return state == InArray ? NI_JSON_PULL_ARRAY_END : NI_JSON_PULL_OBJECT_END;
+}
+
+static ni_json_pull_event_t
+ni_json_pull_scalar(ni_json_pull_t *jp, ni_json_token_type_t token)
+{
+	const char *string = jp->reader.token.string;
+
+	/* literals and numbers are validated here, strings need no check */
+	switch (token) {
+	case Literal:
+		jp->value = ni_json_new_literal(string);
+		break;
+	case Number:
+		jp->value = ni_json_new_number(string);
+		break;
+	default:
+		break;
+	}
+	if (token != String && !jp->value)
+		return ni_json_pull_error(jp, "invalid literal or number");
+
+	jp->token = token;
+	jp->expect = jp->depth ? PullSeparatorOrEnd : PullEndOfFile;
+	return NI_JSON_PULL_VALUE;
+}
+
+static ni_json_pull_event_t
+ni_json_pull_value_event(ni_json_pull_t *jp, ni_json_token_type_t token)
+{
+	switch (token) {
+	case ArrayBegin:
+		return ni_json_pull_begin(jp, InArray);
+	case ObjectBegin:
+		return ni_json_pull_begin(jp, InObject);
+	case Literal:
+	case Number:
+	case String:
+		return ni_json_pull_scalar(jp, token);
+	case ArrayEnd:
+		if (jp->expect == PullValueOrEnd)
+			return ni_json_pull_end(jp);
+		return ni_json_pull_error(jp, "unexpected array end");
+	case EndOfFile:
+		if (!jp->depth && jp->expect == PullValue)
+			return NI_JSON_PULL_EOF;
+		return ni_json_pull_error(jp, "unexpected end of file");
+	default:
+		return ni_json_pull_error(jp, "unexpected token");
+	}
+}
+
+static ni_json_pull_event_t
+ni_json_pull_name_event(ni_json_pull_t *jp, ni_json_token_type_t token)
+{
+	switch (token) {
+	case String:
+		/* read the colon directly, the token holds the name */
+		ni_json_reader_skip_spaces(&jp->reader);
+		if (ni_buffer_getc(&jp->inbuf) != ':')
+			return ni_json_pull_error(jp, "missed colon after object member name");
+		jp->expect = PullValue;
+		return NI_JSON_PULL_NAME;
+	case ObjectEnd:
+		if (jp->expect == PullNameOrEnd)
+			return ni_json_pull_end(jp);
+		return ni_json_pull_error(jp, "unexpected object end");
+	default:
+		return ni_json_pull_error(jp, "unexpected object token");
+	}
+}
+
+/*
+ * Advance to the next event
+ */
+ni_json_pull_event_t
+ni_json_pull_next(ni_json_pull_t *jp)
+{
+	ni_json_token_type_t token;
+	ni_json_state_t state;
+
+	if (!jp)
+		return NI_JSON_PULL_ERROR;
+
+	ni_json_free(jp->value);
+	jp->value = NULL;
+	jp->token = None;
+
+	for (;;) {
+		if (jp->expect == PullError)
+			return jp->event = NI_JSON_PULL_ERROR;
+
+		ni_json_reader_skip_spaces(&jp->reader);
+		token = ni_json_get_token(&jp->reader, &jp->reader.token);
+
+		switch (jp->expect) {
+		case PullValue:
+		case PullValueOrEnd:
+			return jp->event = ni_json_pull_value_event(jp, token);
+
+		case PullName:
+		case PullNameOrEnd:
+			return jp->event = ni_json_pull_name_event(jp, token);
+
+		case PullSeparatorOrEnd:
+			state = ni_json_reader_get_state(&jp->reader);
+			if (token == Comma) {
+				jp->expect = state == InArray ? PullValue : PullName;
+				continue;
+			}
+			if ((token == ArrayEnd && state == InArray) ||
+			    (token == ObjectEnd && state == InObject))
+				return jp->event = ni_json_pull_end(jp);
+			return ni_json_pull_error(jp, "missed separator or end");
+
+		case PullEndOfFile:
+			if (token == EndOfFile)
+				return jp->event = NI_JSON_PULL_EOF;
+			return ni_json_pull_error(jp, "unexpected data after the document");
+
+		default:
+			return ni_json_pull_error(jp, "unexpected state");
+		}
+	}
+}
+
+unsigned int
+ni_json_pull_depth(const ni_json_pull_t *jp)
+{
+	return jp ? jp->depth : 0;
+}
+
+/*
+ * The member name of a NAME event or the text of a scalar VALUE,
+ * valid until the next call
+ */
+const char *
+ni_json_pull_string(const ni_json_pull_t *jp)
+{
+	if (!jp || (jp->event != NI_JSON_PULL_NAME && jp->event != NI_JSON_PULL_VALUE))
+		return NULL;
+	return jp->reader.token.string ? jp->reader.token.string : "";
+}
+
+/*
+ * A new reference to the scalar value of a VALUE event
+ */
+ni_json_t *
+ni_json_pull_value(ni_json_pull_t *jp)
+{
+	if (!jp || jp->event != NI_JSON_PULL_VALUE)
+		return NULL;
+
+	if (!jp->value && jp->token == String)
+		jp->value = ni_json_new_string(ni_json_pull_string(jp));
+	return ni_json_ref(jp->value);
+}
+
+/*
+ * Skip the remainder of the array or object of an *_BEGIN event,
+ * consuming its END event
+ */
+ni_bool_t
+ni_json_pull_skip(ni_json_pull_t *jp)
+{
+	unsigned int depth;
+
+	if (!jp || (jp->event != NI_JSON_PULL_ARRAY_BEGIN &&
+		    jp->event != NI_JSON_PULL_OBJECT_BEGIN))
+		return FALSE;
+
+	depth = jp->depth;
+	while (jp->depth >= depth) {
+		switch (ni_json_pull_next(jp)) {
+		case NI_JSON_PULL_ERROR:
+		case NI_JSON_PULL_EOF:
+			return FALSE;
+		default:
+			break;
+		}
+	}
+	return TRUE;
+}
+
+static ni_json_t *
+ni_json_pull_build(ni_json_pull_t *jp)
+{
+	ni_json_pull_event_t event;
+	ni_json_t *json, *value;
+	char *name = NULL;
+
+	switch (jp->event) {
+	case NI_JSON_PULL_VALUE:
+		return ni_json_pull_value(jp);
+
+	case NI_JSON_PULL_ARRAY_BEGIN:
+		json = ni_json_new_array();
+		while ((event = ni_json_pull_next(jp)) != NI_JSON_PULL_ARRAY_END) {
+			if (!(value = ni_json_pull_build(jp))) {
+				ni_json_free(json);
+				return NULL;
+			}
+			ni_json_array_append(json, value);
+		}
+		return json;
+
+	case NI_JSON_PULL_OBJECT_BEGIN:
+		json = ni_json_new_object();
+		while ((event = ni_json_pull_next(jp)) != NI_JSON_PULL_OBJECT_END) {
+			if (event != NI_JSON_PULL_NAME) {
+				ni_json_free(json);
+				return NULL;
+			}
+			ni_string_dup(&name, ni_json_pull_string(jp));
+			ni_json_pull_next(jp);
+			if (!(value = ni_json_pull_build(jp))) {
+				ni_string_free(&name);
+				ni_json_free(json);
+				return NULL;
+			}
+			ni_json_object_set(json, name, value);
+		}
+		ni_string_free(&name);
+		return json;
+
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Build the tree of the VALUE or the array or object of an *_BEGIN
+ * event, consuming its END event
+ */
+ni_json_t *
+ni_json_pull_tree(ni_json_pull_t *jp)
+{
+	return jp ? ni_json_pull_build(jp) : NULL;
+}
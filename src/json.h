@@ -74,6 +74,7 @@ extern	ni_bool_t			ni_json_bool_get(ni_json_t *, ni_bool_t *);
 extern	ni_bool_t			ni_json_int64_get(ni_json_t *, int64_t *);
 extern	ni_bool_t			ni_json_double_get(ni_json_t *, double *);
 extern	ni_bool_t			ni_json_string_get(ni_json_t *, char **);
+extern	const char *			ni_json_string_value(ni_json_t *);
 
 extern	ni_json_t *			ni_json_array_get(ni_json_t *, unsigned int);
 extern	ni_json_t *			ni_json_array_ref(ni_json_t *, unsigned int);
@@ -118,4 +119,31 @@ extern	const char *			ni_json_format_string(ni_stringbuf_t *buf,
 
 extern	ni_json_t *			ni_json_parse_string(const char *str);
 
+
+/*
+ * Pull parser over a (UTF-8) string, which is not copied and
+ * has to be kept until the parser is freed.
+ */
+typedef struct ni_json_pull		ni_json_pull_t;
+
+typedef enum {
+	NI_JSON_PULL_ERROR = -1,
+	NI_JSON_PULL_EOF = 0,
+	NI_JSON_PULL_OBJECT_BEGIN,
+	NI_JSON_PULL_OBJECT_END,
+	NI_JSON_PULL_ARRAY_BEGIN,
+	NI_JSON_PULL_ARRAY_END,
+	NI_JSON_PULL_NAME,
+	NI_JSON_PULL_VALUE,
+} ni_json_pull_event_t;
+
+extern	ni_json_pull_t *		ni_json_pull_new(const char *, size_t);
+extern	void				ni_json_pull_free(ni_json_pull_t *);
+extern	ni_json_pull_event_t		ni_json_pull_next(ni_json_pull_t *);
+extern	unsigned int			ni_json_pull_depth(const ni_json_pull_t *);
+extern	const char *			ni_json_pull_string(const ni_json_pull_t *);
+extern	ni_json_t *			ni_json_pull_value(ni_json_pull_t *);
+extern	ni_bool_t			ni_json_pull_skip(ni_json_pull_t *);
+extern	ni_json_t *			ni_json_pull_tree(ni_json_pull_t *);
+
 #endif /* NI_JSON_H */
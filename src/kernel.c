@@ -587,6 +587,120 @@ retry:
 	return rv;
 }
 
+/*
+ * Generic netlink message with an empty genl header
+ */
+static struct nl_msg *
+__ni_nl_genl_msg(int family, int cmd, int version, int flags)
+{
+	struct genlmsghdr *ghdr;
+	struct nl_msg *msg;
+
+	if (!(msg = nlmsg_alloc()))
+		return NULL;
+
+	if (!nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, family, GENL_HDRLEN, flags)) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+
+	ghdr = nlmsg_data(nlmsg_hdr(msg));
+	ghdr->cmd = cmd;
+	ghdr->version = version;
+	return msg;
+}
+
+static int
+__ni_nl_genl_family_valid(struct nl_msg *msg, void *p)
+{
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	int *family = p;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, CTRL_ATTR_MAX, NULL) < 0)
+		return NL_SKIP;
+
+	if (tb[CTRL_ATTR_FAMILY_ID])
+		*family = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+	return NL_OK;
+}
+
+/*
+ * Resolve the id of a generic netlink family by name
+ */
+int
+ni_nl_genl_family(ni_netlink_t *nl, const char *name)
+{
+	struct nl_msg *msg;
+	int family = 0;
+	int rv;
+
+	if (!nl || !nl->nl_sock || ni_string_empty(name))
+		return -NLE_BAD_SOCK;
+
+	if (!(msg = __ni_nl_genl_msg(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1, 0)))
+		return -NLE_NOMEM;
+
+	if ((rv = nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, name)) < 0) {
+		nlmsg_free(msg);
+		return rv;
+	}
+
+	rv = __ni_nl_talk(nl, msg, __ni_nl_genl_family_valid, &family);
+	nlmsg_free(msg);
+	if (rv < 0) {
+		ni_debug_socket("genl family %s: %s", name, nl_geterror(rv));
+		return rv;
+	}
+	return family > 0 ? family : -NLE_OBJ_NOTFOUND;
+}
+
+/*
+ * Issue a generic netlink DUMP request and store all replies in list
+ */
+int
+ni_nl_genl_dump_store(ni_netlink_t *nl, int family, int cmd, int version,
+			struct ni_nlmsg_list *list)
+{
+	struct __ni_nl_dump_state data = {
+		.msg_type = family,
+		.hdrlen = GENL_HDRLEN,
+		.list = list,
+	};
+	struct nl_msg *msg;
+	struct nl_cb *cb;
+	int rv;
+
+	if (!nl || !nl->nl_sock)
+		return -NLE_BAD_SOCK;
+
+	if (!(msg = __ni_nl_genl_msg(family, cmd, version, NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	rv = nl_send_auto(nl->nl_sock, msg);
+	nlmsg_free(msg);
+	if (rv < 0) {
+		ni_error("genl family %d cmd %d: failed to send request: %s",
+				family, cmd, nl_geterror(rv));
+		return rv;
+	}
+
+	if (!(cb = __ni_nl_cb_clone(nl)))
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, __ni_nl_dump_valid, &data);
+
+	do {
+		rv = nl_recvmsgs(nl->nl_sock, cb);
+	} while (rv == -NLE_AGAIN);
+
+	/* the caller decides whether and how to fall back */
+	if (rv < 0)
+		ni_debug_socket("genl family %d cmd %d: failed to receive response: %s",
+				family, cmd, nl_geterror(rv));
+	nl_cb_put(cb);
+	return rv;
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -74,6 +74,9 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_genl_family(struct __ni_netlink *, const char *);
+extern int	ni_nl_genl_dump_store(struct __ni_netlink *, int family, int cmd,
+				int version, struct ni_nlmsg_list *list);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
@@ -30,10 +30,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sys/stat.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/addrconf.h>
@@ -46,6 +49,7 @@
 
 #include "appconfig.h"
 #include "leasefile.h"
+#include "buffer.h"
 #include "dhcp.h"
 #include "dhcp4/lease.h"
 #include "dhcp6/lease.h"
@@ -1241,9 +1245,454 @@ ni_addrconf_lease_from_xml(ni_addrconf_lease_t **leasep, const xml_node_t *root,
  * lease file read and write routines
  */
 static const char *		__ni_addrconf_lease_file_path(char **,
-				const char *, const char *, int, int);
+				const char *, const char *, int, int,
+				ni_config_lease_file_format_t);
 static void			__ni_addrconf_lease_file_remove(
-				const char *, const char *, int, int);
+				const char *, const char *, int, int,
+				ni_config_lease_file_format_t);
+
+/*
+ * Compact binary lease files
+ *
+ * A versioned header is followed by records. The first record carries
+ * the lease xml tree with the values of the "acquired" timestamp nodes
+ * cut out, the next ones the timestamps in document order. A renew that
+ * changes the timestamps only appends a timestamp record to the file;
+ * the last complete one applies when the file is read back.
+ */
+#define NI_LEASE_BIN_MAGIC		0x574c4246	/* "WLBF" */
+#define NI_LEASE_BIN_VERSION		1
+#define NI_LEASE_BIN_REC_TREE		1
+#define NI_LEASE_BIN_REC_STAMPS		2
+#define NI_LEASE_BIN_REC_HDR_LEN	(sizeof(uint16_t) + sizeof(uint32_t))
+#define NI_LEASE_BIN_NO_STRING		0xffffffffU
+#define NI_LEASE_BIN_MAX_DEPTH		32
+#define NI_LEASE_BIN_STAMP_NODE		"acquired"
+
+typedef struct ni_lease_bin_stamps {
+	unsigned int		count;
+	int64_t *		data;
+} ni_lease_bin_stamps_t;
+
+/*
+ * What the last binary write of a lease put into the file, so a renew
+ * can be appended when the tree is unchanged.
+ */
+typedef struct ni_lease_bin_state	ni_lease_bin_state_t;
+struct ni_lease_bin_state {
+	ni_lease_bin_state_t *	next;
+
+	char *			ifname;
+	int			type;
+	int			family;
+
+	char *			path;
+	off_t			size;
+	unsigned int		records;
+
+	size_t			tree_len;
+	unsigned char *		tree;
+	size_t			stamps_len;
+	unsigned char *		stamps;
+};
+
+static ni_lease_bin_state_t *	ni_lease_bin_states;
+
+static void
+ni_lease_bin_stamps_add(ni_lease_bin_stamps_t *stamps, int64_t stamp)
+{
+	if ((stamps->count % 4) == 0) {
+		stamps->data = xrealloc(stamps->data,
+				(stamps->count + 4) * sizeof(stamps->data[0]));
+	}
+	stamps->data[stamps->count++] = stamp;
+}
+
+static void
+ni_lease_bin_put(ni_buffer_t *bp, const void *data, size_t len)
+{
+	if (ni_buffer_tailroom(bp) < len)
+		ni_buffer_ensure_tailroom(bp, len < 1024 ? 1024 : len);
+	ni_buffer_put(bp, data, len);
+}
+
+static void
+ni_lease_bin_put_uint16(ni_buffer_t *bp, uint16_t value)
+{
+	value = htons(value);
+	ni_lease_bin_put(bp, &value, sizeof(value));
+}
+
+static void
+ni_lease_bin_put_uint32(ni_buffer_t *bp, uint32_t value)
+{
+	value = htonl(value);
+	ni_lease_bin_put(bp, &value, sizeof(value));
+}
+
+static void
+ni_lease_bin_put_string(ni_buffer_t *bp, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	ni_lease_bin_put_uint32(bp, str ? len : NI_LEASE_BIN_NO_STRING);
+	ni_lease_bin_put(bp, str, len);
+}
+
+static void
+ni_lease_bin_put_node(ni_buffer_t *bp, const xml_node_t *node, ni_lease_bin_stamps_t *stamps)
+{
+	const char *cdata = node->cdata;
+	const xml_node_t *child;
+	unsigned int i, count;
+	int64_t stamp;
+
+	if (ni_string_eq(node->name, NI_LEASE_BIN_STAMP_NODE) && !node->children &&
+	    cdata && ni_parse_int64(cdata, &stamp, 10) == 0) {
+		ni_lease_bin_stamps_add(stamps, stamp);
+		cdata = NULL;
+	}
+
+	/* as the xml parser, read an empty element back without cdata */
+	ni_lease_bin_put_string(bp, node->name);
+	ni_lease_bin_put_string(bp, ni_string_empty(cdata) ? NULL : cdata);
+
+	ni_lease_bin_put_uint16(bp, node->attrs.count);
+	for (i = 0; i < node->attrs.count; ++i) {
+		ni_lease_bin_put_string(bp, node->attrs.data[i].name);
+		ni_lease_bin_put_string(bp, node->attrs.data[i].value);
+	}
+
+	for (count = 0, child = node->children; child; child = child->next)
+		count++;
+	ni_lease_bin_put_uint16(bp, count);
+	for (child = node->children; child; child = child->next)
+		ni_lease_bin_put_node(bp, child, stamps);
+}
+
+static size_t
+ni_lease_bin_record_begin(ni_buffer_t *bp, uint16_t type)
+{
+	size_t offset = bp->tail;
+
+	ni_lease_bin_put_uint16(bp, type);
+	ni_lease_bin_put_uint32(bp, 0);
+	return offset;
+}
+
+static void
+ni_lease_bin_record_end(ni_buffer_t *bp, size_t offset)
+{
+	uint32_t len = htonl(bp->tail - offset - NI_LEASE_BIN_REC_HDR_LEN);
+
+	memcpy(bp->base + offset + sizeof(uint16_t), &len, sizeof(len));
+}
+
+/*
+ * Encode the file header, the tree and the timestamp record, which
+ * starts at the returned offset.
+ */
+static size_t
+ni_lease_bin_encode(ni_buffer_t *bp, const xml_node_t *xml)
+{
+	ni_lease_bin_stamps_t stamps = { 0, NULL };
+	size_t offset;
+	unsigned int i;
+
+	ni_lease_bin_put_uint32(bp, NI_LEASE_BIN_MAGIC);
+	ni_lease_bin_put_uint16(bp, NI_LEASE_BIN_VERSION);
+	ni_lease_bin_put_uint16(bp, 0);
+
+	offset = ni_lease_bin_record_begin(bp, NI_LEASE_BIN_REC_TREE);
+	ni_lease_bin_put_node(bp, xml, &stamps);
+	ni_lease_bin_record_end(bp, offset);
+
+	offset = ni_lease_bin_record_begin(bp, NI_LEASE_BIN_REC_STAMPS);
+	ni_lease_bin_put_uint16(bp, stamps.count);
+	for (i = 0; i < stamps.count; ++i) {
+		ni_lease_bin_put_uint32(bp, (uint64_t)stamps.data[i] >> 32);
+		ni_lease_bin_put_uint32(bp, (uint64_t)stamps.data[i] & 0xffffffffU);
+	}
+	ni_lease_bin_record_end(bp, offset);
+
+	free(stamps.data);
+	return offset;
+}
+
+static ni_bool_t
+ni_lease_bin_get_string(ni_buffer_t *bp, char **str)
+{
+	const void *data;
+	uint32_t len;
+
+	*str = NULL;
+	if (ni_buffer_get_uint32(bp, &len) < 0)
+		return FALSE;
+	if (len == NI_LEASE_BIN_NO_STRING)
+		return TRUE;
+	if (!(data = ni_buffer_pull_head(bp, len)))
+		return FALSE;
+
+	*str = xmalloc(len + 1);
+	memcpy(*str, data, len);
+	(*str)[len] = '\0';
+	return TRUE;
+}
+
+static xml_node_t *
+ni_lease_bin_get_node(ni_buffer_t *bp, xml_node_t *parent, unsigned int depth)
+{
+	char *name = NULL, *value = NULL;
+	uint16_t i, count;
+	xml_node_t *node;
+
+	if (depth > NI_LEASE_BIN_MAX_DEPTH)
+		return NULL;
+	if (!ni_lease_bin_get_string(bp, &name) || !name)
+		return NULL;
+
+	node = xml_node_new(name, parent);
+	free(name);
+	if (!ni_lease_bin_get_string(bp, &node->cdata))
+		goto failed;
+
+	if (ni_buffer_get_uint16(bp, &count) < 0)
+		goto failed;
+	for (i = 0; i < count; ++i) {
+		if (!ni_lease_bin_get_string(bp, &name) || !name ||
+		    !ni_lease_bin_get_string(bp, &value)) {
+			free(name);
+			goto failed;
+		}
+		ni_var_array_set(&node->attrs, name, value);
+		free(name);
+		free(value);
+	}
+
+	if (ni_buffer_get_uint16(bp, &count) < 0)
+		goto failed;
+	for (i = 0; i < count; ++i) {
+		if (!ni_lease_bin_get_node(bp, node, depth + 1))
+			goto failed;
+	}
+	return node;
+
+failed:
+	/* a child is released with the root node */
+	if (!parent)
+		xml_node_free(node);
+	return NULL;
+}
+
+static ni_bool_t
+ni_lease_bin_get_stamps(ni_buffer_t *bp, ni_lease_bin_stamps_t *stamps)
+{
+	uint32_t hi, lo;
+	uint16_t i, count;
+
+	stamps->count = 0;
+	if (ni_buffer_get_uint16(bp, &count) < 0)
+		return FALSE;
+	for (i = 0; i < count; ++i) {
+		if (ni_buffer_get_uint32(bp, &hi) < 0 ||
+		    ni_buffer_get_uint32(bp, &lo) < 0)
+			return FALSE;
+		ni_lease_bin_stamps_add(stamps, (int64_t)(((uint64_t)hi << 32) | lo));
+	}
+	return ni_buffer_count(bp) == 0;
+}
+
+static void
+ni_lease_bin_set_stamps(xml_node_t *node, const ni_lease_bin_stamps_t *stamps, unsigned int *pos)
+{
+	xml_node_t *child;
+
+	if (ni_string_eq(node->name, NI_LEASE_BIN_STAMP_NODE) &&
+	    !node->children && !node->cdata) {
+		if (*pos < stamps->count)
+			ni_string_printf(&node->cdata, "%"PRId64, stamps->data[*pos]);
+		(*pos)++;
+		return;
+	}
+	for (child = node->children; child; child = child->next)
+		ni_lease_bin_set_stamps(child, stamps, pos);
+}
+
+static xml_node_t *
+ni_lease_bin_decode(ni_buffer_t *bp, const char *filename)
+{
+	ni_lease_bin_stamps_t stamps = { 0, NULL };
+	uint16_t version, flags, type;
+	xml_node_t *xml = NULL;
+	unsigned int pos = 0;
+	ni_buffer_t rec;
+	uint32_t magic, len;
+	void *data;
+
+	if (ni_buffer_get_uint32(bp, &magic) < 0 || magic != NI_LEASE_BIN_MAGIC ||
+	    ni_buffer_get_uint16(bp, &version) < 0 ||
+	    ni_buffer_get_uint16(bp, &flags) < 0) {
+		ni_error("File '%s' is not a binary lease file", filename);
+		return NULL;
+	}
+	if (version != NI_LEASE_BIN_VERSION) {
+		ni_error("File '%s' has unsupported binary lease version %u",
+				filename, version);
+		return NULL;
+	}
+
+	while (ni_buffer_count(bp)) {
+		if (ni_buffer_get_uint16(bp, &type) < 0 ||
+		    ni_buffer_get_uint32(bp, &len) < 0 ||
+		    !(data = ni_buffer_pull_head(bp, len))) {
+			/* an interrupted append, the records before are complete */
+			ni_debug_dhcp("Ignoring truncated record in '%s'", filename);
+			break;
+		}
+
+		ni_buffer_init_reader(&rec, data, len);
+		switch (type) {
+		case NI_LEASE_BIN_REC_TREE:
+			if (xml || !(xml = ni_lease_bin_get_node(&rec, NULL, 0)) ||
+			    ni_buffer_count(&rec))
+				goto failed;
+			break;
+
+		case NI_LEASE_BIN_REC_STAMPS:
+			if (!ni_lease_bin_get_stamps(&rec, &stamps))
+				goto failed;
+			break;
+
+		default:
+			break;
+		}
+	}
+	if (!xml)
+		goto failed;
+
+	ni_lease_bin_set_stamps(xml, &stamps, &pos);
+	if (pos != stamps.count)
+		goto failed;
+
+	free(stamps.data);
+	return xml;
+
+failed:
+	ni_error("Unable to decode binary lease file '%s'", filename);
+	if (xml)
+		xml_node_free(xml);
+	free(stamps.data);
+	return NULL;
+}
+
+static ni_lease_bin_state_t **
+ni_lease_bin_state_find(const char *ifname, int type, int family)
+{
+	ni_lease_bin_state_t **pos, *state;
+
+	for (pos = &ni_lease_bin_states; (state = *pos); pos = &state->next) {
+		if (state->type == type && state->family == family &&
+		    ni_string_eq(state->ifname, ifname))
+			break;
+	}
+	return pos;
+}
+
+static void
+ni_lease_bin_state_drop(const char *ifname, int type, int family)
+{
+	ni_lease_bin_state_t **pos, *state;
+
+	pos = ni_lease_bin_state_find(ifname, type, family);
+	if ((state = *pos)) {
+		*pos = state->next;
+		ni_string_free(&state->ifname);
+		ni_string_free(&state->path);
+		free(state->tree);
+		free(state->stamps);
+		free(state);
+	}
+}
+
+static void
+ni_lease_bin_state_update(const char *ifname, const ni_addrconf_lease_t *lease,
+		const char *path, const ni_buffer_t *bp, size_t stamps)
+{
+	ni_lease_bin_state_t **pos, *state;
+
+	pos = ni_lease_bin_state_find(ifname, lease->type, lease->family);
+	if (!(state = *pos)) {
+		state = xcalloc(1, sizeof(*state));
+		ni_string_dup(&state->ifname, ifname);
+		state->type = lease->type;
+		state->family = lease->family;
+		*pos = state;
+	}
+
+	ni_string_dup(&state->path, path);
+	state->size = bp->tail;
+	state->records = 0;
+
+	free(state->tree);
+	state->tree_len = stamps;
+	state->tree = xmalloc(stamps);
+	memcpy(state->tree, bp->base, stamps);
+
+	free(state->stamps);
+	state->stamps_len = bp->tail - stamps;
+	state->stamps = xmalloc(state->stamps_len);
+	memcpy(state->stamps, bp->base + stamps, state->stamps_len);
+}
+
+/*
+ * Append the timestamp record when only the timestamps changed since the
+ * last write. Returns FALSE when the file has to be rewritten.
+ */
+static ni_bool_t
+ni_lease_bin_append(const char *ifname, const ni_addrconf_lease_t *lease,
+		const ni_buffer_t *bp, size_t stamps)
+{
+	size_t len = bp->tail - stamps;
+	ni_lease_bin_state_t *state;
+	struct stat st;
+	int fd;
+
+	state = *ni_lease_bin_state_find(ifname, lease->type, lease->family);
+	if (!state || state->tree_len != stamps ||
+	    memcmp(state->tree, bp->base, stamps))
+		return FALSE;
+
+	/* removed or replaced by someone else */
+	if (stat(state->path, &st) < 0 || st.st_size != state->size)
+		return FALSE;
+
+	if (state->stamps_len == len && !memcmp(state->stamps, bp->base + stamps, len)) {
+		ni_debug_dhcp("Lease in file '%s' is unchanged", state->path);
+		return TRUE;
+	}
+	if (state->records >= ni_config_addrconf_lease_file_max_records())
+		return FALSE;
+
+	if ((fd = open(state->path, O_WRONLY | O_APPEND | O_CLOEXEC)) < 0)
+		return FALSE;
+	if (write(fd, bp->base + stamps, len) != (ssize_t)len) {
+		/* a partial record is ignored by the reader */
+		close(fd);
+		return FALSE;
+	}
+	if (close(fd) < 0)
+		return FALSE;
+
+	state->size += len;
+	state->records++;
+	free(state->stamps);
+	state->stamps_len = len;
+	state->stamps = xmalloc(len);
+	memcpy(state->stamps, bp->base + stamps, len);
+
+	ni_debug_dhcp("Lease renew appended to file '%s'", state->path);
+	return TRUE;
+}
 
 /*
  * Write a lease to a file
@@ -1251,10 +1700,13 @@ static void			__ni_addrconf_lease_file_remove(
 int
 ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 {
+	ni_config_lease_file_format_t format, other;
 	char tempname[PATH_MAX] = {'\0'};
+	ni_buffer_t buf = { NULL };
 	ni_bool_t fallback = FALSE;
 	char *filename = NULL;
 	xml_node_t *xml = NULL;
+	size_t stamps = 0;
 	FILE *fp = NULL;
 	int ret = -1;
 	int fd;
@@ -1264,8 +1716,12 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		return 0;
 	}
 
+	format = ni_config_addrconf_lease_file_format();
+	other = format == NI_CONFIG_LEASE_FILE_BINARY ?
+		NI_CONFIG_LEASE_FILE_XML : NI_CONFIG_LEASE_FILE_BINARY;
+
 	if (!__ni_addrconf_lease_file_path(&filename, ni_config_storedir(),
-					ifname, lease->type, lease->family)) {
+					ifname, lease->type, lease->family, format)) {
 		ni_error("Cannot construct lease file name: %m");
 		return -1;
 	}
@@ -1284,11 +1740,22 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		goto failed;
 	}
 
+	if (format == NI_CONFIG_LEASE_FILE_BINARY) {
+		ni_buffer_init_dynamic(&buf, 4096);
+		stamps = ni_lease_bin_encode(&buf, xml);
+		if (ni_lease_bin_append(ifname, lease, &buf, stamps)) {
+			ni_buffer_destroy(&buf);
+			xml_node_free(xml);
+			ni_string_free(&filename);
+			return 0;
+		}
+	}
+
 	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
 	if ((fd = mkstemp(tempname)) < 0) {
 		if (errno == EROFS && __ni_addrconf_lease_file_path(&filename,
 						ni_config_statedir(), ifname,
-						lease->type, lease->family)) {
+						lease->type, lease->family, format)) {
 			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
 					filename);
 			snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
@@ -1311,9 +1778,20 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 	}
 
 	ni_debug_dhcp("Writing lease to temporary file for '%s'", filename);
-	xml_node_print(xml, fp);
+	if (format == NI_CONFIG_LEASE_FILE_BINARY) {
+		if (fwrite(buf.base, 1, buf.tail, fp) != buf.tail) {
+			ni_error("Cannot write temporary lease file '%s': %m",
+					tempname);
+			ret = -1;
+			goto failed;
+		}
+	} else {
+		xml_node_print(xml, fp);
+	}
 	fclose(fp);
+	fp = NULL;
 	xml_node_free(xml);
+	xml = NULL;
 
 	if ((ret = rename(tempname, filename)) != 0) {
 		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
@@ -1321,7 +1799,18 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		goto failed;
 	} else if (!fallback) {
 		__ni_addrconf_lease_file_remove(ni_config_statedir(),
-				ifname, lease->type, lease->family);
+				ifname, lease->type, lease->family, format);
+	}
+
+	/* a switch of the format leaves no stale lease behind */
+	__ni_addrconf_lease_file_remove(ni_config_statedir(),
+			ifname, lease->type, lease->family, other);
+	__ni_addrconf_lease_file_remove(ni_config_storedir(),
+			ifname, lease->type, lease->family, other);
+
+	if (format == NI_CONFIG_LEASE_FILE_BINARY) {
+		ni_lease_bin_state_update(ifname, lease, filename, &buf, stamps);
+		ni_buffer_destroy(&buf);
 	}
 
 	ni_debug_dhcp("Lease written to file '%s'", filename);
@@ -1335,47 +1824,80 @@ failed:
 		xml_node_free(xml);
 	if (tempname[0])
 		unlink(tempname);
+	ni_buffer_destroy(&buf);
+	ni_lease_bin_state_drop(ifname, lease->type, lease->family);
 	ni_string_free(&filename);
 	return -1;
 }
 
+static xml_node_t *
+__ni_addrconf_lease_file_read_xml(FILE *fp, const char *filename)
+{
+	return xml_node_scan(fp, filename);
+}
+
+static xml_node_t *
+__ni_addrconf_lease_file_read_bin(FILE *fp, const char *filename)
+{
+	xml_node_t *xml = NULL;
+	ni_buffer_t buf;
+	struct stat st;
+
+	if (fstat(fileno(fp), &st) < 0 || st.st_size <= 0)
+		return NULL;
+
+	ni_buffer_init_dynamic(&buf, st.st_size);
+	if (fread(buf.base, 1, st.st_size, fp) == (size_t)st.st_size) {
+		buf.tail = st.st_size;
+		xml = ni_lease_bin_decode(&buf, filename);
+	}
+	ni_buffer_destroy(&buf);
+	return xml;
+}
+
 /*
  * Read a lease from a file
  */
 ni_addrconf_lease_t *
 ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 {
+	static const ni_config_lease_file_format_t formats[] = {
+		NI_CONFIG_LEASE_FILE_BINARY, NI_CONFIG_LEASE_FILE_XML
+	};
+	const char *dirs[] = { ni_config_statedir(), ni_config_storedir() };
+	ni_config_lease_file_format_t format = NI_CONFIG_LEASE_FILE_XML;
 	ni_addrconf_lease_t *lease = NULL;
 	xml_node_t *xml = NULL, *lnode;
 	char *filename = NULL;
-	FILE *fp;
-
-	if (!__ni_addrconf_lease_file_path(&filename,
-				ni_config_statedir(),
-				ifname, type, family)) {
-		ni_error("Unable to construct lease file name: %m");
-		return NULL;
-	}
+	unsigned int d, f;
+	FILE *fp = NULL;
 
-	if ((fp = fopen(filename, "re")) == NULL) {
-		if (errno == ENOENT) {
-			if (__ni_addrconf_lease_file_path(&filename,
-						ni_config_storedir(),
-						ifname, type, family))
-				fp = fopen(filename, "re");
-		}
-		if (fp == NULL) {
-			if (errno != ENOENT) {
+	for (d = 0; !fp && d < 2; ++d) {
+		for (f = 0; !fp && f < 2; ++f) {
+			format = formats[f];
+			if (!__ni_addrconf_lease_file_path(&filename, dirs[d],
+						ifname, type, family, format)) {
+				ni_error("Unable to construct lease file name: %m");
+				return NULL;
+			}
+			if ((fp = fopen(filename, "re")) == NULL && errno != ENOENT) {
 				ni_error("Unable to open %s for reading: %m",
 						filename);
+				ni_string_free(&filename);
+				return NULL;
 			}
-			ni_string_free(&filename);
-			return NULL;
 		}
 	}
+	if (fp == NULL) {
+		ni_string_free(&filename);
+		return NULL;
+	}
 
 	ni_debug_dhcp("Reading lease from %s", filename);
-	xml = xml_node_scan(fp, filename);
+	if (format == NI_CONFIG_LEASE_FILE_BINARY)
+		xml = __ni_addrconf_lease_file_read_bin(fp, filename);
+	else
+		xml = __ni_addrconf_lease_file_read_xml(fp, filename);
 	fclose(fp);
 
 	if (xml == NULL) {
@@ -1413,11 +1935,12 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
  */
 static void
 __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
-				int type, int family)
+				int type, int family,
+				ni_config_lease_file_format_t format)
 {
 	char *filename = NULL;
 
-	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family))
+	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family, format))
 		return;
 
 	if (ni_file_exists(filename) && unlink(filename) == 0)
@@ -1428,40 +1951,49 @@ __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
 void
 ni_addrconf_lease_file_remove(const char *ifname, int type, int family)
 {
-	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family);
-	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family);
+	ni_lease_bin_state_drop(ifname, type, family);
+	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_XML);
+	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_XML);
+	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_BINARY);
+	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_BINARY);
 }
 
 static const char *
 __ni_addrconf_lease_file_path(char **path, const char *dir,
-		const char *ifname, int type, int family)
+		const char *ifname, int type, int family,
+		ni_config_lease_file_format_t format)
 {
 	const char *t = ni_addrconf_type_to_name(type);
 	const char *f = ni_addrfamily_type_to_name(family);
+	const char *s = format == NI_CONFIG_LEASE_FILE_BINARY ? "bin" : "xml";
 
 	if (!path || ni_string_empty(dir) || ni_string_empty(ifname) || !t || !f)
 		return NULL;
-	return ni_string_printf(path, "%s/lease-%s-%s-%s.xml", dir, ifname, t, f);
+	return ni_string_printf(path, "%s/lease-%s-%s-%s.%s", dir, ifname, t, f, s);
 }
 
 ni_bool_t
 ni_addrconf_lease_file_exists(const char *ifname, int type, int family)
 {
+	const char *dirs[] = { ni_config_statedir(), ni_config_storedir() };
 	char *filename = NULL;
+	unsigned int d, f;
 
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_statedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
-		}
-	}
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_storedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
+	for (d = 0; d < 2; ++d) {
+		for (f = NI_CONFIG_LEASE_FILE_XML; f <= NI_CONFIG_LEASE_FILE_BINARY; ++f) {
+			if (!__ni_addrconf_lease_file_path(&filename, dirs[d],
+						ifname, type, family, f))
+				continue;
+			if (ni_file_exists(filename)) {
+				ni_string_free(&filename);
+				return TRUE;
+			}
 		}
 	}
 	ni_string_free(&filename);
 	return FALSE;
 }
-
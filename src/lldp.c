@@ -19,9 +19,13 @@
 #include <wicked/socket.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <sys/socket.h>
 #include <time.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <net/if_arp.h>
 #include <net/ethernet.h>
+#include <netpacket/packet.h>
 #include <stdarg.h>
 
 #if defined(HAVE_DCB_ATTR_IEEE_MAXRATE) && defined(HAVE_LINUX_DCBNL_H)
@@ -34,6 +38,7 @@
 #include "debug.h"
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "modprobe.h"
 #include "lldp-priv.h"
 
 /*
@@ -41,6 +46,24 @@
  */
 #define NI_LLDP_MAX_PEERS	256
 
+/*
+ * All agents share one ETH_P_LLDP packet socket, demultiplexing
+ * the received frames by ifindex using the agent hash table.
+ * The receive handler reads up to NI_LLDP_RECV_BATCH frames per
+ * wakeup using recvmmsg, or a single one where it is not available;
+ * larger PDUs than NI_LLDP_FRAME_MAX are dropped.
+ */
+#define NI_LLDP_AGENT_HASH_SIZE	64
+#define NI_LLDP_RECV_BATCH	16
+#define NI_LLDP_FRAME_MAX	1500
+
+/*
+ * The initial transmission of an agent is delayed by an ifindex
+ * dependent offset in this range (msec), so the periodic tx timers
+ * of agents started at once do not fire at the same time.
+ */
+#define NI_LLDP_TX_STAGGER	1000
+
 typedef struct ni_lldp_agent ni_lldp_agent_t;
 typedef struct ni_lldp_peer ni_lldp_peer_t;
 
@@ -67,7 +90,7 @@ struct ni_lldp_agent {
 
 	ni_lldp_peer_t *	peers;
 
-	ni_capture_t *		capture;
+	struct sockaddr_ll	destaddr;
 	ni_buffer_t		sendbuf;
 };
 
@@ -79,7 +102,13 @@ struct ni_lldp_peer {
 	unsigned char		raw_id[0];
 };
 
-static ni_lldp_agent_t *	ni_lldp_agents;
+static ni_lldp_agent_t *	ni_lldp_agents[NI_LLDP_AGENT_HASH_SIZE];
+static unsigned int		ni_lldp_agent_count;
+
+static struct ni_lldp_socket {
+	ni_socket_t *		sock;
+	unsigned char *		buffer;
+} ni_lldp_socket;
 
 static ni_hwaddr_t		ni_lldp_destaddr[__NI_LLDP_DEST_MAX] = {
 [NI_LLDP_DEST_NEAREST_BRIDGE] = {
@@ -110,6 +139,7 @@ static void		ni_lldp_agent_free(ni_lldp_agent_t *);
 static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int);
 static void		ni_lldp_tx_timer_arm(ni_lldp_agent_t *);
 static void		ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *);
+static void		ni_lldp_tx_timer_arm_stagger(ni_lldp_agent_t *);
 static void		ni_lldp_receive(ni_socket_t *);
 static ni_lldp_peer_t *	ni_lldp_peer_new(const void *raw_id, unsigned int raw_id_len);
 static void		ni_lldp_peer_unlink_and_free(ni_lldp_peer_t **);
@@ -294,8 +324,9 @@ ni_system_lldp_up(ni_netdev_t *dev, const ni_lldp_t *config)
 		if (ni_lldp_agent_start(dev, lldp, dcbx) < 0)
 			return -1;
 
-		/* Record the LLDP config requested by the user */
-		ni_netdev_set_lldp(dev, lldp);
+		/* Record the LLDP config requested by the user;
+		 * the agent owns lldp, so store a copy */
+		ni_netdev_set_lldp(dev, ni_lldp_clone(lldp));
 	} else {
 		/* Else: stop LLDP */
 		ni_netdev_set_lldp(dev, NULL);
@@ -346,7 +377,6 @@ ni_lldp_agent_new(ni_netdev_t *dev, unsigned int mtu)
 void
 ni_lldp_agent_free(ni_lldp_agent_t *agent)
 {
-	ni_capture_free(agent->capture);
 	ni_lldp_free(agent->config);
 	if (agent->txTTR)
 		ni_timer_cancel(agent->txTTR);
@@ -360,23 +390,110 @@ ni_lldp_agent_free(ni_lldp_agent_t *agent)
 	free(agent);
 }
 
+static inline ni_lldp_agent_t **
+__ni_lldp_agent_bucket(unsigned int ifindex)
+{
+	return &ni_lldp_agents[ifindex % NI_LLDP_AGENT_HASH_SIZE];
+}
+
 static ni_lldp_agent_t *
-__ni_lldp_take_agent(unsigned int ifindex, ni_lldp_agent_t ***pos_ret)
+__ni_lldp_find_agent(unsigned int ifindex)
+{
+	ni_lldp_agent_t *agent;
+
+	for (agent = *__ni_lldp_agent_bucket(ifindex); agent; agent = agent->next) {
+		if (agent->ifindex == ifindex)
+			return agent;
+	}
+	return NULL;
+}
+
+static ni_lldp_agent_t *
+__ni_lldp_take_agent(unsigned int ifindex)
 {
 	ni_lldp_agent_t *agent, **pos;
 
-	for (pos = &ni_lldp_agents; (agent = *pos) != NULL; pos = &agent->next) {
+	for (pos = __ni_lldp_agent_bucket(ifindex); (agent = *pos) != NULL; pos = &agent->next) {
 		if (agent->ifindex == ifindex) {
 			*pos = agent->next;
 			agent->next = NULL;
+			ni_lldp_agent_count--;
 			break;
 		}
 	}
-
-	*pos_ret = pos;
 	return agent;
 }
 
+static void
+__ni_lldp_insert_agent(ni_lldp_agent_t *agent)
+{
+	ni_lldp_agent_t **pos = __ni_lldp_agent_bucket(agent->ifindex);
+
+	agent->next = *pos;
+	*pos = agent;
+	ni_lldp_agent_count++;
+}
+
+/*
+ * The LLDP packet socket shared by all agents
+ */
+static ni_bool_t
+ni_lldp_socket_open(void)
+{
+	static ni_bool_t modprobe_done = FALSE;
+	int fd;
+
+	if (ni_lldp_socket.sock)
+		return TRUE;
+
+	if (!modprobe_done) {
+		/* load af_packet module we need for capturing */
+		ni_modprobe("af_packet", NULL);
+		modprobe_done = TRUE;
+	}
+
+	if ((fd = socket(PF_PACKET, SOCK_DGRAM, htons(ETHERTYPE_LLDP))) < 0) {
+		ni_error("unable to open LLDP packet socket: %m");
+		return FALSE;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (!(ni_lldp_socket.sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		close(fd);
+		return FALSE;
+	}
+	ni_lldp_socket.buffer = xmalloc(NI_LLDP_RECV_BATCH * NI_LLDP_FRAME_MAX);
+	ni_lldp_socket.sock->receive = ni_lldp_receive;
+	ni_socket_activate(ni_lldp_socket.sock);
+	return TRUE;
+}
+
+static void
+ni_lldp_socket_close(void)
+{
+	if (ni_lldp_socket.sock) {
+		ni_socket_close(ni_lldp_socket.sock);
+		ni_lldp_socket.sock = NULL;
+	}
+	free(ni_lldp_socket.buffer);
+	ni_lldp_socket.buffer = NULL;
+}
+
+static ssize_t
+ni_lldp_socket_send(ni_lldp_agent_t *agent, const ni_buffer_t *bp)
+{
+	ssize_t rv;
+
+	if (!ni_lldp_socket.sock)
+		return -1;
+
+	rv = sendto(ni_lldp_socket.sock->__fd, ni_buffer_head(bp), ni_buffer_count(bp), 0,
+			(const struct sockaddr *) &agent->destaddr, sizeof(agent->destaddr));
+	if (rv < 0)
+		ni_error("%s: unable to send LLDP packet: %m", agent->dev->name);
+	return rv;
+}
+
 static int
 __ni_lldp_agent_configure(ni_netdev_t *dev, ni_lldp_t *lldp)
 {
@@ -446,57 +563,70 @@ ni_lldp_agent_configure(ni_lldp_agent_t *agent, ni_netdev_t *dev, ni_lldp_t *lld
 static int
 ni_lldp_agent_start(ni_netdev_t *dev, ni_lldp_t *lldp, ni_dcbx_state_t *dcbx)
 {
-	ni_lldp_agent_t *agent, **pos;
-	ni_capture_t *capture = NULL;
+	const ni_hwaddr_t *destaddr;
+	ni_lldp_agent_t *agent;
 
-	if ((agent = __ni_lldp_take_agent(dev->link.ifindex, &pos)) != NULL) {
-		capture = agent->capture;
-		agent->capture = NULL;
+	if ((agent = __ni_lldp_take_agent(dev->link.ifindex)) != NULL)
 		ni_lldp_agent_free(agent);
-	}
-
-	agent = ni_lldp_agent_new(dev, 1500);
-	agent->next = *pos;
-	*pos = agent;
-
-	if (ni_lldp_agent_configure(agent, dev, lldp, dcbx) < 0)
-		return -1;
 
-	if (capture == NULL) {
-		ni_capture_devinfo_t devinfo;
-		ni_capture_protinfo_t protinfo;
-
-		memset(&protinfo, 0, sizeof(protinfo));
-		protinfo.eth_protocol = ETHERTYPE_LLDP;
+	if (dev->link.ifindex == 0 || !ni_lldp_socket_open()) {
+		ni_error("%s: unable to start LLDP agent", dev->name);
+		goto failed;
+	}
 
-		if (agent->config->destination >= __NI_LLDP_DEST_MAX)
-			return -1;
-		protinfo.eth_destaddr = ni_lldp_destaddr[agent->config->destination];
+	agent = ni_lldp_agent_new(dev, NI_LLDP_FRAME_MAX);
+	agent->ifindex = dev->link.ifindex;
 
-		if (ni_capture_devinfo_init(&devinfo, dev->name, &dev->link) < 0)
-			return -1;
+	if (ni_lldp_agent_configure(agent, dev, lldp, dcbx) < 0) {
+		ni_lldp_agent_free(agent);
+		lldp = NULL;
+		goto failed;
+	}
 
-		capture = ni_capture_open(&devinfo, &protinfo, ni_lldp_receive);
+	if (agent->config->destination >= __NI_LLDP_DEST_MAX) {
+		/* the agent owns lldp and dcbx now */
+		ni_lldp_agent_free(agent);
+		lldp = NULL;
+		dcbx = NULL;
+		goto failed;
 	}
-	agent->capture = capture;
+	__ni_lldp_insert_agent(agent);
 
-	ni_capture_set_user_data(capture, agent);
+	destaddr = &ni_lldp_destaddr[agent->config->destination];
 
-	ni_lldp_agent_send(agent);
+	agent->destaddr.sll_family = AF_PACKET;
+	agent->destaddr.sll_protocol = htons(ETHERTYPE_LLDP);
+	agent->destaddr.sll_ifindex = agent->ifindex;
+	agent->destaddr.sll_hatype = htons(dev->link.hwaddr.type);
+	agent->destaddr.sll_halen = destaddr->len;
+	memcpy(agent->destaddr.sll_addr, destaddr->data, destaddr->len);
+
+	ni_lldp_tx_timer_arm_stagger(agent);
 	return 0;
+
+failed:
+	ni_lldp_free(lldp);
+	if (dcbx)
+		ni_dcbx_free(dcbx);
+	if (ni_lldp_agent_count == 0)
+		ni_lldp_socket_close();
+	return -1;
 }
 
 void
 ni_lldp_agent_stop(ni_netdev_t *dev)
 {
-	ni_lldp_agent_t *agent, **pos;
+	ni_lldp_agent_t *agent;
 
-	if ((agent = __ni_lldp_take_agent(dev->link.ifindex, &pos)) != NULL) {
+	if ((agent = __ni_lldp_take_agent(dev->link.ifindex)) != NULL) {
 		/* While the device is still up, try to send a shutdown PDU */
 		if (ni_netdev_device_is_up(dev))
 			ni_lldp_agent_send_shutdown(agent);
 		ni_lldp_agent_free(agent);
 	}
+
+	if (ni_lldp_agent_count == 0)
+		ni_lldp_socket_close();
 }
 
 static ni_bool_t
@@ -538,7 +668,7 @@ ni_lldp_agent_send(ni_lldp_agent_t *agent)
 
 		ni_debug_lldp("%s: sending LLDP packet (PDU len=%u)", agent->dev->name, ni_buffer_count(bp));
 		/* ni_debug_lldp(PDU=%s", ni_print_hex(ni_buffer_head(bp), ni_buffer_count(bp))); */
-		ni_capture_send(agent->capture, &agent->sendbuf, NULL);
+		ni_lldp_socket_send(agent, &agent->sendbuf);
 		agent->txCredit--;
 
 		/* Decrement txFast if we're in a fast retrans cycle */
@@ -567,7 +697,7 @@ ni_lldp_agent_send_shutdown(ni_lldp_agent_t *agent)
 		return -1;
 	}
 
-	ni_capture_send(agent->capture, &agent->sendbuf, NULL);
+	ni_lldp_socket_send(agent, &agent->sendbuf);
 	return 0;
 }
 
@@ -631,6 +761,14 @@ ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *agent)
 	__ni_lldp_tx_timer_arm(agent, 1000);
 }
 
+void
+ni_lldp_tx_timer_arm_stagger(ni_lldp_agent_t *agent)
+{
+	/* Spread the agents over the stagger range (multiplicative hash);
+	 * the periodic timer re-arms keep this phase offset. */
+	__ni_lldp_tx_timer_arm(agent, (agent->ifindex * 2654435761U) % NI_LLDP_TX_STAGGER);
+}
+
 /*
  * LLDP rx agent
  */
@@ -723,37 +861,113 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
  * LLDP receive handling
  */
 static void
-ni_lldp_receive(ni_socket_t *sock)
+ni_lldp_agent_receive(ni_lldp_agent_t *agent, ni_buffer_t *buf)
+{
+	ni_buffer_t raw_id_buf;
+	const void *raw_id;
+	unsigned int raw_id_len;
+	ni_lldp_t *lldp;
+
+	/* Get the chassis and port ID TLVs as a raw string
+	 * of bytes. */
+	raw_id_buf = *buf;
+	if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
+		return;
+
+	lldp = ni_lldp_new();
+	if (ni_lldp_pdu_parse(lldp, buf) < 0) {
+		ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
+		ni_lldp_free(lldp);
+		return;
+	}
+
+	ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
+}
+
+static void
+ni_lldp_receive_frame(const struct sockaddr_ll *from, const struct msghdr *msg,
+			void *data, size_t len)
 {
-	ni_capture_t *capture = sock->user_data;
-	ni_sockaddr_t from;
+	ni_lldp_agent_t *agent;
 	ni_buffer_t buf;
 
 	/* FIXME: we need to store the MAC address we received this packet from.
 	 * This is needed for DCBX tie-breaking among other things. */
-	if (ni_capture_recv(capture, &buf, &from, "lldp") >= 0) {
-		ni_lldp_agent_t *agent = ni_capture_get_user_data(capture);
-		ni_buffer_t raw_id_buf;
-		const void *raw_id;
-		unsigned int raw_id_len;
-		ni_lldp_t *lldp;
-
-		/* Get the chassis and port ID TLVs as a raw string
-		 * of bytes. */
-		raw_id_buf = buf;
-		if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
-			return;
-
-		lldp = ni_lldp_new();
-		if (ni_lldp_pdu_parse(lldp, &buf) < 0) {
-			ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
-			ni_lldp_free(lldp);
-			return;
-		}
+	if (from->sll_pkttype == PACKET_OUTGOING)
+		return;
+
+	if (!(agent = __ni_lldp_find_agent(from->sll_ifindex)))
+		return;
+
+	if (msg->msg_flags & MSG_TRUNC) {
+		ni_debug_lldp("%s: dropping oversized LLDP packet", agent->dev->name);
+		return;
+	}
+
+	ni_debug_socket("%s: incoming lldp packet", agent->dev->name);
+	ni_buffer_init_reader(&buf, data, len);
+	ni_lldp_agent_receive(agent, &buf);
+}
+
+static void
+ni_lldp_receive(ni_socket_t *sock)
+{
+#if defined(HAVE_RECVMMSG)
+	struct mmsghdr msgs[NI_LLDP_RECV_BATCH];
+	struct iovec iov[NI_LLDP_RECV_BATCH];
+	struct sockaddr_ll from[NI_LLDP_RECV_BATCH];
+	int i, count;
 
-		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
+	if (!ni_lldp_socket.buffer)
+		return;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < NI_LLDP_RECV_BATCH; ++i) {
+		iov[i].iov_base = ni_lldp_socket.buffer + i * NI_LLDP_FRAME_MAX;
+		iov[i].iov_len = NI_LLDP_FRAME_MAX;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+	}
+
+	count = recvmmsg(sock->__fd, msgs, NI_LLDP_RECV_BATCH, MSG_DONTWAIT, NULL);
+	if (count < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			ni_error("cannot read LLDP packets from socket: %m");
+		return;
 	}
 
+	for (i = 0; i < count; ++i) {
+		ni_lldp_receive_frame(&from[i], &msgs[i].msg_hdr,
+				iov[i].iov_base, msgs[i].msg_len);
+	}
+#else
+	struct msghdr msg;
+	struct iovec iov;
+	struct sockaddr_ll from;
+	ssize_t len;
+
+	if (!ni_lldp_socket.buffer)
+		return;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = ni_lldp_socket.buffer;
+	iov.iov_len = NI_LLDP_FRAME_MAX;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_name = &from;
+	msg.msg_namelen = sizeof(from);
+
+	len = recvmsg(sock->__fd, &msg, MSG_DONTWAIT);
+	if (len < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			ni_error("cannot read LLDP packet from socket: %m");
+		return;
+	}
+
+	ni_lldp_receive_frame(&from, &msg, iov.iov_base, len);
+#endif
 }
 
 /*
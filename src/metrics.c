@@ -0,0 +1,134 @@
+/*
+ *	In-process runtime metrics of the wicked daemons
+ *
+ *	Copyright (C) 2015 SUSE Linux GmbH, Nuernberg, Germany.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ * The counters are updated inline at the instrumented places; this
+ * file only provides the storage and the names used to export them
+ * via the org.opensuse.Network.Metrics interface.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "metrics.h"
+
+uint64_t			ni_metrics_value[__NI_METRIC_MAX];
+ni_metrics_histogram_t		ni_metrics_histogram[__NI_METRIC_HISTOGRAM_MAX];
+
+static const ni_metric_info_t	ni_metrics_info_table[__NI_METRIC_MAX] = {
+	[NI_METRIC_RTNL_RECEIVED]	= {
+		"rtnl-messages-received",	NI_METRIC_TYPE_COUNTER,
+		"rtnetlink event messages received"
+	},
+	[NI_METRIC_RTNL_DROPPED]	= {
+		"rtnl-messages-dropped",	NI_METRIC_TYPE_COUNTER,
+		"rtnetlink event messages filtered or not processed"
+	},
+	[NI_METRIC_RTNL_RECV_ERRORS]	= {
+		"rtnl-receive-errors",		NI_METRIC_TYPE_COUNTER,
+		"rtnetlink event socket receive errors (listener restarts)"
+	},
+	[NI_METRIC_EVENTS_DISPATCHED]	= {
+		"events-dispatched",		NI_METRIC_TYPE_COUNTER,
+		"interface, address, prefix, route and rule events dispatched"
+	},
+	[NI_METRIC_FSM_TRANSITIONS]	= {
+		"fsm-transitions",		NI_METRIC_TYPE_COUNTER,
+		"interface worker state transitions executed"
+	},
+	[NI_METRIC_TIMERS_ARMED]	= {
+		"timers-armed",			NI_METRIC_TYPE_COUNTER,
+		"timers registered or rearmed"
+	},
+	[NI_METRIC_TIMERS_ACTIVE]	= {
+		"timers-active",		NI_METRIC_TYPE_GAUGE,
+		"timers currently pending"
+	},
+	[NI_METRIC_PROCESSES_SPAWNED]	= {
+		"processes-spawned",		NI_METRIC_TYPE_COUNTER,
+		"child processes forked"
+	},
+};
+
+static const ni_metric_info_t	ni_metrics_histogram_info_table[__NI_METRIC_HISTOGRAM_MAX] = {
+	[NI_METRIC_HISTOGRAM_DBUS_CALL]	= {
+		"dbus-call-usec",		NI_METRIC_TYPE_HISTOGRAM,
+		"synchronous D-Bus calls made and their latency"
+	},
+	[NI_METRIC_HISTOGRAM_DBUS_METHOD] = {
+		"dbus-method-usec",		NI_METRIC_TYPE_HISTOGRAM,
+		"D-Bus method calls served and their latency"
+	},
+	[NI_METRIC_HISTOGRAM_PROCESS_RUNTIME] = {
+		"process-runtime-usec",		NI_METRIC_TYPE_HISTOGRAM,
+		"child processes reaped and their runtime"
+	},
+};
+
+const ni_metric_info_t *
+ni_metrics_info(ni_metric_t id)
+{
+	if ((unsigned int)id >= __NI_METRIC_MAX)
+		return NULL;
+	return &ni_metrics_info_table[id];
+}
+
+const ni_metric_info_t *
+ni_metrics_histogram_info(ni_metric_histogram_t id)
+{
+	if ((unsigned int)id >= __NI_METRIC_HISTOGRAM_MAX)
+		return NULL;
+	return &ni_metrics_histogram_info_table[id];
+}
+
+/*
+ * Return the upper (exclusive) bound of a histogram bucket in usec
+ * as string or "inf" for the last one, which is unbounded.
+ */
+const char *
+ni_metrics_bucket_name(unsigned int i)
+{
+	static const char *names[NI_METRICS_BUCKETS] = {
+		"1",		"2",		"4",		"8",
+		"16",		"32",		"64",		"128",
+		"256",		"512",		"1024",		"2048",
+		"4096",		"8192",		"16384",	"32768",
+		"65536",	"131072",	"262144",	"524288",
+		"1048576",	"2097152",	"4194304",	"inf",
+	};
+
+	return i < NI_METRICS_BUCKETS ? names[i] : NULL;
+}
+
+/*
+ * Reset the counters and histograms, but not the gauges,
+ * which reflect the current state.
+ */
+void
+ni_metrics_reset(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < __NI_METRIC_MAX; ++i) {
+		if (ni_metrics_info_table[i].type != NI_METRIC_TYPE_GAUGE)
+			ni_metrics_value[i] = 0;
+	}
+	memset(ni_metrics_histogram, 0, sizeof(ni_metrics_histogram));
+}
@@ -0,0 +1,133 @@
+/*
+ *	In-process runtime metrics of the wicked daemons
+ *
+ *	Copyright (C) 2015 SUSE Linux GmbH, Nuernberg, Germany.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef   __WICKED_METRICS_H__
+#define   __WICKED_METRICS_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * The daemons are single threaded, so the counters are plain
+ * integers updated from the main loop without any locking.
+ */
+typedef enum {
+	NI_METRIC_RTNL_RECEIVED,
+	NI_METRIC_RTNL_DROPPED,
+	NI_METRIC_RTNL_RECV_ERRORS,
+	NI_METRIC_EVENTS_DISPATCHED,
+	NI_METRIC_FSM_TRANSITIONS,
+	NI_METRIC_TIMERS_ARMED,
+	NI_METRIC_TIMERS_ACTIVE,
+	NI_METRIC_PROCESSES_SPAWNED,
+
+	__NI_METRIC_MAX
+} ni_metric_t;
+
+typedef enum {
+	NI_METRIC_HISTOGRAM_DBUS_CALL,
+	NI_METRIC_HISTOGRAM_DBUS_METHOD,
+	NI_METRIC_HISTOGRAM_PROCESS_RUNTIME,
+
+	__NI_METRIC_HISTOGRAM_MAX
+} ni_metric_histogram_t;
+
+typedef enum {
+	NI_METRIC_TYPE_COUNTER,
+	NI_METRIC_TYPE_GAUGE,
+	NI_METRIC_TYPE_HISTOGRAM,
+} ni_metric_type_t;
+
+/*
+ * Latency histograms in microseconds with power of 2 buckets:
+ * bucket[i] counts the observations below 2^i usec, the last
+ * one everything from 2^(NI_METRICS_BUCKETS-2) usec (~4s) on.
+ */
+#define NI_METRICS_BUCKETS		24
+
+typedef struct ni_metrics_histogram {
+	uint64_t		count;
+	uint64_t		sum;
+	uint64_t		bucket[NI_METRICS_BUCKETS];
+} ni_metrics_histogram_t;
+
+typedef struct ni_metric_info {
+	const char *		name;
+	ni_metric_type_t	type;
+	const char *		description;
+} ni_metric_info_t;
+
+extern uint64_t				ni_metrics_value[__NI_METRIC_MAX];
+extern ni_metrics_histogram_t		ni_metrics_histogram[__NI_METRIC_HISTOGRAM_MAX];
+
+extern const ni_metric_info_t *		ni_metrics_info(ni_metric_t);
+extern const ni_metric_info_t *		ni_metrics_histogram_info(ni_metric_histogram_t);
+extern const char *			ni_metrics_bucket_name(unsigned int);
+extern void				ni_metrics_reset(void);
+
+static inline void
+ni_metrics_inc(ni_metric_t id)
+{
+	ni_metrics_value[id]++;
+}
+
+static inline void
+ni_metrics_dec(ni_metric_t id)
+{
+	if (ni_metrics_value[id])
+		ni_metrics_value[id]--;
+}
+
+static inline void
+ni_metrics_observe(ni_metric_histogram_t id, uint64_t usec)
+{
+	ni_metrics_histogram_t *h = &ni_metrics_histogram[id];
+	unsigned int i = 0;
+
+	while (i < NI_METRICS_BUCKETS - 1 && (usec >> i))
+		i++;
+	h->bucket[i]++;
+	h->count++;
+	h->sum += usec;
+}
+
+/*
+ * Latency measurements use the monotonic clock, which is a
+ * vdso call and not affected by wall clock adjustments.
+ */
+static inline void
+ni_metrics_start(struct timespec *start)
+{
+	clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static inline void
+ni_metrics_observe_since(ni_metric_histogram_t id, const struct timespec *start)
+{
+	struct timespec now;
+	int64_t usec;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	usec = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+	ni_metrics_observe(id, usec > 0 ? usec : 0);
+}
+
+#endif /* __WICKED_METRICS_H__ */
@@ -7,7 +7,14 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/utsname.h>
+
 #include <wicked/util.h>
+#include <wicked/logging.h>
+#include "modprobe.h"
 #include "process.h"
 
 #ifndef NI_MODPROBE_BIN
@@ -16,6 +23,105 @@
 #ifndef NI_MODPROBE_OPT
 #define NI_MODPROBE_OPT "-qs"
 #endif
+#ifndef NI_MODPROBE_SYSFS_DIR
+#define NI_MODPROBE_SYSFS_DIR "/sys/module"
+#endif
+#ifndef NI_MODPROBE_MODULES_DIR
+#define NI_MODPROBE_MODULES_DIR "/lib/modules"
+#endif
+
+/*
+ * Names of the modules built into the running kernel,
+ * read once from modules.builtin.
+ */
+static ni_string_array_t	ni_modprobe_builtin_names = NI_STRING_ARRAY_INIT;
+static ni_bool_t		ni_modprobe_builtin_read = FALSE;
+
+static void
+ni_modprobe_name(char *name, size_t size, const char *module)
+{
+	size_t i;
+
+	/* the kernel uses underscores in module names */
+	for (i = 0; i + 1 < size && module[i]; ++i)
+		name[i] = module[i] == '-' ? '_' : module[i];
+	name[i] = '\0';
+}
+
+static void
+ni_modprobe_builtin_load(void)
+{
+	char path[PATH_MAX], line[PATH_MAX], name[NAME_MAX + 1];
+	struct utsname uts;
+	char *base, *ext;
+	FILE *fp;
+
+	ni_modprobe_builtin_read = TRUE;
+	if (uname(&uts) < 0)
+		return;
+
+	snprintf(path, sizeof(path), "%s/%s/modules.builtin",
+			NI_MODPROBE_MODULES_DIR, uts.release);
+	if (!(fp = fopen(path, "re")))
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		base = strrchr(line, '/');
+		base = base ? base + 1 : line;
+		if ((ext = strstr(base, ".ko")))
+			*ext = '\0';
+		if (ni_string_empty(base))
+			continue;
+
+		ni_modprobe_name(name, sizeof(name), base);
+		ni_string_array_append(&ni_modprobe_builtin_names, name);
+	}
+	fclose(fp);
+}
+
+/*
+ * Check if a module is built in or loaded without to run modprobe.
+ * The sysfs module directory is the cache -- it disappears when the
+ * module gets unloaded, so there is nothing to invalidate.
+ */
+ni_bool_t
+ni_modprobe_loaded(const char *module)
+{
+	char name[NAME_MAX + 1];
+	char path[PATH_MAX];
+	char *state = NULL;
+	ni_bool_t loaded;
+	FILE *fp;
+
+	if (ni_string_empty(module))
+		return FALSE;
+
+	ni_modprobe_name(name, sizeof(name), module);
+	if (!ni_modprobe_builtin_read)
+		ni_modprobe_builtin_load();
+	if (ni_string_array_index(&ni_modprobe_builtin_names, name) >= 0)
+		return TRUE;
+
+	snprintf(path, sizeof(path), "%s/%s", NI_MODPROBE_SYSFS_DIR, name);
+	if (!ni_isdir(path))
+		return FALSE;
+
+	/* loadable modules in "coming" or "going" state are not usable yet */
+	snprintf(path, sizeof(path), "%s/%s/initstate", NI_MODPROBE_SYSFS_DIR, name);
+	if (!(fp = fopen(path, "re")))
+		return TRUE;
+
+	if (fgets(path, sizeof(path), fp)) {
+		path[strcspn(path, "\r\n")] = '\0';
+		ni_string_dup(&state, path);
+	}
+	fclose(fp);
+
+	loaded = ni_string_eq(state, "live");
+	ni_string_free(&state);
+	return loaded;
+}
 
 int
 ni_modprobe(const char *module, const char *options)
@@ -28,6 +134,12 @@ ni_modprobe(const char *module, const char *options)
 	if (ni_string_len(module) == 0)
 		return -1;
 
+	if (ni_modprobe_loaded(module)) {
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_IFCONFIG,
+				"module %s is already loaded", module);
+		return 0;
+	}
+
 	ni_string_array_init(&argv);
 	if (ni_string_array_append(&argv, NI_MODPROBE_BIN) < 0 ||
 	    ni_string_array_append(&argv, NI_MODPROBE_OPT) < 0 ||
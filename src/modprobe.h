@@ -7,6 +7,9 @@
 #ifndef __WICKED_MODPROBE_H__
 #define __WICKED_MODPROBE_H__
 
-extern int	ni_modprobe(const char *module, const char *options);
+#include <wicked/types.h>
+
+extern ni_bool_t	ni_modprobe_loaded(const char *module);
+extern int		ni_modprobe(const char *module, const char *options);
 
 #endif /* __WICKED_MODPROBE_H__ */
@@ -97,6 +97,9 @@ extern int		__ni_system_interface_flush_routes(ni_netconfig_t *, ni_netdev_t *);
 extern void		__ni_system_ethernet_refresh(ni_netdev_t *);
 extern void		__ni_system_ethernet_update(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_system_ethtool_refresh(ni_netdev_t *);
+extern void		ni_system_ethtool_refresh_all(ni_netconfig_t *);
+extern void		ni_system_ethtool_invalidate(ni_netdev_t *);
+extern ni_bool_t	ni_system_ethtool_revalidate(ni_netdev_t *);
 
 /* FIXME: These should go elsewhere, maybe runtime.h */
 extern int		__ni_system_interface_update_lease(ni_netdev_t *, ni_addrconf_lease_t **, ni_event_t);
@@ -149,6 +152,19 @@ typedef struct ni_capture_protinfo {
 	uint16_t		ip_port;
 } ni_capture_protinfo_t;
 
+/*
+ * Per socket receive counters; a wakeup drains up to
+ * NI_CAPTURE_BATCH_MAX packets from the socket at once.
+ */
+#define NI_CAPTURE_BATCH_MAX	16
+
+typedef struct ni_capture_stats {
+	unsigned int		wakeups;
+	unsigned int		packets;
+	unsigned int		max_batch;	/* most packets in one wakeup */
+	unsigned int		full_batches;	/* wakeups that filled the batch */
+} ni_capture_stats_t;
+
 extern int		ni_capture_devinfo_init(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern int		ni_capture_devinfo_refresh(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern ni_capture_t *	ni_capture_open(const ni_capture_devinfo_t *, const ni_capture_protinfo_t *, void (*)(ni_socket_t *));
@@ -166,6 +182,7 @@ extern int		ni_capture_build_udp_header(ni_buffer_t *,
 extern void		ni_capture_set_user_data(ni_capture_t *, void *);
 extern void *		ni_capture_get_user_data(const ni_capture_t *);
 extern int		ni_capture_is_valid(const ni_capture_t *, int protocol);
+extern void		ni_capture_get_stats(const ni_capture_t *, ni_capture_stats_t *);
 
 typedef struct ni_arp_socket ni_arp_socket_t;
 
@@ -197,13 +214,43 @@ extern int		ni_arp_send_grat_reply(ni_arp_socket_t *, struct in_addr);
 extern int		ni_arp_send_grat_request(ni_arp_socket_t *, struct in_addr);
 extern int		ni_arp_send(ni_arp_socket_t *, const ni_arp_packet_t *);
 
+/*
+ * Hash index of the IPv4 addresses in an arp verify/notify array
+ */
+typedef struct ni_arp_address_index {
+	unsigned int		size;		/* power of 2, > 2 * count	*/
+	unsigned int *		slots;		/* position + 1, 0 when unused	*/
+} ni_arp_address_index_t;
+
+/*
+ * Link-layer addresses of the other interfaces on this host,
+ * sorted by address to rule out replies from ourselves.
+ */
+typedef struct ni_arp_hwaddr_entry {
+	ni_hwaddr_t		hwaddr;
+	unsigned int		ifindex;
+} ni_arp_hwaddr_entry_t;
+
+typedef struct ni_arp_hwaddr_index {
+	unsigned int		count;
+	ni_arp_hwaddr_entry_t *	data;
+	ni_bool_t		valid;
+} ni_arp_hwaddr_index_t;
+
 typedef struct ni_arp_verify {
 	unsigned int		nprobes;
+	unsigned int		rate;		/* probes per second, 0: unlimited */
 
 	unsigned int		wait_ms;
+	unsigned int		delay_ms;	/* current delay since started	*/
 	struct timeval		started;
 
+	unsigned int		next;		/* next address in probe round	*/
+	unsigned int		sent;		/* probes sent in probe round	*/
+
 	ni_address_array_t	ipaddrs;
+	ni_arp_address_index_t	index;
+	ni_arp_hwaddr_index_t	hwaddrs;
 } ni_arp_verify_t;
 
 extern void		ni_arp_verify_init(ni_arp_verify_t *, unsigned int, unsigned int);
@@ -211,6 +258,8 @@ extern void		ni_arp_verify_reset(ni_arp_verify_t *, unsigned int, unsigned int);
 extern void		ni_arp_verify_destroy(ni_arp_verify_t *);
 extern unsigned int	ni_arp_verify_add_address(ni_arp_verify_t *,  ni_address_t *);
 extern void		ni_arp_verify_process(ni_arp_socket_t *, const ni_arp_packet_t *, void *);
+extern void		ni_arp_verify_set_rate(ni_arp_verify_t *, unsigned int);
+extern ni_address_t *	ni_arp_verify_find_address(const ni_arp_verify_t *, struct in_addr);
 extern ni_bool_t	ni_arp_verify_send(ni_arp_socket_t *, ni_arp_verify_t *, unsigned int *);
 
 typedef struct ni_arp_notify {
@@ -220,6 +269,7 @@ typedef struct ni_arp_notify {
 	struct timeval		started;
 
 	ni_address_array_t	ipaddrs;
+	ni_arp_address_index_t	index;
 } ni_arp_notify_t;
 
 extern void		ni_arp_notify_init(ni_arp_notify_t *, unsigned int, unsigned int);
@@ -268,4 +318,20 @@ extern void			ni_addrconf_updater_set_data(ni_addrconf_updater_t *, void *, ni_a
 extern void *			ni_addrconf_updater_get_data(ni_addrconf_updater_t *, ni_addrconf_updater_cleanup_t *);
 extern void			ni_addrconf_updater_free(ni_addrconf_updater_t **);
 
+/*
+ * System updater actions executed in-process, referenced by symbol name
+ * in the <builtin> elements of a <system-updater> extension.
+ */
+typedef int			ni_system_updater_builtin_t(const char *ifname, unsigned int type,
+							unsigned int family, const char *arg);
+
+extern ni_system_updater_builtin_t	ni_system_updater_hostname_backup;
+extern ni_system_updater_builtin_t	ni_system_updater_hostname_restore;
+extern ni_system_updater_builtin_t	ni_system_updater_hostname_install;
+extern ni_system_updater_builtin_t	ni_system_updater_hostname_remove;
+extern ni_system_updater_builtin_t	ni_system_updater_resolver_backup;
+extern ni_system_updater_builtin_t	ni_system_updater_resolver_restore;
+extern ni_system_updater_builtin_t	ni_system_updater_resolver_install;
+extern ni_system_updater_builtin_t	ni_system_updater_resolver_remove;
+
 #endif /* __NETINFO_PRIV_H__ */
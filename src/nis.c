@@ -130,7 +130,9 @@ void
 ni_nis_info_free(ni_nis_info_t *nis)
 {
 	ni_string_free(&nis->domainname);
+	ni_string_array_destroy(&nis->default_servers);
 	ni_nis_domain_array_destroy(&nis->domains);
+	free(nis);
 }
 
 ni_nis_domain_t *
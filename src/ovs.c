@@ -30,6 +30,7 @@
 #include <wicked/util.h>
 #include <wicked/netinfo.h>
 #include "ovs.h"
+#include "ovsdb.h"
 #include "buffer.h"
 #include "process.h"
 #include "util_priv.h"
@@ -196,6 +197,74 @@ ni_ovs_bridge_port_config_destroy(ni_ovs_bridge_port_config_t *conf)
 }
 
 
+/*
+ * ovsdb-server transactions; NI_OVSDB_UNAVAILABLE falls back to ovs-vsctl
+ */
+static int
+ni_ovs_ovsdb_bridge_add(const ni_netdev_t *cfg, ni_bool_t may_exist)
+{
+	ni_ovsdb_txn_t *txn;
+	int rv = NI_OVSDB_FAILURE;
+
+	if (!(txn = ni_ovsdb_txn_new()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (ni_ovsdb_txn_bridge_add(txn, cfg->name, cfg->ovsbr->config.vlan.parent.name,
+					cfg->ovsbr->config.vlan.tag, may_exist))
+		rv = ni_ovsdb_txn_commit(txn);
+
+	ni_ovsdb_txn_free(txn);
+	return rv;
+}
+
+static int
+ni_ovs_ovsdb_bridge_del(const char *brname)
+{
+	ni_ovsdb_txn_t *txn;
+	int rv = NI_OVSDB_FAILURE;
+
+	if (!(txn = ni_ovsdb_txn_new()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (ni_ovsdb_txn_bridge_del(txn, brname))
+		rv = ni_ovsdb_txn_commit(txn);
+
+	ni_ovsdb_txn_free(txn);
+	return rv;
+}
+
+static int
+ni_ovs_ovsdb_port_add(const char *brname, const char *pname, ni_bool_t may_exist)
+{
+	ni_ovsdb_txn_t *txn;
+	int rv = NI_OVSDB_FAILURE;
+
+	if (!(txn = ni_ovsdb_txn_new()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (ni_ovsdb_txn_port_add(txn, brname, pname, may_exist))
+		rv = ni_ovsdb_txn_commit(txn);
+
+	ni_ovsdb_txn_free(txn);
+	return rv;
+}
+
+static int
+ni_ovs_ovsdb_port_del(const char *brname, const char *pname)
+{
+	ni_ovsdb_txn_t *txn;
+	int rv = NI_OVSDB_FAILURE;
+
+	if (!(txn = ni_ovsdb_txn_new()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (ni_ovsdb_txn_port_del(txn, brname, pname))
+		rv = ni_ovsdb_txn_commit(txn);
+
+	ni_ovsdb_txn_free(txn);
+	return rv;
+}
+
 static const char *
 ni_ovs_vsctl_tool_path(void)
 {
@@ -221,6 +290,10 @@ ni_ovs_vsctl_bridge_exists(const char *brname)
 	if (ni_string_empty(brname))
 		return rv;
 
+	if ((rv = ni_ovsdb_bridge_exists(brname)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -263,6 +336,10 @@ ni_ovs_vsctl_bridge_to_vlan(const char *brname, uint16_t *vlan)
 	if (ni_string_empty(brname) || !vlan)
 		return rv;
 
+	if ((rv = ni_ovsdb_bridge_to_vlan(brname, vlan)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -325,6 +402,10 @@ ni_ovs_vsctl_bridge_to_parent(const char *brname, char **parent)
 	if (ni_string_empty(brname) || !parent)
 		return rv;
 
+	if ((rv = ni_ovsdb_bridge_to_parent(brname, parent)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -381,6 +462,10 @@ ni_ovs_vsctl_bridge_ports(const char *brname, ni_ovs_bridge_port_array_t *ports)
 	if (ni_string_empty(brname) || !ports)
 		return rv;
 
+	if ((rv = ni_ovsdb_bridge_ports(brname, ports)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -445,6 +530,10 @@ ni_ovs_vsctl_bridge_add(const ni_netdev_t *cfg, ni_bool_t may_exist)
 	if (!cfg || ni_string_empty(cfg->name) || !cfg->ovsbr)
 		return rv;
 
+	if ((rv = ni_ovs_ovsdb_bridge_add(cfg, may_exist)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -495,6 +584,10 @@ ni_ovs_vsctl_bridge_del(const char *brname)
 	if (ni_string_empty(brname))
 		return rv;
 
+	if ((rv = ni_ovs_ovsdb_bridge_del(brname)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -534,6 +627,10 @@ ni_ovs_vsctl_bridge_port_add(const char *pname, const ni_ovs_bridge_port_config_
 	if (ni_string_empty(pname) || !pconf || ni_string_empty(pconf->bridge.name))
 		return rv;
 
+	if ((rv = ni_ovs_ovsdb_port_add(pconf->bridge.name, pname, may_exist)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -580,6 +677,10 @@ ni_ovs_vsctl_bridge_port_del(const char *brname, const char *pname)
 	if (ni_string_empty(brname) || ni_string_empty(pname))
 		return rv;
 
+	if ((rv = ni_ovs_ovsdb_port_del(brname, pname)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
@@ -624,6 +725,10 @@ ni_ovs_vsctl_bridge_port_to_bridge(const char *pname, char **brname)
 	if (ni_string_empty(pname) || !brname)
 		return rv;
 
+	if ((rv = ni_ovsdb_port_to_bridge(pname, brname)) != NI_OVSDB_UNAVAILABLE)
+		return rv;
+	rv = NI_PROCESS_FAILURE;
+
 	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
 		return rv;
 
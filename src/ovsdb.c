@@ -0,0 +1,1187 @@
+/*
+ *	OVSDB (RFC 7047) JSON-RPC client
+ *
+ *	Copyright (C) 2015 SUSE Linux GmbH, Nuernberg, Germany.
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ * The client connects to the local ovsdb-server unix socket and monitors
+ * the Open_vSwitch, Bridge, Port and Interface tables. The queries are
+ * answered from the monitor cache after processing the pending update
+ * notifications. Changes are collected in a transaction and committed
+ * in one "transact" request, followed by a wait until ovs-vswitchd has
+ * applied it (cur_cfg), as ovs-vsctl does.
+ *
+ * Fake (VLAN) bridges are represented as in ovs-vsctl: an internal port
+ * with fake_bridge=true and the VLAN tag in the parent bridge.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include "ovsdb.h"
+#include "json.h"
+#include "util_priv.h"
+
+#define NI_OVSDB_DATABASE		"Open_vSwitch"
+#define NI_OVSDB_TIMEOUT		5000	/* msec */
+
+typedef struct ni_ovsdb_client {
+	char *			path;
+	int			fd;
+	int64_t			id;
+	ni_stringbuf_t		rbuf;
+	ni_json_t *		tables;
+} ni_ovsdb_client_t;
+
+struct ni_ovsdb_txn {
+	ni_json_t *		ops;
+	ni_json_t *		bridges;	/* new bridge name -> ports set */
+	unsigned int		seq;
+	ni_bool_t		failed;
+};
+
+static ni_ovsdb_client_t	ni_ovsdb_client = {
+	.fd	= -1,
+	.rbuf	= NI_STRINGBUF_INIT_DYNAMIC,
+};
+
+/*
+ * json construction utilities
+ */
+static ni_json_t *
+ni_ovsdb_json_pair(const char *first, ni_json_t *second)
+{
+	ni_json_t *array = ni_json_new_array();
+
+	ni_json_array_append(array, ni_json_new_string(first));
+	ni_json_array_append(array, second);
+	return array;
+}
+
+static ni_json_t *
+ni_ovsdb_json_uuid(const char *uuid)
+{
+	return ni_ovsdb_json_pair("uuid", ni_json_new_string(uuid));
+}
+
+static ni_json_t *
+ni_ovsdb_json_named_uuid(const char *name)
+{
+	return ni_ovsdb_json_pair("named-uuid", ni_json_new_string(name));
+}
+
+static ni_json_t *
+ni_ovsdb_json_set(ni_json_t *element)
+{
+	ni_json_t *array = ni_json_new_array();
+
+	if (element)
+		ni_json_array_append(array, element);
+	return ni_ovsdb_json_pair("set", array);
+}
+
+static ni_json_t *
+ni_ovsdb_json_where(const char *column, ni_json_t *value)
+{
+	ni_json_t *where = ni_json_new_array();
+	ni_json_t *cond = ni_json_new_array();
+
+	if (column) {
+		ni_json_array_append(cond, ni_json_new_string(column));
+		ni_json_array_append(cond, ni_json_new_string("=="));
+		ni_json_array_append(cond, value);
+		ni_json_array_append(where, cond);
+	} else {
+		ni_json_free(cond);
+	}
+	return where;
+}
+
+static ni_json_t *
+ni_ovsdb_json_op(const char *op, const char *table)
+{
+	ni_json_t *json = ni_json_new_object();
+
+	ni_json_object_set(json, "op", ni_json_new_string(op));
+	ni_json_object_set(json, "table", ni_json_new_string(table));
+	return json;
+}
+
+static ni_json_t *
+ni_ovsdb_json_mutate(const char *table, ni_json_t *where, const char *column,
+			const char *mutator, ni_json_t *value)
+{
+	ni_json_t *op = ni_ovsdb_json_op("mutate", table);
+	ni_json_t *mutations = ni_json_new_array();
+	ni_json_t *mutation = ni_json_new_array();
+
+	ni_json_array_append(mutation, ni_json_new_string(column));
+	ni_json_array_append(mutation, ni_json_new_string(mutator));
+	ni_json_array_append(mutation, value);
+	ni_json_array_append(mutations, mutation);
+
+	ni_json_object_set(op, "where", where);
+	ni_json_object_set(op, "mutations", mutations);
+	return op;
+}
+
+static ni_json_t *
+ni_ovsdb_json_columns(const char *column, ...)
+{
+	ni_json_t *json = ni_json_new_object();
+	ni_json_t *columns = ni_json_new_array();
+	va_list ap;
+
+	va_start(ap, column);
+	while (column) {
+		ni_json_array_append(columns, ni_json_new_string(column));
+		column = va_arg(ap, const char *);
+	}
+	va_end(ap);
+
+	ni_json_object_set(json, "columns", columns);
+	return json;
+}
+
+/*
+ * ovsdb value (atom, set) access
+ */
+static const char *
+ni_ovsdb_string(ni_json_t *row, const char *column)
+{
+	return ni_json_string_value(ni_json_object_get_value(row, column));
+}
+
+static const char *
+ni_ovsdb_uuid(ni_json_t *atom)
+{
+	if (ni_json_array_entries(atom) != 2 ||
+	    !ni_string_eq(ni_json_string_value(ni_json_array_get(atom, 0)), "uuid"))
+		return NULL;
+	return ni_json_string_value(ni_json_array_get(atom, 1));
+}
+
+static ni_bool_t
+ni_ovsdb_is_set(ni_json_t *value)
+{
+	return ni_json_array_entries(value) == 2 &&
+		ni_string_eq(ni_json_string_value(ni_json_array_get(value, 0)), "set");
+}
+
+static unsigned int
+ni_ovsdb_set_entries(ni_json_t *value)
+{
+	if (!value)
+		return 0;
+	if (ni_ovsdb_is_set(value))
+		return ni_json_array_entries(ni_json_array_get(value, 1));
+	return 1;
+}
+
+static ni_json_t *
+ni_ovsdb_set_get(ni_json_t *value, unsigned int pos)
+{
+	if (ni_ovsdb_is_set(value))
+		return ni_json_array_get(ni_json_array_get(value, 1), pos);
+	return pos == 0 ? value : NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_set_has_uuid(ni_json_t *value, const char *uuid)
+{
+	unsigned int i, n = ni_ovsdb_set_entries(value);
+
+	for (i = 0; i < n; ++i) {
+		if (ni_string_eq(ni_ovsdb_uuid(ni_ovsdb_set_get(value, i)), uuid))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static ni_bool_t
+ni_ovsdb_integer(ni_json_t *row, const char *column, int64_t *num)
+{
+	ni_json_t *value = ni_json_object_get_value(row, column);
+
+	/* optional integers (e.g. Port tag) are empty sets when unset */
+	if (ni_ovsdb_set_entries(value) != 1)
+		return FALSE;
+	return ni_json_int64_get(ni_ovsdb_set_get(value, 0), num);
+}
+
+static ni_bool_t
+ni_ovsdb_boolean(ni_json_t *row, const char *column)
+{
+	ni_bool_t value = FALSE;
+
+	ni_json_bool_get(ni_json_object_get_value(row, column), &value);
+	return value;
+}
+
+/*
+ * monitor cache lookups
+ */
+static ni_json_t *
+ni_ovsdb_table(ni_ovsdb_client_t *client, const char *table)
+{
+	return ni_json_object_get_value(client->tables, table);
+}
+
+static ni_json_t *
+ni_ovsdb_row_by_uuid(ni_ovsdb_client_t *client, const char *table, const char *uuid)
+{
+	return uuid ? ni_json_object_get_value(ni_ovsdb_table(client, table), uuid) : NULL;
+}
+
+static ni_json_t *
+ni_ovsdb_row_by_name(ni_ovsdb_client_t *client, const char *table, const char *name,
+			const char **uuid)
+{
+	ni_json_t *rows = ni_ovsdb_table(client, table);
+	unsigned int i, n = ni_json_object_entries(rows);
+
+	for (i = 0; i < n; ++i) {
+		ni_json_pair_t *pair = ni_json_object_get_pair_at(rows, i);
+		ni_json_t *row = ni_json_pair_get_value(pair);
+
+		if (ni_string_eq(ni_ovsdb_string(row, "name"), name)) {
+			if (uuid)
+				*uuid = ni_json_pair_get_name(pair);
+			return row;
+		}
+	}
+	return NULL;
+}
+
+static ni_json_t *
+ni_ovsdb_port_bridge(ni_ovsdb_client_t *client, const char *port_uuid, const char **uuid)
+{
+	ni_json_t *rows = ni_ovsdb_table(client, "Bridge");
+	unsigned int i, n = ni_json_object_entries(rows);
+
+	for (i = 0; i < n; ++i) {
+		ni_json_pair_t *pair = ni_json_object_get_pair_at(rows, i);
+		ni_json_t *row = ni_json_pair_get_value(pair);
+
+		if (ni_ovsdb_set_has_uuid(ni_json_object_get_value(row, "ports"), port_uuid)) {
+			if (uuid)
+				*uuid = ni_json_pair_get_name(pair);
+			return row;
+		}
+	}
+	return NULL;
+}
+
+static ni_json_t *
+ni_ovsdb_bridge_fake_by_tag(ni_ovsdb_client_t *client, ni_json_t *bridge, int64_t tag)
+{
+	ni_json_t *ports = ni_json_object_get_value(bridge, "ports");
+	unsigned int i, n = ni_ovsdb_set_entries(ports);
+	ni_json_t *port;
+	int64_t num;
+
+	for (i = 0; i < n; ++i) {
+		port = ni_ovsdb_row_by_uuid(client, "Port",
+				ni_ovsdb_uuid(ni_ovsdb_set_get(ports, i)));
+
+		if (ni_ovsdb_boolean(port, "fake_bridge") &&
+		    ni_ovsdb_integer(port, "tag", &num) && num == tag)
+			return port;
+	}
+	return NULL;
+}
+
+typedef struct ni_ovsdb_bridge_ref {
+	const char *		uuid;	/* real (parent) bridge */
+	ni_json_t *		bridge;
+	ni_json_t *		fake;	/* fake bridge port     */
+	int64_t			tag;
+} ni_ovsdb_bridge_ref_t;
+
+static ni_bool_t
+ni_ovsdb_bridge_lookup(ni_ovsdb_client_t *client, const char *brname, ni_ovsdb_bridge_ref_t *ref)
+{
+	const char *port_uuid = NULL;
+	ni_json_t *port;
+
+	memset(ref, 0, sizeof(*ref));
+	if ((ref->bridge = ni_ovsdb_row_by_name(client, "Bridge", brname, &ref->uuid)))
+		return TRUE;
+
+	port = ni_ovsdb_row_by_name(client, "Port", brname, &port_uuid);
+	if (!ni_ovsdb_boolean(port, "fake_bridge") ||
+	    !ni_ovsdb_integer(port, "tag", &ref->tag))
+		return FALSE;
+
+	if (!(ref->bridge = ni_ovsdb_port_bridge(client, port_uuid, &ref->uuid)))
+		return FALSE;
+
+	ref->fake = port;
+	return TRUE;
+}
+
+static const char *
+ni_ovsdb_port_owner(ni_ovsdb_client_t *client, const char *port_uuid, ni_json_t *port)
+{
+	ni_json_t *bridge, *fake;
+	int64_t tag;
+
+	if (!(bridge = ni_ovsdb_port_bridge(client, port_uuid, NULL)))
+		return NULL;
+
+	if (ni_ovsdb_integer(port, "tag", &tag) &&
+	    (fake = ni_ovsdb_bridge_fake_by_tag(client, bridge, tag)))
+		return ni_ovsdb_string(fake, "name");
+
+	return ni_ovsdb_string(bridge, "name");
+}
+
+static ni_bool_t
+ni_ovsdb_bridge_has_port(ni_ovsdb_client_t *client, const ni_ovsdb_bridge_ref_t *ref, ni_json_t *port)
+{
+	int64_t tag;
+
+	/* as ovs-vsctl list-ports: no local and no fake bridge ports */
+	if (!port || ni_ovsdb_boolean(port, "fake_bridge"))
+		return FALSE;
+
+	if (ni_string_eq(ni_ovsdb_string(port, "name"), ni_ovsdb_string(ref->bridge, "name")))
+		return FALSE;
+
+	if (ref->fake)
+		return ni_ovsdb_integer(port, "tag", &tag) && tag == ref->tag;
+
+	if (ni_ovsdb_integer(port, "tag", &tag) &&
+	    ni_ovsdb_bridge_fake_by_tag(client, ref->bridge, tag))
+		return FALSE;
+
+	return TRUE;
+}
+
+static void
+ni_ovsdb_update(ni_ovsdb_client_t *client, ni_json_t *updates)
+{
+	unsigned int t, nt = ni_json_object_entries(updates);
+
+	for (t = 0; t < nt; ++t) {
+		ni_json_pair_t *tpair = ni_json_object_get_pair_at(updates, t);
+		const char *table = ni_json_pair_get_name(tpair);
+		ni_json_t *rows = ni_json_pair_get_value(tpair);
+		unsigned int r, nr = ni_json_object_entries(rows);
+		ni_json_t *cache, *row;
+
+		if (!(cache = ni_ovsdb_table(client, table))) {
+			cache = ni_json_new_object();
+			ni_json_object_set(client->tables, table, cache);
+		}
+
+		for (r = 0; r < nr; ++r) {
+			ni_json_pair_t *rpair = ni_json_object_get_pair_at(rows, r);
+			const char *uuid = ni_json_pair_get_name(rpair);
+
+			row = ni_json_object_get_value(ni_json_pair_get_value(rpair), "new");
+			if (row)
+				ni_json_object_set(cache, uuid, ni_json_ref(row));
+			else
+				ni_json_object_delete(cache, uuid);
+		}
+	}
+}
+
+/*
+ * JSON-RPC connection
+ */
+static void
+ni_ovsdb_client_reset(ni_ovsdb_client_t *client)
+{
+	if (client->fd >= 0)
+		close(client->fd);
+	client->fd = -1;
+	ni_stringbuf_destroy(&client->rbuf);
+	ni_json_free(client->tables);
+	client->tables = NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_send(ni_ovsdb_client_t *client, const ni_json_t *msg)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *ptr;
+	size_t len;
+	ssize_t ret;
+
+	if (!ni_json_format_string(&buf, msg, NULL) || !buf.string) {
+		ni_stringbuf_destroy(&buf);
+		return FALSE;
+	}
+
+	ptr = buf.string;
+	len = buf.len;
+	while (len) {
+		ret = send(client->fd, ptr, len, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			ni_error("ovsdb: unable to send request: %m");
+			ni_stringbuf_destroy(&buf);
+			ni_ovsdb_client_reset(client);
+			return FALSE;
+		}
+		ptr += ret;
+		len -= ret;
+	}
+	ni_stringbuf_destroy(&buf);
+	return TRUE;
+}
+
+/*
+ * The stream does not delimit messages; find the end of the
+ * first complete JSON object/array in the receive buffer.
+ */
+static size_t
+ni_ovsdb_message_length(const ni_stringbuf_t *buf)
+{
+	ni_bool_t string = FALSE, escape = FALSE;
+	unsigned int depth = 0;
+	size_t i;
+
+	for (i = 0; i < buf->len; ++i) {
+		char cc = buf->string[i];
+
+		if (string) {
+			if (escape)
+				escape = FALSE;
+			else if (cc == '\\')
+				escape = TRUE;
+			else if (cc == '"')
+				string = FALSE;
+			continue;
+		}
+		switch (cc) {
+		case '"':
+			string = TRUE;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			if (depth && --depth == 0)
+				return i + 1;
+			break;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
+static ni_json_t *
+ni_ovsdb_recv(ni_ovsdb_client_t *client, int timeout)
+{
+	struct pollfd pfd;
+	char buf[8192];
+	ni_json_t *msg;
+	ssize_t ret;
+	size_t len;
+	char save;
+
+	while (client->fd >= 0) {
+		if ((len = ni_ovsdb_message_length(&client->rbuf))) {
+			save = client->rbuf.string[len];
+			client->rbuf.string[len] = '\0';
+			msg = ni_json_parse_string(client->rbuf.string);
+			client->rbuf.string[len] = save;
+
+			memmove(client->rbuf.string, client->rbuf.string + len,
+					client->rbuf.len - len + 1);
+			client->rbuf.len -= len;
+
+			if (!msg) {
+				ni_error("ovsdb: unable to parse server message");
+				ni_ovsdb_client_reset(client);
+			}
+			return msg;
+		}
+
+		pfd.fd = client->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, timeout);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return NULL;
+
+		ret = recv(client->fd, buf, sizeof(buf), 0);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (ret < 0)
+				ni_error("ovsdb: unable to receive: %m");
+			else
+				ni_debug_ifconfig("ovsdb: server closed the connection");
+			ni_ovsdb_client_reset(client);
+			return NULL;
+		}
+		ni_stringbuf_put(&client->rbuf, buf, ret);
+	}
+	return NULL;
+}
+
+static void
+ni_ovsdb_notify(ni_ovsdb_client_t *client, ni_json_t *msg)
+{
+	const char *method = ni_json_string_value(ni_json_object_get_value(msg, "method"));
+	ni_json_t *params = ni_json_object_get_value(msg, "params");
+	ni_json_t *reply;
+
+	if (ni_string_eq(method, "update")) {
+		ni_ovsdb_update(client, ni_json_array_get(params, 1));
+	} else
+	if (ni_string_eq(method, "echo")) {
+		reply = ni_json_new_object();
+		ni_json_object_set(reply, "result", ni_json_clone(params));
+		ni_json_object_set(reply, "error", ni_json_new_null());
+		ni_json_object_set(reply, "id", ni_json_clone(ni_json_object_get_value(msg, "id")));
+		ni_ovsdb_send(client, reply);
+		ni_json_free(reply);
+	}
+}
+
+static ni_json_t *
+ni_ovsdb_call(ni_ovsdb_client_t *client, const char *method, ni_json_t *params)
+{
+	ni_stringbuf_t err = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *req, *msg, *error, *result;
+	int64_t id, rid;
+
+	id = ++client->id;
+	req = ni_json_new_object();
+	ni_json_object_set(req, "method", ni_json_new_string(method));
+	ni_json_object_set(req, "params", params);
+	ni_json_object_set(req, "id", ni_json_new_int64(id));
+	if (!ni_ovsdb_send(client, req)) {
+		ni_json_free(req);
+		return NULL;
+	}
+	ni_json_free(req);
+
+	while ((msg = ni_ovsdb_recv(client, NI_OVSDB_TIMEOUT))) {
+		if (ni_json_object_get_value(msg, "method")) {
+			ni_ovsdb_notify(client, msg);
+			ni_json_free(msg);
+			continue;
+		}
+
+		if (!ni_json_int64_get(ni_json_object_get_value(msg, "id"), &rid) || rid != id) {
+			ni_json_free(msg);
+			continue;
+		}
+
+		error = ni_json_object_get_value(msg, "error");
+		if (error && !ni_json_is_null(error)) {
+			ni_json_format_string(&err, error, NULL);
+			ni_error("ovsdb: %s request failed: %s", method, err.string);
+			ni_stringbuf_destroy(&err);
+			ni_json_free(msg);
+			return NULL;
+		}
+
+		result = ni_json_ref(ni_json_object_get_value(msg, "result"));
+		ni_json_free(msg);
+		return result;
+	}
+
+	if (client->fd >= 0) {
+		ni_error("ovsdb: no reply to %s request", method);
+		ni_ovsdb_client_reset(client);
+	}
+	return NULL;
+}
+
+ni_bool_t
+ni_ovsdb_open(const char *path)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	struct sockaddr_un sun;
+	ni_json_t *params, *tables, *result;
+	int fd;
+
+	ni_ovsdb_client_reset(client);
+	if (ni_string_empty(path))
+		path = NI_OVSDB_SOCKET_PATH;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sun.sun_path))
+		return FALSE;
+	strcpy(sun.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return FALSE;
+
+	if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		ni_debug_ifconfig("ovsdb: unable to connect to %s: %m", path);
+		close(fd);
+		return FALSE;
+	}
+	client->fd = fd;
+	client->tables = ni_json_new_object();
+
+	tables = ni_json_new_object();
+	ni_json_object_set(tables, "Open_vSwitch",
+			ni_ovsdb_json_columns("bridges", "cur_cfg", NULL));
+	ni_json_object_set(tables, "Bridge",
+			ni_ovsdb_json_columns("name", "ports", NULL));
+	ni_json_object_set(tables, "Port",
+			ni_ovsdb_json_columns("name", "interfaces", "tag", "fake_bridge", NULL));
+	ni_json_object_set(tables, "Interface",
+			ni_ovsdb_json_columns("name", "type", NULL));
+
+	params = ni_json_new_array();
+	ni_json_array_append(params, ni_json_new_string(NI_OVSDB_DATABASE));
+	ni_json_array_append(params, ni_json_new_null());
+	ni_json_array_append(params, tables);
+
+	if (!(result = ni_ovsdb_call(client, "monitor", params))) {
+		ni_ovsdb_client_reset(client);
+		return FALSE;
+	}
+	ni_ovsdb_update(client, result);
+	ni_json_free(result);
+
+	if (!ni_string_eq(client->path, path))
+		ni_string_dup(&client->path, path);
+
+	ni_debug_ifconfig("ovsdb: connected to %s", path);
+	return TRUE;
+}
+
+void
+ni_ovsdb_close(void)
+{
+	ni_ovsdb_client_reset(&ni_ovsdb_client);
+	ni_string_free(&ni_ovsdb_client.path);
+}
+
+static ni_ovsdb_client_t *
+ni_ovsdb_client_get(void)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_json_t *msg;
+
+	/* apply the pending updates, reconnect when the server restarted */
+	while (client->fd >= 0 && (msg = ni_ovsdb_recv(client, 0))) {
+		if (ni_json_object_get_value(msg, "method"))
+			ni_ovsdb_notify(client, msg);
+		ni_json_free(msg);
+	}
+
+	if (client->fd < 0 && !ni_ovsdb_open(client->path))
+		return NULL;
+
+	return client;
+}
+
+/*
+ * ovs-vsctl like queries
+ */
+int
+ni_ovsdb_bridge_exists(const char *brname)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname))
+		return NI_OVSDB_FAILURE;
+
+	if (!(client = ni_ovsdb_client_get()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref))
+		return NI_OVSDB_NOT_FOUND;
+
+	return NI_OVSDB_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_to_vlan(const char *brname, uint16_t *vlan)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname) || !vlan)
+		return NI_OVSDB_FAILURE;
+
+	if (!(client = ni_ovsdb_client_get()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge vlan", brname);
+		return NI_OVSDB_FAILURE;
+	}
+
+	if (ref.fake && (ref.tag <= 0 || ref.tag >= 0x0fff /* VLAN_VID_MASK */)) {
+		ni_error("%s: bridge vlan id %"PRId64" not in range 1..%u",
+				brname, ref.tag, 0x0fff);
+		return NI_OVSDB_FAILURE;
+	}
+
+	*vlan = ref.fake ? ref.tag : 0;
+	return NI_OVSDB_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_to_parent(const char *brname, char **parent)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (ni_string_empty(brname) || !parent)
+		return NI_OVSDB_FAILURE;
+
+	if (!(client = ni_ovsdb_client_get()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge parent", brname);
+		return NI_OVSDB_FAILURE;
+	}
+
+	if (ref.fake)
+		ni_string_dup(parent, ni_ovsdb_string(ref.bridge, "name"));
+	return NI_OVSDB_SUCCESS;
+}
+
+int
+ni_ovsdb_bridge_ports(const char *brname, ni_ovs_bridge_port_array_t *ports)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_bridge_ref_t ref;
+	unsigned int i, n;
+	ni_json_t *set, *port;
+
+	if (ni_string_empty(brname) || !ports)
+		return NI_OVSDB_FAILURE;
+
+	if (!(client = ni_ovsdb_client_get()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge ports", brname);
+		return NI_OVSDB_FAILURE;
+	}
+
+	set = ni_json_object_get_value(ref.bridge, "ports");
+	n = ni_ovsdb_set_entries(set);
+	for (i = 0; i < n; ++i) {
+		port = ni_ovsdb_row_by_uuid(client, "Port",
+				ni_ovsdb_uuid(ni_ovsdb_set_get(set, i)));
+
+		if (ni_ovsdb_bridge_has_port(client, &ref, port))
+			ni_ovs_bridge_port_array_add_new(ports, ni_ovsdb_string(port, "name"));
+	}
+	return NI_OVSDB_SUCCESS;
+}
+
+int
+ni_ovsdb_port_to_bridge(const char *pname, char **brname)
+{
+	ni_ovsdb_client_t *client;
+	const char *uuid = NULL;
+	const char *owner;
+	ni_json_t *port;
+
+	if (ni_string_empty(pname) || !brname)
+		return NI_OVSDB_FAILURE;
+
+	if (!(client = ni_ovsdb_client_get()))
+		return NI_OVSDB_UNAVAILABLE;
+
+	port = ni_ovsdb_row_by_name(client, "Port", pname, &uuid);
+	if (!port || ni_ovsdb_boolean(port, "fake_bridge") ||
+	    !(owner = ni_ovsdb_port_owner(client, uuid, port))) {
+		ni_error("%s: unable to query port bridge", pname);
+		return NI_OVSDB_FAILURE;
+	}
+
+	ni_string_dup(brname, owner);
+	return NI_OVSDB_SUCCESS;
+}
+
+/*
+ * transactions
+ */
+ni_ovsdb_txn_t *
+ni_ovsdb_txn_new(void)
+{
+	ni_ovsdb_txn_t *txn;
+
+	if (!ni_ovsdb_client_get())
+		return NULL;
+
+	txn = xcalloc(1, sizeof(*txn));
+	txn->ops = ni_json_new_array();
+	ni_json_array_append(txn->ops, ni_json_new_string(NI_OVSDB_DATABASE));
+	txn->bridges = ni_json_new_object();
+	return txn;
+}
+
+void
+ni_ovsdb_txn_free(ni_ovsdb_txn_t *txn)
+{
+	if (txn) {
+		ni_json_free(txn->ops);
+		ni_json_free(txn->bridges);
+		free(txn);
+	}
+}
+
+static ni_json_t *
+ni_ovsdb_txn_port_insert(ni_ovsdb_txn_t *txn, const char *pname, const char *type,
+			int64_t tag, ni_bool_t fake)
+{
+	char *iface = NULL, *port = NULL;
+	ni_json_t *op, *row, *ref;
+
+	txn->seq++;
+	ni_string_printf(&iface, "iface%u", txn->seq);
+	ni_string_printf(&port, "port%u", txn->seq);
+
+	row = ni_json_new_object();
+	ni_json_object_set(row, "name", ni_json_new_string(pname));
+	if (type)
+		ni_json_object_set(row, "type", ni_json_new_string(type));
+	op = ni_ovsdb_json_op("insert", "Interface");
+	ni_json_object_set(op, "row", row);
+	ni_json_object_set(op, "uuid-name", ni_json_new_string(iface));
+	ni_json_array_append(txn->ops, op);
+
+	row = ni_json_new_object();
+	ni_json_object_set(row, "name", ni_json_new_string(pname));
+	ni_json_object_set(row, "interfaces",
+			ni_ovsdb_json_set(ni_ovsdb_json_named_uuid(iface)));
+	if (tag > 0)
+		ni_json_object_set(row, "tag", ni_json_new_int64(tag));
+	if (fake)
+		ni_json_object_set(row, "fake_bridge", ni_json_new_bool(TRUE));
+	op = ni_ovsdb_json_op("insert", "Port");
+	ni_json_object_set(op, "row", row);
+	ni_json_object_set(op, "uuid-name", ni_json_new_string(port));
+	ni_json_array_append(txn->ops, op);
+
+	ref = ni_ovsdb_json_named_uuid(port);
+	ni_string_free(&iface);
+	ni_string_free(&port);
+	return ref;
+}
+
+static ni_bool_t
+ni_ovsdb_txn_bridge_attach(ni_ovsdb_txn_t *txn, ni_ovsdb_client_t *client,
+			const char *brname, ni_json_t *port)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_json_t *ports;
+
+	/* bridge created in this transaction */
+	if ((ports = ni_json_object_get_value(txn->bridges, brname)))
+		return ni_json_array_append(ports, port);
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref) || ref.fake) {
+		ni_error("%s: no such ovs bridge", brname);
+		ni_json_free(port);
+		txn->failed = TRUE;
+		return FALSE;
+	}
+
+	return ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Bridge",
+				ni_ovsdb_json_where("_uuid", ni_ovsdb_json_uuid(ref.uuid)),
+				"ports", "insert", ni_ovsdb_json_set(port)));
+}
+
+ni_bool_t
+ni_ovsdb_txn_bridge_add(ni_ovsdb_txn_t *txn, const char *brname, const char *parent,
+			uint16_t vlan, ni_bool_t may_exist)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_ovsdb_bridge_ref_t ref;
+	ni_json_t *op, *row, *ports;
+	char *name = NULL;
+
+	if (!txn || ni_string_empty(brname) || client->fd < 0)
+		return FALSE;
+
+	if (ni_json_object_get_value(txn->bridges, brname) ||
+	    ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		if (may_exist)
+			return TRUE;
+		ni_error("%s: ovs bridge already exists", brname);
+		txn->failed = TRUE;
+		return FALSE;
+	}
+
+	if (!ni_string_empty(parent)) {
+		if (vlan == 0 || vlan >= 0x0fff /* VLAN_VID_MASK */) {
+			ni_error("%s: bridge vlan id %u not in range 1..%u",
+					brname, vlan, 0x0fff);
+			txn->failed = TRUE;
+			return FALSE;
+		}
+		op = ni_ovsdb_txn_port_insert(txn, brname, "internal", vlan, TRUE);
+		return ni_ovsdb_txn_bridge_attach(txn, client, parent, op);
+	}
+
+	ports = ni_ovsdb_json_set(ni_ovsdb_txn_port_insert(txn, brname, "internal", 0, FALSE));
+	ni_json_object_set(txn->bridges, brname, ni_json_ref(ni_json_array_get(ports, 1)));
+
+	ni_string_printf(&name, "bridge%u", ++txn->seq);
+	row = ni_json_new_object();
+	ni_json_object_set(row, "name", ni_json_new_string(brname));
+	ni_json_object_set(row, "ports", ports);
+	op = ni_ovsdb_json_op("insert", "Bridge");
+	ni_json_object_set(op, "row", row);
+	ni_json_object_set(op, "uuid-name", ni_json_new_string(name));
+	ni_json_array_append(txn->ops, op);
+
+	ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Open_vSwitch",
+				ni_ovsdb_json_where(NULL, NULL), "bridges", "insert",
+				ni_ovsdb_json_set(ni_ovsdb_json_named_uuid(name))));
+	ni_string_free(&name);
+	return TRUE;
+}
+
+ni_bool_t
+ni_ovsdb_txn_bridge_del(ni_ovsdb_txn_t *txn, const char *brname)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_ovsdb_bridge_ref_t ref;
+	ni_json_t *set, *ports, *port;
+	const char *uuid;
+	unsigned int i, n;
+	int64_t tag;
+
+	if (!txn || ni_string_empty(brname) || client->fd < 0)
+		return FALSE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: no such ovs bridge", brname);
+		txn->failed = TRUE;
+		return FALSE;
+	}
+
+	if (!ref.fake) {
+		return ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Open_vSwitch",
+					ni_ovsdb_json_where(NULL, NULL), "bridges", "delete",
+					ni_ovsdb_json_set(ni_ovsdb_json_uuid(ref.uuid))));
+	}
+
+	/* the fake bridge port and all ports in its vlan */
+	set = ni_ovsdb_json_set(NULL);
+	ports = ni_json_object_get_value(ref.bridge, "ports");
+	n = ni_ovsdb_set_entries(ports);
+	for (i = 0; i < n; ++i) {
+		uuid = ni_ovsdb_uuid(ni_ovsdb_set_get(ports, i));
+		port = ni_ovsdb_row_by_uuid(client, "Port", uuid);
+
+		if (ni_ovsdb_integer(port, "tag", &tag) && tag == ref.tag)
+			ni_json_array_append(ni_json_array_get(set, 1),
+					ni_ovsdb_json_uuid(uuid));
+	}
+
+	return ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Bridge",
+				ni_ovsdb_json_where("_uuid", ni_ovsdb_json_uuid(ref.uuid)),
+				"ports", "delete", set));
+}
+
+ni_bool_t
+ni_ovsdb_txn_port_add(ni_ovsdb_txn_t *txn, const char *brname, const char *pname,
+			ni_bool_t may_exist)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_ovsdb_bridge_ref_t ref;
+	const char *uuid = NULL;
+	const char *owner;
+	const char *parent = brname;
+	ni_json_t *port;
+	int64_t tag = 0;
+
+	if (!txn || ni_string_empty(brname) || ni_string_empty(pname) || client->fd < 0)
+		return FALSE;
+
+	if ((port = ni_ovsdb_row_by_name(client, "Port", pname, &uuid))) {
+		owner = ni_ovsdb_port_owner(client, uuid, port);
+		if (may_exist && ni_string_eq(owner, brname))
+			return TRUE;
+		ni_error("%s: ovs port already exists in bridge %s", pname,
+				owner ? owner : "(none)");
+		txn->failed = TRUE;
+		return FALSE;
+	}
+
+	/* ports of a fake bridge are tagged ports in the parent */
+	if (!ni_json_object_get_value(txn->bridges, brname) &&
+	    ni_ovsdb_bridge_lookup(client, brname, &ref) && ref.fake) {
+		parent = ni_ovsdb_string(ref.bridge, "name");
+		tag = ref.tag;
+	}
+
+	port = ni_ovsdb_txn_port_insert(txn, pname, NULL, tag, FALSE);
+	return ni_ovsdb_txn_bridge_attach(txn, client, parent, port);
+}
+
+ni_bool_t
+ni_ovsdb_txn_port_del(ni_ovsdb_txn_t *txn, const char *brname, const char *pname)
+{
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_ovsdb_bridge_ref_t ref;
+	const char *uuid = NULL;
+	ni_json_t *port;
+
+	if (!txn || ni_string_empty(brname) || ni_string_empty(pname) || client->fd < 0)
+		return FALSE;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref) ||
+	    !(port = ni_ovsdb_row_by_name(client, "Port", pname, &uuid)) ||
+	    !ni_ovsdb_bridge_has_port(client, &ref, port) ||
+	    !ni_ovsdb_set_has_uuid(ni_json_object_get_value(ref.bridge, "ports"), uuid)) {
+		ni_error("%s: no port %s in ovs bridge", brname, pname);
+		txn->failed = TRUE;
+		return FALSE;
+	}
+
+	return ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Bridge",
+				ni_ovsdb_json_where("_uuid", ni_ovsdb_json_uuid(ref.uuid)),
+				"ports", "delete", ni_ovsdb_json_set(ni_ovsdb_json_uuid(uuid))));
+}
+
+static ni_bool_t
+ni_ovsdb_cfg_applied(ni_ovsdb_client_t *client, int64_t next_cfg)
+{
+	ni_json_t *rows = ni_ovsdb_table(client, "Open_vSwitch");
+	unsigned int i, n = ni_json_object_entries(rows);
+	int64_t cur_cfg;
+
+	for (i = 0; i < n; ++i) {
+		ni_json_t *row = ni_json_pair_get_value(ni_json_object_get_pair_at(rows, i));
+
+		if (ni_json_int64_get(ni_json_object_get_value(row, "cur_cfg"), &cur_cfg) &&
+		    cur_cfg >= next_cfg)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+ni_ovsdb_cfg_wait(ni_ovsdb_client_t *client, int64_t next_cfg)
+{
+	struct timeval now, deadline, left;
+	ni_json_t *msg;
+
+	ni_timer_get_time(&deadline);
+	deadline.tv_sec += NI_OVSDB_TIMEOUT / 1000;
+
+	while (!ni_ovsdb_cfg_applied(client, next_cfg)) {
+		ni_timer_get_time(&now);
+		if (!timercmp(&now, &deadline, <)) {
+			ni_warn("ovsdb: ovs-vswitchd did not apply the configuration yet");
+			return;
+		}
+		timersub(&deadline, &now, &left);
+
+		msg = ni_ovsdb_recv(client, left.tv_sec * 1000 + left.tv_usec / 1000);
+		if (!msg)
+			continue;
+		if (ni_json_object_get_value(msg, "method"))
+			ni_ovsdb_notify(client, msg);
+		ni_json_free(msg);
+		if (client->fd < 0)
+			return;
+	}
+}
+
+int
+ni_ovsdb_txn_commit(ni_ovsdb_txn_t *txn)
+{
+	ni_stringbuf_t err = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_ovsdb_client_t *client = &ni_ovsdb_client;
+	ni_json_t *op, *columns, *result, *reply, *rows;
+	unsigned int i, n;
+	int64_t next_cfg = -1;
+	int rv = NI_OVSDB_SUCCESS;
+
+	if (!txn || txn->failed)
+		return NI_OVSDB_FAILURE;
+
+	if (ni_json_array_entries(txn->ops) <= 1)
+		return NI_OVSDB_SUCCESS;
+
+	if (client->fd < 0)
+		return NI_OVSDB_UNAVAILABLE;
+
+	/* let ovs-vswitchd report when it applied the changes */
+	ni_json_array_append(txn->ops, ni_ovsdb_json_mutate("Open_vSwitch",
+				ni_ovsdb_json_where(NULL, NULL), "next_cfg", "+=",
+				ni_json_new_int64(1)));
+	columns = ni_json_new_array();
+	ni_json_array_append(columns, ni_json_new_string("next_cfg"));
+	op = ni_ovsdb_json_op("select", "Open_vSwitch");
+	ni_json_object_set(op, "where", ni_ovsdb_json_where(NULL, NULL));
+	ni_json_object_set(op, "columns", columns);
+	ni_json_array_append(txn->ops, op);
+
+	if (!(result = ni_ovsdb_call(client, "transact", ni_json_ref(txn->ops))))
+		return NI_OVSDB_FAILURE;
+
+	n = ni_json_array_entries(result);
+	for (i = 0; i < n; ++i) {
+		reply = ni_json_array_get(result, i);
+		if (ni_json_object_get_value(reply, "error")) {
+			ni_json_format_string(&err, reply, NULL);
+			ni_error("ovsdb: transaction failed: %s", err.string);
+			ni_stringbuf_destroy(&err);
+			rv = NI_OVSDB_FAILURE;
+		}
+	}
+
+	if (rv == NI_OVSDB_SUCCESS) {
+		rows = ni_json_object_get_value(ni_json_array_get(result, n - 1), "rows");
+		ni_json_int64_get(ni_json_object_get_value(ni_json_array_get(rows, 0),
+					"next_cfg"), &next_cfg);
+	}
+	ni_json_free(result);
+
+	if (next_cfg >= 0)
+		ni_ovsdb_cfg_wait(client, next_cfg);
+
+	return rv;
+}
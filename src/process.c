@@ -19,6 +19,7 @@
 #include <wicked/socket.h>
 #include "socket_priv.h"
 #include "process.h"
+#include "metrics.h"
 
 static int				__ni_process_run(ni_process_t *, int *);
 static int				__ni_process_run_info(ni_process_t *);
@@ -392,6 +393,8 @@ __ni_process_run_info(ni_process_t *pi)
 		struct timeval delta;
 
 		timersub(&now, &pi->started, &delta);
+		ni_metrics_observe(NI_METRIC_HISTOGRAM_PROCESS_RUNTIME,
+				delta.tv_sec * 1000000ULL + delta.tv_usec);
 		snprintf(runtime, sizeof(runtime), " [%ldm%ld.%03lds]",
 				delta.tv_sec / 60, delta.tv_sec % 60,
 				delta.tv_usec / 1000);
@@ -443,6 +446,24 @@ ni_process_run_and_wait(ni_process_t *pi)
 
 int
 ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
+{
+	int fd, rv;
+
+	rv = ni_process_capture_start(pi, &fd);
+	if (rv < NI_PROCESS_SUCCESS)
+		return rv;
+
+	return ni_process_capture_finish(pi, fd, out_buffer);
+}
+
+/*
+ * Start a subprocess with the output redirected into a pipe and
+ * return the read end of the pipe in fdp. The output is collected
+ * by ni_process_capture_finish, so the caller can start several
+ * processes before waiting for any of them.
+ */
+int
+ni_process_capture_start(ni_process_t *pi, int *fdp)
 {
 	int pfd[2], rv;
 
@@ -458,15 +479,23 @@ ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
 		return rv;
 	}
 
-	rv = NI_PROCESS_SUCCESS;
 	close(pfd[1]);
+	*fdp = pfd[0];
+	return NI_PROCESS_SUCCESS;
+}
+
+int
+ni_process_capture_finish(ni_process_t *pi, int fd, ni_buffer_t *out_buffer)
+{
+	int rv = NI_PROCESS_SUCCESS;
+
 	while (1) {
 		int cnt;
 
 		if (ni_buffer_tailroom(out_buffer) < 256)
 			ni_buffer_ensure_tailroom(out_buffer, 4096);
 
-		cnt = read(pfd[0], ni_buffer_tail(out_buffer), ni_buffer_tailroom(out_buffer));
+		cnt = read(fd, ni_buffer_tail(out_buffer), ni_buffer_tailroom(out_buffer));
 		if (cnt == 0) {
 			break;
 		} else if (cnt > 0) {
@@ -477,13 +506,14 @@ ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
 			break;
 		}
 	}
-	close(pfd[0]);
+	close(fd);
 
 	while (waitpid(pi->pid, &pi->status, 0) < 0) {
 		if (errno == EINTR)
 			continue;
 		ni_error("%s: waitpid returns error (%m)", __func__);
 		rv = NI_PROCESS_WAITPID;
+		break;
 	}
 	if (pi->notify_callback)
 		pi->notify_callback(pi);
@@ -518,6 +548,8 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 	pi->pid = pid;
 	pi->status = -1;
 	ni_timer_get_time(&pi->started);
+	if (pid > 0)
+		ni_metrics_inc(NI_METRIC_PROCESSES_SPAWNED);
 
 	if (pid == 0) {
 		int maxfd;
@@ -71,6 +71,8 @@ extern ni_process_t *		ni_process_new(ni_shellcmd_t *);
 extern int			ni_process_run(ni_process_t *);
 extern int			ni_process_run_and_wait(ni_process_t *);
 extern int			ni_process_run_and_capture_output(ni_process_t *, ni_buffer_t *);
+extern int			ni_process_capture_start(ni_process_t *, int *);
+extern int			ni_process_capture_finish(ni_process_t *, int, ni_buffer_t *);
 extern void			ni_process_setenv(ni_process_t *, const char *, const char *);
 extern const char *		ni_process_getenv(const ni_process_t *, const char *);
 extern ni_tempstate_t *		ni_process_tempstate(ni_process_t *);
@@ -33,6 +33,9 @@ ni_sysconfig_new(const char *pathname)
 	sc = calloc(1, sizeof(ni_sysconfig_t));
 	sc->pathname = xstrdup(pathname);
 
+	/* ifcfg files are queried for many suffixed variables */
+	ni_var_array_index_enable(&sc->vars);
+
 	return sc;
 }
 
@@ -393,16 +396,17 @@ int
 ni_sysconfig_find_matching(const ni_sysconfig_t *sc, const char *prefix,
 		ni_string_array_t *res)
 {
-	unsigned int i, pfxlen;
+	ni_uint_array_t found = NI_UINT_ARRAY_INIT;
+	unsigned int i;
 	ni_var_t *var;
 
-	pfxlen = strlen(prefix);
-	for (i = 0, var = sc->vars.data; i < sc->vars.count; ++i, ++var) {
-		const char *value = var->value;
-
-		if (value && *value && !strncmp(var->name, prefix, pfxlen))
+	ni_var_array_find_prefix(&sc->vars, prefix, &found);
+	for (i = 0; i < found.count; ++i) {
+		var = &sc->vars.data[found.data[i]];
+		if (var->value && *var->value)
 			ni_string_array_append(res, var->name);
 	}
+	ni_uint_array_destroy(&found);
 	return res->count;
 }
 
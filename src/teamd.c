@@ -28,7 +28,12 @@
 
 #include <limits.h>
 #include <pwd.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <wicked/util.h>
 #include <wicked/dbus-service.h>
@@ -42,8 +47,6 @@
 #include "appconfig.h"
 #include "util_priv.h"
 #include "systemctl.h"
-#include "process.h"
-#include "buffer.h"
 #include "teamd.h"
 #include "json.h"
 
@@ -69,6 +72,12 @@
 #define NI_TEAMD_CALL_PORT_ADD			"PortAdd"
 #define NI_TEAMD_CALL_PORT_CONFIG_UPDATE	"PortConfigUpdate"
 
+#define NI_TEAMD_USOCK_FMT			"%s/%s.sock"
+#define NI_TEAMD_USOCK_REQUEST			"REQUEST"
+#define NI_TEAMD_USOCK_REPLY_SUCCESS		"REPLY_SUCCESS"
+#define NI_TEAMD_USOCK_REPLY_ERROR		"REPLY_ERROR"
+#define NI_TEAMD_USOCK_TIMEOUT			5000	/* msec */
+
 
 typedef struct ni_teamd_client_ops {
 	void	(*destroy)(ni_teamd_client_t *);
@@ -89,7 +98,7 @@ struct ni_teamd_client {
 	ni_dbus_object_t *	proxy;
 
 	/* unix */
-	ni_shellcmd_t *		cmd;
+	int			usock;
 };
 
 static inline const char *
@@ -323,111 +332,205 @@ ni_teamd_dbus_ctl_port_config_update(ni_teamd_client_t *tdc, const char *port_na
 
 /*
  * === unix client ===
+ *
+ * Native client for the teamd unix control socket, using the same
+ * protocol as "teamdctl --force-usock":
+ *
+ *   request:	"REQUEST\n<method>\n[<arg>\n...]"
+ *   reply:	"REPLY_SUCCESS\n<result>"
+ *		"REPLY_ERROR\n<code>\n<message>\n"
  */
-static const char *
-ni_teamdctl_tool_path()
+static ni_bool_t
+ni_teamd_unix_client_init(ni_teamd_client_t *tdc)
+{
+	struct sockaddr_un sun;
+	int fd;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if ((size_t)snprintf(sun.sun_path, sizeof(sun.sun_path), NI_TEAMD_USOCK_FMT,
+			ni_config_teamd_socket_dir(), tdc->instance) >= sizeof(sun.sun_path)) {
+		ni_error("%s: teamd control socket path too long", tdc->instance);
+		return FALSE;
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+		ni_error("%s: unable to create teamd control socket: %m", tdc->instance);
+		return FALSE;
+	}
+
+	if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		ni_error("%s: unable to connect teamd control socket %s: %m",
+				tdc->instance, sun.sun_path);
+		close(fd);
+		return FALSE;
+	}
+
+	tdc->usock = fd;
+	return TRUE;
+}
+
+void
+ni_teamd_unix_client_destroy(ni_teamd_client_t *tdc)
 {
-	static const char *paths[] = {
-		"/usr/sbin/teamdctl",
-		NULL
-	};
-	const char *path = ni_find_executable(paths);
-	if (!path)
-		ni_warn("unable to find teamdctl utility");
-	return path;
+	if (tdc->usock >= 0) {
+		close(tdc->usock);
+		tdc->usock = -1;
+	}
 }
 
 static ni_bool_t
-ni_teamd_unix_client_init(ni_teamd_client_t *tdc)
+ni_teamd_unix_send(int fd, const char *data, size_t len)
 {
-	const char *tool;
+	ssize_t ret;
 
-	if (!(tool = ni_teamdctl_tool_path()))
-		goto failure;
+	/* the request is a single seqpacket message */
+	do {
+		ret = send(fd, data, len, MSG_NOSIGNAL);
+	} while (ret < 0 && errno == EINTR);
 
-	if (!(tdc->cmd = ni_shellcmd_new(NULL)))
-		goto failure;
+	return ret >= 0 && (size_t)ret == len;
+}
 
-	if (!ni_shellcmd_add_arg(tdc->cmd, tool))
-		goto failure;
+static ni_bool_t
+ni_teamd_unix_recv(int fd, ni_stringbuf_t *reply)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	ssize_t len, ret;
 
-	if (!ni_shellcmd_add_arg(tdc->cmd, "--force-usock"))
-		goto failure;
+	if (poll(&pfd, 1, NI_TEAMD_USOCK_TIMEOUT) <= 0)
+		return FALSE;
 
-	if (!ni_shellcmd_add_arg(tdc->cmd, "--oneline"))
-		goto failure;
+	/* teamd sends each reply as one message; peek at its full size */
+	do {
+		len = recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+	} while (len < 0 && errno == EINTR);
+	if (len <= 0)
+		return FALSE;
 
-	if (!ni_shellcmd_add_arg(tdc->cmd, tdc->instance))
-		goto failure;
+	ni_stringbuf_grow(reply, len);
+	do {
+		ret = recv(fd, reply->string + reply->len, len, MSG_DONTWAIT);
+	} while (ret < 0 && errno == EINTR);
+	if (ret <= 0)
+		return FALSE;
 
+	reply->len += ret;
+	reply->string[reply->len] = '\0';
 	return TRUE;
-failure:
-	return FALSE;
 }
 
-void
-ni_teamd_unix_client_destroy(ni_teamd_client_t *tdc)
+static int
+ni_teamd_unix_call(ni_teamd_client_t *tdc, const char *method, char **result, ...)
 {
-	ni_shellcmd_release(tdc->cmd);
+	ni_stringbuf_t req = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t rep = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *arg;
+	char *line, *next;
+	va_list ap;
+	int rv = -1;
+
+	if (!tdc || tdc->usock < 0 || ni_string_empty(method))
+		return -1;
+
+	ni_stringbuf_printf(&req, "%s\n%s\n", NI_TEAMD_USOCK_REQUEST, method);
+	va_start(ap, result);
+	while ((arg = va_arg(ap, const char *)))
+		ni_stringbuf_printf(&req, "%s\n", arg);
+	va_end(ap);
+
+	if (!ni_teamd_unix_send(tdc->usock, req.string, req.len)) {
+		ni_error("%s: unable to send teamd %s request: %m", tdc->instance, method);
+		goto done;
+	}
+	if (!ni_teamd_unix_recv(tdc->usock, &rep)) {
+		ni_error("%s: no reply to teamd %s request", tdc->instance, method);
+		goto done;
+	}
+
+	line = rep.string;
+	if ((next = strchr(line, '\n')))
+		*next++ = '\0';
+
+	if (ni_string_eq(line, NI_TEAMD_USOCK_REPLY_SUCCESS)) {
+		if (result) {
+			size_t len = ni_string_len(next);
+
+			while (len && next[len - 1] == '\n')
+				next[--len] = '\0';
+			ni_string_dup(result, next);
+		}
+		rv = 0;
+	} else
+	if (ni_string_eq(line, NI_TEAMD_USOCK_REPLY_ERROR)) {
+		char *code = next, *msg = NULL;
+
+		if (code && (msg = strchr(code, '\n')))
+			*msg++ = '\0';
+		if (msg && (next = strchr(msg, '\n')))
+			*next = '\0';
+		ni_error("%s: teamd %s request failed: %s: %s", tdc->instance,
+				method, code ? code : "", msg ? msg : "");
+	} else {
+		ni_error("%s: invalid reply to teamd %s request", tdc->instance, method);
+	}
+
+done:
+	ni_stringbuf_destroy(&req);
+	ni_stringbuf_destroy(&rep);
+	return rv;
 }
 
 int
 ni_teamd_unix_ctl_config_dump(ni_teamd_client_t *tdc, ni_bool_t actual, char **result)
 {
-	ni_buffer_t buf;
-	ni_process_t *pi;
-	int rv;
+	const char *method = actual ? NI_TEAMD_CALL_CONFIG_DUMP_ACTUAL : NI_TEAMD_CALL_CONFIG_DUMP;
 
 	if (!result)
 		return -1;
 
-	ni_buffer_init_dynamic(&buf, 1024);
-	if (!(pi = ni_process_new(tdc->cmd)))
-		goto failure;
-
-	ni_string_array_append(&pi->argv, "config");
-	ni_string_array_append(&pi->argv, "dump");
-	if (actual)
-		ni_string_array_append(&pi->argv, "actual");
-
-	rv = ni_process_run_and_capture_output(pi, &buf);
-	ni_process_free(pi);
-	if (rv) {
+	if (ni_teamd_unix_call(tdc, method, result, NULL) < 0) {
 		ni_error("%s: unable to dump team config", tdc->instance);
-		goto failure;
+		return -1;
 	}
-
-	ni_buffer_put(&buf, "\0", 1);
-	ni_string_free(result);
-	*result = (char *)buf.base;
-	buf.base = NULL;
-	ni_buffer_destroy(&buf);
 	return 0;
-
-failure:
-	ni_buffer_destroy(&buf);
-	return -1;
 }
 
 int
-ni_teamd_unix_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
+ni_teamd_unix_ctl_state_dump(ni_teamd_client_t *tdc, char **result)
 {
-	ni_process_t *pi;
-	int rv;
+	if (!result)
+		return -1;
 
-	if (ni_string_empty(port_name))
+	return ni_teamd_unix_call(tdc, NI_TEAMD_CALL_STATE_DUMP, result, NULL);
+}
+
+int
+ni_teamd_unix_ctl_state_get_item(ni_teamd_client_t *tdc, const char *item_name, char **result)
+{
+	if (!result || ni_string_empty(item_name))
 		return -1;
 
-	if (!(pi = ni_process_new(tdc->cmd)))
+	return ni_teamd_unix_call(tdc, NI_TEAMD_CALL_STATE_ITEM_GET, result, item_name, NULL);
+}
+
+int
+ni_teamd_unix_ctl_state_set_item(ni_teamd_client_t *tdc, const char *item_name, const char *item_val)
+{
+	if (ni_string_empty(item_name))
 		return -1;
 
-	ni_string_array_append(&pi->argv, "port");
-	ni_string_array_append(&pi->argv, "add");
-	ni_string_array_append(&pi->argv, port_name);
+	return ni_teamd_unix_call(tdc, NI_TEAMD_CALL_STATE_ITEM_SET, NULL,
+					item_name, item_val ? item_val : "", NULL);
+}
 
-	rv = ni_process_run_and_wait(pi);
-	ni_process_free(pi);
-	if (rv) {
+int
+ni_teamd_unix_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
+{
+	if (ni_string_empty(port_name))
+		return -1;
+
+	if (ni_teamd_unix_call(tdc, NI_TEAMD_CALL_PORT_ADD, NULL, port_name, NULL) < 0) {
 		ni_error("%s: unable to add team port %s", tdc->instance, port_name);
 		return -1;
 	}
@@ -437,24 +540,11 @@ ni_teamd_unix_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
 int
 ni_teamd_unix_ctl_port_config_update(ni_teamd_client_t *tdc, const char *port_name, const char *port_conf)
 {
-	ni_process_t *pi;
-	int rv;
-
 	if (!tdc || ni_string_empty(port_name))
 		return -1;
 
-	if (!(pi = ni_process_new(tdc->cmd)))
-		return -1;
-
-	ni_string_array_append(&pi->argv, "port");
-	ni_string_array_append(&pi->argv, "config");
-	ni_string_array_append(&pi->argv, "update");
-	ni_string_array_append(&pi->argv, port_name);
-	ni_string_array_append(&pi->argv, port_conf ? port_conf : "");
-
-	rv = ni_process_run_and_wait(pi);
-	ni_process_free(pi);
-	if (rv) {
+	if (ni_teamd_unix_call(tdc, NI_TEAMD_CALL_PORT_CONFIG_UPDATE, NULL,
+				port_name, port_conf ? port_conf : "", NULL) < 0) {
 		ni_error("%s: unable to update team port %s config", tdc->instance, port_name);
 		return -1;
 	}
@@ -477,6 +567,9 @@ static const ni_teamd_client_ops_t	teamd_dbus_ops = {
 static const ni_teamd_client_ops_t	teamd_unix_ops = {
 	.destroy		= ni_teamd_unix_client_destroy,
 	.ctl_config_dump	= ni_teamd_unix_ctl_config_dump,
+	.ctl_state_dump		= ni_teamd_unix_ctl_state_dump,
+	.ctl_state_get_item	= ni_teamd_unix_ctl_state_get_item,
+	.ctl_state_set_item	= ni_teamd_unix_ctl_state_set_item,
 	.ctl_port_add		= ni_teamd_unix_ctl_port_add,
 	.ctl_port_config_update	= ni_teamd_unix_ctl_port_config_update,
 };
@@ -493,10 +586,33 @@ ni_teamd_enabled(const char *instance)
 	return FALSE;
 }
 
+/*
+ * Cache of the teamd@<instance> service BusName property, to not
+ * query systemctl on each client open; an empty value means that
+ * teamd does not provide a dbus interface. The entry is dropped
+ * when the service gets started or stopped.
+ */
+static ni_var_array_t		ni_teamd_busname_cache = NI_VAR_ARRAY_INIT;
+
+static void
+ni_teamd_busname_cache_drop(const char *instance)
+{
+	ni_var_array_remove(&ni_teamd_busname_cache, instance);
+}
+
 static ni_config_teamd_ctl_t
 ni_teamd_client_ctl_detect_call(const char *instance, char **busname)
 {
-	ni_teamd_service_show_property(instance, "BusName", busname);
+	const ni_var_t *var;
+
+	if ((var = ni_var_array_get(&ni_teamd_busname_cache, instance))) {
+		ni_string_dup(busname, var->value);
+	} else {
+		ni_teamd_service_show_property(instance, "BusName", busname);
+		ni_var_array_set(&ni_teamd_busname_cache, instance,
+				busname && *busname ? *busname : "");
+	}
+
 	if (busname && !ni_string_empty(*busname))
 		return NI_CONFIG_TEAMD_CTL_DBUS;
 	else
@@ -557,6 +673,7 @@ ni_teamd_client_open(const char *instance)
 		return NULL;
 
 	tdc = xcalloc(1, sizeof(*tdc));
+	tdc->usock = -1;
 	ni_string_dup(&tdc->instance, instance);
 
 	ctl = ni_teamd_client_ctl_detect(instance, &busname);
@@ -1471,6 +1588,7 @@ ni_teamd_service_start(const ni_netdev_t *cfg)
 	if (ni_teamd_config_file_write(cfg->name, cfg->team, &cfg->link.hwaddr) < 0)
 		return -1;
 
+	ni_teamd_busname_cache_drop(cfg->name);
 	ni_string_printf(&service, NI_TEAMD_SERVICE_FMT, cfg->name);
 	rv = ni_systemctl_service_start(service);
 	if (rv < 0)
@@ -1486,6 +1604,7 @@ ni_teamd_service_stop(const char *ifname)
 	int rv;
 	char *service = NULL;
 
+	ni_teamd_busname_cache_drop(ifname);
 	ni_string_printf(&service, NI_TEAMD_SERVICE_FMT, ifname);
 	rv = ni_systemctl_service_stop(service);
 	ni_teamd_config_file_remove(ifname);
@@ -11,6 +11,7 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "metrics.h"
 
 struct ni_timer {
 	ni_timer_t *		next;
@@ -98,6 +99,7 @@ ni_timer_next_timeout(void)
 				(long) now.tv_sec, (long) now.tv_usec,
 				(long) timer->expires.tv_sec, (long) timer->expires.tv_usec);
 		ni_timer_list = timer->next;
+		ni_metrics_dec(NI_METRIC_TIMERS_ACTIVE);
 		timer->callback(timer->user_data, timer);
 		free(timer);
 	}
@@ -127,6 +129,9 @@ __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 
 	timer->next = tail;
 	*pos = timer;
+
+	ni_metrics_inc(NI_METRIC_TIMERS_ARMED);
+	ni_metrics_inc(NI_METRIC_TIMERS_ACTIVE);
 }
 
 static ni_timer_t *
@@ -138,6 +143,7 @@ __ni_timer_disarm(const ni_timer_t *handle)
 		if (timer == handle) {
 			*pos = timer->next;
 			timer->next = NULL;
+			ni_metrics_dec(NI_METRIC_TIMERS_ACTIVE);
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 					"%s: timer %p found", __func__, handle);
 			return timer;
@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <unistd.h>
+#include <errno.h>
+#include <net/if.h>
 
 #include <wicked/types.h>
 #include <wicked/util.h>
@@ -43,6 +45,12 @@
 #ifndef _PATH_SYS_CLASS_NET
 #define _PATH_SYS_CLASS_NET	"/sys/class/net"
 #endif
+#ifndef _PATH_UDEV_DATA
+#define _PATH_UDEV_DATA		"/run/udev/data"
+#endif
+
+/* udev database layout not supported by the native reader */
+#define NI_UDEV_DB_UNKNOWN	(-ENOTSUP)
 
 struct netdev_uinfo {
 	unsigned int	ifindex;
@@ -173,6 +181,146 @@ ni_udevadm_info(ni_var_array_t **list, const char *query, const char *path)
 	return ret;
 }
 
+/*
+ * Native reader of the (systemd-)udev runtime database.
+ *
+ * Returns the same properties as "udevadm info --query=all" for
+ * a network device without to spawn a process:
+ * - SUBSYSTEM, INTERFACE and IFINDEX from sysfs uevent,
+ * - E: properties and G: tags (as TAGS) from udev data n<ifindex>.
+ * Returns NI_UDEV_DB_UNKNOWN when the database layout is unknown,
+ * the caller falls back to udevadm then.
+ */
+static ni_bool_t	ni_udev_db_unknown;
+
+static int
+ni_udev_db_read_uevent(ni_var_array_t *vars, const char *ifname)
+{
+	char path[PATH_MAX] = {'\0'};
+	char line[PATH_MAX];
+	char *key, *val;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s/uevent", _PATH_SYS_CLASS_NET, ifname);
+	if (!(fp = fopen(path, "re")))
+		/* as udevadm: exit code 2 when the syspath does not exist */
+		return errno == ENOENT || errno == ENODEV ? 2 : -1;
+
+	ni_var_array_set(vars, "SUBSYSTEM", "net");
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		key = line;
+		if (!(val = strchr(key, '=')))
+			continue;
+		*val++ = '\0';
+		ni_var_array_set(vars, key, val);
+	}
+	fclose(fp);
+	return 0;
+}
+
+static int
+ni_udev_db_read_data(ni_var_array_t *vars, unsigned int ifindex)
+{
+	char path[PATH_MAX] = {'\0'};
+	char line[PATH_MAX];
+	ni_stringbuf_t tags = NI_STRINGBUF_INIT_DYNAMIC;
+	char *key, *val;
+	int ret = 0;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/n%u", _PATH_UDEV_DATA, ifindex);
+	if (!(fp = fopen(path, "re"))) {
+		/* not (yet) processed by udev: no properties, no tags */
+		return errno == ENOENT ? 0 : -1;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0')
+			continue;
+		if (line[1] != ':') {
+			ret = NI_UDEV_DB_UNKNOWN;
+			break;
+		}
+
+		val = line + 2;
+		switch (line[0]) {
+		case 'E':
+			key = val;
+			if (!(val = strchr(key, '=')))
+				break;
+			*val++ = '\0';
+			ni_var_array_set(vars, key, val);
+			break;
+		case 'G':
+			if (!tags.len)
+				ni_stringbuf_putc(&tags, ':');
+			ni_stringbuf_printf(&tags, "%s:", val);
+			break;
+		case 'S': case 'L': case 'W': case 'I':
+		case 'Q': case 'V': case 'N':
+			/* links, priorities, watch, init time, current tags, version */
+			break;
+		default:
+			ret = NI_UDEV_DB_UNKNOWN;
+			break;
+		}
+		if (ret)
+			break;
+	}
+	fclose(fp);
+
+	if (ret == NI_UDEV_DB_UNKNOWN)
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EVENTS,
+				"udev: unknown database entry '%s' in %s", line, path);
+	else if (tags.len)
+		ni_var_array_set(vars, "TAGS", tags.string);
+
+	ni_stringbuf_destroy(&tags);
+	return ret;
+}
+
+static int
+ni_udev_db_netdev_info(ni_var_array_t **list, const char *ifname, unsigned int ifindex)
+{
+	ni_var_array_t *vars;
+	int ret;
+
+	if (ni_udev_db_unknown || !ni_isdir(_PATH_UDEV_DATA))
+		return NI_UDEV_DB_UNKNOWN;
+
+	if (!(vars = ni_var_array_new()))
+		return NI_PROCESS_FAILURE;
+
+	if (!(ret = ni_udev_db_read_uevent(vars, ifname)))
+		ret = ni_udev_db_read_data(vars, ifindex);
+
+	if (ret == NI_UDEV_DB_UNKNOWN)
+		ni_udev_db_unknown = TRUE;
+
+	if (ret) {
+		ni_var_array_free(vars);
+		return ret;
+	}
+	ni_var_array_list_append(list, vars);
+	return 0;
+}
+
+int
+ni_udev_netdev_info(ni_var_array_t **list, const char *ifname, unsigned int ifindex)
+{
+	char pathbuf[PATH_MAX] = { '\0' };
+	int ret;
+
+	ret = ni_udev_db_netdev_info(list, ifname, ifindex);
+	if (ret != NI_UDEV_DB_UNKNOWN)
+		return ret;
+
+	snprintf(pathbuf, sizeof(pathbuf), "%s/%s", _PATH_SYS_CLASS_NET, ifname);
+	return ni_udevadm_info(list, "all", pathbuf);
+}
+
 static ni_bool_t
 ni_systemd_udev_is_active(void)
 {
@@ -324,7 +472,6 @@ ni_udev_netdev_update_name(ni_netdev_t *dev)
 ni_bool_t
 ni_udev_netdev_is_ready(ni_netdev_t *dev)
 {
-	char pathbuf[PATH_MAX] = { '\0' };
 	ni_var_array_t *vars = NULL;
 	int ret, retry = 2;
 
@@ -337,10 +484,7 @@ ni_udev_netdev_is_ready(ni_netdev_t *dev)
 		if (ni_udev_netdev_update_name(dev) < 0)
 			return FALSE;
 
-		snprintf(pathbuf, sizeof(pathbuf), "%s/%s",
-				_PATH_SYS_CLASS_NET, dev->name);
-
-		ret = ni_udevadm_info(&vars, "all", pathbuf);
+		ret = ni_udev_netdev_info(&vars, dev->name, dev->link.ifindex);
 		switch (ret) {
 		case 0:
 			ret = netdev_uinfo_ready(vars, dev->name, dev->link.ifindex);
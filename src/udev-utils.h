@@ -26,6 +26,7 @@
 #define WICKED_UDEV_UTILS_H
 
 extern int			ni_udevadm_info(ni_var_array_t **, const char *, const char *);
+extern int			ni_udev_netdev_info(ni_var_array_t **, const char *, unsigned int);
 
 extern ni_bool_t		ni_udev_is_active(void);
 extern ni_bool_t		ni_udev_net_subsystem_available(void);
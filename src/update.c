@@ -8,6 +8,9 @@
 #endif
 
 #include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -80,6 +83,7 @@ struct ni_updater_job {
 
 	ni_netdev_ref_t			device;
 	const ni_addrconf_lease_t *	lease;
+	struct timeval			created;
 
 	ni_updater_job_state_t		state;
 
@@ -107,6 +111,11 @@ struct ni_updater {
 	ni_shellcmd_t *			proc_install;
 	ni_shellcmd_t *			proc_remove;
 	ni_shellcmd_t *			proc_batch;
+
+	ni_system_updater_builtin_t *	builtin_backup;
+	ni_system_updater_builtin_t *	builtin_restore;
+	ni_system_updater_builtin_t *	builtin_install;
+	ni_system_updater_builtin_t *	builtin_remove;
 };
 
 static ni_updater_t			updaters[__NI_ADDRCONF_UPDATER_MAX];
@@ -125,6 +134,14 @@ static const ni_intmap_t		ni_updater_kind_names[] = {
 	{ NULL,				__NI_ADDRCONF_UPDATER_MAX	}
 };
 
+static const ni_intmap_t		ni_updater_resolver_preference[] = {
+	{ ".static.ipv4",		3				},
+	{ ".static.ipv6",		3				},
+	{ ".dhcp.ipv4",			2				},
+	{ ".dhcp.ipv6",			1				},
+	{ NULL,				0				}
+};
+
 static ni_bool_t			ni_system_updater_generic_batch_test(ni_updater_t *);
 
 /*
@@ -385,6 +402,7 @@ ni_updater_job_new(ni_updater_job_t **list, const ni_addrconf_lease_t *lease,
 
 	job->nr = job_nr++; /* for debugging purposes only */
 	job->refcount = 1;
+	ni_timer_get_time(&job->created);
 	if (!ni_netdev_ref_set(&job->device, ifname, ifindex)) {
 		free(job);
 		return NULL;
@@ -560,6 +578,20 @@ ni_updater_job_list_find_pending(ni_updater_job_t **list)
 	return NULL;
 }
 
+/*
+ * Resolve a <builtin> action of a system updater extension
+ */
+static ni_system_updater_builtin_t *
+ni_system_updater_builtin_find(const ni_extension_t *ex, const char *action)
+{
+	const ni_c_binding_t *binding;
+
+	if (!(binding = ni_extension_find_c_binding(ex, action)))
+		return NULL;
+
+	return ni_c_binding_get_address(binding);
+}
+
 /*
  * Initialize the system updaters based on the data found in the config
  * file.
@@ -598,24 +630,34 @@ ni_system_updaters_init(void)
 				if (!ni_system_updater_generic_batch_test(updater))
 					updater->proc_batch = NULL;
 			}
+		} else {
+			updater->builtin_backup = ni_system_updater_builtin_find(ex, "backup");
+			updater->builtin_restore = ni_system_updater_builtin_find(ex, "restore");
+			updater->builtin_install = ni_system_updater_builtin_find(ex, "install");
+			updater->builtin_remove = ni_system_updater_builtin_find(ex, "remove");
 		}
 
 		/* Create runtime directories for resolver and hostname extensions. */
 		if (!(ni_extension_statedir(name))) {
 			updater->enabled = FALSE;
 		} else
-		if (updater->proc_install == NULL && updater->proc_batch == NULL) {
+		if (updater->proc_install == NULL && updater->proc_batch == NULL &&
+		    updater->builtin_install == NULL) {
 			ni_warn("system-updater %s configured, but no install script defined", name);
 			updater->enabled = FALSE;
 		} else
-		if (updater->proc_remove == NULL && updater->proc_batch == NULL) {
+		if (updater->proc_remove == NULL && updater->proc_batch == NULL &&
+		    updater->builtin_remove == NULL) {
 			ni_warn("system-updater %s configured, but no remove script defined", name);
 			updater->enabled = FALSE;
 		}
-		if (updater->enabled && (updater->proc_backup == NULL || updater->proc_restore == NULL)) {
+		if (updater->enabled &&
+		    ((updater->proc_backup == NULL && updater->builtin_backup == NULL) ||
+		     (updater->proc_restore == NULL && updater->builtin_restore == NULL))) {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
 				"system-updater %s configured, but no backup/restore script defined", name);
 			updater->proc_backup = updater->proc_restore = NULL;
+			updater->builtin_backup = updater->builtin_restore = NULL;
 		}
 	}
 }
@@ -743,6 +785,26 @@ ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd, ni_string_
 	return rv;
 }
 
+/*
+ * Execute a builtin updater action in-process; the result is picked
+ * up by the following wait action like the exit status of a script.
+ */
+static int
+ni_system_updater_builtin_call(ni_updater_t *updater, ni_updater_job_t *job,
+				ni_system_updater_builtin_t *func, const char *ifname,
+				unsigned int type, unsigned int family, const char *arg)
+{
+	job->result = func(ifname, type, family, arg) < 0 ? -1 : 0;
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+		"%s: executed lease %s:%s in state %s %s updater builtin, status %d",
+			ifname,
+			ni_addrfamily_type_to_name(job->lease->family),
+			ni_addrconf_type_to_name(job->lease->type),
+			ni_addrconf_state_to_name(job->lease->state),
+			ni_updater_name(updater->kind), job->result);
+	return 0;
+}
+
 /*
  * Retrieve result of a running call
  */
@@ -787,6 +849,10 @@ ni_system_updater_backup_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (updater->have_backup)
 		return 0;
 
+	if (updater->builtin_backup)
+		return ni_system_updater_builtin_call(updater, job, updater->builtin_backup,
+				job->device.name, job->lease->type, job->lease->family, NULL);
+
 	if (!updater->proc_backup)
 		return 0;
 
@@ -828,6 +894,10 @@ ni_system_updater_restore_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (!updater->have_backup)
 		return 0;
 
+	if (updater->builtin_restore)
+		return ni_system_updater_builtin_call(updater, job, updater->builtin_restore,
+				job->device.name, job->lease->type, job->lease->family, NULL);
+
 	if (!updater->proc_restore)
 		return 0;
 
@@ -850,7 +920,9 @@ ni_system_updater_restore_wait(ni_updater_t *updater, ni_updater_job_t *job)
 	if ((ret = ni_system_updater_process_wait(updater, job, __func__)))
 		return ret;
 
-	updater->have_backup = 0;
+	/* restore call is a no-op while other leases are still applied */
+	if (!updater->sources.count)
+		updater->have_backup = 0;
 
 	return ret;
 }
@@ -895,6 +967,12 @@ ni_system_updater_generic_cleanup_call(ni_updater_t *updater, ni_updater_job_t *
 	    updater->format == NI_ADDRCONF_UPDATER_FORMAT_INFO)
 		ni_leaseinfo_remove(src->device.name, src->lease.type, src->lease.family);
 
+	if (updater->builtin_remove) {
+		ret = ni_system_updater_builtin_call(updater, job, updater->builtin_remove,
+				src->device.name, src->lease.type, src->lease.family, NULL);
+		goto cleanup;
+	}
+
 	job->result = 0;
 	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to cleanup %s updater (%s) for lease %s:%s in state %s",
@@ -1288,6 +1366,78 @@ ni_system_updater_generic_remove_wait(ni_updater_t *updater, ni_updater_job_t *j
 /*
  * Resolver updater specific calls
  */
+static char *
+ni_system_updater_resolver_file(const char *statedir, const char *ifname,
+				unsigned int type, unsigned int family)
+{
+	char *filename = NULL;
+
+	ni_string_printf(&filename, "%s/resolv.conf.%s.%s.%s", statedir, ifname,
+			ni_addrconf_type_to_name(type),
+			ni_addrfamily_type_to_name(family));
+	return filename;
+}
+
+/*
+ * Merge the pending resolver jobs of other leases into the current one:
+ * their resolv.conf files are written or removed here and the builtin
+ * install or remove action of the current job applies them all at once.
+ */
+static void
+ni_system_updater_resolver_batch_pending(ni_updater_t *updater, ni_updater_job_t *job,
+					const char *statedir)
+{
+	ni_updater_source_t *src;
+	char *filename;
+	ni_updater_job_t *j;
+	unsigned int pos;
+
+	for (j = job->next; (j = ni_updater_job_list_find_pending(&j)); j = j->next) {
+		if ((pos = ni_uint_array_index(&j->updater, updater->kind)) == -1U)
+			continue;
+
+		if (!can_update_type(j->lease, updater->kind))
+			continue;
+
+		filename = ni_system_updater_resolver_file(statedir, j->device.name,
+						j->lease->type, j->lease->family);
+		if (ni_string_empty(filename)) {
+			ni_string_free(&filename);
+			continue;
+		}
+
+		switch (j->flow) {
+		case NI_UPDATER_FLOW_INSTALL:
+			if (ni_resolver_write_resolv_conf(filename, j->lease->resolver, NULL) < 0) {
+				ni_string_free(&filename);
+				continue;
+			}
+			ni_updater_sources_update_match(&updater->sources, &j->device, j->lease);
+			break;
+
+		case NI_UPDATER_FLOW_REMOVAL:
+			src = ni_updater_sources_remove_match(&updater->sources, &j->device, j->lease);
+			if (src) {
+				ni_updater_source_free(src);
+				unlink(filename);
+			}
+			break;
+
+		default:
+			break;
+		}
+		ni_string_free(&filename);
+
+		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+				"%s: merged %s updater job[%lu] for lease %s:%s in state %s",
+				job->device.name, ni_updater_name(updater->kind), j->nr,
+				ni_addrfamily_type_to_name(j->lease->family),
+				ni_addrconf_type_to_name(j->lease->type),
+				ni_addrconf_state_to_name(j->lease->state));
+		ni_uint_array_remove_at(&j->updater, pos);
+	}
+}
+
 static int
 ni_system_updater_resolver_cleanup_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
@@ -1319,10 +1469,8 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 				job->device.name, ni_updater_name(updater->kind));
 		goto cleanup;
 	}
-	ni_string_printf(&filename, "%s/resolv.conf.%s.%s.%s",
-			statedir, job->device.name,
-			ni_addrconf_type_to_name(job->lease->type),
-			ni_addrfamily_type_to_name(job->lease->family));
+	filename = ni_system_updater_resolver_file(statedir, job->device.name,
+				job->lease->type, job->lease->family);
 	if (ni_string_empty(filename)) {
 		ni_warn("%s: unable to construct %s updater resolv.conf file for lease %s:%s",
 				job->device.name, ni_updater_name(updater->kind),
@@ -1339,6 +1487,14 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 		goto cleanup;
 	}
 
+	if (updater->builtin_install) {
+		ni_updater_sources_update_match(&updater->sources, &job->device, job->lease);
+		ni_system_updater_resolver_batch_pending(updater, job, statedir);
+		ret = ni_system_updater_builtin_call(updater, job, updater->builtin_install,
+				job->device.name, job->lease->type, job->lease->family, filename);
+		goto cleanup;
+	}
+
 	job->result = 0;
 	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
@@ -1378,6 +1534,7 @@ ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *
 {
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
 	ni_updater_source_t *src;
+	const char *statedir;
 	int ret = -1;
 
 	/* Call remove action only, when we applied it */
@@ -1386,6 +1543,13 @@ ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *
 		return 0;
 	ni_updater_source_free(src);
 
+	if (updater->builtin_remove) {
+		if ((statedir = ni_extension_statedir(ni_updater_name(updater->kind))))
+			ni_system_updater_resolver_batch_pending(updater, job, statedir);
+		return ni_system_updater_builtin_call(updater, job, updater->builtin_remove,
+				job->device.name, job->lease->type, job->lease->family, NULL);
+	}
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1549,6 +1713,11 @@ ni_system_updater_hostname_install_call(ni_updater_t *updater, ni_updater_job_t
 	if (ni_string_empty(job->hostname))
 		return -1;
 
+	if (updater->builtin_install)
+		return ni_system_updater_builtin_call(updater, job, updater->builtin_install,
+				job->device.name, job->lease->type, job->lease->family,
+				job->hostname);
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1599,6 +1768,10 @@ ni_system_updater_hostname_remove_call(ni_updater_t *updater, ni_updater_job_t *
 		return 0;
 	ni_updater_source_free(src);
 
+	if (updater->builtin_remove)
+		return ni_system_updater_builtin_call(updater, job, updater->builtin_remove,
+				job->device.name, job->lease->type, job->lease->family, NULL);
+
 	if (!ni_system_updater_common_args(&args, job->device.name,
 				job->lease->type, job->lease->family))
 		goto cleanup;
@@ -1634,6 +1807,289 @@ ni_system_updater_hostname_remove_wait(ni_updater_t *updater, ni_updater_job_t *
 	return ret;
 }
 
+/*
+ * Builtin hostname updater actions, doing what the hostname extension
+ * script does: the first lease providing a hostname controls it, the
+ * hostname from /etc/hostname is set again when it gets removed.
+ */
+static char *
+ni_system_updater_hostname_file(const char *ifname, unsigned int type, unsigned int family)
+{
+	const char *statedir;
+	char *filename = NULL;
+
+	statedir = ni_extension_statedir(ni_updater_name(NI_ADDRCONF_UPDATER_HOSTNAME));
+	if (!statedir)
+		return NULL;
+
+	ni_string_printf(&filename, "%s/hostname.%s.%s.%s", statedir, ifname,
+			ni_addrconf_type_to_name(type),
+			ni_addrfamily_type_to_name(family));
+	return filename;
+}
+
+static const char *
+ni_system_updater_hostname_read(const char *filename, char *buf, size_t size)
+{
+	FILE *fp;
+	char *ptr;
+
+	if (!(fp = fopen(filename, "r")))
+		return NULL;
+
+	ptr = fgets(buf, size, fp);
+	fclose(fp);
+	if (!ptr)
+		return NULL;
+
+	buf[strcspn(buf, ".\r\n")] = '\0';
+	return buf;
+}
+
+static const char *
+ni_system_updater_hostname_current(char *buf, size_t size)
+{
+	if (__ni_system_hostname_get(buf, size) < 0)
+		return NULL;
+
+	buf[size - 1] = '\0';
+	buf[strcspn(buf, ".")] = '\0';
+	return buf;
+}
+
+static int
+ni_system_updater_hostname_set_default(void)
+{
+	char def[HOST_NAME_MAX + 2], cur[HOST_NAME_MAX + 2];
+
+	if (ni_string_empty(ni_system_updater_hostname_read("/etc/hostname", def, sizeof(def))))
+		return 0;
+
+	if (ni_string_eq(def, ni_system_updater_hostname_current(cur, sizeof(cur))))
+		return 0;
+
+	if (__ni_system_hostname_put(def) < 0) {
+		ni_error("unable to set hostname to %s: %m", def);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+ni_system_updater_hostname_cleanup(const char *current)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	char name[HOST_NAME_MAX + 2];
+	const char *statedir;
+	char *filename = NULL;
+	unsigned int i;
+
+	statedir = ni_extension_statedir(ni_updater_name(NI_ADDRCONF_UPDATER_HOSTNAME));
+	if (!statedir)
+		return;
+
+	ni_scandir(statedir, "hostname.*", &files);
+	for (i = 0; i < files.count; ++i) {
+		ni_string_printf(&filename, "%s/%s", statedir, files.data[i]);
+		if (current && ni_string_eq(ni_system_updater_hostname_read(filename,
+						name, sizeof(name)), current))
+			continue;
+		unlink(filename);
+	}
+	ni_string_free(&filename);
+	ni_string_array_destroy(&files);
+}
+
+int
+ni_system_updater_hostname_backup(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	/* /etc/hostname is not modified, no need for a backup */
+	return 0;
+}
+
+int
+ni_system_updater_hostname_restore(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	ni_system_updater_hostname_cleanup(NULL);
+	return ni_system_updater_hostname_set_default();
+}
+
+int
+ni_system_updater_hostname_install(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	char hostname[HOST_NAME_MAX + 2], current[HOST_NAME_MAX + 2];
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	char *filename;
+	FILE *fp;
+	int ret = 0;
+
+	if (ni_string_empty(arg) || !(filename = ni_system_updater_hostname_file(ifname, type, family)))
+		return -1;
+
+	snprintf(hostname, sizeof(hostname), "%s", arg);
+	hostname[strcspn(hostname, ".")] = '\0';
+	if (!ni_system_updater_hostname_current(current, sizeof(current)))
+		current[0] = '\0';
+
+	/* drop files of leases which no longer control the hostname */
+	ni_system_updater_hostname_cleanup(current);
+	ni_scandir(ni_dirname(filename), "hostname.*", &files);
+
+	if (files.count == 0 || ni_file_exists(filename)) {
+		if (!ni_string_eq(hostname, current) && __ni_system_hostname_put(hostname) < 0) {
+			ni_error("%s: unable to set hostname to %s: %m", ifname, hostname);
+			ret = -1;
+		}
+		if ((fp = fopen(filename, "w"))) {
+			fprintf(fp, "%s\n", hostname);
+			fclose(fp);
+		}
+	}
+
+	ni_string_array_destroy(&files);
+	ni_string_free(&filename);
+	return ret;
+}
+
+int
+ni_system_updater_hostname_remove(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	char *filename;
+	int ret = 0;
+
+	if (!(filename = ni_system_updater_hostname_file(ifname, type, family)))
+		return -1;
+
+	if (ni_file_exists(filename)) {
+		unlink(filename);
+		ret = ni_system_updater_hostname_set_default();
+	}
+	ni_string_free(&filename);
+	return ret;
+}
+
+/*
+ * Builtin resolver updater actions, doing what the resolver extension
+ * script does without netconfig: the preferred resolv.conf file of all
+ * leases, static over dhcp ipv4 over dhcp ipv6, becomes /etc/resolv.conf.
+ */
+static unsigned int
+ni_system_updater_resolver_file_preference(const char *name)
+{
+	const ni_intmap_t *map;
+	size_t len, slen;
+
+	len = ni_string_len(name);
+	for (map = ni_updater_resolver_preference; map->name; ++map) {
+		slen = strlen(map->name);
+		if (len > slen && ni_string_eq(name + len - slen, map->name))
+			return map->value;
+	}
+	return 0;
+}
+
+static int
+ni_system_updater_resolver_install_preferred(const char *newfile)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	unsigned int i, pref, best_pref = 0;
+	const char *statedir, *best = NULL;
+	char *filename = NULL;
+	int ret = 0;
+
+	statedir = ni_extension_statedir(ni_updater_name(NI_ADDRCONF_UPDATER_RESOLVER));
+	if (!statedir)
+		return -1;
+
+	ni_scandir(statedir, "resolv.conf.*", &files);
+	for (i = 0; i < files.count; ++i) {
+		pref = ni_system_updater_resolver_file_preference(files.data[i]);
+		if (pref > best_pref || (pref && pref == best_pref && strcmp(files.data[i], best) < 0)) {
+			best_pref = pref;
+			best = files.data[i];
+		}
+	}
+
+	if (best)
+		ni_string_printf(&filename, "%s/%s", statedir, best);
+	else
+		ni_string_dup(&filename, newfile);
+
+	if (!ni_string_empty(filename) && ni_isreg(filename)) {
+		if ((ret = ni_copy_file_path(filename, _PATH_RESOLV_CONF)) == 0)
+			chmod(_PATH_RESOLV_CONF, 0644);
+	}
+
+	ni_string_free(&filename);
+	ni_string_array_destroy(&files);
+	return ret;
+}
+
+int
+ni_system_updater_resolver_backup(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	if (!ni_file_exists(_PATH_RESOLV_CONF))
+		return 0;
+	return __ni_system_resolver_backup();
+}
+
+int
+ni_system_updater_resolver_restore(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	const char *statedir;
+	char *filename = NULL;
+	unsigned int i;
+
+	statedir = ni_extension_statedir(ni_updater_name(NI_ADDRCONF_UPDATER_RESOLVER));
+	if (statedir && ni_scandir(statedir, "resolv.conf.*", &files) > 0) {
+		for (i = 0; i < files.count; ++i) {
+			ni_string_printf(&filename, "%s/%s", statedir, files.data[i]);
+			unlink(filename);
+		}
+		ni_string_free(&filename);
+	}
+	ni_string_array_destroy(&files);
+
+	return __ni_system_resolver_restore();
+}
+
+int
+ni_system_updater_resolver_install(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	return ni_system_updater_resolver_install_preferred(arg);
+}
+
+int
+ni_system_updater_resolver_remove(const char *ifname, unsigned int type,
+				unsigned int family, const char *arg)
+{
+	const char *statedir;
+	char *filename;
+	char *backup = NULL;
+	int ret;
+
+	statedir = ni_extension_statedir(ni_updater_name(NI_ADDRCONF_UPDATER_RESOLVER));
+	if (!statedir)
+		return -1;
+
+	if ((filename = ni_system_updater_resolver_file(statedir, ifname, type, family)))
+		unlink(filename);
+	ni_string_free(&filename);
+
+	ni_string_printf(&backup, "%s/%s", ni_config_backupdir(), ni_basename(_PATH_RESOLV_CONF));
+	ret = ni_system_updater_resolver_install_preferred(backup);
+	ni_string_free(&backup);
+	return ret;
+}
+
 static const ni_updater_action_t	system_updater_generic_install[] = {
 	{ ni_system_updater_generic_cleanup_call	},
 	{ ni_system_updater_generic_cleanup_wait	},
@@ -1768,6 +2224,36 @@ ni_updater_job_set_timeout(ni_updater_job_t *job, unsigned int timeout)
 		updater->timeout = timeout;
 }
 
+/*
+ * Keep a pending job back until the configured batch window after its
+ * creation expired, to collect the jobs of the leases arriving meanwhile
+ * and merge them into the batch of the first one.
+ */
+static ni_bool_t
+ni_updater_job_batch_defer(ni_updater_job_t *job, const ni_addrconf_lease_t *lease)
+{
+	unsigned int window = ni_config_addrconf_updater_batch_window();
+	struct timeval now, delta;
+	unsigned long elapsed;
+
+	if (!window || !ni_updater_job_pending(job))
+		return FALSE;
+
+	ni_timer_get_time(&now);
+	if (timercmp(&now, &job->created, >)) {
+		timersub(&now, &job->created, &delta);
+		elapsed = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	} else {
+		elapsed = 0;
+	}
+	if (elapsed >= window)
+		return FALSE;
+
+	if (lease->updater)
+		lease->updater->timeout = window - elapsed;
+	return TRUE;
+}
+
 static int
 ni_updater_job_action_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
@@ -1872,6 +2358,14 @@ ni_system_update_from_lease(const ni_addrconf_lease_t *lease, const unsigned int
 			}
 		}
 		if ((found = ni_updater_job_list_find_pending(&job_list))) {
+			if (ni_updater_job_batch_defer(found, lease)) {
+				ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EXTENSION,
+						"deferred %ums to batch %s",
+						lease->updater ? lease->updater->timeout : 0,
+						ni_updater_job_info(&out, found));
+				ni_stringbuf_destroy(&out);
+				return 1;
+			}
 			if (ni_updater_job_execute(found) == 1) {
 				ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EXTENSION,
 						"deferred by %s",
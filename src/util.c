@@ -462,7 +462,152 @@ ni_uint_array_set(ni_uint_array_t *nua, unsigned int index, unsigned int num)
 
 /*
  * Array of variables
+ *
+ * Arrays with many variables (sysconfig files) can enable an index:
+ * a hash table with open addressing for name lookups and the variable
+ * positions sorted by name for prefix lookups. It is maintained on set
+ * and rebuilt on remove; the variables themselves stay in insert order.
  */
+struct ni_var_index {
+	unsigned int		size;		/* power of 2, > 2 * count	*/
+	unsigned int *		slots;		/* position + 1, 0 when unused	*/
+	unsigned int		space;		/* allocated sorted positions	*/
+	unsigned int *		sorted;		/* positions ordered by name	*/
+};
+
+#define NI_VAR_INDEX_MIN_SIZE	64
+
+static inline unsigned int
+__ni_var_index_hash(const char *name)
+{
+	unsigned int hash = 2166136261U;	/* FNV-1a */
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void
+__ni_var_index_hash_insert(ni_var_index_t *index, const ni_var_array_t *nva, unsigned int pos)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int slot = __ni_var_index_hash(nva->data[pos].name) & mask;
+
+	while (index->slots[slot])
+		slot = (slot + 1) & mask;
+	index->slots[slot] = pos + 1;
+}
+
+static void
+__ni_var_index_rehash(ni_var_index_t *index, const ni_var_array_t *nva)
+{
+	unsigned int i;
+
+	while (index->size <= 2 * nva->count)
+		index->size <<= 1;
+
+	free(index->slots);
+	index->slots = xcalloc(index->size, sizeof(index->slots[0]));
+	for (i = 0; i < nva->count; ++i)
+		__ni_var_index_hash_insert(index, nva, i);
+}
+
+/* first of @n sorted positions with a name not less than @name (@len chars) */
+static unsigned int
+__ni_var_index_lower_bound(const ni_var_index_t *index, const ni_var_array_t *nva,
+				unsigned int n, const char *name, size_t len)
+{
+	unsigned int lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(nva->data[index->sorted[mid]].name, name, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* add the variable appended at position count - 1 */
+static void
+__ni_var_index_add(ni_var_index_t *index, const ni_var_array_t *nva)
+{
+	unsigned int pos = nva->count - 1;
+	const char *name = nva->data[pos].name;
+	unsigned int at;
+
+	if (2 * nva->count >= index->size)
+		__ni_var_index_rehash(index, nva);
+	else
+		__ni_var_index_hash_insert(index, nva, pos);
+
+	if (nva->count > index->space) {
+		index->space = nva->count + NI_VAR_ARRAY_CHUNK;
+		index->sorted = xrealloc(index->sorted, index->space * sizeof(index->sorted[0]));
+	}
+
+	at = __ni_var_index_lower_bound(index, nva, pos, name, strlen(name) + 1);
+	memmove(&index->sorted[at + 1], &index->sorted[at], (pos - at) * sizeof(index->sorted[0]));
+	index->sorted[at] = pos;
+}
+
+static int
+__ni_var_index_sort_cmp(const void *a, const void *b, void *data)
+{
+	const ni_var_array_t *nva = data;
+
+	return strcmp(nva->data[*(const unsigned int *)a].name,
+			nva->data[*(const unsigned int *)b].name);
+}
+
+static int
+__ni_var_index_pos_cmp(const void *a, const void *b)
+{
+	unsigned int pa = *(const unsigned int *)a;
+	unsigned int pb = *(const unsigned int *)b;
+
+	return pa < pb ? -1 : pa > pb;
+}
+
+static void
+__ni_var_index_free(ni_var_index_t *index)
+{
+	if (index) {
+		free(index->slots);
+		free(index->sorted);
+		free(index);
+	}
+}
+
+static ni_var_index_t *
+__ni_var_index_build(const ni_var_array_t *nva)
+{
+	ni_var_index_t *index;
+	unsigned int i;
+
+	index = xcalloc(1, sizeof(*index));
+	index->size = NI_VAR_INDEX_MIN_SIZE;
+	__ni_var_index_rehash(index, nva);
+
+	index->space = nva->count + NI_VAR_ARRAY_CHUNK;
+	index->sorted = xcalloc(index->space, sizeof(index->sorted[0]));
+	for (i = 0; i < nva->count; ++i)
+		index->sorted[i] = i;
+	qsort_r(index->sorted, nva->count, sizeof(index->sorted[0]),
+			__ni_var_index_sort_cmp, (void *)nva);
+	return index;
+}
+
+void
+ni_var_array_index_enable(ni_var_array_t *nva)
+{
+	if (nva && !nva->index)
+		nva->index = __ni_var_index_build(nva);
+}
+
 ni_var_array_t *
 ni_var_array_new(void)
 {
@@ -494,15 +639,28 @@ ni_var_array_destroy(ni_var_array_t *nva)
 		free(nva->data[i].value);
 	}
 	free(nva->data);
+	__ni_var_index_free(nva->index);
 	memset(nva, 0, sizeof(*nva));
 }
 
 ni_var_t *
 ni_var_array_get(const ni_var_array_t *nva, const char *name)
 {
-	unsigned int i;
+	const ni_var_index_t *index = nva->index;
+	unsigned int i, slot, mask;
 	ni_var_t *var;
 
+	if (index && name) {
+		mask = index->size - 1;
+		for (slot = __ni_var_index_hash(name) & mask; index->slots[slot];
+				slot = (slot + 1) & mask) {
+			var = &nva->data[index->slots[slot] - 1];
+			if (ni_string_eq(var->name, name))
+				return var;
+		}
+		return NULL;
+	}
+
 	for (i = 0, var = nva->data; i < nva->count; ++i, ++var) {
 		if (ni_string_eq(var->name, name))
 			return var;
@@ -510,6 +668,41 @@ ni_var_array_get(const ni_var_array_t *nva, const char *name)
 	return NULL;
 }
 
+/*
+ * Append the positions of all variables starting with @prefix to @res,
+ * in the order of the array.
+ */
+unsigned int
+ni_var_array_find_prefix(const ni_var_array_t *nva, const char *prefix, ni_uint_array_t *res)
+{
+	const ni_var_index_t *index = nva->index;
+	unsigned int i, first, count = res->count;
+	size_t pfxlen = ni_string_len(prefix);
+	ni_uint_array_t found = NI_UINT_ARRAY_INIT;
+
+	if (!index) {
+		for (i = 0; i < nva->count; ++i) {
+			if (!strncmp(nva->data[i].name, prefix, pfxlen))
+				ni_uint_array_append(res, i);
+		}
+		return res->count - count;
+	}
+
+	first = __ni_var_index_lower_bound(index, nva, nva->count, prefix, pfxlen);
+	for (i = first; i < nva->count; ++i) {
+		if (strncmp(nva->data[index->sorted[i]].name, prefix, pfxlen))
+			break;
+		ni_uint_array_append(&found, index->sorted[i]);
+	}
+	if (found.count > 1)
+		qsort(found.data, found.count, sizeof(found.data[0]), __ni_var_index_pos_cmp);
+
+	for (i = 0; i < found.count; ++i)
+		ni_uint_array_append(res, found.data[i]);
+	ni_uint_array_destroy(&found);
+	return res->count - count;
+}
+
 static void
 __ni_var_array_realloc(ni_var_array_t *nva, unsigned int newsize)
 {
@@ -543,26 +736,25 @@ ni_var_array_remove_at(ni_var_array_t *array, unsigned int index)
 	array->data[array->count].name = NULL;
 	array->data[array->count].value = NULL;
 
+	if (array->index) {
+		__ni_var_index_free(array->index);
+		array->index = __ni_var_index_build(array);
+	}
 	return TRUE;
 }
 
 ni_bool_t
 ni_var_array_remove(ni_var_array_t *array, const char *name)
 {
-	unsigned int i;
 	ni_var_t *var;
 
-	if (array) {
-		for (i = 0, var = array->data; i < array->count; ++i, ++var) {
-			if (ni_string_eq(var->name, name))
-				return ni_var_array_remove_at(array, i);
-		}
-	}
+	if (array && (var = ni_var_array_get(array, name)))
+		return ni_var_array_remove_at(array, var - array->data);
 
 	return FALSE;
 }
 
-static void
+static ni_var_t *
 __ni_var_array_append(ni_var_array_t *nva, const char *name, const char *value)
 {
 	ni_var_t *var;
@@ -572,6 +764,10 @@ __ni_var_array_append(ni_var_array_t *nva, const char *name, const char *value)
 	var = &nva->data[nva->count++];
 	var->name = xstrdup(name);
 	var->value = xstrdup(value);
+
+	if (nva->index)
+		__ni_var_index_add(nva->index, nva);
+	return var;
 }
 
 void
@@ -579,16 +775,10 @@ ni_var_array_set(ni_var_array_t *nva, const char *name, const char *value)
 {
 	ni_var_t *var;
 
-	if ((var = ni_var_array_get(nva, name)) == NULL) {
-		if ((nva->count % NI_VAR_ARRAY_CHUNK) == 0)
-			__ni_var_array_realloc(nva, nva->count);
-
-		var = &nva->data[nva->count++];
-		var->name = xstrdup(name);
-		var->value = NULL;
-	}
-
-	ni_string_dup(&var->value, value);
+	if ((var = ni_var_array_get(nva, name)) == NULL)
+		__ni_var_array_append(nva, name, value);
+	else
+		ni_string_dup(&var->value, value);
 }
 
 void
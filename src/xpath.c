@@ -65,8 +65,19 @@ struct xpath_enode {
 
 	char *			identifier;
 	xpath_integer_t		integer;
+
+	/* number of steps of a simple path, set on the root node */
+	unsigned int		path_steps;
 };
 
+/*
+ * Expressions consisting of child::Name steps on the context node,
+ * optionally followed by an attribute::Name, e.g. "link/master" or
+ * "/interface/name" or "ipv4:static/address/@local" are evaluated
+ * directly on the xml tree without the intermediate node sets.
+ */
+#define XPATH_PATH_STEPS_MAX	16
+
 static xpath_operator_t	__xpath_operator_node;
 static xpath_operator_t	__xpath_operator_child;
 static xpath_operator_t	__xpath_operator_descendant;
@@ -83,6 +94,8 @@ static xpath_result_t *	__xpath_expression_eval(const xpath_enode_t *, xpath_res
 static xpath_result_t *	__xpath_build_boolean(int);
 
 static xpath_enode_t *	__xpath_build_expr(const char **, char, int infixprio);
+static unsigned int	__xpath_path_steps(const xpath_enode_t *);
+static xpath_result_t *	__xpath_path_eval(const xpath_enode_t *, xml_node_t *);
 static int		__xpath_enode_assert_element(xpath_enode_t **);
 static const char *	__xpath_next_identifier(const char **);
 static void		__xpath_skipws(const char **);
@@ -122,6 +135,7 @@ xpath_expression_parse(const char *expr)
 	if (*expr)
 		goto failed;
 
+	tree->path_steps = __xpath_path_steps(tree);
 	return tree;
 
 failed:
@@ -137,15 +151,101 @@ failed:
 xpath_result_t *
 xpath_expression_eval(const xpath_enode_t *enode, xml_node_t *xn)
 {
-	xpath_result_t *in = xpath_result_new(XPATH_ELEMENT);
-	xpath_result_t *result;
+	xpath_result_t *in, *result;
+
+	if (enode->path_steps && xn)
+		return __xpath_path_eval(enode, xn);
 
+	in = xpath_result_new(XPATH_ELEMENT);
 	xpath_result_append_element(in, xn);
 	result = __xpath_expression_eval(enode, in);
 	xpath_result_free(in);
 	return result;
 }
 
+/*
+ * Process wide cache of compiled expressions, keyed by the expression
+ * text. The cached expressions are owned by the cache; callers must not
+ * free them nor keep them across calls, as a full cache is flushed.
+ */
+#define XPATH_CACHE_BUCKETS	64
+#define XPATH_CACHE_MAX		256
+
+typedef struct xpath_cache_entry	xpath_cache_entry_t;
+struct xpath_cache_entry {
+	xpath_cache_entry_t *	next;
+	unsigned int		hash;
+	char *			expr;
+	xpath_enode_t *		enode;
+};
+
+static struct xpath_cache {
+	unsigned int		count;
+	xpath_cache_entry_t *	bucket[XPATH_CACHE_BUCKETS];
+} xpath_cache;
+
+static unsigned int
+__xpath_cache_hash(const char *expr)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*expr) {
+		hash ^= (unsigned char)*expr++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+const xpath_enode_t *
+xpath_expression_parse_cached(const char *expr)
+{
+	xpath_cache_entry_t *entry;
+	xpath_enode_t *enode;
+	unsigned int hash;
+
+	if (!expr)
+		return NULL;
+
+	hash = __xpath_cache_hash(expr);
+	for (entry = xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS]; entry; entry = entry->next) {
+		if (entry->hash == hash && !strcmp(entry->expr, expr))
+			return entry->enode;
+	}
+
+	/* parse errors are not cached and reported on every use */
+	if (!(enode = xpath_expression_parse(expr)))
+		return NULL;
+
+	if (xpath_cache.count >= XPATH_CACHE_MAX)
+		xpath_expression_cache_flush();
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->hash = hash;
+	entry->expr = xstrdup(expr);
+	entry->enode = enode;
+	entry->next = xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS];
+	xpath_cache.bucket[hash % XPATH_CACHE_BUCKETS] = entry;
+	xpath_cache.count++;
+	return enode;
+}
+
+void
+xpath_expression_cache_flush(void)
+{
+	xpath_cache_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0; i < XPATH_CACHE_BUCKETS; ++i) {
+		while ((entry = xpath_cache.bucket[i])) {
+			xpath_cache.bucket[i] = entry->next;
+			xpath_expression_free(entry->enode);
+			free(entry->expr);
+			free(entry);
+		}
+	}
+	xpath_cache.count = 0;
+}
+
 /*
  * Free a parsed XPATH expression
  */
@@ -174,16 +274,15 @@ xpath_expression_free(xpath_enode_t *enode)
 char *
 xml_xpath_eval_string(xml_document_t *doc, xml_node_t *xn, const char *expr)
 {
+	const xpath_enode_t *expr_tree;
 	xpath_result_t *xresult;
-	xpath_enode_t *expr_tree;
 	char *result = NULL;
 
-	expr_tree = xpath_expression_parse(expr);
+	expr_tree = xpath_expression_parse_cached(expr);
 	if (!expr_tree)
 		return NULL;
 
 	xresult = xpath_expression_eval(expr_tree, xn);
-	xpath_expression_free(expr_tree);
 
 	if (!xresult)
 		return NULL;
@@ -452,6 +551,66 @@ failed:
 	return NULL;
 }
 
+/*
+ * Return the number of steps if the expression is a simple path
+ */
+static unsigned int
+__xpath_path_steps(const xpath_enode_t *enode)
+{
+	unsigned int steps = 0;
+
+	if (enode->ops == &__xpath_operator_getattr && enode->identifier) {
+		enode = enode->left;
+		steps++;
+	}
+	while (enode && enode->ops == &__xpath_operator_child && enode->identifier && !enode->right) {
+		enode = enode->left;
+		steps++;
+	}
+	if (!enode || enode->ops != &__xpath_operator_node || enode->left || enode->right)
+		return 0;
+
+	return steps <= XPATH_PATH_STEPS_MAX ? steps : 0;
+}
+
+static void
+__xpath_path_match(xml_node_t *xn, const xpath_enode_t **step, unsigned int steps,
+			xpath_result_t *result)
+{
+	const char *attrval;
+	xml_node_t *cn;
+
+	if ((*step)->ops == &__xpath_operator_getattr) {
+		if ((attrval = xml_node_get_attr(xn, (*step)->identifier)))
+			xpath_result_append_string(result, attrval);
+		return;
+	}
+
+	/* depth first gives the same document order as the step by step evaluation */
+	for (cn = xn->children; cn; cn = cn->next) {
+		if (!ni_string_eq(cn->name, (*step)->identifier))
+			continue;
+		if (steps == 1)
+			xpath_result_append_element(result, cn);
+		else
+			__xpath_path_match(cn, step + 1, steps - 1, result);
+	}
+}
+
+static xpath_result_t *
+__xpath_path_eval(const xpath_enode_t *enode, xml_node_t *xn)
+{
+	const xpath_enode_t *step[XPATH_PATH_STEPS_MAX];
+	unsigned int n, steps = enode->path_steps;
+	xpath_result_t *result;
+
+	result = xpath_result_new(enode->ops->outtype);
+	for (n = steps; n--; enode = enode->left)
+		step[n] = enode;
+	__xpath_path_match(xn, step, steps, result);
+	return result;
+}
+
 static int
 __xpath_enode_assert_element(xpath_enode_t **epp)
 {
@@ -1061,7 +1220,8 @@ __xpath_enode_predicate_evaluate(const xpath_enode_t *enode, xpath_result_t *lef
 				/* Just return all elements */
 				if (rn->value.boolean) {
 					xpath_result_free(result);
-					return left;
+					xpath_result_free(right);
+					return xpath_result_dup(left);
 				}
 				break;
 
@@ -0,0 +1,310 @@
+/*
+ * Verify a large set of IPv4 addresses with ARP duplicate address
+ * detection.
+ *
+ * Without interface arguments, the verify process is fed with
+ * synthetic replies and the hashed address lookup is timed against
+ * the plain array scan.
+ *
+ * With a veth pair, the addresses are verified on the first device,
+ * while the second answers the probes for every 7th address:
+ *
+ *   ip link add veth0 type veth peer name veth1
+ *   ip link set veth0 up && ip link set veth1 up
+ *   arp-test -n 1000 -r 500 veth0 veth1
+ *
+ * The receive counters of both capture sockets show how many packets
+ * were drained per wakeup. The expected duplicate address errors are
+ * not shown without -v.
+ *
+ * Usage: arp-test [-v] [-n count] [-r probes/sec] [ifname peer]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <net/if_arp.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/address.h>
+#include <wicked/socket.h>
+#include "netinfo_priv.h"
+
+#define ARP_TEST_DUP_EVERY	7
+
+static struct in_addr
+arp_test_ipaddr(unsigned int i)
+{
+	struct in_addr ip;
+
+	/* 10.64.0.0/10 */
+	ip.s_addr = htonl(0x0a400000 + 1 + i);
+	return ip;
+}
+
+static unsigned long
+arp_test_usec(const struct timeval *start)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+static void
+arp_test_add_addresses(ni_arp_verify_t *vfy, ni_address_t **list, unsigned int count)
+{
+	ni_sockaddr_t addr;
+	ni_address_t *ap;
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		ni_sockaddr_set_ipv4(&addr, arp_test_ipaddr(i), 0);
+		ap = ni_address_new(AF_INET, 10, &addr, list);
+		ni_address_set_tentative(ap, TRUE);
+		ni_arp_verify_add_address(vfy, ap);
+	}
+}
+
+static unsigned int
+arp_test_count_duplicates(const ni_arp_verify_t *vfy, unsigned int *failed)
+{
+	unsigned int i, dups = 0;
+	ni_bool_t expect;
+
+	for (i = 0; i < vfy->ipaddrs.count; ++i) {
+		expect = (i % ARP_TEST_DUP_EVERY) == 0;
+		if (ni_address_is_duplicate(vfy->ipaddrs.data[i]))
+			dups++;
+		if (ni_address_is_duplicate(vfy->ipaddrs.data[i]) != expect)
+			(*failed)++;
+	}
+	return dups;
+}
+
+static int
+arp_test_synthetic(unsigned int count)
+{
+	ni_address_t *list = NULL, sip;
+	ni_arp_socket_t sock;
+	ni_arp_packet_t pkt;
+	ni_arp_verify_t vfy;
+	struct timeval start;
+	unsigned long usec[2];
+	unsigned int i, hits[2] = { 0, 0 }, failed = 0;
+
+	memset(&sock, 0, sizeof(sock));
+	sock.dev_info.ifname = "synthetic";
+	sock.dev_info.ifindex = 1;
+	ni_link_address_parse(&sock.dev_info.hwaddr, ARPHRD_ETHER, "02:00:00:00:00:01");
+
+	ni_arp_verify_init(&vfy, 3, 300);
+	arp_test_add_addresses(&vfy, &list, count);
+	if (vfy.ipaddrs.count != count)
+		failed++;
+
+	/* adding the same addresses again is a no-op */
+	for (i = 0; i < count; ++i) {
+		if (ni_arp_verify_add_address(&vfy, vfy.ipaddrs.data[i]))
+			failed++;
+	}
+
+	memset(&sip, 0, sizeof(sip));
+	ni_timer_get_time(&start);
+	for (i = 0; i < 2 * count; ++i) {
+		ni_sockaddr_set_ipv4(&sip.local_addr, arp_test_ipaddr(i), 0);
+		if (ni_address_array_find_match(&vfy.ipaddrs, &sip, NULL, ni_address_equal_local_addr))
+			hits[0]++;
+	}
+	usec[0] = arp_test_usec(&start);
+
+	ni_timer_get_time(&start);
+	for (i = 0; i < 2 * count; ++i) {
+		if (ni_arp_verify_find_address(&vfy, arp_test_ipaddr(i)))
+			hits[1]++;
+	}
+	usec[1] = arp_test_usec(&start);
+	if (hits[0] != count || hits[1] != count)
+		failed++;
+
+	/* replies from another host for every 7th and one from ourselves */
+	memset(&pkt, 0, sizeof(pkt));
+	pkt.op = ARPOP_REPLY;
+	ni_link_address_parse(&pkt.sha, ARPHRD_ETHER, "02:00:00:00:00:02");
+	for (i = 0; i < count; i += ARP_TEST_DUP_EVERY) {
+		pkt.sip = arp_test_ipaddr(i);
+		ni_arp_verify_process(&sock, &pkt, &vfy);
+	}
+	pkt.sha = sock.dev_info.hwaddr;
+	pkt.sip = arp_test_ipaddr(1);
+	ni_arp_verify_process(&sock, &pkt, &vfy);
+
+	printf("%u addresses, %u duplicates\n", count, arp_test_count_duplicates(&vfy, &failed));
+	printf("array scan: %8lu usec\n", usec[0]);
+	printf("hashed:     %8lu usec\n", usec[1]);
+
+	ni_arp_verify_destroy(&vfy);
+	ni_address_list_destroy(&list);
+	return failed;
+}
+
+/*
+ * A host behind the peer claims every 7th address. The peer itself
+ * answers for the 7th + 3, which is not a duplicate as it is one of
+ * our own interfaces without the address.
+ */
+static void
+arp_test_responder(ni_arp_socket_t *sock, const ni_arp_packet_t *pkt, void *user_data)
+{
+	unsigned int *probes = user_data;
+	ni_arp_packet_t reply;
+	unsigned int i;
+
+	if (pkt->op != ARPOP_REQUEST || pkt->sip.s_addr != 0)
+		return;
+
+	(*probes)++;
+	i = ntohl(pkt->tip.s_addr) - ntohl(arp_test_ipaddr(0).s_addr);
+	if ((i % ARP_TEST_DUP_EVERY) == 0) {
+		memset(&reply, 0, sizeof(reply));
+		reply.op = ARPOP_REPLY;
+		reply.sip = pkt->tip;
+		reply.tha = pkt->sha;
+		ni_link_address_parse(&reply.sha, ARPHRD_ETHER, "02:00:00:00:00:02");
+		ni_arp_send(sock, &reply);
+	} else
+	if ((i % ARP_TEST_DUP_EVERY) == 3) {
+		ni_arp_send_reply(sock, pkt->tip, &pkt->sha, pkt->sip);
+	}
+}
+
+static ni_arp_socket_t *
+arp_test_socket_open(ni_netconfig_t *nc, const char *ifname, ni_arp_callback_t *cb, void *data)
+{
+	ni_capture_devinfo_t dev_info;
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_netdev_by_name(nc, ifname))) {
+		printf("arp-test: unknown interface %s\n", ifname);
+		return NULL;
+	}
+	if (ni_capture_devinfo_init(&dev_info, dev->name, &dev->link) < 0)
+		return NULL;
+	return ni_arp_socket_open(&dev_info, cb, data);
+}
+
+static void
+arp_test_print_stats(const char *ifname, const ni_arp_socket_t *sock)
+{
+	ni_capture_stats_t stats;
+
+	ni_capture_get_stats(sock->capture, &stats);
+	printf("%s: %u packets in %u wakeups (max %u per wakeup, %u full batches)\n",
+			ifname, stats.packets, stats.wakeups,
+			stats.max_batch, stats.full_batches);
+}
+
+static int
+arp_test_veth(const char *ifname, const char *peer, unsigned int count, unsigned int rate)
+{
+	ni_arp_socket_t *sock = NULL, *resp = NULL;
+	ni_address_t *list = NULL;
+	unsigned int timeout, probes = 0, failed = 0;
+	ni_netconfig_t *nc;
+	ni_capture_stats_t stats;
+	ni_arp_verify_t vfy;
+	struct timeval start;
+	unsigned long usec;
+
+	if (!(nc = ni_global_state_handle(1)))
+		return 1;
+	if (!(sock = arp_test_socket_open(nc, ifname, ni_arp_verify_process, &vfy)) ||
+	    !(resp = arp_test_socket_open(nc, peer, arp_test_responder, &probes))) {
+		failed++;
+		goto done;
+	}
+
+	ni_arp_verify_init(&vfy, 3, 300);
+	ni_arp_verify_set_rate(&vfy, rate);
+	arp_test_add_addresses(&vfy, &list, count);
+
+	ni_timer_get_time(&start);
+	while (ni_arp_verify_send(sock, &vfy, &timeout))
+		ni_socket_wait(timeout);
+	usec = arp_test_usec(&start);
+
+	printf("%u addresses, %u probes, %u duplicates in %lu msec (rate %u/s)\n",
+			count, probes, arp_test_count_duplicates(&vfy, &failed),
+			usec / 1000, rate);
+	arp_test_print_stats(ifname, sock);
+	arp_test_print_stats(peer, resp);
+	ni_capture_get_stats(resp->capture, &stats);
+	if (stats.packets < probes)
+		failed++;
+
+	/* duplicates are not probed again in the 2nd and 3rd round */
+	if (probes != 3 * count - 2 * ((count + ARP_TEST_DUP_EVERY - 1) / ARP_TEST_DUP_EVERY))
+		failed++;
+	if (rate && usec / 1000 < (3 * count * 1000UL) / rate - 3 * 50)
+		failed++;
+
+	ni_arp_verify_destroy(&vfy);
+	ni_address_list_destroy(&list);
+done:
+	if (sock)
+		ni_arp_socket_close(sock);
+	if (resp)
+		ni_arp_socket_close(resp);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = 1000, rate = 500;
+	ni_bool_t verbose = FALSE;
+	int c, fd, failed;
+
+	if (ni_init("arp-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "vn:r:")) != EOF) {
+		switch (c) {
+		case 'v':
+			verbose = TRUE;
+			break;
+		case 'n':
+			if (ni_parse_uint(optarg, &count, 10) < 0 || !count)
+				return -1;
+			break;
+		case 'r':
+			if (ni_parse_uint(optarg, &rate, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: arp-test [-v] [-n count] [-r probes/sec] [ifname peer]\n");
+			return -1;
+		}
+	}
+
+	if (!verbose && (fd = open("/dev/null", O_WRONLY)) >= 0) {
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+	}
+
+	if (optind + 2 == argc)
+		failed = arp_test_veth(argv[optind], argv[optind + 1], count, rate);
+	else
+		failed = arp_test_synthetic(count);
+
+	printf("arp-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
@@ -3,6 +3,9 @@
 #endif
 #include <signal.h>
 #include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <wicked/fsm.h>
 
@@ -11,6 +14,53 @@
 
 extern ni_global_t ni_global;
 
+/*
+ * Queue a state while the statedir is missing: the flush has to fail,
+ * keep the state queued and visible to loads and write it once the
+ * statedir exists again.
+ */
+static ni_bool_t
+cstate_test_failed_flush(ni_client_state_t *cs, unsigned int ifindex, ni_bool_t indexed)
+{
+	char base[] = "/tmp/cstate-test.XXXXXX";
+	char dir[PATH_MAX], path[PATH_MAX];
+	char *statedir;
+	ni_bool_t rv = FALSE;
+
+	if (!mkdtemp(base))
+		return FALSE;
+	snprintf(dir, sizeof(dir), "%s/statedir", base);
+	snprintf(path, sizeof(path), "%s/statedir/%s", base, indexed ?
+			NI_CLIENT_STATE_STORE_FILE : "state-1.xml");
+
+	statedir = ni_global.config->statedir.path;
+	ni_global.config->statedir.path = dir;
+	ni_client_state_write_behind(1000, indexed);
+
+	cs->control.persistent = TRUE;
+	ni_client_state_save(cs, ifindex);
+	if (ni_client_state_flush())
+		goto done;
+
+	cs->control.persistent = FALSE;
+	if (!ni_client_state_load(cs, ifindex) || !cs->control.persistent)
+		goto done;
+	ni_client_state_debug("Test7", cs, "print");
+
+	if (mkdir(dir, 0755) < 0 || !ni_client_state_flush() || !ni_file_exists(path))
+		goto done;
+
+	ni_client_state_drop(ifindex);
+	rv = ni_client_state_flush();
+done:
+	ni_client_state_write_behind(0, FALSE);
+	ni_global.config->statedir.path = statedir;
+	unlink(path);
+	rmdir(dir);
+	rmdir(base);
+	return rv;
+}
+
 int main(int argc, char **argv)
 {
 	ni_client_state_t *cs;
@@ -36,9 +86,47 @@ int main(int argc, char **argv)
 	ni_client_state_load(cs, ifindex2);
 	ni_client_state_debug("Test3", cs, "print");
 
-	ni_client_state_free(cs);
 	ni_client_state_drop(ifindex2);
 
+	/* queued writes to the indexed store */
+	ni_client_state_write_behind(1000, TRUE);
+
+	cs->control.persistent = TRUE;
+	ni_client_state_save(cs, ifindex1);
+	cs->control.persistent = FALSE;
+	ni_client_state_save(cs, ifindex2);
+	ni_client_state_load(cs, ifindex1);
+	ni_client_state_debug("Test4", cs, "print");
+	if (!cs->control.persistent)
+		return 1;
+
+	if (!ni_client_state_flush())
+		return 1;
+	ni_client_state_load(cs, ifindex2);
+	ni_client_state_debug("Test5", cs, "print");
+	if (cs->control.persistent)
+		return 1;
+
+	ni_client_state_drop(ifindex2);
+	ni_client_state_move(ifindex1, ifindex2);
+	ni_client_state_write_behind(0, FALSE);
+	if (ni_client_state_load(cs, ifindex1))
+		return 1;
+
+	ni_client_state_write_behind(0, TRUE);
+	if (!ni_client_state_load(cs, ifindex2) || !cs->control.persistent)
+		return 1;
+	ni_client_state_debug("Test6", cs, "print");
+
+	ni_client_state_drop(ifindex2);
+	ni_client_state_write_behind(0, FALSE);
+
+	if (!cstate_test_failed_flush(cs, ifindex1, FALSE) ||
+	    !cstate_test_failed_flush(cs, ifindex1, TRUE))
+		return 1;
+
+	ni_client_state_free(cs);
+
 	ni_config_free(ni_global.config);
 	return 0;
 }
@@ -0,0 +1,879 @@
+/*
+ * Acquire DHCPv4 or DHCPv6 leases on a large number of interfaces
+ * against a stand-in server and report the time to lease, the CPU
+ * time per lease, the memory used per device and how the renewals
+ * of the short leases are handled.
+ *
+ * The test runs in a network namespace of its own: it creates the
+ * veth pairs d0..dN and moves the peers into the namespace of a
+ * forked responder, which enslaves them to a bridge and answers
+ * DISCOVER/REQUEST or SOLICIT/REQUEST/RENEW/REBIND. The clients are
+ * driven in-process like in "wicked test dhcp4|dhcp6", that is the
+ * wickedd-dhcp4/6 event loop without the dbus layer. As wickedd
+ * does, the acquired IPv4 addresses are set on the interfaces, so
+ * the renewals are unicast to the server.
+ *
+ * The -s, -j and -r options set the renew stagger window, jitter and
+ * rate limit of the wicked-config(5) <renew> element. The first
+ * renewal of every interface has to happen between T1 and T2 and,
+ * with a rate limit, the renewals started per second must not exceed
+ * it. The jitter uses a fixed random seed.
+ *
+ * Needs root for the namespaces and the veth pairs:
+ *
+ *   dhcp-scale-test -n 500 -l 20
+ *
+ * Usage: dhcp-scale-test [-6] [-v] [-n count] [-l lease-time] [-t timeout]
+ *                        [-s stagger] [-j jitter] [-r renewals/sec]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/if_ether.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/addrconf.h>
+#include <wicked/socket.h>
+#include "dhcp4/dhcp4.h"
+#include "dhcp4/protocol.h"
+#include "dhcp6/dhcp6.h"
+#include "dhcp6/device.h"
+#include "dhcp6/protocol.h"
+#include "dhcp6/options.h"
+#include "appconfig.h"
+
+#define DHCP_SCALE_BRIDGE	"br0"
+#define DHCP_SCALE_SERVER4	0x0a400001	/* 10.64.0.1/16 */
+#define DHCP_SCALE_POOL4	0x0a40000a	/* 10.64.0.10 + index */
+#define DHCP_SCALE_POOL6	"fd00:64::"	/* fd00:64::a + index */
+#define DHCP_SCALE_PACKET_MAX	1500
+
+typedef struct dhcp_scale_client {
+	char			ifname[IFNAMSIZ];
+	void *			dev;
+	struct timeval		started;
+	struct timeval		acquired;
+	struct timeval		renewed;
+	unsigned int		leases;
+} dhcp_scale_client_t;
+
+static struct dhcp_scale {
+	unsigned int		family;
+	unsigned int		count;
+	unsigned int		lease_time;
+	dhcp_scale_client_t *	clients;
+	unsigned int		acquired;
+	unsigned int		renewed;
+	FILE *			ip;
+} dhcp_scale;
+
+static volatile sig_atomic_t	dhcp_scale_server_done;
+
+static unsigned long
+dhcp_scale_usec(const struct timeval *start, const struct timeval *end)
+{
+	struct timeval delta;
+
+	timersub(end, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+static unsigned long
+dhcp_scale_cpu_usec(void)
+{
+	struct rusage ru;
+	struct timeval sum;
+
+	getrusage(RUSAGE_SELF, &ru);
+	timeradd(&ru.ru_utime, &ru.ru_stime, &sum);
+	return sum.tv_sec * 1000000 + sum.tv_usec;
+}
+
+static unsigned long
+dhcp_scale_rss_kb(void)
+{
+	unsigned long size, rss = 0;
+	FILE *fp;
+
+	if ((fp = fopen("/proc/self/statm", "r"))) {
+		if (fscanf(fp, "%lu %lu", &size, &rss) != 2)
+			rss = 0;
+		fclose(fp);
+	}
+	return rss * (getpagesize() / 1024);
+}
+
+static ni_bool_t
+dhcp_scale_sysctl(const char *path, const char *value)
+{
+	FILE *fp;
+
+	if (!(fp = fopen(path, "w")))
+		return FALSE;
+	fputs(value, fp);
+	return fclose(fp) == 0;
+}
+
+/*
+ * The stand-in server
+ */
+static void
+dhcp_scale_server_signal(int sig)
+{
+	(void)sig;
+	dhcp_scale_server_done = 1;
+}
+
+static unsigned int
+dhcp_scale_server_lease(unsigned char *opt, unsigned int msg_type)
+{
+	unsigned char *p = opt;
+	uint32_t value;
+
+	*p++ = DHCP4_MESSAGETYPE;
+	*p++ = 1;
+	*p++ = msg_type;
+	*p++ = DHCP4_SERVERIDENTIFIER;
+	*p++ = 4;
+	value = htonl(DHCP_SCALE_SERVER4);
+	memcpy(p, &value, 4); p += 4;
+	*p++ = DHCP4_NETMASK;
+	*p++ = 4;
+	value = htonl(0xffff0000);
+	memcpy(p, &value, 4); p += 4;
+	*p++ = DHCP4_LEASETIME;
+	*p++ = 4;
+	value = htonl(dhcp_scale.lease_time);
+	memcpy(p, &value, 4); p += 4;
+	*p++ = DHCP4_RENEWALTIME;
+	*p++ = 4;
+	value = htonl(dhcp_scale.lease_time / 2);
+	memcpy(p, &value, 4); p += 4;
+	*p++ = DHCP4_REBINDTIME;
+	*p++ = 4;
+	value = htonl(dhcp_scale.lease_time * 7 / 8);
+	memcpy(p, &value, 4); p += 4;
+	*p++ = DHCP4_END;
+	return p - opt;
+}
+
+static void
+dhcp_scale_server4_packet(int fd, unsigned char *pkt, size_t len, unsigned int *counts)
+{
+	ni_dhcp4_message_t *msg = (ni_dhcp4_message_t *)pkt;
+	unsigned char reply[DHCP_SCALE_PACKET_MAX];
+	ni_dhcp4_message_t *out = (ni_dhcp4_message_t *)reply;
+	unsigned char *opt, *end = pkt + len;
+	unsigned int msg_type = 0, olen;
+	struct sockaddr_in sin;
+	struct arpreq arp;
+
+	if (len < sizeof(*msg) || msg->op != DHCP4_BOOTREQUEST ||
+	    msg->cookie != htonl(MAGIC_COOKIE) || msg->hwlen != ETH_ALEN)
+		return;
+
+	for (opt = pkt + sizeof(*msg); opt + 2 <= end && *opt != DHCP4_END; ) {
+		if (*opt == DHCP4_PAD) {
+			opt++;
+			continue;
+		}
+		if (*opt == DHCP4_MESSAGETYPE && opt[1] == 1 && opt + 3 <= end)
+			msg_type = opt[2];
+		opt += 2 + opt[1];
+	}
+	if (msg_type != DHCP4_DISCOVER && msg_type != DHCP4_REQUEST)
+		return;
+	counts[msg_type]++;
+
+	memset(reply, 0, sizeof(reply));
+	out->op = DHCP4_BOOTREPLY;
+	out->hwtype = msg->hwtype;
+	out->hwlen = msg->hwlen;
+	out->xid = msg->xid;
+	out->flags = msg->flags;
+	out->ciaddr = msg->ciaddr;
+	/* the clients are numbered in the last two bytes of their MAC */
+	out->yiaddr = htonl(DHCP_SCALE_POOL4 + (msg->chaddr[4] << 8) + msg->chaddr[5]);
+	memcpy(out->chaddr, msg->chaddr, sizeof(out->chaddr));
+	out->cookie = htonl(MAGIC_COOKIE);
+	olen = dhcp_scale_server_lease(reply + sizeof(*out),
+			msg_type == DHCP4_DISCOVER ? DHCP4_OFFER : DHCP4_ACK);
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(DHCP4_CLIENT_PORT);
+	if (msg->ciaddr) {
+		sin.sin_addr.s_addr = msg->ciaddr;
+	} else {
+		/* unicast to the client without an address, as servers do */
+		memset(&arp, 0, sizeof(arp));
+		sin.sin_addr.s_addr = out->yiaddr;
+		memcpy(&arp.arp_pa, &sin, sizeof(sin));
+		arp.arp_ha.sa_family = ARPHRD_ETHER;
+		memcpy(arp.arp_ha.sa_data, msg->chaddr, ETH_ALEN);
+		arp.arp_flags = ATF_COM;
+		strncpy(arp.arp_dev, DHCP_SCALE_BRIDGE, sizeof(arp.arp_dev) - 1);
+		if (ioctl(fd, SIOCSARP, &arp) < 0)
+			sin.sin_addr.s_addr = INADDR_BROADCAST;
+	}
+
+	len = sizeof(*out) + olen;
+	if (len < BOOTP_MESSAGE_LENGTH_MIN - 28)
+		len = BOOTP_MESSAGE_LENGTH_MIN - 28;
+	sendto(fd, reply, len, 0, (struct sockaddr *)&sin, sizeof(sin));
+}
+
+static unsigned char *
+dhcp_scale_server6_option(unsigned char *p, unsigned int code, const void *data, size_t len)
+{
+	p[0] = code >> 8;
+	p[1] = code;
+	p[2] = len >> 8;
+	p[3] = len;
+	if (data)
+		memcpy(p + 4, data, len);
+	return p + 4 + len;
+}
+
+static void
+dhcp_scale_server6_packet(int fd, unsigned char *pkt, size_t len,
+			const struct sockaddr_in6 *from, unsigned int *counts)
+{
+	static const unsigned char duid[] = { 0, 3, 0, 1, 0x02, 0, 0, 0xff, 0xff, 0xff };
+	unsigned char reply[DHCP_SCALE_PACKET_MAX], iaaddr[24];
+	unsigned char *clientid = NULL, *iaid = NULL, *p, *ia;
+	unsigned int code, olen, clientid_len = 0;
+	struct in6_addr addr;
+	uint32_t value;
+	size_t pos;
+
+	if (len < 4)
+		return;
+	for (pos = 4; pos + 4 <= len; pos += 4 + olen) {
+		code = (pkt[pos] << 8) | pkt[pos + 1];
+		olen = (pkt[pos + 2] << 8) | pkt[pos + 3];
+		if (pos + 4 + olen > len)
+			return;
+		if (code == NI_DHCP6_OPTION_CLIENTID) {
+			clientid = pkt + pos + 4;
+			clientid_len = olen;
+		} else
+		if (code == NI_DHCP6_OPTION_IA_NA && olen >= 12) {
+			iaid = pkt + pos + 4;
+		}
+	}
+	switch (pkt[0]) {
+	case NI_DHCP6_SOLICIT:
+	case NI_DHCP6_REQUEST:
+	case NI_DHCP6_RENEW:
+	case NI_DHCP6_REBIND:
+		break;
+	default:
+		return;
+	}
+	if (!clientid || !iaid)
+		return;
+	counts[pkt[0]]++;
+
+	reply[0] = pkt[0] == NI_DHCP6_SOLICIT ? NI_DHCP6_ADVERTISE : NI_DHCP6_REPLY;
+	memcpy(reply + 1, pkt + 1, 3);
+	p = reply + 4;
+	p = dhcp_scale_server6_option(p, NI_DHCP6_OPTION_CLIENTID, clientid, clientid_len);
+	p = dhcp_scale_server6_option(p, NI_DHCP6_OPTION_SERVERID, duid, sizeof(duid));
+	if (pkt[0] == NI_DHCP6_SOLICIT)
+		p = dhcp_scale_server6_option(p, NI_DHCP6_OPTION_PREFERENCE, "\xff", 1);
+
+	/* the clients are numbered in the last two bytes of their MAC */
+	inet_pton(AF_INET6, DHCP_SCALE_POOL6, &addr);
+	addr.s6_addr[13] = 0x0a;
+	addr.s6_addr[14] = from->sin6_addr.s6_addr[14];
+	addr.s6_addr[15] = from->sin6_addr.s6_addr[15];
+	memcpy(iaaddr, &addr, 16);
+	value = htonl(dhcp_scale.lease_time);
+	memcpy(iaaddr + 16, &value, 4);
+	memcpy(iaaddr + 20, &value, 4);
+
+	ia = p;
+	p = dhcp_scale_server6_option(p, NI_DHCP6_OPTION_IA_NA, NULL, 12 + 4 + sizeof(iaaddr));
+	memcpy(ia + 4, iaid, 4);
+	value = htonl(dhcp_scale.lease_time / 2);
+	memcpy(ia + 8, &value, 4);
+	value = htonl(dhcp_scale.lease_time * 7 / 8);
+	memcpy(ia + 12, &value, 4);
+	dhcp_scale_server6_option(ia + 16, NI_DHCP6_OPTION_IA_ADDRESS, iaaddr, sizeof(iaaddr));
+
+	sendto(fd, reply, p - reply, 0, (const struct sockaddr *)from, sizeof(*from));
+}
+
+static int
+dhcp_scale_server_socket(void)
+{
+	struct sockaddr_in6 sin6;
+	struct sockaddr_in sin;
+	struct ipv6_mreq mreq;
+	int fd, on = 1;
+
+	if (dhcp_scale.family == AF_INET6) {
+		if ((fd = socket(AF_INET6, SOCK_DGRAM, 0)) < 0)
+			return -1;
+		memset(&sin6, 0, sizeof(sin6));
+		sin6.sin6_family = AF_INET6;
+		sin6.sin6_port = htons(NI_DHCP6_SERVER_PORT);
+		memset(&mreq, 0, sizeof(mreq));
+		inet_pton(AF_INET6, NI_DHCP6_ALL_RAGENTS, &mreq.ipv6mr_multiaddr);
+		mreq.ipv6mr_interface = if_nametoindex(DHCP_SCALE_BRIDGE);
+		if (bind(fd, (struct sockaddr *)&sin6, sizeof(sin6)) < 0 ||
+		    setsockopt(fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)) < 0)
+			goto failed;
+	} else {
+		if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+			return -1;
+		memset(&sin, 0, sizeof(sin));
+		sin.sin_family = AF_INET;
+		sin.sin_port = htons(DHCP4_SERVER_PORT);
+		if (setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0 ||
+		    setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, DHCP_SCALE_BRIDGE,
+					sizeof(DHCP_SCALE_BRIDGE)) < 0 ||
+		    bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+			goto failed;
+	}
+	on = 1 << 20;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &on, sizeof(on));
+	return fd;
+
+failed:
+	close(fd);
+	return -1;
+}
+
+static ni_bool_t
+dhcp_scale_server_bridge(void)
+{
+	unsigned int i;
+	FILE *ip;
+
+	dhcp_scale_sysctl("/proc/sys/net/ipv6/conf/default/accept_dad", "0");
+	if (!(ip = popen("ip -batch -", "w")))
+		return FALSE;
+	fprintf(ip, "link set lo up\n");
+	fprintf(ip, "link add %s type bridge forward_delay 0 mcast_snooping 0\n",
+			DHCP_SCALE_BRIDGE);
+	fprintf(ip, "address add 10.64.0.1/16 dev %s\n", DHCP_SCALE_BRIDGE);
+	for (i = 0; i < dhcp_scale.count; ++i)
+		fprintf(ip, "link set p%u master %s up\n", i, DHCP_SCALE_BRIDGE);
+	fprintf(ip, "link set %s up\n", DHCP_SCALE_BRIDGE);
+	return pclose(ip) == 0;
+}
+
+/*
+ * The responder runs in a network namespace of its own: it tells the
+ * parent its namespace is ready for the veth peers and waits until
+ * they were created before building the bridge.
+ */
+static void
+dhcp_scale_server(int ready, int start)
+{
+	unsigned char pkt[DHCP_SCALE_PACKET_MAX];
+	unsigned int counts[16];
+	struct sockaddr_in6 from;
+	struct sigaction sa;
+	socklen_t alen;
+	ssize_t len;
+	char c = 0;
+	int fd;
+
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = dhcp_scale_server_signal;
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (unshare(CLONE_NEWNET) < 0 || write(ready, &c, 1) != 1)
+		_exit(1);
+	if (read(start, &c, 1) != 1 || !dhcp_scale_server_bridge())
+		_exit(1);
+	if ((fd = dhcp_scale_server_socket()) < 0)
+		_exit(1);
+	if (write(ready, &c, 1) != 1)
+		_exit(1);
+
+	memset(counts, 0, sizeof(counts));
+	while (!dhcp_scale_server_done) {
+		alen = sizeof(from);
+		len = recvfrom(fd, pkt, sizeof(pkt), 0, (struct sockaddr *)&from, &alen);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			break;
+		if (dhcp_scale.family == AF_INET6)
+			dhcp_scale_server6_packet(fd, pkt, len, &from, counts);
+		else
+			dhcp_scale_server4_packet(fd, pkt, len, counts);
+	}
+
+	if (dhcp_scale.family == AF_INET6)
+		printf("server: %u solicit, %u request, %u renew, %u rebind\n",
+				counts[NI_DHCP6_SOLICIT], counts[NI_DHCP6_REQUEST],
+				counts[NI_DHCP6_RENEW], counts[NI_DHCP6_REBIND]);
+	else
+		printf("server: %u discover, %u request\n",
+				counts[DHCP4_DISCOVER], counts[DHCP4_REQUEST]);
+	fflush(stdout);
+	_exit(0);
+}
+
+/*
+ * The clients
+ */
+static dhcp_scale_client_t *
+dhcp_scale_client(const char *ifname)
+{
+	unsigned int i;
+
+	if (!ifname || *ifname != 'd' || ni_parse_uint(ifname + 1, &i, 10) < 0)
+		return NULL;
+	return i < dhcp_scale.count ? &dhcp_scale.clients[i] : NULL;
+}
+
+static void
+dhcp_scale_client_acquired(dhcp_scale_client_t *client, const ni_addrconf_lease_t *lease)
+{
+	if (client->leases++ == 0) {
+		ni_timer_get_time(&client->acquired);
+		dhcp_scale.acquired++;
+	} else
+	if (client->leases == 2) {
+		ni_timer_get_time(&client->renewed);
+		dhcp_scale.renewed++;
+	}
+
+	/* as wickedd, apply the address to renew the lease from it */
+	if (lease->family == AF_INET && client->leases == 1 && dhcp_scale.ip) {
+		fprintf(dhcp_scale.ip, "address replace %s/16 dev %s\n",
+				inet_ntoa(lease->dhcp4.address), client->ifname);
+		fflush(dhcp_scale.ip);
+	}
+}
+
+static void
+dhcp_scale_dhcp4_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *dev,
+			ni_addrconf_lease_t *lease)
+{
+	dhcp_scale_client_t *client;
+
+	if (ev != NI_DHCP4_EVENT_ACQUIRED || !lease || !(client = dhcp_scale_client(dev->ifname)))
+		return;
+	dhcp_scale_client_acquired(client, lease);
+}
+
+static void
+dhcp_scale_dhcp6_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *dev,
+			ni_addrconf_lease_t *lease)
+{
+	dhcp_scale_client_t *client;
+
+	if (ev != NI_DHCP6_EVENT_ACQUIRED || !lease || !(client = dhcp_scale_client(dev->ifname)))
+		return;
+	dhcp_scale_client_acquired(client, lease);
+}
+
+static ni_bool_t
+dhcp_scale_client_start(dhcp_scale_client_t *client, const ni_netdev_t *ifp)
+{
+	ni_dhcp4_request_t *req4;
+	ni_dhcp6_request_t *req6;
+	char *err = NULL;
+	int rv;
+
+	ni_timer_get_time(&client->started);
+	if (dhcp_scale.family == AF_INET6) {
+		ni_dhcp6_device_t *dev;
+
+		if (!(dev = ni_dhcp6_device_new(ifp->name, &ifp->link)))
+			return FALSE;
+		client->dev = dev;
+		if (!ni_dhcp6_device_check_ready(dev))
+			return FALSE;
+
+		req6 = ni_dhcp6_request_new();
+		req6->mode = NI_DHCP6_MODE_MANAGED;
+		req6->rapid_commit = FALSE;
+		req6->update = ni_config_addrconf_update(ifp->name, NI_ADDRCONF_DHCP, AF_INET6);
+		ni_uuid_generate(&req6->uuid);
+		rv = ni_dhcp6_acquire(dev, req6, &err);
+		ni_dhcp6_request_free(req6);
+		ni_string_free(&err);
+	} else {
+		ni_dhcp4_device_t *dev;
+
+		if (!(dev = ni_dhcp4_device_new(ifp->name, &ifp->link)))
+			return FALSE;
+		client->dev = dev;
+
+		req4 = ni_dhcp4_request_new();
+		req4->update = ni_config_addrconf_update(ifp->name, NI_ADDRCONF_DHCP, AF_INET);
+		ni_uuid_generate(&req4->uuid);
+		rv = ni_dhcp4_acquire(dev, req4);
+		ni_dhcp4_request_free(req4);
+	}
+	return rv >= 0;
+}
+
+static void
+dhcp_scale_client_stop(dhcp_scale_client_t *client)
+{
+	if (!client->dev)
+		return;
+	if (dhcp_scale.family == AF_INET6) {
+		ni_dhcp6_device_stop(client->dev);
+		ni_dhcp6_device_put(client->dev);
+	} else {
+		ni_dhcp4_device_stop(client->dev);
+		ni_dhcp4_device_put(client->dev);
+	}
+	client->dev = NULL;
+}
+
+/*
+ * The namespace of the clients: the veth peers are created in the
+ * responder namespace, the clients are numbered in their MAC.
+ */
+static ni_bool_t
+dhcp_scale_links(pid_t server)
+{
+	unsigned int i;
+	FILE *ip;
+
+	if (unshare(CLONE_NEWNET) < 0)
+		return FALSE;
+
+	/* no DAD delays for the link-local addresses, no ARP replies
+	 * to the probes for the addresses of the other clients */
+	dhcp_scale_sysctl("/proc/sys/net/ipv6/conf/default/accept_dad", "0");
+	dhcp_scale_sysctl("/proc/sys/net/ipv6/conf/default/accept_ra", "0");
+	dhcp_scale_sysctl("/proc/sys/net/ipv4/conf/all/arp_ignore", "1");
+
+	if (!(ip = popen("ip -batch -", "w")))
+		return FALSE;
+	fprintf(ip, "link set lo up\n");
+	for (i = 0; i < dhcp_scale.count; ++i) {
+		fprintf(ip, "link add d%u address 02:00:00:00:%02x:%02x type veth "
+				"peer name p%u netns %d\n", i, i >> 8, i & 0xff, i, server);
+		fprintf(ip, "link set d%u up\n", i);
+	}
+	return pclose(ip) == 0;
+}
+
+static ni_netconfig_t *
+dhcp_scale_wait_links(unsigned int timeout)
+{
+	ni_netconfig_t *nc;
+	ni_netdev_t *ifp;
+	unsigned int i;
+
+	for (; timeout; --timeout) {
+		if (!(nc = ni_global_state_handle(1)))
+			return NULL;
+		for (i = 0; i < dhcp_scale.count; ++i) {
+			ifp = ni_netdev_by_name(nc, dhcp_scale.clients[i].ifname);
+			if (!ifp || !ni_netdev_link_is_up(ifp) ||
+			    !(ifp->link.ifflags & NI_IFF_LINK_UP))
+				break;
+		}
+		if (i == dhcp_scale.count)
+			return nc;
+		sleep(1);
+	}
+	return NULL;
+}
+
+static void
+dhcp_scale_rmdir(const char *dirname)
+{
+	struct dirent *de;
+	char *path = NULL;
+	DIR *dir;
+
+	if ((dir = opendir(dirname))) {
+		while ((de = readdir(dir))) {
+			if (de->d_name[0] == '.')
+				continue;
+			ni_string_printf(&path, "%s/%s", dirname, de->d_name);
+			unlink(path);
+		}
+		closedir(dir);
+	}
+	ni_string_free(&path);
+	rmdir(dirname);
+}
+
+static void
+dhcp_scale_report(const struct timeval *start, const struct timeval *end,
+			unsigned long cpu, unsigned long rss)
+{
+	unsigned long usec, min = -1UL, max = 0, sum = 0;
+	dhcp_scale_client_t *client;
+	unsigned int i;
+
+	for (i = 0; i < dhcp_scale.count; ++i) {
+		client = &dhcp_scale.clients[i];
+		if (!client->leases)
+			continue;
+		usec = dhcp_scale_usec(&client->started, &client->acquired);
+		if (usec < min)
+			min = usec;
+		if (usec > max)
+			max = usec;
+		sum += usec;
+	}
+	if (!dhcp_scale.acquired)
+		min = 0;
+
+	printf("%u %s leases on %u interfaces in %lu msec\n", dhcp_scale.acquired,
+			dhcp_scale.family == AF_INET6 ? "DHCPv6" : "DHCPv4",
+			dhcp_scale.count, dhcp_scale_usec(start, end) / 1000);
+	printf("time to lease: min %lu, avg %lu, max %lu msec\n", min / 1000,
+			dhcp_scale.acquired ? sum / dhcp_scale.acquired / 1000 : 0, max / 1000);
+	printf("cpu per lease: %lu usec\n", dhcp_scale.acquired ? cpu / dhcp_scale.acquired : 0);
+	printf("memory per device: %lu KiB\n", rss / dhcp_scale.count);
+}
+
+/*
+ * The first renewal has to be in the T1..T2 window of the lease and
+ * the renewals started per second must not exceed the rate limit.
+ */
+static unsigned int
+dhcp_scale_check_renewals(const struct timeval *start, unsigned int rate)
+{
+	unsigned long usec, t1, t2, min = -1UL, max = 0, sec, peak = 0;
+	unsigned int i, failed = 0, *counts;
+	dhcp_scale_client_t *client;
+	size_t seconds;
+
+	/* tolerate the timer granularity, the round trip and the ARP
+	 * validation of the renewed IPv4 lease before it is committed */
+	t1 = dhcp_scale.lease_time * 1000000UL / 2 - 50000;
+	t2 = dhcp_scale.lease_time * 7000000UL / 8 + 1000000;
+	seconds = 2 * dhcp_scale.lease_time + 120;
+	counts = xcalloc(seconds, sizeof(*counts));
+
+	for (i = 0; i < dhcp_scale.count; ++i) {
+		client = &dhcp_scale.clients[i];
+		if (client->leases < 2)
+			continue;
+		usec = dhcp_scale_usec(&client->acquired, &client->renewed);
+		if (usec < t1 || usec > t2)
+			failed++;
+		if (usec < min)
+			min = usec;
+		if (usec > max)
+			max = usec;
+
+		/* the renewal was started about a round trip earlier */
+		sec = dhcp_scale_usec(start, &client->renewed) / 1000000;
+		if (sec < seconds && ++counts[sec] > peak)
+			peak = counts[sec];
+	}
+	free(counts);
+	if (!dhcp_scale.renewed)
+		min = 0;
+
+	printf("renewal after lease: min %lu, max %lu msec (T1 %u, T2 %u msec)\n",
+			min / 1000, max / 1000, dhcp_scale.lease_time * 1000 / 2,
+			dhcp_scale.lease_time * 7000 / 8);
+	printf("renewals per second: max %lu\n", peak);
+	if (rate && peak > rate + 1)
+		failed++;
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	char statedir[] = "/tmp/dhcp-scale-test.XXXXXX";
+	unsigned int i, timeout = 60, failed = 0;
+	ni_config_dhcp_renew_t renew;
+	struct timeval start, now, acquired;
+	unsigned long cpu[3], rss[2];
+	int ready[2], go[2], fd, c;
+	ni_bool_t verbose = FALSE;
+	ni_netconfig_t *nc;
+	ni_netdev_t *ifp;
+	char byte = 0;
+	pid_t pid;
+
+	dhcp_scale.family = AF_INET;
+	dhcp_scale.count = 100;
+	dhcp_scale.lease_time = 20;
+	memset(&renew, 0, sizeof(renew));
+
+	if (ni_init("dhcp-scale-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "6vn:l:t:s:j:r:")) != EOF) {
+		switch (c) {
+		case '6':
+			dhcp_scale.family = AF_INET6;
+			break;
+		case 'v':
+			verbose = TRUE;
+			break;
+		case 'n':
+			if (ni_parse_uint(optarg, &dhcp_scale.count, 10) < 0 ||
+			    !dhcp_scale.count || dhcp_scale.count > 0xff00)
+				return -1;
+			break;
+		case 'l':
+			if (ni_parse_uint(optarg, &dhcp_scale.lease_time, 10) < 0 ||
+			    dhcp_scale.lease_time < 4)
+				return -1;
+			break;
+		case 't':
+			if (ni_parse_uint(optarg, &timeout, 10) < 0 || !timeout)
+				return -1;
+			break;
+		case 's':
+			if (ni_parse_uint(optarg, &renew.stagger, 10) < 0)
+				return -1;
+			break;
+		case 'j':
+			if (ni_parse_uint(optarg, &renew.jitter, 10) < 0)
+				return -1;
+			break;
+		case 'r':
+			if (ni_parse_uint(optarg, &renew.rate, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: dhcp-scale-test [-6] [-v] [-n count] "
+					"[-l lease-time] [-t timeout]\n"
+					"                       [-s stagger] [-j jitter] "
+					"[-r renewals/sec]\n");
+			return -1;
+		}
+	}
+
+	if (!verbose && (fd = open("/dev/null", O_WRONLY)) >= 0) {
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+	}
+
+	/* keep the lease and DUID files out of the system directories */
+	if (!mkdtemp(statedir))
+		return -1;
+	ni_string_dup(&ni_global.config->statedir.path, statedir);
+	ni_string_dup(&ni_global.config->storedir.path, statedir);
+	ni_global.config->addrconf.dhcp4.renew = renew;
+	ni_global.config->addrconf.dhcp6.renew = renew;
+	srandom(1);
+
+	dhcp_scale.clients = xcalloc(dhcp_scale.count, sizeof(dhcp_scale_client_t));
+	for (i = 0; i < dhcp_scale.count; ++i)
+		snprintf(dhcp_scale.clients[i].ifname, IFNAMSIZ, "d%u", i);
+
+	if (pipe(ready) < 0 || pipe(go) < 0)
+		return -1;
+	fflush(stdout);
+	if ((pid = fork()) < 0)
+		return -1;
+	if (pid == 0)
+		dhcp_scale_server(ready[1], go[0]);
+
+	if (read(ready[0], &byte, 1) != 1 || !dhcp_scale_links(pid) ||
+	    write(go[1], &byte, 1) != 1 || read(ready[0], &byte, 1) != 1) {
+		printf("dhcp-scale-test: unable to set up the links\n");
+		failed++;
+		goto done;
+	}
+	if (!(nc = dhcp_scale_wait_links(20))) {
+		printf("dhcp-scale-test: links are not up\n");
+		failed++;
+		goto done;
+	}
+	if (dhcp_scale.family == AF_INET)
+		dhcp_scale.ip = popen("ip -force -batch -", "w");
+
+	if (dhcp_scale.family == AF_INET6)
+		ni_dhcp6_set_event_handler(dhcp_scale_dhcp6_event);
+	else
+		ni_dhcp4_set_event_handler(dhcp_scale_dhcp4_event);
+
+	rss[0] = dhcp_scale_rss_kb();
+	cpu[0] = dhcp_scale_cpu_usec();
+	ni_timer_get_time(&start);
+	for (i = 0; i < dhcp_scale.count; ++i) {
+		ifp = ni_netdev_by_name(nc, dhcp_scale.clients[i].ifname);
+		if (!ifp || !dhcp_scale_client_start(&dhcp_scale.clients[i], ifp))
+			failed++;
+	}
+
+	/* all leases, then the first renewal of each */
+	memset(&acquired, 0, sizeof(acquired));
+	cpu[1] = cpu[0];
+	rss[1] = rss[0];
+	while (!ni_caught_terminal_signal()) {
+		if (dhcp_scale.acquired == dhcp_scale.count && !timerisset(&acquired)) {
+			ni_timer_get_time(&acquired);
+			cpu[1] = dhcp_scale_cpu_usec();
+			rss[1] = dhcp_scale_rss_kb();
+		}
+		if (dhcp_scale.renewed == dhcp_scale.count)
+			break;
+
+		ni_timer_get_time(&now);
+		if (now.tv_sec - start.tv_sec >= (time_t)timeout)
+			break;
+		if (ni_socket_wait(ni_timer_next_timeout()) != 0)
+			break;
+	}
+	cpu[2] = dhcp_scale_cpu_usec();
+	if (!timerisset(&acquired)) {
+		ni_timer_get_time(&acquired);
+		cpu[1] = cpu[2];
+		rss[1] = dhcp_scale_rss_kb();
+	}
+
+	dhcp_scale_report(&start, &acquired, cpu[1] - cpu[0],
+			rss[1] > rss[0] ? rss[1] - rss[0] : 0);
+	printf("renewals: %u of %u, cpu per renewal: %lu usec\n",
+			dhcp_scale.renewed, dhcp_scale.count,
+			dhcp_scale.renewed ? (cpu[2] - cpu[1]) / dhcp_scale.renewed : 0);
+
+	failed += dhcp_scale_check_renewals(&start, renew.rate);
+	if (dhcp_scale.acquired != dhcp_scale.count || dhcp_scale.renewed != dhcp_scale.count)
+		failed++;
+
+	for (i = 0; i < dhcp_scale.count; ++i)
+		dhcp_scale_client_stop(&dhcp_scale.clients[i]);
+	if (dhcp_scale.ip)
+		pclose(dhcp_scale.ip);
+done:
+	fflush(stdout);
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	dhcp_scale_rmdir(statedir);
+	free(dhcp_scale.clients);
+
+	printf("dhcp-scale-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
@@ -0,0 +1,418 @@
+/*
+ * Decode DHCPv4 responses offline: check the table driven option
+ * decoder on a synthetic corpus, feed it with truncated and mutated
+ * packets and measure the parse throughput.
+ *
+ * Files given as arguments are replayed in addition to the built-in
+ * corpus; each file contains one raw BOOTP message as found in the
+ * UDP payload of a captured packet. "-" reads a single message from
+ * stdin, so the program can be used as an AFL target:
+ *
+ *   afl-fuzz -i corpus -o findings -- dhcp4-test -n 0 @@
+ *
+ * For libFuzzer, build with -DDHCP4_TEST_FUZZER -fsanitize=fuzzer to
+ * use the LLVMFuzzerTestOneInput entry point instead of main.
+ *
+ * Usage: dhcp4-test [-d facility] [-n iterations] [file|- ...]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+#include <wicked/addrconf.h>
+#include <wicked/resolver.h>
+#include <wicked/nis.h>
+#include <wicked/route.h>
+#include <wicked/socket.h>
+#include "dhcp4/dhcp4.h"
+#include "dhcp4/protocol.h"
+#include "dhcp.h"
+#include "buffer.h"
+
+#define DHCP4_TEST_PACKET_MAX	1500
+#define DHCP4_TEST_CUSTOM_CODE	224
+
+typedef struct dhcp4_test_packet {
+	size_t			len;
+	unsigned char		data[DHCP4_TEST_PACKET_MAX];
+} dhcp4_test_packet_t;
+
+static ni_dhcp4_config_t	dhcp4_test_config;
+
+static int
+dhcp4_test_parse(const unsigned char *data, size_t len, ni_addrconf_lease_t **leasep)
+{
+	ni_dhcp4_message_t *message;
+	ni_buffer_t buf;
+	void *copy;
+	int ret;
+
+	/* the buffer may be modified, parse a private copy */
+	*leasep = NULL;
+	if (!(copy = malloc(len ? len : 1)))
+		return -1;
+	memcpy(copy, data, len);
+
+	ni_buffer_init_reader(&buf, copy, len);
+	if ((message = ni_buffer_pull_head(&buf, sizeof(*message))))
+		ret = ni_dhcp4_parse_response(&dhcp4_test_config, message, &buf, leasep);
+	else
+		ret = -1;
+
+	free(copy);
+	return ret;
+}
+
+int
+LLVMFuzzerTestOneInput(const unsigned char *data, size_t len)
+{
+	ni_addrconf_lease_t *lease;
+
+	if (dhcp4_test_parse(data, len, &lease) >= 0)
+		ni_addrconf_lease_free(lease);
+	return 0;
+}
+
+static void
+dhcp4_test_option(dhcp4_test_packet_t *pkt, unsigned int code, const void *data, size_t len)
+{
+	pkt->data[pkt->len++] = code;
+	pkt->data[pkt->len++] = len;
+	memcpy(pkt->data + pkt->len, data, len);
+	pkt->len += len;
+}
+
+static void
+dhcp4_test_option_ipv4(dhcp4_test_packet_t *pkt, unsigned int code, const char *addr)
+{
+	struct in_addr in;
+
+	inet_aton(addr, &in);
+	dhcp4_test_option(pkt, code, &in, sizeof(in));
+}
+
+static void
+dhcp4_test_option_u32(dhcp4_test_packet_t *pkt, unsigned int code, uint32_t value)
+{
+	value = htonl(value);
+	dhcp4_test_option(pkt, code, &value, sizeof(value));
+}
+
+static void
+dhcp4_test_option_str(dhcp4_test_packet_t *pkt, unsigned int code, const char *str)
+{
+	dhcp4_test_option(pkt, code, str, strlen(str));
+}
+
+/* END option and padding to the minimal BOOTP message size */
+static void
+dhcp4_test_end(dhcp4_test_packet_t *pkt)
+{
+	pkt->data[pkt->len++] = DHCP4_END;
+	if (pkt->len < 300)
+		pkt->len = 300;
+}
+
+static ni_dhcp4_message_t *
+dhcp4_test_header(dhcp4_test_packet_t *pkt, unsigned int type, unsigned int host)
+{
+	ni_dhcp4_message_t *message;
+	unsigned char mtype = type;
+
+	memset(pkt, 0, sizeof(*pkt));
+	message = (ni_dhcp4_message_t *)pkt->data;
+	message->op = DHCP4_BOOTREPLY;
+	message->hwtype = 1;
+	message->hwlen = 6;
+	message->xid = htonl(0x12345678);
+	message->yiaddr = htonl(0x0a000000 + host);
+	message->cookie = htonl(MAGIC_COOKIE);
+	pkt->len = sizeof(*message);
+
+	dhcp4_test_option(pkt, DHCP4_MESSAGETYPE, &mtype, 1);
+	dhcp4_test_option_ipv4(pkt, DHCP4_SERVERIDENTIFIER, "10.0.0.1");
+	return message;
+}
+
+/*
+ * A typical ACK with routes, resolver and a custom option, where the
+ * dns-server option is split into two parts (RFC 3396).
+ */
+static void
+dhcp4_test_build_ack(dhcp4_test_packet_t *pkt, unsigned int host)
+{
+	static const unsigned char csr[] = {
+		24, 192, 168, 1,	10, 0, 0, 254,
+		0,			10, 0, 0, 1,
+	};
+	static const unsigned char search[] = {
+		7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+		3, 'l', 'a', 'b', 0xc0, 0,
+	};
+	unsigned char dns[8] = { 10, 0, 0, 2, 10, 0, 0, 3 };
+	unsigned char mtu[2] = { 0x05, 0xdc };
+	char hostname[32];
+
+	dhcp4_test_header(pkt, DHCP4_ACK, host);
+	dhcp4_test_option_u32(pkt, DHCP4_LEASETIME, 3600);
+	dhcp4_test_option_u32(pkt, DHCP4_RENEWALTIME, 1800);
+	dhcp4_test_option_u32(pkt, DHCP4_REBINDTIME, 3150);
+	dhcp4_test_option_ipv4(pkt, DHCP4_NETMASK, "255.255.255.0");
+	dhcp4_test_option_ipv4(pkt, DHCP4_BROADCAST, "10.0.0.255");
+	dhcp4_test_option_ipv4(pkt, DHCP4_ROUTERS, "10.0.0.1");
+	dhcp4_test_option(pkt, DHCP4_DNSSERVER, dns, 4);
+	dhcp4_test_option(pkt, DHCP4_DNSSERVER, dns + 4, 4);
+	dhcp4_test_option_str(pkt, DHCP4_DNSDOMAIN, "example.com");
+	dhcp4_test_option(pkt, DHCP4_DNSSEARCH, search, sizeof(search));
+	dhcp4_test_option(pkt, DHCP4_CSR, csr, sizeof(csr));
+	dhcp4_test_option(pkt, DHCP4_MTU, mtu, sizeof(mtu));
+	snprintf(hostname, sizeof(hostname), "host%u", host);
+	dhcp4_test_option_str(pkt, DHCP4_HOSTNAME, hostname);
+	dhcp4_test_option_ipv4(pkt, DHCP4_NTPSERVER, "10.0.0.4");
+	dhcp4_test_option_str(pkt, DHCP4_NISDOMAIN, "nis.example.com");
+	dhcp4_test_option_str(pkt, DHCP4_POSIX_TZ_STRING, "CET-1CEST");
+	dhcp4_test_option_u32(pkt, DHCP4_TEST_CUSTOM_CODE, host);
+	dhcp4_test_end(pkt);
+}
+
+/*
+ * An offer with the options overloaded into the file field and
+ * options with invalid lengths, which are ignored.
+ */
+static void
+dhcp4_test_build_offer(dhcp4_test_packet_t *pkt, unsigned int host)
+{
+	dhcp4_test_packet_t file;
+	ni_dhcp4_message_t *message;
+	unsigned char overload = DHCP4_OVERLOAD_BOOTFILE;
+	unsigned char bad[3] = { 1, 2, 3 };
+
+	message = dhcp4_test_header(pkt, DHCP4_OFFER, host);
+	dhcp4_test_option(pkt, DHCP4_OPTIONSOVERLOADED, &overload, 1);
+	dhcp4_test_option(pkt, DHCP4_NETMASK, bad, sizeof(bad));
+	dhcp4_test_option(pkt, DHCP4_DNSSERVER, bad, sizeof(bad));
+	dhcp4_test_option(pkt, DHCP4_TEST_CUSTOM_CODE, bad, 2);
+	dhcp4_test_end(pkt);
+
+	file.len = 0;
+	dhcp4_test_option_u32(&file, DHCP4_LEASETIME, 600);
+	dhcp4_test_option_ipv4(&file, DHCP4_ROUTERS, "10.0.0.1");
+	file.data[file.len++] = DHCP4_END;
+	memcpy(message->bootfile, file.data, file.len);
+}
+
+static int
+dhcp4_test_check_ack(unsigned int host)
+{
+	const ni_dhcp_option_t *opt;
+	dhcp4_test_packet_t pkt;
+	ni_addrconf_lease_t *lease;
+	ni_route_table_t *tab;
+	unsigned int routes = 0;
+	char hostname[32];
+	int failed = 0;
+
+	dhcp4_test_build_ack(&pkt, host);
+	if (dhcp4_test_parse(pkt.data, pkt.len, &lease) != DHCP4_ACK || !lease)
+		return 1;
+
+	snprintf(hostname, sizeof(hostname), "host%u", host);
+	if (ntohl(lease->dhcp4.address.s_addr) != 0x0a000000 + host ||
+	    lease->dhcp4.lease_time != 3600 || lease->dhcp4.rebind_time != 3150 ||
+	    lease->dhcp4.mtu != 1500 || !ni_string_eq(lease->hostname, hostname) ||
+	    !lease->addrs || lease->addrs->prefixlen != 24)
+		failed++;
+
+	if (!lease->resolver || lease->resolver->dns_servers.count != 2 ||
+	    lease->resolver->dns_search.count != 2 ||
+	    !ni_string_eq(lease->resolver->dns_search.data[1], "lab.example.com") ||
+	    !ni_string_eq(lease->resolver->default_domain, "example.com"))
+		failed++;
+	if (!lease->nis || !ni_string_eq(lease->nis->domainname, "nis.example.com") ||
+	    lease->ntp_servers.count != 1 || !ni_string_eq(lease->posix_tz_string, "CET-1CEST"))
+		failed++;
+
+	/* classless routes replace the routers option */
+	for (tab = lease->routes; tab; tab = tab->next)
+		routes += tab->routes.count;
+	if (routes != 2)
+		failed++;
+
+	opt = lease->dhcp4.options;
+	if (!opt || opt->code != DHCP4_TEST_CUSTOM_CODE || opt->len != 4 || opt->next)
+		failed++;
+
+	ni_addrconf_lease_free(lease);
+	return failed;
+}
+
+static int
+dhcp4_test_check_offer(void)
+{
+	dhcp4_test_packet_t pkt;
+	ni_addrconf_lease_t *lease;
+	int failed = 0;
+
+	dhcp4_test_build_offer(&pkt, 7);
+	if (dhcp4_test_parse(pkt.data, pkt.len, &lease) != DHCP4_OFFER || !lease)
+		return 1;
+
+	if (lease->dhcp4.lease_time != 600 || !lease->routes ||
+	    lease->dhcp4.netmask.s_addr != htonl(0xff000000) ||
+	    lease->resolver || lease->dhcp4.options || lease->dhcp4.boot_file)
+		failed++;
+
+	ni_addrconf_lease_free(lease);
+	return failed;
+}
+
+/*
+ * All truncations and random byte mutations of a packet; the parser
+ * has to reject or accept them without crashing or leaking.
+ */
+static void
+dhcp4_test_mutate(const dhcp4_test_packet_t *pkt, unsigned int rounds)
+{
+	dhcp4_test_packet_t copy;
+	unsigned int i, n;
+	size_t len;
+
+	for (len = 0; len <= pkt->len; ++len)
+		LLVMFuzzerTestOneInput(pkt->data, len);
+
+	if (pkt->len <= sizeof(ni_dhcp4_message_t))
+		return;
+
+	for (i = 0; i < rounds; ++i) {
+		copy = *pkt;
+		for (n = 1 + random() % 4; n; --n)
+			copy.data[sizeof(ni_dhcp4_message_t) + random() %
+				(copy.len - sizeof(ni_dhcp4_message_t))] = random();
+		LLVMFuzzerTestOneInput(copy.data, copy.len);
+	}
+}
+
+static ni_bool_t
+dhcp4_test_load(dhcp4_test_packet_t *pkt, const char *filename)
+{
+	FILE *fp;
+
+	if (ni_string_eq(filename, "-"))
+		fp = stdin;
+	else if (!(fp = fopen(filename, "r")))
+		return FALSE;
+
+	pkt->len = fread(pkt->data, 1, sizeof(pkt->data), fp);
+	if (fp != stdin)
+		fclose(fp);
+	return TRUE;
+}
+
+static unsigned long
+dhcp4_test_usec(const struct timeval *start)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+#ifndef DHCP4_TEST_FUZZER
+int main(int argc, char **argv)
+{
+	ni_dhcp_option_decl_t *custom = NULL;
+	dhcp4_test_packet_t *corpus;
+	ni_addrconf_lease_t *lease;
+	unsigned int count, iterations = 20000;
+	unsigned int i, n, parsed = 0, failed = 0;
+	struct timeval start;
+	unsigned long usec;
+	int c;
+
+	if (ni_init("dhcp4-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "d:n:")) != EOF) {
+		switch (c) {
+		case 'd':
+			if (ni_enable_debug(optarg) < 0)
+				return -1;
+			break;
+		case 'n':
+			if (ni_parse_uint(optarg, &iterations, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: dhcp4-test [-d facility] [-n iterations] [file|- ...]\n");
+			return -1;
+		}
+	}
+
+	ni_dhcp_option_decl_list_append(&custom, ni_dhcp_option_decl_new("custom",
+				DHCP4_TEST_CUSTOM_CODE, NI_DHCP_OPTION_KIND_SCALAR,
+				ni_dhcp_option_type_find("uint32")));
+	dhcp4_test_config.custom_options = custom;
+
+	count = 64 + argc - optind;
+	corpus = xcalloc(count, sizeof(*corpus));
+	for (i = 0; i < 64; ++i) {
+		if (i % 4)
+			dhcp4_test_build_ack(&corpus[i], i + 1);
+		else
+			dhcp4_test_build_offer(&corpus[i], i + 1);
+	}
+	for (n = 64; optind < argc; ++optind) {
+		if (!dhcp4_test_load(&corpus[n], argv[optind])) {
+			printf("dhcp4-test: cannot read %s\n", argv[optind]);
+			failed++;
+			continue;
+		}
+		LLVMFuzzerTestOneInput(corpus[n].data, corpus[n].len);
+		n++;
+	}
+	count = n;
+
+	failed += dhcp4_test_check_ack(1);
+	failed += dhcp4_test_check_offer();
+
+	srandom(1);
+	if (iterations)
+		for (i = 0; i < count; ++i)
+			dhcp4_test_mutate(&corpus[i], iterations / count);
+
+	ni_timer_get_time(&start);
+	for (i = 0; i < iterations; ++i) {
+		const dhcp4_test_packet_t *pkt = &corpus[i % count];
+
+		if (dhcp4_test_parse(pkt->data, pkt->len, &lease) >= 0) {
+			ni_addrconf_lease_free(lease);
+			parsed++;
+		}
+	}
+	usec = dhcp4_test_usec(&start);
+
+	if (iterations) {
+		printf("%u packets, %u parsed in %lu usec (%lu packets/s)\n",
+				iterations, parsed, usec,
+				usec ? iterations * 1000000UL / usec : 0);
+	}
+
+	free(corpus);
+	ni_dhcp_option_decl_list_destroy(&custom);
+
+	printf("dhcp4-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
+#endif
@@ -26,6 +26,10 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
 #include "json.h"
 
 static ni_json_t *
@@ -190,10 +194,181 @@ test_case2()
 	ni_json_free(json);
 }
 
+/*
+ * Throughput benchmark on an ovsdb monitor update like document
+ * with a large table object keyed by row uuids.
+ */
+static unsigned long
+bench_nsec(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000UL + now.tv_nsec - start->tv_nsec;
+}
+
+static const char *
+bench_uuid(char *buf, size_t size, unsigned int i)
+{
+	unsigned int h = i * 2654435761U;
+
+	snprintf(buf, size, "%08x-%04x-4%03x-8%03x-%012x",
+			h, i & 0xffff, (h >> 4) & 0xfff, (h >> 16) & 0xfff, i);
+	return buf;
+}
+
+static void
+bench_document(ni_stringbuf_t *doc, unsigned int rows)
+{
+	char uuid[64];
+	unsigned int i;
+
+	ni_stringbuf_puts(doc, "{\"Interface\": {");
+	for (i = 0; i < rows; ++i) {
+		ni_stringbuf_printf(doc, "%s\n  \"%s\": {\"new\": {"
+				"\"name\": \"eth%u\", \"type\": \"\", \"ofport\": %u, "
+				"\"mtu\": 1.5e3, \"admin_state\": \"up\", \"link_up\": true, "
+				"\"error\": null, \"external_ids\": [\"map\", [[\"attached-mac\", "
+				"\"52:54:00:%02x:%02x:%02x\"], [\"iface-id\", \"caf\\u00e9 \\\"%u\\\" "
+				"\\uD834\\uDD1E \\u20ac ©\"]]]}}",
+				i ? "," : "", bench_uuid(uuid, sizeof(uuid), i), i, i + 1,
+				(i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, i);
+	}
+	ni_stringbuf_puts(doc, "\n}}\n");
+}
+
+static unsigned int
+bench_pull(const char *doc, size_t len, unsigned int *values)
+{
+	ni_json_pull_event_t event;
+	ni_json_pull_t *jp;
+	unsigned int events = 0;
+
+	*values = 0;
+	if (!(jp = ni_json_pull_new(doc, len)))
+		return 0;
+	while ((event = ni_json_pull_next(jp)) > NI_JSON_PULL_EOF) {
+		if (event == NI_JSON_PULL_VALUE)
+			(*values)++;
+		events++;
+	}
+	ni_json_pull_free(jp);
+	return event == NI_JSON_PULL_EOF ? events : 0;
+}
+
+static ni_json_t *
+bench_linear_get(ni_json_t *json, const char *name)
+{
+	ni_json_pair_t *pair;
+	unsigned int i;
+
+	for (i = 0; (pair = ni_json_object_get_pair_at(json, i)); ++i) {
+		if (ni_string_eq(ni_json_pair_get_name(pair), name))
+			return ni_json_pair_get_value(pair);
+	}
+	return NULL;
+}
+
+static int
+test_bench(unsigned int rows)
+{
+	ni_stringbuf_t doc = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t out1 = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t out2 = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i, n, events, values, loops = 5, failed = 0;
+	unsigned long nsec[4];
+	ni_json_t *json, *tree, *table, *row;
+	ni_json_pull_t *jp;
+	struct timespec start;
+	const char *iface;
+	char uuid[64];
+	double mb;
+
+	bench_document(&doc, rows);
+	mb = doc.len / 1000000.0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < loops; ++n) {
+		json = ni_json_parse_string(doc.string);
+		if (n + 1 < loops)
+			ni_json_free(json);
+	}
+	nsec[0] = bench_nsec(&start) / loops;
+	if (!json)
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < loops; ++n)
+		events = bench_pull(doc.string, doc.len, &values);
+	nsec[1] = bench_nsec(&start) / loops;
+	/* document: 2 objects, 1 name; per row: 10 names, 12 values, 2 objects, 4 arrays */
+	if (events != 2 * 2 + 1 + rows * (10 + 12 + 2 * 2 + 4 * 2) || values != 12 * rows)
+		failed++;
+
+	/* the pull tree and the DOM reader have to agree */
+	jp = ni_json_pull_new(doc.string, doc.len);
+	ni_json_pull_next(jp);
+	tree = ni_json_pull_tree(jp);
+	if (!tree || ni_json_pull_next(jp) != NI_JSON_PULL_EOF)
+		failed++;
+	ni_json_format_string(&out1, json, NULL);
+	ni_json_format_string(&out2, tree, NULL);
+	if (!ni_string_eq(out1.string, out2.string))
+		failed++;
+	ni_json_pull_free(jp);
+	ni_json_free(tree);
+
+	table = ni_json_object_get_value(json, "Interface");
+	if (ni_json_object_entries(table) != rows)
+		failed++;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < rows; ++i) {
+		row = ni_json_object_get_value(table, bench_uuid(uuid, sizeof(uuid), i));
+		row = ni_json_object_get_value(row, "new");
+		iface = ni_json_string_value(ni_json_object_get_value(row, "name"));
+		if (!iface || strtoul(iface + 3, NULL, 10) != i)
+			failed++;
+	}
+	nsec[2] = bench_nsec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < rows; ++i) {
+		row = bench_linear_get(table, bench_uuid(uuid, sizeof(uuid), i));
+		if (row != ni_json_object_get_value(table, uuid))
+			failed++;
+	}
+	nsec[3] = bench_nsec(&start);
+
+	printf("document:     %u rows, %zu bytes\n", rows, doc.len);
+	printf("tree parse:   %8.3f msec, %7.2f MB/s\n", nsec[0] / 1e6, mb * 1e9 / nsec[0]);
+	printf("pull parse:   %8.3f msec, %7.2f MB/s, %u events\n", nsec[1] / 1e6,
+			mb * 1e9 / nsec[1], events);
+	printf("row lookup:   %8lu nsec/op hashed, %lu nsec/op linear\n",
+			nsec[2] / rows, nsec[3] / rows);
+
+	ni_json_free(json);
+	ni_stringbuf_destroy(&doc);
+	ni_stringbuf_destroy(&out1);
+	ni_stringbuf_destroy(&out2);
+	return failed;
+}
+
 int
 main(int argc, char **argv)
 {
-	int n;
+	unsigned int rows = 20000;
+	int n, failed;
+
+	if (argc > 1 && ni_string_eq(argv[1], "--bench")) {
+		if (argc > 2 && (ni_parse_uint(argv[2], &rows, 10) < 0 || !rows)) {
+			fprintf(stderr, "Usage: json-test --bench [rows]\n");
+			return -1;
+		}
+		failed = test_bench(rows);
+		printf("json-test: %s\n", failed ? "FAILED" : "OK");
+		return failed;
+	}
 
 	if (argc == 1) {
 		test_case1();
@@ -0,0 +1,360 @@
+/*
+ * Write and read a DHCPv4 and a DHCPv6 lease file in the xml and
+ * the compact binary format and compare the cost per operation.
+ *
+ * Each write is a renew, which changes the timestamps only: the xml
+ * file is rewritten each time, the binary one gets a timestamp record
+ * appended and is rewritten after max-records appends. The leases are
+ * read back and compared to the written ones via their xml export.
+ *
+ * Usage: leasefile-test [-n renews] [-m max-records]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/addrconf.h>
+#include <wicked/address.h>
+#include <wicked/resolver.h>
+#include <wicked/socket.h>
+#include <wicked/xml.h>
+#include "appconfig.h"
+#include "dhcp6/options.h"
+
+#define LEASEFILE_TEST_IFNAME	"eth0"
+#define LEASEFILE_TEST_IAS	4
+
+static char	leasefile_test_dir[] = "/tmp/leasefile-test.XXXXXX";
+
+static unsigned long
+leasefile_test_usec(const struct timeval *start)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+static void
+leasefile_test_resolver(ni_addrconf_lease_t *lease, const char *dns1, const char *dns2)
+{
+	lease->resolver = ni_resolver_info_new();
+	ni_string_dup(&lease->resolver->default_domain, "example.com");
+	ni_string_array_append(&lease->resolver->dns_servers, dns1);
+	ni_string_array_append(&lease->resolver->dns_servers, dns2);
+	ni_string_array_append(&lease->resolver->dns_search, "example.com");
+	ni_string_array_append(&lease->resolver->dns_search, "lab.example.com");
+	ni_string_array_append(&lease->ntp_servers, "ntp.example.com");
+}
+
+static ni_addrconf_lease_t *
+leasefile_test_dhcp4(void)
+{
+	ni_addrconf_lease_t *lease;
+	ni_sockaddr_t addr;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	lease->update = ni_config_addrconf_update_mask(lease->type, lease->family);
+	ni_timer_get_time(&lease->acquired);
+	lease->acquired.tv_usec = 0;
+	ni_string_dup(&lease->hostname, "client.example.com");
+
+	inet_aton("10.64.1.2", &lease->dhcp4.address);
+	inet_aton("255.255.0.0", &lease->dhcp4.netmask);
+	inet_aton("10.64.255.255", &lease->dhcp4.broadcast);
+	inet_aton("10.64.0.1", &lease->dhcp4.server_id);
+	lease->dhcp4.lease_time = 3600;
+	lease->dhcp4.renewal_time = 1800;
+	lease->dhcp4.rebind_time = 3150;
+	lease->dhcp4.mtu = 1500;
+
+	ni_sockaddr_set_ipv4(&addr, lease->dhcp4.address, 0);
+	ni_address_new(AF_INET, 16, &addr, &lease->addrs);
+	leasefile_test_resolver(lease, "10.64.0.1", "10.64.0.2");
+	return lease;
+}
+
+static ni_addrconf_lease_t *
+leasefile_test_dhcp6(void)
+{
+	ni_addrconf_lease_t *lease;
+	ni_dhcp6_ia_addr_t *iadr;
+	struct in6_addr ip6;
+	ni_dhcp6_ia_t *ia;
+	unsigned int i;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET6);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	lease->update = ni_config_addrconf_update_mask(lease->type, lease->family);
+	ni_timer_get_time(&lease->acquired);
+	lease->acquired.tv_usec = 0;
+	lease->dhcp6.server_pref = 255;
+	inet_pton(AF_INET6, "fe80::1", &lease->dhcp6.server_addr);
+
+	for (i = 0; i < LEASEFILE_TEST_IAS; ++i) {
+		ia = ni_dhcp6_ia_new(NI_DHCP6_OPTION_IA_NA, i + 1);
+		ia->acquired = lease->acquired;
+		ia->renewal_time = 1800;
+		ia->rebind_time = 3150;
+
+		inet_pton(AF_INET6, "2001:db8::", &ip6);
+		ip6.s6_addr[15] = i + 1;
+		iadr = ni_dhcp6_ia_addr_new(ip6, 128);
+		iadr->preferred_lft = 3600;
+		iadr->valid_lft = 7200;
+		ni_dhcp6_ia_addr_list_append(&ia->addrs, iadr);
+		ni_dhcp6_ia_list_append(&lease->dhcp6.ia_list, ia);
+	}
+	leasefile_test_resolver(lease, "2001:db8::1", "2001:db8::2");
+	return lease;
+}
+
+static void
+leasefile_test_renew(ni_addrconf_lease_t *lease)
+{
+	ni_dhcp6_ia_t *ia;
+
+	lease->acquired.tv_sec++;
+	if (lease->family != AF_INET6)
+		return;
+	for (ia = lease->dhcp6.ia_list; ia; ia = ia->next)
+		ia->acquired = lease->acquired;
+}
+
+static char *
+leasefile_test_sprint(const ni_addrconf_lease_t *lease)
+{
+	xml_node_t *xml = NULL;
+	char *str;
+
+	if (ni_addrconf_lease_to_xml(lease, &xml, LEASEFILE_TEST_IFNAME))
+		return NULL;
+	str = xml_node_sprint(xml);
+	xml_node_free(xml);
+	return str;
+}
+
+static ni_bool_t
+leasefile_test_compare(const ni_addrconf_lease_t *lease)
+{
+	ni_addrconf_lease_t *read;
+	char *a, *b = NULL;
+	ni_bool_t ok;
+
+	if (!(read = ni_addrconf_lease_file_read(LEASEFILE_TEST_IFNAME,
+					lease->type, lease->family)))
+		return FALSE;
+
+	a = leasefile_test_sprint(lease);
+	b = leasefile_test_sprint(read);
+	ok = a && b && ni_string_eq(a, b);
+	if (!ok)
+		printf("read back lease differs:\n%s\n---\n%s\n", a, b);
+
+	ni_string_free(&a);
+	ni_string_free(&b);
+	ni_addrconf_lease_free(read);
+	return ok;
+}
+
+static off_t
+leasefile_test_size(const ni_addrconf_lease_t *lease, const char *suffix)
+{
+	char *path = NULL;
+	struct stat st;
+
+	ni_string_printf(&path, "%s/lease-%s-%s-%s.%s", leasefile_test_dir,
+			LEASEFILE_TEST_IFNAME, ni_addrconf_type_to_name(lease->type),
+			ni_addrfamily_type_to_name(lease->family), suffix);
+	if (stat(path, &st) < 0)
+		st.st_size = -1;
+	ni_string_free(&path);
+	return st.st_size;
+}
+
+/* record header, count and the lease + per IA timestamps */
+static off_t
+leasefile_test_record_len(const ni_addrconf_lease_t *lease)
+{
+	unsigned int stamps = lease->family == AF_INET6 ? 1 + LEASEFILE_TEST_IAS : 1;
+
+	return 2 + 4 + 2 + stamps * 8;
+}
+
+/*
+ * Cut the last record in half as an append interrupted by a crash,
+ * the lease has the timestamps of the previous renew then.
+ */
+static int
+leasefile_test_truncated(ni_addrconf_lease_t *lease)
+{
+	char *path = NULL;
+	off_t size;
+	int failed = 0;
+
+	ni_string_dup(&lease->resolver->default_domain, "truncated.example.com");
+	ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease);
+	leasefile_test_renew(lease);
+	ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease);
+
+	size = leasefile_test_size(lease, "bin");
+	ni_string_printf(&path, "%s/lease-%s-%s-%s.bin", leasefile_test_dir,
+			LEASEFILE_TEST_IFNAME, ni_addrconf_type_to_name(lease->type),
+			ni_addrfamily_type_to_name(lease->family));
+	if (size <= 4 || truncate(path, size - 4) < 0)
+		failed++;
+	ni_string_free(&path);
+
+	lease->acquired.tv_sec--;
+	if (lease->family == AF_INET6) {
+		ni_dhcp6_ia_t *ia;
+
+		for (ia = lease->dhcp6.ia_list; ia; ia = ia->next)
+			ia->acquired = lease->acquired;
+	}
+	if (!leasefile_test_compare(lease))
+		failed++;
+
+	/* the next write notices the size and rewrites the file */
+	leasefile_test_renew(lease);
+	ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease);
+	if (!leasefile_test_compare(lease))
+		failed++;
+	return failed;
+}
+
+static int
+leasefile_test_run(ni_addrconf_lease_t *lease, ni_config_lease_file_format_t format,
+		unsigned int count, unsigned int max_records)
+{
+	const char *suffix = format == NI_CONFIG_LEASE_FILE_BINARY ? "bin" : "xml";
+	const char *other = format == NI_CONFIG_LEASE_FILE_BINARY ? "xml" : "bin";
+	ni_addrconf_lease_t *read;
+	struct timeval start;
+	unsigned long usec[2];
+	off_t size, base;
+	unsigned int i;
+	int failed = 0;
+
+	ni_global.config->addrconf.lease_file.format = format;
+	ni_global.config->addrconf.lease_file.max_records = max_records;
+
+	/* the first write replaces the file of the other format */
+	if (ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease) < 0 ||
+	    leasefile_test_size(lease, other) >= 0)
+		failed++;
+	base = leasefile_test_size(lease, suffix);
+
+	ni_timer_get_time(&start);
+	for (i = 0; i < count; ++i) {
+		leasefile_test_renew(lease);
+		if (ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease) < 0)
+			failed++;
+	}
+	usec[0] = leasefile_test_usec(&start);
+	size = leasefile_test_size(lease, suffix);
+
+	ni_timer_get_time(&start);
+	for (i = 0; i < count; ++i) {
+		read = ni_addrconf_lease_file_read(LEASEFILE_TEST_IFNAME,
+						lease->type, lease->family);
+		if (!read || read->acquired.tv_sec != lease->acquired.tv_sec)
+			failed++;
+		if (read)
+			ni_addrconf_lease_free(read);
+	}
+	usec[1] = leasefile_test_usec(&start);
+
+	if (!leasefile_test_compare(lease))
+		failed++;
+
+	/* renews since the last rewrite after max-records appends */
+	if (format == NI_CONFIG_LEASE_FILE_BINARY &&
+	    size != base + (count % (max_records + 1)) * leasefile_test_record_len(lease))
+		failed++;
+
+	printf("%-5s %-6s %6u renews  write %6.1f usec  read %6.1f usec  %5lld bytes\n",
+			ni_addrfamily_type_to_name(lease->family), suffix, count,
+			(double)usec[0] / count, (double)usec[1] / count,
+			(long long)size);
+
+	if (format == NI_CONFIG_LEASE_FILE_BINARY && max_records)
+		failed += leasefile_test_truncated(lease);
+
+	/* a real change is written in full */
+	ni_string_dup(&lease->resolver->default_domain, "changed.example.com");
+	if (ni_addrconf_lease_file_write(LEASEFILE_TEST_IFNAME, lease) < 0 ||
+	    !leasefile_test_compare(lease))
+		failed++;
+	ni_string_dup(&lease->resolver->default_domain, "example.com");
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = 1000, max_records = 64;
+	ni_addrconf_lease_t *leases[2];
+	unsigned int i;
+	int c, failed = 0;
+
+	if (ni_init("leasefile-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "n:m:")) != EOF) {
+		switch (c) {
+		case 'n':
+			if (ni_parse_uint(optarg, &count, 10) < 0 || !count)
+				return -1;
+			break;
+		case 'm':
+			if (ni_parse_uint(optarg, &max_records, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: leasefile-test [-n renews] [-m max-records]\n");
+			return -1;
+		}
+	}
+
+	/* the write removes a lease in the statedir, it has to differ */
+	if (!ni_global.config || !mkdtemp(leasefile_test_dir))
+		return -1;
+	ni_string_printf(&ni_global.config->statedir.path, "%s/run", leasefile_test_dir);
+	ni_string_dup(&ni_global.config->storedir.path, leasefile_test_dir);
+
+	leases[0] = leasefile_test_dhcp4();
+	leases[1] = leasefile_test_dhcp6();
+	for (i = 0; i < 2; ++i) {
+		failed += leasefile_test_run(leases[i], NI_CONFIG_LEASE_FILE_XML,
+						count, max_records);
+		failed += leasefile_test_run(leases[i], NI_CONFIG_LEASE_FILE_BINARY,
+						count, max_records);
+		failed += leasefile_test_run(leases[i], NI_CONFIG_LEASE_FILE_XML,
+						1, max_records);
+
+		ni_addrconf_lease_file_remove(LEASEFILE_TEST_IFNAME,
+				leases[i]->type, leases[i]->family);
+		if (ni_addrconf_lease_file_exists(LEASEFILE_TEST_IFNAME,
+				leases[i]->type, leases[i]->family))
+			failed++;
+		ni_addrconf_lease_free(leases[i]);
+	}
+	rmdir(ni_global.config->statedir.path);
+	rmdir(leasefile_test_dir);
+
+	printf("leasefile-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
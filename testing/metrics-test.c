@@ -0,0 +1,203 @@
+/*
+ * Check the runtime metrics counters of timers and subprocesses and
+ * compare the cost of the metrics updates with the cost of the code
+ * paths they instrument.
+ *
+ * Usage: metrics-test [-n iterations] [-p processes]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include "netinfo_priv.h"
+#include "process.h"
+#include "metrics.h"
+
+#define METRICS_TEST_TIMERS	1000
+
+/* keep the compiler from merging the increments of the loops */
+#define metrics_test_barrier()	__asm__ __volatile__("" ::: "memory")
+
+static void
+metrics_test_timeout(void *user_data, const ni_timer_t *timer)
+{
+	unsigned int *expired = user_data;
+
+	(*expired)++;
+}
+
+static unsigned long
+metrics_test_nsec(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000UL + now.tv_nsec - start->tv_nsec;
+}
+
+static int
+metrics_test_timers(void)
+{
+	const ni_timer_t *timers[METRICS_TEST_TIMERS];
+	uint64_t armed = ni_metrics_value[NI_METRIC_TIMERS_ARMED];
+	unsigned int i, expired = 0, failed = 0;
+
+	for (i = 0; i < METRICS_TEST_TIMERS; ++i)
+		timers[i] = ni_timer_register(i % 2 ? 60000 : 0, metrics_test_timeout, &expired);
+	if (ni_metrics_value[NI_METRIC_TIMERS_ACTIVE] != METRICS_TEST_TIMERS)
+		failed++;
+
+	/* rearm counts as armed again, the number of active timers stays */
+	for (i = 1; i < METRICS_TEST_TIMERS; i += 4)
+		ni_timer_rearm(timers[i], 30000);
+	if (ni_metrics_value[NI_METRIC_TIMERS_ACTIVE] != METRICS_TEST_TIMERS)
+		failed++;
+
+	usleep(1000);
+	ni_timer_next_timeout();
+	if (expired != METRICS_TEST_TIMERS / 2)
+		failed++;
+	if (ni_metrics_value[NI_METRIC_TIMERS_ACTIVE] != METRICS_TEST_TIMERS / 2)
+		failed++;
+
+	for (i = 1; i < METRICS_TEST_TIMERS; i += 2)
+		ni_timer_cancel(timers[i]);
+	if (ni_metrics_value[NI_METRIC_TIMERS_ACTIVE] != 0)
+		failed++;
+	if (ni_metrics_value[NI_METRIC_TIMERS_ARMED] - armed != METRICS_TEST_TIMERS * 5 / 4)
+		failed++;
+
+	printf("timers:    %llu armed, %llu active\n",
+			(unsigned long long)ni_metrics_value[NI_METRIC_TIMERS_ARMED],
+			(unsigned long long)ni_metrics_value[NI_METRIC_TIMERS_ACTIVE]);
+	return failed;
+}
+
+static int
+metrics_test_processes(unsigned int count)
+{
+	const ni_metrics_histogram_t *h = &ni_metrics_histogram[NI_METRIC_HISTOGRAM_PROCESS_RUNTIME];
+	uint64_t spawned = ni_metrics_value[NI_METRIC_PROCESSES_SPAWNED];
+	uint64_t reaped = h->count;
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+	unsigned int i, failed = 0;
+
+	if (!(cmd = ni_shellcmd_parse("/bin/true")))
+		return 1;
+
+	for (i = 0; i < count; ++i) {
+		if (!(pi = ni_process_new(cmd))) {
+			failed++;
+			break;
+		}
+		if (ni_process_run_and_wait(pi) != 0)
+			failed++;
+		ni_process_free(pi);
+	}
+	ni_shellcmd_release(cmd);
+
+	if (ni_metrics_value[NI_METRIC_PROCESSES_SPAWNED] - spawned != count)
+		failed++;
+	if (h->count - reaped != count)
+		failed++;
+
+	printf("processes: %llu spawned, %llu reaped in %llu usec\n",
+			(unsigned long long)ni_metrics_value[NI_METRIC_PROCESSES_SPAWNED],
+			(unsigned long long)h->count, (unsigned long long)h->sum);
+	return failed;
+}
+
+/*
+ * A timer register and cancel with METRICS_TEST_TIMERS pending timers
+ * updates 3 metrics values, a D-Bus method call measures its latency.
+ * Compare each with the cost of the instrumented operation.
+ */
+static int
+metrics_test_bench(unsigned int iterations)
+{
+	const ni_timer_t *timers[METRICS_TEST_TIMERS];
+	unsigned long nsec[4];
+	struct timespec start, t;
+	unsigned int i, expired = 0;
+
+	for (i = 0; i < METRICS_TEST_TIMERS; ++i)
+		timers[i] = ni_timer_register(60000 + i, metrics_test_timeout, &expired);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; ++i)
+		ni_timer_cancel(ni_timer_register(60000 + i % METRICS_TEST_TIMERS,
+						metrics_test_timeout, &expired));
+	nsec[0] = metrics_test_nsec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; ++i) {
+		ni_metrics_inc(NI_METRIC_TIMERS_ARMED);
+		ni_metrics_inc(NI_METRIC_TIMERS_ACTIVE);
+		metrics_test_barrier();
+		ni_metrics_dec(NI_METRIC_TIMERS_ACTIVE);
+		metrics_test_barrier();
+	}
+	nsec[1] = metrics_test_nsec(&start);
+
+	for (i = 0; i < METRICS_TEST_TIMERS; ++i)
+		ni_timer_cancel(timers[i]);
+
+	/* the latency measurement alone */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; ++i) {
+		ni_metrics_start(&t);
+		ni_metrics_observe_since(NI_METRIC_HISTOGRAM_DBUS_METHOD, &t);
+	}
+	nsec[2] = metrics_test_nsec(&start);
+	ni_metrics_reset();
+
+	printf("timer register+cancel: %6lu nsec/op\n", nsec[0] / iterations);
+	printf("timer metrics updates: %6lu nsec/op (%.2f%%)\n", nsec[1] / iterations,
+			100.0 * nsec[1] / nsec[0]);
+	printf("latency observation:   %6lu nsec/op\n", nsec[2] / iterations);
+
+	/* a local D-Bus round trip takes 50+ usec */
+	return nsec[1] * 20 > nsec[0] || nsec[2] / iterations > 2500;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations = 1000000, processes = 20;
+	int c, failed = 0;
+
+	if (ni_init("metrics-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "n:p:")) != EOF) {
+		switch (c) {
+		case 'n':
+			if (ni_parse_uint(optarg, &iterations, 10) < 0 || !iterations)
+				return -1;
+			break;
+		case 'p':
+			if (ni_parse_uint(optarg, &processes, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: metrics-test [-n iterations] [-p processes]\n");
+			return -1;
+		}
+	}
+
+	failed += metrics_test_timers();
+	failed += metrics_test_processes(processes);
+	failed += metrics_test_bench(iterations);
+
+	printf("metrics-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
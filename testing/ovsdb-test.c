@@ -0,0 +1,288 @@
+/*
+ * Run the ovsdb client queries and a transaction against a
+ * stand-in ovsdb-server on a temporary unix socket.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include "ovsdb.h"
+#include "ovs.h"
+#include "json.h"
+
+/*
+ * br0 with the eth0 port and the fake bridge vlan10 (tag 10, eth1 port)
+ */
+static const char *	ovsdb_test_tables =
+	"{\"Open_vSwitch\": {\"ovs\": {\"new\": {\"bridges\": [\"uuid\", \"b0\"], \"cur_cfg\": 1}}},"
+	" \"Bridge\": {\"b0\": {\"new\": {\"name\": \"br0\", \"ports\": [\"set\","
+	"   [[\"uuid\", \"p0\"], [\"uuid\", \"p1\"], [\"uuid\", \"p2\"], [\"uuid\", \"p3\"]]]}}},"
+	" \"Port\": {"
+	"  \"p0\": {\"new\": {\"name\": \"br0\", \"tag\": [\"set\", []], \"fake_bridge\": false}},"
+	"  \"p1\": {\"new\": {\"name\": \"eth0\", \"tag\": [\"set\", []], \"fake_bridge\": false}},"
+	"  \"p2\": {\"new\": {\"name\": \"vlan10\", \"tag\": 10, \"fake_bridge\": true}},"
+	"  \"p3\": {\"new\": {\"name\": \"eth1\", \"tag\": 10, \"fake_bridge\": false}}}}";
+
+static ni_json_t *
+ovsdb_test_recv(int fd)
+{
+	static char buf[65536];
+	static size_t len;
+	size_t i, depth = 0;
+	ni_bool_t string = FALSE;
+	ni_json_t *msg;
+	ssize_t ret;
+	char save;
+
+	for (;;) {
+		/* the stand-in does not expect escapes in strings */
+		for (i = 0; i < len; ++i) {
+			if (buf[i] == '"')
+				string = !string;
+			else if (!string && buf[i] == '{')
+				depth++;
+			else if (!string && buf[i] == '}' && --depth == 0)
+				break;
+		}
+		if (i < len) {
+			save = buf[++i];
+			buf[i] = '\0';
+			msg = ni_json_parse_string(buf);
+			buf[i] = save;
+			memmove(buf, buf + i, len - i);
+			len -= i;
+			return msg;
+		}
+		string = FALSE;
+		depth = 0;
+		if (len >= sizeof(buf))
+			return NULL;
+		if ((ret = recv(fd, buf + len, sizeof(buf) - len, 0)) <= 0)
+			return NULL;
+		len += ret;
+	}
+}
+
+static void
+ovsdb_test_send(int fd, const ni_json_t *msg)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+
+	ni_json_format_string(&buf, msg, NULL);
+	if (send(fd, buf.string, buf.len, 0) < 0)
+		_exit(1);
+	ni_stringbuf_destroy(&buf);
+}
+
+static void
+ovsdb_test_reply(int fd, ni_json_t *req, ni_json_t *result)
+{
+	ni_json_t *reply = ni_json_new_object();
+
+	ni_json_object_set(reply, "id", ni_json_clone(ni_json_object_get_value(req, "id")));
+	ni_json_object_set(reply, "result", result);
+	ni_json_object_set(reply, "error", ni_json_new_null());
+	ovsdb_test_send(fd, reply);
+	ni_json_free(reply);
+}
+
+static void
+ovsdb_test_transact(int fd, ni_json_t *req)
+{
+	ni_json_t *params = ni_json_object_get_value(req, "params");
+	ni_json_t *result = ni_json_new_array();
+	ni_json_t *bridges = ni_json_new_object();
+	ni_json_t *update, *tables, *row, *op, *rows;
+	unsigned int i, n = ni_json_array_entries(params);
+	char *uuid = NULL;
+
+	for (i = 1; i < n; ++i) {
+		op = ni_json_array_get(params, i);
+		if (ni_string_eq(ni_json_string_value(ni_json_object_get_value(op, "op")), "select")) {
+			row = ni_json_new_object();
+			ni_json_object_set(row, "next_cfg", ni_json_new_int64(2));
+			rows = ni_json_new_object();
+			ni_json_object_set(rows, "rows", ni_json_new_array());
+			ni_json_array_append(ni_json_object_get_value(rows, "rows"), row);
+			ni_json_array_append(result, rows);
+			continue;
+		}
+		if (ni_string_eq(ni_json_string_value(ni_json_object_get_value(op, "table")), "Bridge") &&
+		    (row = ni_json_object_get_value(op, "row"))) {
+			ni_string_printf(&uuid, "new%u", i);
+			update = ni_json_new_object();
+			ni_json_object_set(update, "new", ni_json_clone(row));
+			ni_json_object_set(bridges, uuid, update);
+		}
+		ni_json_array_append(result, ni_json_new_object());
+	}
+	ovsdb_test_reply(fd, req, result);
+
+	/* ovs-vswitchd applied the changes */
+	row = ni_json_new_object();
+	ni_json_object_set(row, "cur_cfg", ni_json_new_int64(2));
+	update = ni_json_new_object();
+	ni_json_object_set(update, "new", row);
+	tables = ni_json_new_object();
+	ni_json_object_set(tables, "ovs", update);
+	update = ni_json_new_object();
+	ni_json_object_set(update, "Open_vSwitch", tables);
+	ni_json_object_set(update, "Bridge", bridges);
+
+	params = ni_json_new_array();
+	ni_json_array_append(params, ni_json_new_null());
+	ni_json_array_append(params, update);
+	req = ni_json_new_object();
+	ni_json_object_set(req, "method", ni_json_new_string("update"));
+	ni_json_object_set(req, "params", params);
+	ni_json_object_set(req, "id", ni_json_new_null());
+	ovsdb_test_send(fd, req);
+	ni_json_free(req);
+	ni_string_free(&uuid);
+}
+
+static void
+ovsdb_test_server(int lfd)
+{
+	const char *method;
+	ni_json_t *msg, *echo;
+	int fd;
+
+	while ((fd = accept(lfd, NULL, NULL)) >= 0) {
+		/* the client has to answer echo requests at any time */
+		echo = ni_json_parse_string("{\"method\": \"echo\", \"params\": [], \"id\": \"echo\"}");
+		ovsdb_test_send(fd, echo);
+		ni_json_free(echo);
+
+		while ((msg = ovsdb_test_recv(fd))) {
+			method = ni_json_string_value(ni_json_object_get_value(msg, "method"));
+			if (ni_string_eq(method, "monitor"))
+				ovsdb_test_reply(fd, msg, ni_json_parse_string(ovsdb_test_tables));
+			else
+			if (ni_string_eq(method, "transact"))
+				ovsdb_test_transact(fd, msg);
+			ni_json_free(msg);
+		}
+		close(fd);
+	}
+	_exit(0);
+}
+
+static int
+ovsdb_test_ports(const char *brname, const char *expected)
+{
+	ni_ovs_bridge_port_array_t ports;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i;
+	int failed;
+
+	ni_ovs_bridge_port_array_init(&ports);
+	failed = ni_ovsdb_bridge_ports(brname, &ports) != NI_OVSDB_SUCCESS;
+	for (i = 0; i < ports.count; ++i)
+		ni_stringbuf_printf(&buf, "%s%s", i ? " " : "", ports.data[i]->device.name);
+	if (!ni_string_eq(buf.string, expected))
+		failed = 1;
+	printf("list-ports %s: %s\n", brname, buf.string);
+	ni_stringbuf_destroy(&buf);
+	ni_ovs_bridge_port_array_destroy(&ports);
+	return failed;
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/ovsdb-test.XXXXXX";
+	struct sockaddr_un sun;
+	ni_ovsdb_txn_t *txn;
+	char *name = NULL;
+	uint16_t vlan = 0;
+	int lfd, failed = 0;
+	pid_t pid;
+
+	if (ni_init("ovsdb-test") < 0 || !mkdtemp(dir))
+		return -1;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	snprintf(sun.sun_path, sizeof(sun.sun_path), "%s/db.sock", dir);
+	if ((lfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+	    bind(lfd, (struct sockaddr *)&sun, sizeof(sun)) < 0 ||
+	    listen(lfd, 1) < 0)
+		return -1;
+
+	if ((pid = fork()) == 0)
+		ovsdb_test_server(lfd);
+	close(lfd);
+
+	if (!ni_ovsdb_open(sun.sun_path)) {
+		printf("ovsdb-test: unable to connect\n");
+		failed++;
+		goto done;
+	}
+
+	if (ni_ovsdb_bridge_exists("br0") != NI_OVSDB_SUCCESS ||
+	    ni_ovsdb_bridge_exists("vlan10") != NI_OVSDB_SUCCESS ||
+	    ni_ovsdb_bridge_exists("eth0") != NI_OVSDB_NOT_FOUND)
+		failed++;
+
+	if (ni_ovsdb_bridge_to_vlan("vlan10", &vlan) || vlan != 10)
+		failed++;
+	if (ni_ovsdb_bridge_to_parent("vlan10", &name) || !ni_string_eq(name, "br0"))
+		failed++;
+	printf("br-to-parent vlan10: %s, br-to-vlan: %u\n", name, vlan);
+	ni_string_free(&name);
+
+	if (ni_ovsdb_bridge_to_vlan("br0", &vlan) || vlan != 0 ||
+	    ni_ovsdb_bridge_to_parent("br0", &name) || name)
+		failed++;
+
+	failed += ovsdb_test_ports("br0", "eth0");
+	failed += ovsdb_test_ports("vlan10", "eth1");
+
+	if (ni_ovsdb_port_to_bridge("eth1", &name) || !ni_string_eq(name, "vlan10"))
+		failed++;
+	printf("port-to-br eth1: %s\n", name);
+	ni_string_free(&name);
+
+	/* ovs-vsctl wrappers use the connection */
+	if (ni_ovs_vsctl_bridge_exists("br0") != 0)
+		failed++;
+
+	if (!(txn = ni_ovsdb_txn_new()) ||
+	    !ni_ovsdb_txn_bridge_add(txn, "br1", NULL, 0, FALSE) ||
+	    !ni_ovsdb_txn_port_add(txn, "br1", "eth2", FALSE) ||
+	    !ni_ovsdb_txn_bridge_add(txn, "br0", NULL, 0, TRUE) ||
+	    ni_ovsdb_txn_commit(txn) != NI_OVSDB_SUCCESS)
+		failed++;
+	ni_ovsdb_txn_free(txn);
+
+	if (ni_ovsdb_bridge_exists("br1") != NI_OVSDB_SUCCESS)
+		failed++;
+	printf("add-br br1: %s\n", ni_ovsdb_bridge_exists("br1") ? "missing" : "exists");
+
+	txn = ni_ovsdb_txn_new();
+	if (!txn || ni_ovsdb_txn_port_add(txn, "br0", "eth1", FALSE) ||
+	    ni_ovsdb_txn_commit(txn) != NI_OVSDB_FAILURE)
+		failed++;
+	ni_ovsdb_txn_free(txn);
+
+	ni_ovsdb_close();
+done:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	unlink(sun.sun_path);
+	rmdir(dir);
+
+	printf("ovsdb-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
@@ -0,0 +1,224 @@
+/*
+ * Check the recovery of the server state from a journal snapshot and
+ * the journal records appended to it: records of the snapshot generation
+ * are merged, stale records of an older generation and a torn record at
+ * the end of the journal are ignored.
+ *
+ * Usage: state-test
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include <wicked/objectmodel.h>
+
+#define STATE_TEST_OBJECT(n)	"/org/opensuse/Network/Interface/" #n
+
+static char			state_test_file[PATH_MAX];
+static char			state_test_journal[PATH_MAX];
+
+static ni_bool_t
+state_test_write(const char *path, const char *data)
+{
+	FILE *fp;
+	ni_bool_t rv;
+
+	if (!(fp = fopen(path, "we")))
+		return FALSE;
+	rv = fputs(data, fp) >= 0;
+	return fclose(fp) == 0 && rv;
+}
+
+/*
+ * Append a journal record as ni_objectmodel_state_journal_flush does
+ */
+static void
+state_test_record(ni_stringbuf_t *journal, const char *record)
+{
+	ni_stringbuf_printf(journal, "@%zu\n%s", strlen(record), record);
+}
+
+static const xml_node_t *
+state_test_object(const xml_document_t *doc, const char *path)
+{
+	const xml_node_t *node;
+
+	for (node = doc->root->children; node; node = node->next) {
+		if (ni_string_eq(xml_node_get_attr(node, "path"), path))
+			return node;
+	}
+	return NULL;
+}
+
+static const char *
+state_test_address(const xml_document_t *doc, const char *path)
+{
+	const xml_node_t *node;
+
+	if (!(node = state_test_object(doc, path)))
+		return NULL;
+	if (!(node = xml_node_get_child(node, "ipv4")))
+		return NULL;
+	if (!(node = xml_node_get_child(node, "address")))
+		return NULL;
+	return node->cdata;
+}
+
+static unsigned int
+state_test_count(const xml_document_t *doc)
+{
+	const xml_node_t *node;
+	unsigned int count = 0;
+
+	for (node = doc->root->children; node; node = node->next)
+		count++;
+	return count;
+}
+
+static xml_document_t *
+state_test_read(const char *state, const ni_stringbuf_t *journal)
+{
+	if (!state_test_write(state_test_file, state) ||
+	    !state_test_write(state_test_journal, journal->string ? journal->string : ""))
+		return NULL;
+	return ni_objectmodel_state_read(state_test_file);
+}
+
+/*
+ * Records of the snapshot generation are merged, older ones are not;
+ * the replay ends at the torn record.
+ */
+static int
+state_test_replay(void)
+{
+	ni_stringbuf_t journal = NI_STRINGBUF_INIT_DYNAMIC;
+	xml_document_t *doc;
+	int failed = 0;
+
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(1) "\" generation=\"100\">"
+		"<ipv4><address>10.0.0.2</address></ipv4></object>\n");
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(2) "\" generation=\"99\" deleted=\"true\"/>\n");
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(3) "\" generation=\"100\">"
+		"<ipv4><address>10.0.0.3</address></ipv4></object>\n");
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(2) "\" generation=\"100\">"
+		"<ipv4/></object>\n");
+	ni_stringbuf_printf(&journal, "@200\n<object path=\"" STATE_TEST_OBJECT(1) "\" deleted=");
+
+	doc = state_test_read(
+		"<snapshot generation=\"100\">\n"
+		"  <object path=\"" STATE_TEST_OBJECT(1) "\">"
+		"<ipv4><address>10.0.0.1</address></ipv4></object>\n"
+		"  <object path=\"" STATE_TEST_OBJECT(2) "\">"
+		"<ipv4><address>10.0.1.1</address></ipv4></object>\n"
+		"</snapshot>\n", &journal);
+
+	if (!doc) {
+		failed++;
+	} else {
+		if (!ni_string_eq(state_test_address(doc, STATE_TEST_OBJECT(1)), "10.0.0.2"))
+			failed++;
+		if (!ni_string_eq(state_test_address(doc, STATE_TEST_OBJECT(3)), "10.0.0.3"))
+			failed++;
+		if (!state_test_object(doc, STATE_TEST_OBJECT(2)) ||
+		    state_test_address(doc, STATE_TEST_OBJECT(2)))
+			failed++;
+		if (state_test_count(doc) != 3)
+			failed++;
+	}
+
+	xml_document_free(doc);
+	ni_stringbuf_destroy(&journal);
+	printf("replay: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
+
+/*
+ * A compaction wrote a snapshot of a new generation without objects,
+ * but the journal was not truncated: none of its records apply.
+ */
+static int
+state_test_compacted(void)
+{
+	ni_stringbuf_t journal = NI_STRINGBUF_INIT_DYNAMIC;
+	xml_document_t *doc;
+	int failed = 0;
+
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(1) "\" generation=\"100\">"
+		"<ipv4><address>10.0.0.1</address></ipv4></object>\n");
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(1) "\" generation=\"100\" deleted=\"true\"/>\n");
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(2) "\" generation=\"100\">"
+		"<ipv4><address>10.0.1.1</address></ipv4></object>\n");
+
+	doc = state_test_read("<snapshot generation=\"101\"/>\n", &journal);
+	if (!doc || state_test_count(doc) != 0)
+		failed++;
+
+	xml_document_free(doc);
+	ni_stringbuf_destroy(&journal);
+	printf("compacted: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
+
+/*
+ * A state file saved without the journal is not a snapshot of it.
+ */
+static int
+state_test_plain(void)
+{
+	ni_stringbuf_t journal = NI_STRINGBUF_INIT_DYNAMIC;
+	xml_document_t *doc;
+	int failed = 0;
+
+	state_test_record(&journal,
+		"<object path=\"" STATE_TEST_OBJECT(1) "\" generation=\"100\" deleted=\"true\"/>\n");
+
+	doc = state_test_read(
+		"<object path=\"" STATE_TEST_OBJECT(1) "\">"
+		"<ipv4><address>10.0.0.1</address></ipv4></object>\n", &journal);
+	if (!doc || state_test_count(doc) != 1 ||
+	    !ni_string_eq(state_test_address(doc, STATE_TEST_OBJECT(1)), "10.0.0.1"))
+		failed++;
+
+	xml_document_free(doc);
+	ni_stringbuf_destroy(&journal);
+	printf("plain: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	char dir[] = "/tmp/state-test.XXXXXX";
+	int failed = 0;
+
+	if (!mkdtemp(dir))
+		return 1;
+	snprintf(state_test_file, sizeof(state_test_file), "%s/state.xml", dir);
+	snprintf(state_test_journal, sizeof(state_test_journal), "%s/state.xml.journal", dir);
+
+	failed += state_test_replay();
+	failed += state_test_compacted();
+	failed += state_test_plain();
+
+	unlink(state_test_journal);
+	unlink(state_test_file);
+	rmdir(dir);
+
+	printf("state-test: %s\n", failed ? "FAILED" : "OK");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Compare the indexed sysconfig variable lookups with the plain
+ * array scan and time both on a large synthetic ifcfg file.
+ *
+ * Usage: sysconfig-test [number of addresses]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/sysconfig.h>
+#include <wicked/socket.h>
+
+static const char *	sysconfig_test_suffixes[] = {
+	"IPADDR", "PREFIXLEN", "LABEL", "BROADCAST", "REMOTE_IPADDR", NULL
+};
+
+static ni_bool_t
+sysconfig_test_write(const char *filename, unsigned int count)
+{
+	const char **name;
+	unsigned int i;
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "w")))
+		return FALSE;
+
+	fprintf(fp, "# synthetic ifcfg file\nBOOTPROTO='static'\nSTARTMODE='auto'\n");
+	for (i = 0; i < count; ++i) {
+		for (name = sysconfig_test_suffixes; *name; ++name)
+			fprintf(fp, "%s_%u='%u'\n", *name, i, i);
+		fprintf(fp, "ETHTOOL_OPTIONS_%u=''\n", i);
+	}
+	return fclose(fp) == 0;
+}
+
+static unsigned long
+sysconfig_test_usec(const struct timeval *start)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	return delta.tv_sec * 1000000 + delta.tv_usec;
+}
+
+/* the lookups of __get_ipaddr for every suffix, plus some misses */
+static unsigned long
+sysconfig_test_lookups(const ni_var_array_t *vars, unsigned int count, unsigned int *hits)
+{
+	struct timeval start;
+	const char **name;
+	char buf[64];
+	unsigned int i;
+
+	*hits = 0;
+	ni_timer_get_time(&start);
+	for (i = 0; i < count + count / 2; ++i) {
+		for (name = sysconfig_test_suffixes; *name; ++name) {
+			snprintf(buf, sizeof(buf), "%s_%u", *name, i);
+			if (ni_var_array_get(vars, buf))
+				(*hits)++;
+		}
+	}
+	return sysconfig_test_usec(&start);
+}
+
+static int
+sysconfig_test_compare(ni_sysconfig_t *sc, const ni_var_array_t *plain)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	ni_uint_array_t a = NI_UINT_ARRAY_INIT;
+	ni_uint_array_t b = NI_UINT_ARRAY_INIT;
+	const char *prefixes[] = { "", "IPADDR", "IPADDR_1", "LABEL_", "X", "ETHTOOL", NULL };
+	unsigned int i, failed = 0;
+	const ni_var_t *var;
+
+	for (i = 0; i < plain->count; ++i) {
+		var = ni_sysconfig_get(sc, plain->data[i].name);
+		if (!var || var != &sc->vars.data[i])
+			failed++;
+	}
+	if (ni_sysconfig_get(sc, "IPADDR_") || ni_sysconfig_get(sc, "IPADDR_1_"))
+		failed++;
+
+	for (i = 0; prefixes[i]; ++i) {
+		ni_var_array_find_prefix(&sc->vars, prefixes[i], &a);
+		ni_var_array_find_prefix(plain, prefixes[i], &b);
+		if (a.count != b.count || memcmp(a.data, b.data, a.count * sizeof(a.data[0]))) {
+			printf("prefix %s: %u != %u matches\n", prefixes[i], a.count, b.count);
+			failed++;
+		}
+		ni_uint_array_destroy(&a);
+		ni_uint_array_destroy(&b);
+	}
+
+	/* empty values are not matching */
+	ni_sysconfig_find_matching(sc, "ETHTOOL_OPTIONS", &names);
+	if (names.count)
+		failed++;
+	ni_string_array_destroy(&names);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	char filename[] = "/tmp/sysconfig-test.XXXXXX";
+	ni_var_array_t plain = NI_VAR_ARRAY_INIT;
+	unsigned int count = 1000, hits[2];
+	unsigned long usec[2];
+	ni_sysconfig_t *sc;
+	int fd, failed = 0;
+
+	if (ni_init("sysconfig-test") < 0)
+		return -1;
+	if (argc > 1 && (ni_parse_uint(argv[1], &count, 10) < 0 || !count))
+		return -1;
+
+	if ((fd = mkstemp(filename)) < 0)
+		return -1;
+	close(fd);
+	if (!sysconfig_test_write(filename, count) || !(sc = ni_sysconfig_read(filename))) {
+		unlink(filename);
+		return -1;
+	}
+	unlink(filename);
+
+	ni_var_array_copy(&plain, &sc->vars);
+	failed += sysconfig_test_compare(sc, &plain);
+
+	/* index is rebuilt after a removal */
+	ni_sysconfig_set(sc, "IPADDR_0", NULL);
+	ni_var_array_remove(&sc->vars, "IPADDR_0");
+	ni_var_array_remove(&plain, "IPADDR_0");
+	ni_sysconfig_set(sc, "IPADDR_X", "x");
+	ni_var_array_set(&plain, "IPADDR_X", "x");
+	failed += sysconfig_test_compare(sc, &plain);
+
+	usec[0] = sysconfig_test_lookups(&plain, count, &hits[0]);
+	usec[1] = sysconfig_test_lookups(&sc->vars, count, &hits[1]);
+	if (hits[0] != hits[1])
+		failed++;
+
+	printf("%u variables, %u lookups, %u hits\n", plain.count,
+			(count + count / 2) * 5, hits[1]);
+	printf("array scan: %8lu usec\n", usec[0]);
+	printf("indexed:    %8lu usec\n", usec[1]);
+
+	ni_var_array_destroy(&plain);
+	ni_sysconfig_destroy(sc);
+
+	printf("sysconfig-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
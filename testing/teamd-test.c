@@ -4,15 +4,162 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <wicked/types.h>
 #include <wicked/netinfo.h>
+#include <wicked/team.h>
 
 #include "teamd.h"
 #include "json.h"
 #include "appconfig.h"
 
+/*
+ * Fake teamd unix control socket server
+ */
+static const char *	usock_test_config =
+	"{\"device\": \"%s\", \"runner\": {\"name\": \"activebackup\"}, "
+	"\"ports\": {\"eth0\": {\"prio\": 10}, \"eth1\": {\"prio\": -10}}}";
+
+#define USOCK_TEST_REPLY_MAX	16384
+
+static void
+usock_test_server(int lfd, const char *ifname)
+{
+	char buf[4096], *method, *arg, *end;
+	char reply[USOCK_TEST_REPLY_MAX];
+	unsigned int size;
+	ssize_t len;
+	int fd;
+
+	while ((fd = accept(lfd, NULL, NULL)) >= 0) {
+		while ((len = recv(fd, buf, sizeof(buf) - 1, 0)) > 0) {
+			buf[len] = '\0';
+			method = strchr(buf, '\n');
+			if (strncmp(buf, "REQUEST\n", 8) || !method++)
+				break;
+			if ((arg = strchr(method, '\n')))
+				*arg++ = '\0';
+			if (arg && (end = strchr(arg, '\n')))
+				*end = '\0';
+
+			if (!strcmp(method, "ConfigDumpActual")) {
+				len = snprintf(reply, sizeof(reply), "REPLY_SUCCESS\n");
+				snprintf(reply + len, sizeof(reply) - len, usock_test_config, ifname);
+			} else
+			if (!strcmp(method, "StateItemValueGet") && arg && !strcmp(arg, "setup.kernel_team_mode_name"))
+				snprintf(reply, sizeof(reply), "REPLY_SUCCESS\nactivebackup\n");
+			else
+			if (!strcmp(method, "StateItemValueGet") && arg &&
+			    sscanf(arg, "test.reply_size.%u", &size) == 1 &&
+			    size > sizeof("REPLY_SUCCESS\n") && size < sizeof(reply)) {
+				/* a reply of exactly size bytes */
+				len = snprintf(reply, sizeof(reply), "REPLY_SUCCESS\n");
+				memset(reply + len, 'x', size - len);
+				reply[size] = '\0';
+			} else
+			if (!strcmp(method, "PortAdd") && arg && !strcmp(arg, "eth2"))
+				snprintf(reply, sizeof(reply), "REPLY_SUCCESS\n");
+			else
+				snprintf(reply, sizeof(reply), "REPLY_ERROR\nNoSuchMethod\n%s failed\n", method);
+
+			if (send(fd, reply, strlen(reply), 0) < 0)
+				break;
+		}
+		close(fd);
+	}
+	_exit(0);
+}
+
+static ni_bool_t
+usock_test_reply_size(ni_teamd_client_t *tdc, unsigned int size)
+{
+	char item[64], *val = NULL;
+	ni_bool_t ok;
+
+	snprintf(item, sizeof(item), "test.reply_size.%u", size);
+	ok = !ni_teamd_ctl_state_get_item(tdc, item, &val) &&
+		ni_string_len(val) == size - sizeof("REPLY_SUCCESS\n") + 1;
+	printf("reply-size %u: %s\n", size, ok ? "OK" : "FAILED");
+	ni_string_free(&val);
+	return ok;
+}
+
+static int
+usock_test(const char *ifname)
+{
+	char dir[] = "/tmp/teamd-test.XXXXXX";
+	struct sockaddr_un sun;
+	ni_teamd_client_t *tdc;
+	ni_netdev_t *dev;
+	char *val = NULL;
+	int lfd, failed = 0;
+	pid_t pid;
+
+	if (!mkdtemp(dir))
+		return -1;
+	ni_config_teamd_enable(NI_CONFIG_TEAMD_CTL_UNIX);
+	ni_string_dup(&ni_global.config->teamd.socket_dir, dir);
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	snprintf(sun.sun_path, sizeof(sun.sun_path), "%s/%s.sock", dir, ifname);
+	if ((lfd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0 ||
+	    bind(lfd, (struct sockaddr *)&sun, sizeof(sun)) < 0 ||
+	    listen(lfd, 1) < 0)
+		return -1;
+
+	if ((pid = fork()) == 0)
+		usock_test_server(lfd, ifname);
+	close(lfd);
+
+	tdc = ni_teamd_client_open(ifname);
+	if (ni_teamd_ctl_state_get_item(tdc, "setup.kernel_team_mode_name", &val) ||
+	    !ni_string_eq(val, "activebackup"))
+		failed++;
+	printf("state-item-get: %s\n", val);
+
+	if (ni_teamd_ctl_port_add(tdc, "eth2"))
+		failed++;
+	if (!ni_teamd_ctl_port_add(tdc, "eth3"))
+		failed++;
+
+	/* replies filling the former 4096 byte read buffer exactly and beyond */
+	if (!usock_test_reply_size(tdc, 4096))
+		failed++;
+	if (!usock_test_reply_size(tdc, 4096 * 2))
+		failed++;
+	if (!usock_test_reply_size(tdc, 4096 + 100))
+		failed++;
+	ni_teamd_client_free(tdc);
+
+	dev = ni_netdev_new(ifname, 0);
+	dev->link.type = NI_IFTYPE_TEAM;
+	if (ni_teamd_discover(dev) || !dev->team ||
+	    dev->team->runner.type != NI_TEAM_RUNNER_ACTIVE_BACKUP ||
+	    dev->team->ports.count != 2)
+		failed++;
+	else
+		printf("discover: runner %s, %u ports\n",
+			ni_team_runner_type_to_name(dev->team->runner.type),
+			dev->team->ports.count);
+	ni_netdev_put(dev);
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	unlink(sun.sun_path);
+	rmdir(dir);
+	ni_string_free(&val);
+
+	printf("usock-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
+
 int main(int argc, char **argv)
 {
 	ni_teamd_client_t *tdc;
@@ -31,6 +178,9 @@ int main(int argc, char **argv)
 
 	if (ni_init("teamd-test") < 0)
 		return -1;
+	if (ni_string_eq(command, "usock-test"))
+		return usock_test(argv[1]);
+
 	ni_config_teamd_enable(NI_CONFIG_TEAMD_CTL_DETECT_ONCE);
 
 	tdc = ni_teamd_client_open(argv[1]);
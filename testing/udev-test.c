@@ -0,0 +1,93 @@
+/*
+ * Compare the udev database reader with "udevadm info" output
+ * for all (or the given) network devices.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <net/if.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include "udev-utils.h"
+
+static const char *	udev_test_keys[] = {
+	"SUBSYSTEM", "INTERFACE", "IFINDEX", "INTERFACE_OLD", "TAGS", NULL
+};
+
+static const char *
+udev_test_value(const ni_var_array_t *vars, const char *name)
+{
+	const ni_var_t *var = vars ? ni_var_array_get(vars, name) : NULL;
+
+	return var ? var->value : NULL;
+}
+
+static int
+udev_test_netdev(const char *ifname)
+{
+	char path[PATH_MAX];
+	ni_var_array_t *native = NULL;
+	ni_var_array_t *udevadm = NULL;
+	unsigned int ifindex;
+	const char **key;
+	int ret, failed = 0;
+
+	if (!(ifindex = if_nametoindex(ifname))) {
+		printf("%s: no such device\n", ifname);
+		return 1;
+	}
+
+	ret = ni_udev_netdev_info(&native, ifname, ifindex);
+	printf("%s[%u]: udev info: %d\n", ifname, ifindex, ret);
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s", ifname);
+	ret = ni_udevadm_info(&udevadm, "all", path);
+	if (ret) {
+		printf("%s[%u]: udevadm info: %d, skipped\n", ifname, ifindex, ret);
+		goto cleanup;
+	}
+
+	for (key = udev_test_keys; *key; ++key) {
+		const char *n = udev_test_value(native, *key);
+		const char *u = udev_test_value(udevadm, *key);
+
+		printf("%s[%u]: %-14s %s '%s' '%s'\n", ifname, ifindex, *key,
+				ni_string_eq(n, u) ? "OK  " : "FAIL", n, u);
+		if (!ni_string_eq(n, u))
+			failed++;
+	}
+
+cleanup:
+	ni_var_array_list_destroy(&native);
+	ni_var_array_list_destroy(&udevadm);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	struct dirent *d;
+	int failed = 0;
+	DIR *dir;
+
+	if (argc > 1) {
+		while (--argc)
+			failed += udev_test_netdev(*++argv);
+		return failed ? 1 : 0;
+	}
+
+	if (!(dir = opendir("/sys/class/net")))
+		return 1;
+	while ((d = readdir(dir))) {
+		if (d->d_name[0] == '.' || ni_string_eq(d->d_name, "bonding_masters"))
+			continue;
+		failed += udev_test_netdev(d->d_name);
+	}
+	closedir(dir);
+
+	return failed ? 1 : 0;
+}
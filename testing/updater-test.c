@@ -0,0 +1,361 @@
+/*
+ * Apply the resolver and hostname settings of a number of DHCP leases
+ * and remove them again through the system updaters, once with update
+ * scripts and once with the builtin updaters, and count the processes
+ * spawned for it.
+ *
+ * The scripts only log their calls, the builtin updaters modify the
+ * system: the test runs in own mount and uts namespaces with a temp
+ * file bind-mounted over /etc/resolv.conf and requires root.
+ *
+ * Usage: updater-test [-n leases] [-w batch-window msec]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <wicked/util.h>
+#include <wicked/netinfo.h>
+#include <wicked/addrconf.h>
+#include <wicked/resolver.h>
+#include <wicked/system.h>
+#include <wicked/socket.h>
+#include "netinfo_priv.h"
+#include "appconfig.h"
+
+#define UPDATER_TEST_ORIGINAL	"# original resolv.conf\n"
+
+static char	updater_test_dir[] = "/tmp/updater-test.XXXXXX";
+
+static unsigned long
+updater_test_msec(const struct timeval *start)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	return delta.tv_sec * 1000 + delta.tv_usec / 1000;
+}
+
+static ni_bool_t
+updater_test_write(const char *filename, const char *data, unsigned int mode)
+{
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "w")))
+		return FALSE;
+	fputs(data, fp);
+	fchmod(fileno(fp), mode);
+	return fclose(fp) == 0;
+}
+
+static unsigned int
+updater_test_count_spawns(void)
+{
+	char line[256];
+	unsigned int count = 0;
+	char *filename = NULL;
+	FILE *fp;
+
+	ni_string_printf(&filename, "%s/spawns", updater_test_dir);
+	if ((fp = fopen(filename, "r"))) {
+		while (fgets(line, sizeof(line), fp))
+			count++;
+		fclose(fp);
+	}
+	ni_string_free(&filename);
+	return count;
+}
+
+static void
+updater_test_config_updater(ni_stringbuf_t *conf, const char *name, ni_bool_t builtin)
+{
+	static const char *actions[] = { "backup", "restore", "install", "remove", NULL };
+	const char **action;
+
+	ni_stringbuf_printf(conf, "  <system-updater name=\"%s\">\n", name);
+	for (action = actions; *action; ++action) {
+		if (builtin)
+			ni_stringbuf_printf(conf, "    <builtin name=\"%s\" "
+					"symbol=\"ni_system_updater_%s_%s\"/>\n",
+					*action, name, *action);
+		else
+			ni_stringbuf_printf(conf, "    <action name=\"%s\" "
+					"command=\"%s/updater.sh %s %s\"/>\n",
+					*action, updater_test_dir, name, *action);
+	}
+	ni_stringbuf_printf(conf, "  </system-updater>\n");
+}
+
+static ni_bool_t
+updater_test_config(ni_bool_t builtin, unsigned int window)
+{
+	ni_stringbuf_t conf = NI_STRINGBUF_INIT_DYNAMIC;
+	char *filename = NULL;
+	ni_config_t *config;
+	ni_bool_t ret;
+
+	ni_stringbuf_printf(&conf, "<config>\n");
+	ni_stringbuf_printf(&conf, "  <statedir path=\"%s/%s\" mode=\"0755\"/>\n",
+					updater_test_dir, builtin ? "builtin" : "scripts");
+	ni_stringbuf_printf(&conf, "  <storedir path=\"%s\" mode=\"0755\"/>\n", updater_test_dir);
+	ni_stringbuf_printf(&conf, "  <addrconf><updater><batch-window>%u</batch-window>"
+					"</updater></addrconf>\n", window);
+	updater_test_config_updater(&conf, "resolver", builtin);
+	updater_test_config_updater(&conf, "hostname", builtin);
+	ni_stringbuf_printf(&conf, "</config>\n");
+
+	ni_string_printf(&filename, "%s/config.xml", updater_test_dir);
+	ret = updater_test_write(filename, conf.string, 0644);
+	ni_stringbuf_destroy(&conf);
+
+	if (ret && (config = ni_config_parse(filename, NULL, NULL))) {
+		ni_config_free(ni_global.config);
+		ni_global.config = config;
+	} else {
+		ret = FALSE;
+	}
+	ni_string_free(&filename);
+	return ret;
+}
+
+static ni_addrconf_lease_t *
+updater_test_lease(unsigned int i)
+{
+	ni_addrconf_lease_t *lease;
+	char buf[64];
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+	lease->state = NI_ADDRCONF_STATE_GRANTED;
+	ni_addrconf_update_set(&lease->update, NI_ADDRCONF_UPDATE_DNS, TRUE);
+	ni_addrconf_update_set(&lease->update, NI_ADDRCONF_UPDATE_HOSTNAME, TRUE);
+
+	snprintf(buf, sizeof(buf), "host%u.example.com", i);
+	ni_string_dup(&lease->hostname, buf);
+
+	lease->resolver = ni_resolver_info_new();
+	ni_string_dup(&lease->resolver->default_domain, "example.com");
+	snprintf(buf, sizeof(buf), "10.%u.%u.1", (i >> 8) & 0xff, i & 0xff);
+	ni_string_array_append(&lease->resolver->dns_servers, buf);
+	return lease;
+}
+
+/*
+ * Call the updaters of all leases like their updater timers would do,
+ * until all of them finished.
+ */
+static ni_bool_t
+updater_test_drive(ni_addrconf_lease_t **leases, unsigned int count)
+{
+	unsigned int i, pending, timeout;
+	struct timeval start;
+	char ifname[IFNAMSIZ];
+
+	ni_timer_get_time(&start);
+	do {
+		pending = 0;
+		timeout = 100;
+		for (i = 0; i < count; ++i) {
+			snprintf(ifname, sizeof(ifname), "updt%u", i);
+			if (ni_system_update_from_lease(leases[i], i + 1, ifname) != 1)
+				continue;
+
+			pending++;
+			if (leases[i]->updater->timeout && leases[i]->updater->timeout < timeout)
+				timeout = leases[i]->updater->timeout;
+		}
+		if (pending)
+			ni_socket_wait(timeout);
+	} while (pending && updater_test_msec(&start) < 60000);
+
+	return pending == 0;
+}
+
+static ni_bool_t
+updater_test_check_file(const char *filename, const char *data)
+{
+	char buf[1024];
+	size_t len;
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "r")))
+		return FALSE;
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	buf[len] = '\0';
+	return strstr(buf, data) != NULL;
+}
+
+static int
+updater_test_run(ni_bool_t builtin, unsigned int count, unsigned int window)
+{
+	ni_addrconf_lease_t **leases;
+	unsigned long msec[2];
+	struct timeval start;
+	unsigned int i, base, spawns[2], failed = 0;
+	char hostname[256], *statedir = NULL;
+
+	ni_string_printf(&statedir, "%s/%s", updater_test_dir, builtin ? "builtin" : "scripts");
+	if (mkdir(statedir, 0755) < 0 || !updater_test_config(builtin, window)) {
+		ni_string_free(&statedir);
+		return 1;
+	}
+	ni_string_free(&statedir);
+
+	leases = calloc(count, sizeof(*leases));
+	for (i = 0; i < count; ++i) {
+		leases[i] = updater_test_lease(i);
+		ni_addrconf_updater_new_applying(leases[i], NULL, NI_EVENT_ADDRESS_ACQUIRED);
+	}
+
+	base = updater_test_count_spawns();
+	ni_timer_get_time(&start);
+	if (!updater_test_drive(leases, count))
+		failed++;
+	msec[0] = updater_test_msec(&start);
+	spawns[0] = updater_test_count_spawns() - base;
+
+	if (builtin) {
+		/* the first lease controls the hostname, updt0 is the preferred resolver */
+		if (gethostname(hostname, sizeof(hostname)) < 0 || !ni_string_eq(hostname, "host0"))
+			failed++;
+		if (!updater_test_check_file(_PATH_RESOLV_CONF, "nameserver 10.0.0.1\n"))
+			failed++;
+	}
+
+	for (i = 0; i < count; ++i) {
+		leases[i]->state = NI_ADDRCONF_STATE_RELEASED;
+		ni_addrconf_updater_new_removing(leases[i], NULL, NI_EVENT_ADDRESS_RELEASED);
+	}
+
+	ni_timer_get_time(&start);
+	if (!updater_test_drive(leases, count))
+		failed++;
+	msec[1] = updater_test_msec(&start);
+	spawns[1] = updater_test_count_spawns() - spawns[0] - base;
+
+	if (builtin) {
+		if (!updater_test_check_file(_PATH_RESOLV_CONF, UPDATER_TEST_ORIGINAL))
+			failed++;
+		if (spawns[0] || spawns[1])
+			failed++;
+	} else {
+		/* one backup, restore per updater; install per lease, hostname remove unused */
+		if (spawns[0] != 2 * count + 2 || spawns[1] != count + 2)
+			failed++;
+	}
+
+	printf("%-8s %u leases, install: %4u spawns %6lu msec, remove: %4u spawns %6lu msec\n",
+			builtin ? "builtin" : "scripts", count,
+			spawns[0], msec[0], spawns[1], msec[1]);
+
+	for (i = 0; i < count; ++i)
+		ni_addrconf_lease_free(leases[i]);
+	free(leases);
+	return failed;
+}
+
+static ni_bool_t
+updater_test_setup(void)
+{
+	ni_stringbuf_t script = NI_STRINGBUF_INIT_DYNAMIC;
+	char *filename = NULL;
+	ni_bool_t ret = FALSE;
+
+	ni_string_printf(&filename, "%s/updater.sh", updater_test_dir);
+	ni_stringbuf_printf(&script, "#!/bin/sh\necho \"$@\" >> %s/spawns\n", updater_test_dir);
+	ret = updater_test_write(filename, script.string, 0755);
+	ni_stringbuf_destroy(&script);
+	if (!ret)
+		goto cleanup;
+
+	/* private /etc/resolv.conf and hostname */
+	ret = FALSE;
+	ni_string_printf(&filename, "%s/resolv.conf", updater_test_dir);
+	if (!updater_test_write(filename, UPDATER_TEST_ORIGINAL, 0644))
+		goto cleanup;
+	if (unshare(CLONE_NEWNS | CLONE_NEWUTS) < 0)
+		goto cleanup;
+	if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0)
+		goto cleanup;
+	if (mount(filename, _PATH_RESOLV_CONF, NULL, MS_BIND, NULL) < 0)
+		goto cleanup;
+	ret = TRUE;
+
+cleanup:
+	ni_string_free(&filename);
+	return ret;
+}
+
+/*
+ * Each mode runs in a child, as the updaters are initialized once.
+ */
+static int
+updater_test_fork(ni_bool_t builtin, unsigned int count, unsigned int window)
+{
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	if ((pid = fork()) < 0)
+		return 1;
+	if (pid == 0) {
+		status = updater_test_run(builtin, count, window);
+		fflush(stdout);
+		_exit(status);
+	}
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+		return 1;
+	return WEXITSTATUS(status);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = 100, window = 0;
+	int c, failed = 0;
+
+	if (ni_init("updater-test") < 0)
+		return -1;
+
+	while ((c = getopt(argc, argv, "n:w:")) != EOF) {
+		switch (c) {
+		case 'n':
+			if (ni_parse_uint(optarg, &count, 10) < 0 || !count || count > 0xffff)
+				return -1;
+			break;
+		case 'w':
+			if (ni_parse_uint(optarg, &window, 10) < 0)
+				return -1;
+			break;
+		default:
+			fprintf(stderr, "Usage: updater-test [-n leases] [-w batch-window msec]\n");
+			return -1;
+		}
+	}
+
+	if (!mkdtemp(updater_test_dir))
+		return -1;
+
+	if (getuid() != 0 || !updater_test_setup()) {
+		printf("updater-test: skipped, requires root\n");
+	} else {
+		failed += updater_test_fork(FALSE, count, window);
+		failed += updater_test_fork(TRUE, count, window);
+		printf("updater-test: %s\n", failed ? "FAILED" : "OK");
+	}
+
+	ni_file_remove_recursively(updater_test_dir);
+	return failed;
+}
@@ -8,6 +8,7 @@
 #endif
 
 #include <stdlib.h>
+#include <time.h>
 #include <getopt.h>
 #include <wicked/netinfo.h>
 #include <wicked/xpath.h>
@@ -16,20 +17,170 @@
 enum {
 	OPT_DEBUG,
 	OPT_REFERENCE,
+	OPT_BENCH,
 };
 
 static struct option	options[] = {
 	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
 	{ "reference",		required_argument,	NULL,	OPT_REFERENCE },
+	{ "bench",		required_argument,	NULL,	OPT_BENCH },
 
 	{ NULL }
 };
 
+/*
+ * Benchmark the expressions used by the schema document-node references
+ * and similar lookups per interface on a config with many interfaces.
+ * Each expression is paired with an equivalent one, which is not a
+ * simple path and evaluated by the generic code to verify the results.
+ */
+static const char *	bench_expressions[][2] = {
+	{ "/vlan",				"/vlan[true()]"				},
+	{ "/bridge",				"/bridge[true()]"			},
+	{ "ipv4:static",			"ipv4:static[true()]"			},
+	{ "link/master",			"link/master[true()]"			},
+	{ "/ipv4:static/address/local",		"/ipv4:static/address[true()]/local"	},
+	{ "control/mode",			"control[true()]/mode"			},
+	{ "/vlan/@tag",				"/vlan[true()]/@tag"			},
+	{ NULL }
+};
+
+static unsigned long
+bench_nsec(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000UL + now.tv_nsec - start->tv_nsec;
+}
+
+static xml_document_t *
+bench_document(unsigned int count)
+{
+	xml_node_t *root, *ifnode, *node;
+	xml_document_t *doc;
+	unsigned int i, n;
+	char buf[64];
+
+	doc = xml_document_new();
+	root = xml_document_root(doc);
+	for (i = 0; i < count; ++i) {
+		ifnode = xml_node_new("interface", root);
+		snprintf(buf, sizeof(buf), "eth%u", i);
+		xml_node_new_element("name", ifnode, buf);
+		if (i % 2) {
+			node = xml_node_new("vlan", ifnode);
+			xml_node_add_attr(node, "tag", "10");
+			xml_node_new_element("device", node, "eth0");
+			xml_node_new_element("tag", node, "10");
+		}
+		node = xml_node_new("control", ifnode);
+		xml_node_new_element("mode", node, "boot");
+		node = xml_node_new("link", ifnode);
+		xml_node_new_element("master", node, "br0");
+		node = xml_node_new("ipv4:static", ifnode);
+		for (n = 0; n < 4; ++n) {
+			snprintf(buf, sizeof(buf), "10.%u.%u.%u/24", n, (i >> 8) & 0xff, i & 0xff);
+			xml_node_new_element("local", xml_node_new("address", node), buf);
+		}
+		xml_node_new("ipv6:static", ifnode);
+	}
+	return doc;
+}
+
+static ni_bool_t
+bench_result_eq(const xpath_result_t *a, const xpath_result_t *b)
+{
+	unsigned int n;
+
+	if (!a || !b || a->type != b->type || a->count != b->count)
+		return FALSE;
+	for (n = 0; n < a->count; ++n) {
+		if (a->type == XPATH_ELEMENT && a->node[n].value.node != b->node[n].value.node)
+			return FALSE;
+		if (a->type == XPATH_STRING && !ni_string_eq(a->node[n].value.string,
+							     b->node[n].value.string))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+bench(unsigned int count)
+{
+	const xpath_enode_t *enode, *generic;
+	xpath_result_t *result, *expect;
+	unsigned long nsec[3] = { 0, 0, 0 };
+	unsigned int e, evals = 0, failed = 0;
+	struct timespec start;
+	xml_document_t *doc;
+	xml_node_t *ifnode;
+	xpath_enode_t *parsed;
+
+	doc = bench_document(count);
+
+	/* parse and evaluate per use, as the callers did before the cache */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (ifnode = doc->root->children; ifnode; ifnode = ifnode->next) {
+		for (e = 0; bench_expressions[e][0]; ++e) {
+			parsed = xpath_expression_parse(bench_expressions[e][0]);
+			xpath_result_free(xpath_expression_eval(parsed, ifnode));
+			xpath_expression_free(parsed);
+			evals++;
+		}
+	}
+	nsec[0] = bench_nsec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (ifnode = doc->root->children; ifnode; ifnode = ifnode->next) {
+		for (e = 0; bench_expressions[e][0]; ++e) {
+			enode = xpath_expression_parse_cached(bench_expressions[e][0]);
+			xpath_result_free(xpath_expression_eval(enode, ifnode));
+		}
+	}
+	nsec[1] = bench_nsec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (ifnode = doc->root->children; ifnode; ifnode = ifnode->next) {
+		for (e = 0; bench_expressions[e][0]; ++e) {
+			enode = xpath_expression_parse_cached(bench_expressions[e][1]);
+			xpath_result_free(xpath_expression_eval(enode, ifnode));
+		}
+	}
+	nsec[2] = bench_nsec(&start);
+
+	for (ifnode = doc->root->children; ifnode; ifnode = ifnode->next) {
+		for (e = 0; bench_expressions[e][0]; ++e) {
+			enode = xpath_expression_parse_cached(bench_expressions[e][0]);
+			generic = xpath_expression_parse_cached(bench_expressions[e][1]);
+			result = xpath_expression_eval(enode, ifnode);
+			expect = xpath_expression_eval(generic, ifnode);
+			if (!bench_result_eq(result, expect)) {
+				fprintf(stderr, "%s: result differs from %s\n",
+						bench_expressions[e][0], bench_expressions[e][1]);
+				failed++;
+			}
+			xpath_result_free(result);
+			xpath_result_free(expect);
+		}
+	}
+
+	printf("%u interfaces, %u evaluations\n", count, evals);
+	printf("parse and eval per use: %6lu nsec/op\n", nsec[0] / evals);
+	printf("cached simple path:     %6lu nsec/op\n", nsec[1] / evals);
+	printf("cached generic [true]:  %6lu nsec/op\n", nsec[2] / evals);
+
+	xpath_expression_cache_flush();
+	xml_document_free(doc);
+	printf("xpath-test: %s\n", failed ? "FAILED" : "OK");
+	return failed;
+}
 
 int
 main(int argc, char **argv)
 {
 	const char *opt_reference = NULL;
+	unsigned int opt_bench = 0;
 	const char *expression = NULL, *filename = "-";
 	xml_document_t *doc;
 	xml_node_t *refnode;
@@ -43,6 +194,7 @@ main(int argc, char **argv)
 		usage:
 			fprintf(stderr,
 				"./xpath-test [--reference <expression>] <expression> [filename]\n"
+				"./xpath-test --bench <interfaces>\n"
 			       );
 			return 1;
 
@@ -57,9 +209,17 @@ main(int argc, char **argv)
 			opt_reference = optarg;
 			break;
 
+		case OPT_BENCH:
+			if (ni_parse_uint(optarg, &opt_bench, 10) < 0 || !opt_bench)
+				goto usage;
+			break;
+
 		}
 	}
 
+	if (opt_bench)
+		return bench(opt_bench);
+
 	if (optind >= argc)
 		goto usage;
 	expression = argv[optind++];